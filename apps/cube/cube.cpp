@@ -112,6 +112,7 @@ int main()
     while (1){
         demo.rotateCube();
         demo.drawCube();
+        demo.flush();
         sleep(200);
 
         gfx_get_event(&e, GFX_EVENT_NONBLOCKING);
@@ -23,6 +23,19 @@ public:
 	Window(int width, int height, const char* name, int flags) {
 		gfx_create_window(width, height, flags);
 		gfx_set_title(name);
+
+		/* Draw calls are sent to the kernel in batches, submitted by gfx_get_event() */
+		gfx_batch_begin();
+	}
+
+	~Window() {
+		gfx_batch_end();
+	}
+
+	/* Sends batched draw calls now, for windows that draw without waiting for events */
+	void flush()
+	{
+		gfx_batch_submit();
 	}
 
     void drawRect(int x, int y, int width, int height, unsigned char color)
@@ -13,6 +13,7 @@
 #include "cppUtils.hpp"
 #include <lib/syscall.h>
 
+/* new/delete use the libcore allocator, small objects never trap into the kernel. */
 void *operator new(size_t size)
 {
     return malloc(size);
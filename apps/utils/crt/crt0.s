@@ -14,6 +14,8 @@ call_main:
     pushl %ecx
     pushl %ebx
     call main
+    /* Report the allocations of the process before it exits */
+    call malloc_dump_stats
 
 end_thread:
     /* Exit syscall or cleanup */
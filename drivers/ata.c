@@ -1,8 +1,13 @@
 /**
  * @file ata.c
  * @author Joe Bayer (joexbayer)
- * @brief ATA driver for non volatile storage. Using PIO for simplicity.
+ * @brief ATA driver for non volatile storage.
+ * Transfers use PCI bus master DMA when the controller supports it, completion
+ * is signaled by the IDE interrupt. Otherwise READ/WRITE MULTIPLE PIO is used.
+ * Requests are issued as a single command for many sectors, with 48 bit LBA
+ * when the request does not fit in 28 bits.
  * @see https://wiki.osdev.org/PCI_IDE_Controller
+ * @see https://wiki.osdev.org/ATA/ATAPI_using_DMA
  * @version 0.1
  * @date 2022-06-24
  * 
@@ -16,6 +21,9 @@
 #include <arch/io.h>
 #include <diskdev.h>
 #include <libc.h>
+#include <sync.h>
+#include <scheduler.h>
+#include <timer.h>
 
 #include <kutils.h>
 
@@ -24,12 +32,52 @@
 static uint8_t* ata_driver_data;
 struct ide_device ata_ide_device;
 
+/* Ticks to wait for a DMA completion interrupt before polling the controller */
+#define ATA_DMA_TIMEOUT 1000
+
+static struct ata_channel {
+	uint16_t io;
+	uint16_t ctrl;
+	uint16_t bmr;   /* Bus master registers, 0 if DMA is unavailable */
+
+	struct ata_prd* prdt;
+	byte_t* dma_buffer;
+
+	volatile uint8_t irq;
+	wait_queue_t wq;
+	mutex_t lock;
+
+	struct ata_info info;
+} ata_primary_channel = {
+	.io = ATA_PRIMARY_IO,
+	.ctrl = ATA_PRIMARY_DCR_AS,
+	.bmr = 0
+};
+
 void __int_handler ata_primary()
 {
+	struct ata_channel* ch = &ata_primary_channel;
+
+	/* Reading the status register acknowledges the device interrupt. */
+	inportb(ch->io + ATA_REG_STATUS);
+	if(ch->bmr){
+		uint8_t status = inportb(ch->bmr + ATA_BMR_STATUS);
+		if(!(status & ATA_BMR_SR_IRQ)){
+			return;
+		}
+		outportb(ch->bmr + ATA_BMR_STATUS, status | ATA_BMR_SR_IRQ);
+	}
+
+	ch->irq = 1;
+	ch->info.interrupts++;
+	if(ch->wq.waiters != NULL){
+		wake_up_all(&ch->wq);
+	}
 }
 
 void __int_handler ata_secondary()
 {
+	inportb(ATA_SECONDARY_IO + ATA_REG_STATUS);
 }
 
 static void __ide_set_drive(uint8_t bus, uint8_t i)
@@ -53,23 +101,23 @@ static int ata_status_wait(int io_base, int timeout) {
 	return status;
 }
 
-static void ata_io_wait(int io_base) {
-	inportb(io_base + ATA_REG_ALTSTATUS);
-	inportb(io_base + ATA_REG_ALTSTATUS);
-	inportb(io_base + ATA_REG_ALTSTATUS);
-	inportb(io_base + ATA_REG_ALTSTATUS);
+static void ata_io_wait(struct ata_channel* ch) {
+	inportb(ch->ctrl);
+	inportb(ch->ctrl);
+	inportb(ch->ctrl);
+	inportb(ch->ctrl);
 }
 
-static int ata_wait(int io, int adv)
+static int ata_wait(struct ata_channel* ch, int adv)
 {
     uint8_t status = 0;
 
-    ata_io_wait(io);
+    ata_io_wait(ch);
 
-    status = ata_status_wait(io, -1);
+    status = ata_status_wait(ch->io, -1);
 
     if (adv) {
-        status = inportb(io + ATA_REG_STATUS);
+        status = inportb(ch->io + ATA_REG_STATUS);
         if (status & ATA_SR_ERR) return 1;
         if (status & ATA_SR_DF)  return 1;
         if (!(status & ATA_SR_DRQ)) return 1;
@@ -78,117 +126,311 @@ static int ata_wait(int io, int adv)
     return 0;
 }
 
-static int __ata_read_sector(char *buf, int lba)
+/* Only sleep for completions once threads are running and interrupts are enabled. */
+static inline int __ata_can_sleep()
 {
-    uint16_t io = ATA_PRIMARY_IO;
+	return get_scheduler()->ctx.running != NULL && __cli_cnt == 0;
+}
 
-    uint8_t cmd = 0xE0;
-    int errors = 0;
+static inline int __ata_use_lba48(uint32_t lba, uint32_t count)
+{
+	return ata_primary_channel.info.lba48 && (lba + count - 1 > ATA_LBA28_MAX || count > 256);
+}
 
-__ata_read_sector_try_again:
-    outportb(io + ATA_REG_CONTROL, 0x02);
+/**
+ * @brief Selects the master drive and programs LBA and sector count.
+ * 48 bit LBA writes the high order bytes first, each register is a two byte FIFO.
+ */
+static void __ata_setup(struct ata_channel* ch, uint32_t lba, uint32_t count, int lba48)
+{
+	ata_wait(ch, 0);
 
-    ata_wait(io, 0);
+	if(lba48){
+		outportb(ch->io + ATA_REG_HDDEVSEL, 0x40);
+		ata_io_wait(ch);
 
-    outportb(io + ATA_REG_HDDEVSEL, (cmd | (uint8_t)((lba >> 24 & 0x0F))));
-    outportb(io + ATA_REG_FEATURES, 0x00);
-    outportb(io + ATA_REG_SECCOUNT0, 1);
-    outportb(io + ATA_REG_LBA0, (uint8_t)(lba));
-    outportb(io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
-    outportb(io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
-    outportb(io + ATA_REG_COMMAND, ATA_CMD_READ_PIO);
+		outportb(ch->io + ATA_REG_SECCOUNT0, (uint8_t)(count >> 8));
+		outportb(ch->io + ATA_REG_LBA0, (uint8_t)(lba >> 24));
+		outportb(ch->io + ATA_REG_LBA1, 0);
+		outportb(ch->io + ATA_REG_LBA2, 0);
+	} else {
+		outportb(ch->io + ATA_REG_HDDEVSEL, 0xE0 | (uint8_t)((lba >> 24) & 0x0F));
+		ata_io_wait(ch);
+	}
 
-    if (ata_wait(io, 1)) {
-        errors ++;
-        if (errors > 4)
-            return -1;
+	outportb(ch->io + ATA_REG_FEATURES, 0x00);
+	outportb(ch->io + ATA_REG_SECCOUNT0, (uint8_t)count);
+	outportb(ch->io + ATA_REG_LBA0, (uint8_t)(lba));
+	outportb(ch->io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
+	outportb(ch->io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
+}
 
-        goto __ata_read_sector_try_again;
-    }
+static void __ata_flush(struct ata_channel* ch, int lba48)
+{
+	outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_CACHE_FLUSH_EXT : ATA_CMD_CACHE_FLUSH);
+	ata_wait(ch, 0);
+}
 
-    for (int i = 0; i < 256; i++) {
-        uint16_t d = inportw(io + ATA_REG_DATA);
-        *(uint16_t *)(buf + i * 2) = d;
-    }
+/**
+ * @brief Builds the PRD table for the DMA bounce buffer.
+ * Entries are split so none of them crosses a 64KB boundary.
+ */
+static void __ata_dma_prepare(struct ata_channel* ch, uint32_t size)
+{
+	uint32_t addr = (uint32_t) ch->dma_buffer;
+	int i = 0;
 
-    ata_wait(io, 0);
-    return 0;
+	while(size > 0 && i < ATA_PRD_ENTRIES){
+		uint32_t boundary = (addr & ~0xFFFF) + 0x10000;
+		uint32_t chunk = boundary - addr < size ? boundary - addr : size;
+
+		ch->prdt[i].address = addr;
+		ch->prdt[i].size = (uint16_t) chunk;
+		ch->prdt[i].flags = 0;
+
+		addr += chunk;
+		size -= chunk;
+		i++;
+	}
+	ch->prdt[i-1].flags = ATA_PRD_EOT;
 }
 
-static int __ata_write_sector(uint16_t *buf, int lba)
+/**
+ * @brief Runs a single DMA command for count sectors through the bounce buffer.
+ * The caller sleeps until the completion interrupt, before the scheduler is
+ * running the bus master status register is polled instead.
+ */
+static int __ata_dma(struct ata_channel* ch, uint32_t lba, uint32_t count, int write)
 {
-    uint16_t io = ATA_PRIMARY_IO;
+	int lba48 = __ata_use_lba48(lba, count);
 
-    uint8_t cmd = 0xE0;
+	__ata_dma_prepare(ch, count * 512);
 
-    outportb(io + ATA_REG_CONTROL, 0x02);
+	outportb(ch->bmr + ATA_BMR_COMMAND, 0);
+	outportl(ch->bmr + ATA_BMR_PRDT, (uint32_t) ch->prdt);
+	outportb(ch->bmr + ATA_BMR_STATUS, inportb(ch->bmr + ATA_BMR_STATUS) | ATA_BMR_SR_IRQ | ATA_BMR_SR_ERR);
 
-    ata_wait(io, 0);
+	ch->irq = 0;
+	__ata_setup(ch, lba, count, lba48);
 
-    outportb(io + ATA_REG_HDDEVSEL, (cmd | (uint8_t)((lba >> 24 & 0x0F))));
-    ata_wait(io, 0);
-    outportb(io + ATA_REG_FEATURES, 0x00);
-    outportb(io + ATA_REG_SECCOUNT0, 1);
-    outportb(io + ATA_REG_LBA0, (uint8_t)(lba));
-    outportb(io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
-    outportb(io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
-    outportb(io + ATA_REG_COMMAND, ATA_CMD_WRITE_PIO);
-    ata_wait(io, 0);
+	if(write){
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_WRITE_DMA);
+		outportb(ch->bmr + ATA_BMR_COMMAND, ATA_BMR_CMD_START);
+	} else {
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_READ_DMA_EXT : ATA_CMD_READ_DMA);
+		outportb(ch->bmr + ATA_BMR_COMMAND, ATA_BMR_CMD_READ | ATA_BMR_CMD_START);
+	}
 
-    for (int i = 0; i < 256; i++) {
-        outportw(io + ATA_REG_DATA, buf[i]);
-        asm volatile("nop; nop; nop");
-    }
-    outportb(io + 0x07, ATA_CMD_CACHE_FLUSH);
+	if(__ata_can_sleep()){
+		wait_event_timeout(&ch->wq, ch->irq, ATA_DMA_TIMEOUT);
+	}
 
-    ata_wait(io, 0);
+	/* The interrupt might be masked, or the handler already cleared the status. */
+	uint8_t bm_status;
+	while(!ch->irq){
+		bm_status = inportb(ch->bmr + ATA_BMR_STATUS);
+		if(bm_status & (ATA_BMR_SR_IRQ | ATA_BMR_SR_ERR)) break;
+	}
 
-    return 0;
+	outportb(ch->bmr + ATA_BMR_COMMAND, 0);
+	bm_status = inportb(ch->bmr + ATA_BMR_STATUS);
+	outportb(ch->bmr + ATA_BMR_STATUS, bm_status | ATA_BMR_SR_IRQ | ATA_BMR_SR_ERR);
+
+	uint8_t status = ata_status_wait(ch->io, -1);
+	if((bm_status & ATA_BMR_SR_ERR) || (status & (ATA_SR_ERR | ATA_SR_DF))){
+		ch->info.errors++;
+		return -1;
+	}
+
+	if(write){
+		__ata_flush(ch, lba48);
+	}
+
+	ch->info.commands++;
+	ch->info.sectors += count;
+
+	return count;
+}
+
+/**
+ * @brief Reads count sectors with a single PIO command.
+ * With READ MULTIPLE the device only waits for DRQ once per block of sectors.
+ */
+static int __ata_pio_read(struct ata_channel* ch, char* buf, uint32_t lba, uint32_t count)
+{
+	int lba48 = __ata_use_lba48(lba, count);
+	int block = ch->info.multiple ? ch->info.multiple : 1;
+
+	__ata_setup(ch, lba, count, lba48);
+	if(ch->info.multiple){
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_READ_MULTIPLE_EXT : ATA_CMD_READ_MULTIPLE);
+	} else {
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_READ_PIO_EXT : ATA_CMD_READ_PIO);
+	}
+
+	for (uint32_t done = 0; done < count; done += block){
+		if(ata_wait(ch, 1)){
+			ch->info.errors++;
+			return -1;
+		}
+
+		int sectors = count - done < (uint32_t)block ? (int)(count - done) : block;
+		insw(ch->io + ATA_REG_DATA, buf + done * 512, sectors * 256);
+	}
+
+	ch->info.commands++;
+	ch->info.sectors += count;
+
+	return count;
+}
+
+static int __ata_pio_write(struct ata_channel* ch, char* buf, uint32_t lba, uint32_t count)
+{
+	int lba48 = __ata_use_lba48(lba, count);
+	int block = ch->info.multiple ? ch->info.multiple : 1;
+
+	__ata_setup(ch, lba, count, lba48);
+	if(ch->info.multiple){
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_WRITE_MULTIPLE_EXT : ATA_CMD_WRITE_MULTIPLE);
+	} else {
+		outportb(ch->io + ATA_REG_COMMAND, lba48 ? ATA_CMD_WRITE_PIO_EXT : ATA_CMD_WRITE_PIO);
+	}
+
+	for (uint32_t done = 0; done < count; done += block){
+		if(ata_wait(ch, 1)){
+			ch->info.errors++;
+			return -1;
+		}
+
+		int sectors = count - done < (uint32_t)block ? (int)(count - done) : block;
+		outsw(ch->io + ATA_REG_DATA, buf + done * 512, sectors * 256);
+	}
+	ata_wait(ch, 0);
+
+	/* One flush for the whole request */
+	__ata_flush(ch, lba48);
+
+	ch->info.commands++;
+	ch->info.sectors += count;
+
+	return count;
+}
+
+/* Largest number of sectors a single command can transfer */
+static inline uint32_t __ata_max_sectors(struct ata_channel* ch)
+{
+	if(ch->bmr) return ATA_DMA_MAX_SECTORS;
+	return ch->info.lba48 ? 65536 : 256;
 }
 
 int ata_write(char *buf, uint32_t from, uint32_t count)
 {
-    unsigned long pos = from;
+	struct ata_channel* ch = &ata_primary_channel;
+	uint32_t done = 0;
+
+	acquire(&ch->lock);
+	while(done < count){
+		uint32_t n = count - done < __ata_max_sectors(ch) ? count - done : __ata_max_sectors(ch);
+
+		int ret;
+		if(ch->bmr){
+			memcpy(ch->dma_buffer, buf + done * 512, n * 512);
+			ret = __ata_dma(ch, from + done, n, 1);
+		} else {
+			ret = __ata_pio_write(ch, buf + done * 512, from + done, n);
+		}
 
-    ENTER_CRITICAL();
+		if(ret < 0){
+			release(&ch->lock);
+			return -1;
+		}
+		done += n;
+	}
+	release(&ch->lock);
 
-    for (uint32_t i = 0; i < count; i++)
-    {
-        __ata_write_sector((uint16_t*) buf, pos + i);
-        buf += 512;
-        for (int j = 0; j < 1000; j ++)
-            ;
-    }
-    
-    LEAVE_CRITICAL();
-    return count;
+	return count;
 }
 
 int ata_read(char *buf, uint32_t from, uint32_t numsects)
 {
-	unsigned long pos = from;
-    int rc = 0;
+	struct ata_channel* ch = &ata_primary_channel;
+	uint32_t done = 0;
+
+	acquire(&ch->lock);
+	while(done < numsects){
+		uint32_t n = numsects - done < __ata_max_sectors(ch) ? numsects - done : __ata_max_sectors(ch);
+
+		int ret;
+		if(ch->bmr){
+			ret = __ata_dma(ch, from + done, n, 0);
+			if(ret > 0){
+				memcpy(buf + done * 512, ch->dma_buffer, n * 512);
+			}
+		} else {
+			ret = __ata_pio_read(ch, buf + done * 512, from + done, n);
+		}
+
+		if(ret < 0){
+			release(&ch->lock);
+			return -1;
+		}
+		done += n;
+	}
+	release(&ch->lock);
+
+	return numsects;
+}
+
+int ata_get_info(struct ata_info* info)
+{
+	ERR_ON_NULL(info);
 
-    ENTER_CRITICAL();
+	*info = ata_primary_channel.info;
+	return 0;
+}
 
-    for (uint32_t i = 0; i < numsects; i++)
-    {
-        rc = __ata_read_sector((char*) buf, pos + i);
-        if (rc == -1){
-            LEAVE_CRITICAL();
-            return -1;
-        }
-        buf += 512;
-    }
+/**
+ * @brief Sets up bus master DMA using BAR4 of the IDE controller.
+ * The PRD table and bounce buffer come from permanent memory, which is identity mapped.
+ */
+static int __ata_dma_init(struct ata_channel* ch, struct pci_device* dev)
+{
+	if(dev == NULL){
+		return -1;
+	}
 
-    LEAVE_CRITICAL();
-    return rc;
+	uint16_t bar4 = pci_read_word(dev->bus, dev->slot, dev->function, ATA_PCI_BAR4);
+	if(!(bar4 & 0x1) || (bar4 & 0xFFFC) == 0){
+		return -1;
+	}
+
+	/* The PRD table must be 4 byte aligned and not cross a 64KB boundary. */
+	int prdt_size = sizeof(struct ata_prd) * ATA_PRD_ENTRIES;
+	byte_t* prdt = palloc(prdt_size * 2);
+	ch->dma_buffer = palloc(ATA_DMA_MAX_SECTORS * 512);
+	if(prdt == NULL || ch->dma_buffer == NULL){
+		return -1;
+	}
+
+	if((((uint32_t)prdt) & ~0xFFFF) != (((uint32_t)prdt + prdt_size - 1) & ~0xFFFF)){
+		prdt += prdt_size;
+	}
+	ch->prdt = (struct ata_prd*) prdt;
+
+	pci_enable_device_busmaster(dev->bus, dev->slot, dev->function);
+	ch->bmr = bar4 & 0xFFFC;
+	ch->info.dma = 1;
+
+	return 0;
 }
 
 void ata_ide_init(struct pci_device* dev)
 {
-	interrupt_install_handler(ATA_PRIMARY_IRQ, &ata_primary);
-	interrupt_install_handler(ATA_SECONDARY_IRQ, &ata_secondary);
+	struct ata_channel* ch = &ata_primary_channel;
+
+	interrupt_install_handler(32+ATA_PRIMARY_IRQ, &ata_primary);
+	interrupt_install_handler(32+ATA_SECONDARY_IRQ, &ata_secondary);
+	mutex_init(&ch->lock);
 
 	ata_driver_data = kalloc(512);
     if(ata_driver_data == NULL){
@@ -244,7 +486,28 @@ void ata_ide_init(struct pci_device* dev)
          else
             // Device uses CHS or 28-bit Addressing:
             ata_ide_device.size   = *((unsigned int *)(ata_driver_data + ATA_IDENT_MAX_LBA));
-        
+
+		ch->info.lba48 = (ata_ide_device.commandSets & (1 << 26)) ? 1 : 0;
+		ata_ide_device.capabilities = *((unsigned short *)(ata_driver_data + ATA_IDENT_CAPABILITIES));
+
+		/* Use the largest READ/WRITE MULTIPLE block the drive supports */
+		uint8_t multiple = ata_driver_data[ATA_IDENT_MAX_MULTIPLE];
+		if(multiple > 0){
+			outportb(io + ATA_REG_SECCOUNT0, multiple);
+			outportb(io + ATA_REG_COMMAND, ATA_CMD_SET_MULTIPLE);
+			if(!(ata_status_wait(io, -1) & ATA_SR_ERR)){
+				ch->info.multiple = multiple;
+			}
+		}
+
+		if((ata_ide_device.capabilities & (1 << 8)) && __ata_dma_init(ch, dev) == 0){
+			wait_queue_init(&ch->wq);
+		}
+
+		/* Enable device interrupts, they signal DMA completion */
+		outportb(ch->ctrl, 0);
+
+		dbgprintf("[ATA]: %s, multiple %d, lba48 %d, dma %d\n", ata_ide_device.model, ch->info.multiple, ch->info.lba48, ch->info.dma);
 
         attach_disk_dev(&ata_read, &ata_write, &ata_ide_device);
 	}
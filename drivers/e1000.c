@@ -17,25 +17,40 @@
 #include <serial.h>
 #include <kutils.h>
 #include <timer.h>
+#include <net/skb.h>
 
 #define PACKET_SIZE   2048
-#define TX_SIZE 16
-#define RX_SIZE 16
+#define TX_SIZE E1000_TX_RING_SIZE
+#define RX_SIZE E1000_RX_RING_SIZE
 #define TX_BUFF_SIZE (sizeof(struct e1000_tx_desc) * TX_SIZE)
 #define RX_BUFF_SIZE (sizeof(struct e1000_rx_desc) * RX_SIZE)
 
+#define E1000_RX_INTERRUPTS (E1000_IMS_RXT0 | E1000_IMS_RXDMT0 | E1000_IMS_RXO)
+
+/* The RX tail is handed back to the card after this many refilled descriptors */
+#define RX_REFILL_BATCH 32
+
 static volatile uint32_t *e1000;
 #define E1000_DEVICE_SET(offset) (e1000[offset >> 2])
 #define E1000_DEVICE_GET(offset) E1000_DEVICE_SET(offset)
 
 uint8_t mac[6] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56};
 
-/* Allocate space for transmit and recieve buffers. */
-static struct e1000_tx_desc tx_desc_list[TX_SIZE];
-static char* tx_buf[TX_SIZE];
+/**
+ * Descriptor rings, the card requires them to be 16 byte aligned.
+ * RX descriptors point at packet buffers from the skb buffer pool, which are
+ * handed to the network stack as is and replaced by a fresh buffer.
+ * TX descriptors point straight at the data of the skb being sent, the skb
+ * is kept until the card reports the descriptor done.
+ */
+static struct e1000_tx_desc tx_desc_list[TX_SIZE] __attribute__((aligned(16)));
+static struct sk_buff* tx_skb[TX_SIZE];
+static int tx_tail = 0;		/* next descriptor to fill */
+static int tx_clean = 0;	/* oldest descriptor not yet reclaimed */
 
-static struct e1000_rx_desc rx_desc_list[RX_SIZE];
-static char* rx_buf[RX_SIZE];
+static struct e1000_rx_desc rx_desc_list[RX_SIZE] __attribute__((aligned(16)));
+static uint8_t* rx_buf[RX_SIZE];
+static int rx_next = 0;
 
 static int interrupts = 0;
 
@@ -49,11 +64,12 @@ static void _e1000_reset_tx_desc()
 	memset(tx_desc_list, 0, TX_BUFF_SIZE);
     for (int i = 0; i < TX_SIZE; i++)
     { 
-		/* Initialize transmit buffers  */
-		tx_desc_list[i].buffer_addr = (uint32_t)tx_buf[i];
+		/* Descriptors are filled in when a skb is sent */
 		tx_desc_list[i].status  = E1000_TXD_STAT_DD;
-		tx_desc_list[i].cmd = (E1000_TXD_CMD_RS >> 24) | (E1000_TXD_CMD_EOP >> 24);
+		tx_skb[i] = NULL;
     }
+	tx_tail = 0;
+	tx_clean = 0;
 }
 /**
  * @brief Clears the recieve buffers for the e1000
@@ -66,6 +82,7 @@ static void _e1000_reset_rx_desc()
 		/* Initialize recv buffers  */
 		rx_desc_list[i].buffer_addr = (uint32_t)rx_buf[i];
     }
+	rx_next = 0;
 }
 /**
  * @brief Reads in the debug_mac into correct registers.
@@ -138,40 +155,115 @@ void _e1000_rx_init()
 	E1000_DEVICE_SET(E1000_RCTL) = E1000_RCTL_EN | E1000_RCTL_SECRC     |    E1000_RCTL_BAM    |     E1000_RCTL_SZ_2048;;	
 }
 
-static int next = 0;
-int e1000_receive(char* buffer, uint32_t size)
+/**
+ * @brief Hands the next received frame to the network stack without copying it.
+ * The filled buffer becomes the skb data and the descriptor gets a fresh buffer.
+ * If no fresh buffer or skb is available the frame is dropped and the buffer reused.
+ * @return int 1 if a descriptor was consumed, 0 if the ring is empty.
+ */
+static int e1000_receive_one()
 {
-	//int tail = E1000_DEVICE_GET(E1000_RDT);
-	if(!(rx_desc_list[next].status & E1000_RXD_STAT_DD)) /* Descriptor Done */
-	{
-		warningf("[e1000 RX] RXD_STAT_DD not set!\n");
-		return -1;
+	struct e1000_rx_desc* desc = &rx_desc_list[rx_next];
+	if(!(desc->status & E1000_RXD_STAT_DD)){
+		return 0;
 	}
 
-	uint32_t length = rx_desc_list[next].length;
-	if(length >= PACKET_SIZE || length > size)
-	{
+	uint32_t length = desc->length;
+	uint8_t* fresh = NULL;
+	struct sk_buff* skb = NULL;
+
+	/* Frames spanning several descriptors can not happen with 2048 byte buffers and no jumbo frames */
+	if(length == 0 || length > SKB_DATA_SIZE || !(desc->status & E1000_RXD_STAT_EOP)){
 		warningf("[e1000 RX] Dropping packet with length %d\n", length);
-		length = -1;
 		goto drop;
 	}
 
-	//dbgprintf("[e1000 - %d] Received %d bytes %d!\n",timer_get_tick(), length, __cli_cnt);
+	fresh = skb_alloc_data_atomic();
+	if(fresh == NULL){
+		goto drop;
+	}
+
+	skb = skb_new_from_data(rx_buf[rx_next], length);
+	if(skb == NULL){
+		skb_free_data(fresh);
+		goto drop;
+	}
 
-	memcpy(buffer, rx_buf[next], length);
+	rx_buf[rx_next] = fresh;
+	desc->buffer_addr = (uint32_t)fresh;
+	net_incoming_skb(&e1000_netdev, skb);
+	goto done;
 
 drop:
-	rx_desc_list[next].status = 0;
-	next = (next + 1) % RX_SIZE;
-	E1000_DEVICE_SET(E1000_RDT) = (next + RX_SIZE - 1) % RX_SIZE;
+	e1000_netdev.dropped++;
+done:
+	desc->status = 0;
+	rx_next = (rx_next + 1) % RX_SIZE;
+	return 1;
+}
 
-	//dbgprintf("[e1000] received %d bytes! (tail: %d) (\n", length, next);
-	return length;
+/* Frees skbs the card is done sending */
+static void __e1000_tx_reclaim()
+{
+	while(tx_clean != tx_tail && (tx_desc_list[tx_clean].status & E1000_TXD_STAT_DD)){
+		skb_free(tx_skb[tx_clean]);
+		tx_skb[tx_clean] = NULL;
+		tx_clean = (tx_clean + 1) % TX_SIZE;
+	}
 }
 
 /**
- * @brief Put data into correct transmit buffer for e1000
- * card to transmit. Updates tail pointer.
+ * @brief Queues a skb for transmission, the descriptor points at the skb data.
+ * The skb is owned by the driver from here and freed once the card is done with it.
+ * @param skb skb holding the full ethernet frame
+ * @return int32_t size of data, returns -1 on error.
+ */
+static int32_t e1000_transmit_skb(struct sk_buff* skb)
+{
+	int size = skb->len;
+	if(size <= 0 || size >= PACKET_SIZE){
+		warningf("[e1000] Size %d is invalid!\n", size);
+		skb_free(skb);
+		return -1;
+	}
+
+	ENTER_CRITICAL();
+	__e1000_tx_reclaim();
+
+	/* Keep one descriptor free, head == tail means empty to the card */
+	if((tx_tail + 1) % TX_SIZE == tx_clean){
+		LEAVE_CRITICAL();
+		warningf("[e1000] TX ring is full!\n");
+		e1000_netdev.dropped++;
+		skb_free(skb);
+		return -1;
+	}
+
+	struct e1000_tx_desc* txdesc = &tx_desc_list[tx_tail];
+	txdesc->buffer_addr = (uint32_t)skb->data;
+	txdesc->length = size;
+	txdesc->cmd = (E1000_TXD_CMD_RS | E1000_TXD_CMD_EOP) >> 24;
+	txdesc->status = 0;
+	tx_skb[tx_tail] = skb;
+
+	tx_tail = (tx_tail + 1) % TX_SIZE;
+	E1000_DEVICE_SET(E1000_TDT) = tx_tail;
+	LEAVE_CRITICAL();
+
+	return size;
+}
+
+/**
+ * @brief Receive is interrupt driven, frames are handed over as skbs.
+ * Kept for the netdev read interface, which copies, and never has data.
+ */
+int e1000_receive(char* buffer, uint32_t size)
+{
+	return -1;
+}
+
+/**
+ * @brief Copying transmit for callers without a skb.
  * 
  * @param buffer data to transmit
  * @param size of data to transmit
@@ -179,51 +271,60 @@ drop:
  */
 int e1000_transmit(char* buffer, uint32_t size)
 {
-	if(size >= PACKET_SIZE){
+	if(size >= SKB_DATA_SIZE){
 		warningf("[e1000] Size %d is too large!\n", size);
 		return -1;
 	}
 
-	char* ptr = (char*) buffer;
-	uint16_t tail = E1000_DEVICE_GET(E1000_TDT);
-
-	struct e1000_tx_desc* txdesc = &tx_desc_list[tail];
-	if(!(txdesc->status & E1000_TXD_STAT_DD)){
-		warningf("[e1000] DD status is not done!\n");
+	struct sk_buff* skb = skb_new();
+	if(skb == NULL){
 		return -1;
-	} /* Check if status is DD (Descriptor Done) */
-
-	memcpy(tx_buf[tail], ptr, size);
-	txdesc->length = size;
-	txdesc->status &= ~E1000_TXD_STAT_DD;
-	txdesc->cmd |= E1000_TXD_CMD_EOP;
-
-	E1000_DEVICE_SET(E1000_TDT) = (tail+1) % TX_SIZE;
+	}
+	memcpy(skb_put(skb, size), buffer, size);
 
-	//dbgprintf("[e1000 - %d] Sending %d bytes! (tail: %d) %d\n", timer_get_tick(), size, (tail + 1) % TX_SIZE, __cli_cnt);
-	return size;
+	return e1000_transmit_skb(skb);
 }
 
+/**
+ * @brief RX interrupts are masked and the ring is left to netd to poll,
+ * so a burst of frames costs a single interrupt.
+ */
 void __int_handler e1000_callback()
 {
 	uint32_t icr = E1000_DEVICE_GET(E1000_ICR);
-	if (icr & E1000_IMS_RXDW) {
-		net_incoming_packet(&e1000_netdev);
+	if (icr & E1000_RX_INTERRUPTS) {
+		E1000_DEVICE_SET(E1000_IMC) = E1000_RX_INTERRUPTS;
+		net_schedule_poll(&e1000_netdev);
 	}
 
 	interrupts++;
 }
 
-static int32_t e1000_poll()
+/**
+ * @brief Hands up to budget received frames to the network stack.
+ * The tail is written back in batches instead of once per frame.
+ * Once the ring is drained RX interrupts are enabled again.
+ * @return int32_t number of descriptors handled.
+ */
+static int32_t e1000_poll(int budget)
 {
-	dbgprintf("[e1000 - %d] Polling!\n", timer_get_tick());
-	/* Polling for RX interrupts */
-	if(E1000_DEVICE_GET(E1000_ICR) & E1000_IMS_RXDW)
-	{
-		E1000_DEVICE_GET(E1000_ICR);
+	int handled = 0;
+	while(handled < budget && e1000_receive_one()){
+		handled++;
+		if(handled % RX_REFILL_BATCH == 0){
+			E1000_DEVICE_SET(E1000_RDT) = (rx_next + RX_SIZE - 1) % RX_SIZE;
+		}
 	}
 
-	return 0;
+	if(handled % RX_REFILL_BATCH != 0){
+		E1000_DEVICE_SET(E1000_RDT) = (rx_next + RX_SIZE - 1) % RX_SIZE;
+	}
+
+	if(handled < budget){
+		E1000_DEVICE_SET(E1000_IMS) = E1000_RX_INTERRUPTS;
+	}
+
+	return handled;
 }
 
 void e1000_attach(struct pci_device* dev)
@@ -235,11 +336,13 @@ void e1000_attach(struct pci_device* dev)
 
     pci_enable_device_busmaster(dev->bus, dev->slot, dev->function);
 
-	for (int i = 0; i < TX_SIZE; i++)
-		tx_buf[i] = palloc(PACKET_SIZE);
-	
-	for (int i = 0; i < RX_SIZE; i++)
-		rx_buf[i] = palloc(PACKET_SIZE);
+	for (int i = 0; i < RX_SIZE; i++){
+		rx_buf[i] = skb_alloc_data();
+		if(rx_buf[i] == NULL){
+			warningf("[E1000] Unable to allocate RX buffers\n");
+			return;
+		}
+	}
 
 	_e1000_tx_init();
 	_e1000_rx_init();
@@ -251,13 +354,16 @@ void e1000_attach(struct pci_device* dev)
 
 	E1000_DEVICE_SET(E1000_RDTR) = 0;
 	E1000_DEVICE_SET(E1000_RADV) = 0;
-	E1000_DEVICE_SET(E1000_IMS) = E1000_IMS_RXDW | E1000_IMS_RXDMT0 | E1000_IMS_RXO | E1000_IMS_RXT0;
+	/* Moderate interrupts, bursts are drained from the ring in one interrupt */
+	E1000_DEVICE_SET(E1000_ITR) = 1000000000 / (E1000_MAX_INT_RATE * 256);
+	E1000_DEVICE_SET(E1000_IMS) = E1000_RX_INTERRUPTS;
 
 	e1000_netdev = (struct netdev) {
 		.name = "E1000",
 		.driver = *dev,
 		.read = &e1000_receive,
 		.write = &e1000_transmit,
+		.transmit = &e1000_transmit_skb,
 		.poll = &e1000_poll,
 		.sent = 0,
 		.received = 0,
@@ -2,97 +2,73 @@
  * @file loopback.c
  * @author Joe Bayer (joexbayer)
  * @brief Loopback interface for internal networking.
+ * Transmitted skbs are handed straight back to netd as received packets,
+ * without copying them or emulating an interrupt. The only limit on
+ * packets in flight is the netd RX queue.
  * @version 0.1
  * @date 2023-12-12
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 #include <net/interface.h>
-#include <work.h>
 #include <net/netdev.h>
 #include <net/net.h>
+#include <net/skb.h>
 #include <memory.h>
-#include <math.h>
 
 //#undef dbgprintf
 //#define dbgprintf(...)
 
-static struct __queue {
-    struct queue_entry {
-        void* data;
-        int size;
-    } entries[32];
-    int head;
-    int tail;
-    unsigned int size;
-} loopback_queue = {0};
-
 static int iface_loopback_read(char* buffer, uint32_t size);
 static int iface_loopback_write(char* buffer, uint32_t size);
+static int32_t iface_loopback_transmit(struct sk_buff* skb);
 
 static struct netdev loopback_device = {
     .name = "loopback",
     .read = iface_loopback_read,
     .write = iface_loopback_write,
+    .transmit = iface_loopback_transmit,
     .sent = 0,
     .received = 0,
     .dropped = 0,
     .mac = {0x69, 0x00, 0x00, 0x00, 0x00, 0x00}
 };
 
-/* emulating a interrupt to deliver packet */
-static int iface_loopback_interrupt(void* _)
-{   
-    net_incoming_packet(&loopback_device);
-    return 0;
-}
-
-static int iface_loopback_read(char* buffer, uint32_t size)
+/**
+ * @brief Loops the skb back to netd, which parses it as a received packet.
+ * The frame already starts at skb->data, so the skb is reused as is.
+ */
+static int32_t iface_loopback_transmit(struct sk_buff* skb)
 {
-    if(loopback_queue.size == 0)
-        return -1;
-
-    struct queue_entry* entry = &loopback_queue.entries[loopback_queue.head];
-    int read = MIN(entry->size, (int)size);
-    memcpy(buffer, entry->data, read);
+    int size = skb->len;
+    dbgprintf("Looping back packet.\n");
 
-    kfree(entry->data);
-    entry->data = NULL;
-    entry->size = 0;
+    net_incoming_skb(&loopback_device, skb);
 
-    dbgprintf("Removed packet from loopback queue.\n");
-
-    loopback_queue.head = (loopback_queue.head + 1) % 32;
-    loopback_queue.size--;
+    return size;
+}
 
-    return read;
+/* Packets never wait in the device, they are delivered on transmit. */
+static int iface_loopback_read(char* buffer, uint32_t size)
+{
+    return -1;
 }
 
+/**
+ * @brief Copying write for callers without a skb.
+ */
 static int iface_loopback_write(char* buffer, uint32_t size)
 {
-    if(buffer == NULL)
+    if(buffer == NULL || size >= SKB_DATA_SIZE)
         return -1;
 
-    /* check if there is space */
-    if(loopback_queue.size == 32)
-        return -2;
-    
-    if(loopback_queue.entries[loopback_queue.tail].size != 0)
-        return -3;
-
-    char* data = (char*) kalloc(size);
-    memcpy(data, buffer, size);
-
-    loopback_queue.entries[loopback_queue.tail].data = data;
-    loopback_queue.entries[loopback_queue.tail].size = size;
-
-    loopback_queue.tail = (loopback_queue.tail + 1) % 32;
-    loopback_queue.size++;
-
-    dbgprintf("Added packet to loopback queue.\n");
+    struct sk_buff* skb = skb_new();
+    if(skb == NULL)
+        return -1;
 
-    work_queue_add(&iface_loopback_interrupt, NULL, NULL);
+    memcpy(skb_put(skb, size), buffer, size);
+    iface_loopback_transmit(skb);
 
     return 0;
 }
@@ -101,4 +77,3 @@ int net_init_loopback()
 {
     return net_register_netdev("lo0", &loopback_device);
 }
-
@@ -16,13 +16,150 @@
 #include <pcb.h>
 #include <arch/io.h>
 #include <kutils.h>
+#include <errors.h>
 
 #define PIT_IRQ		32
 
+/**
+ * @brief Hierarchical timer wheel
+ * The root level has one slot per tick for the next 256 ticks,
+ * each following level covers 64 times the range of the one below it.
+ * Adding and removing a timer is O(1), timers in the upper levels are
+ * cascaded down one level each time the level below wraps around.
+ */
+#define KTIMER_ROOT_BITS	8
+#define KTIMER_LEVEL_BITS	6
+#define KTIMER_LEVELS		4
+#define KTIMER_ROOT_SIZE	(1 << KTIMER_ROOT_BITS)
+#define KTIMER_LEVEL_SIZE	(1 << KTIMER_LEVEL_BITS)
+#define KTIMER_ROOT_MASK	(KTIMER_ROOT_SIZE-1)
+#define KTIMER_LEVEL_MASK	(KTIMER_LEVEL_SIZE-1)
+#define KTIMER_LEVEL_SHIFT(level) (KTIMER_ROOT_BITS + (level)*KTIMER_LEVEL_BITS)
+
+static struct ktimer_wheel {
+	/* Next tick to be processed */
+	uint32_t current;
+	struct ktimer* root[KTIMER_ROOT_SIZE];
+	struct ktimer* levels[KTIMER_LEVELS][KTIMER_LEVEL_SIZE];
+} wheel = {0};
+
 static unsigned long tick = 0;
+
+static void __ktimer_link(struct ktimer** slot, struct ktimer* timer)
+{
+	timer->slot = slot;
+	timer->prev = NULL;
+	timer->next = *slot;
+	if(*slot != NULL){
+		(*slot)->prev = timer;
+	}
+	*slot = timer;
+}
+
+static void __ktimer_unlink(struct ktimer* timer)
+{
+	if(timer->prev != NULL){
+		timer->prev->next = timer->next;
+	} else {
+		*timer->slot = timer->next;
+	}
+
+	if(timer->next != NULL){
+		timer->next->prev = timer->prev;
+	}
+
+	timer->slot = NULL;
+	timer->next = NULL;
+	timer->prev = NULL;
+}
+
+/**
+ * @brief Links the timer into the slot matching its expiry.
+ * Timers that already expired are placed in the slot of the next processed tick.
+ */
+static void __ktimer_insert(struct ktimer* timer)
+{
+	int level;
+	uint32_t expires = timer->expires;
+	uint32_t delta = expires - wheel.current;
+
+	if((int32_t)delta < 0){
+		__ktimer_link(&wheel.root[wheel.current & KTIMER_ROOT_MASK], timer);
+		return;
+	}
+
+	if(delta < KTIMER_ROOT_SIZE){
+		__ktimer_link(&wheel.root[expires & KTIMER_ROOT_MASK], timer);
+		return;
+	}
+
+	for (level = 0; level < KTIMER_LEVELS-1; level++){
+		if(delta < (1U << KTIMER_LEVEL_SHIFT(level+1))) break;
+	}
+	__ktimer_link(&wheel.levels[level][(expires >> KTIMER_LEVEL_SHIFT(level)) & KTIMER_LEVEL_MASK], timer);
+}
+
+/**
+ * @brief Moves all timers of the current slot in the given level down the wheel.
+ * @return int index of the slot that was cascaded, 0 means the level wrapped.
+ */
+static int __ktimer_cascade(int level)
+{
+	int index = (wheel.current >> KTIMER_LEVEL_SHIFT(level)) & KTIMER_LEVEL_MASK;
+	struct ktimer* list = wheel.levels[level][index];
+	struct ktimer* next;
+
+	wheel.levels[level][index] = NULL;
+	while(list != NULL){
+		next = list->next;
+		__ktimer_insert(list);
+		list = next;
+	}
+
+	return index;
+}
+
+/**
+ * @brief Runs all timers that expired up to and including the given tick.
+ * The expired slot is detached before running the callbacks,
+ * so callbacks are free to add or delete timers.
+ */
+static void __ktimer_run(uint32_t now)
+{
+	struct ktimer* expired;
+	struct ktimer* timer;
+
+	while((int32_t)(now - wheel.current) >= 0){
+		int index = wheel.current & KTIMER_ROOT_MASK;
+
+		if(index == 0){
+			for (int level = 0; level < KTIMER_LEVELS; level++){
+				if(__ktimer_cascade(level) != 0) break;
+			}
+		}
+
+		expired = wheel.root[index];
+		wheel.root[index] = NULL;
+		for (timer = expired; timer != NULL; timer = timer->next){
+			timer->slot = &expired;
+		}
+		wheel.current++;
+
+		while((timer = expired) != NULL){
+			__ktimer_unlink(timer);
+			timer->callback(timer->arg);
+		}
+	}
+}
+
 static void __int_handler timer_callback()
 {
 	tick++;
+
+	ENTER_CRITICAL();
+	__ktimer_run(tick);
+	LEAVE_CRITICAL();
+
 	$process->current->preempts++;
 	EOI(32);
 	if($process->current != NULL)
@@ -36,6 +173,70 @@ int timer_get_tick()
 	return tick;
 }
 
+/**
+ * @brief Initializes a timer, the callback is called from the PIT interrupt.
+ * @param timer timer to initialize
+ * @param callback function to call when the timer expires
+ * @param arg argument passed to the callback
+ */
+void ktimer_init(struct ktimer* timer, ktimer_callback_t callback, void* arg)
+{
+	timer->expires = 0;
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->slot = NULL;
+	timer->next = NULL;
+	timer->prev = NULL;
+}
+
+/**
+ * @brief Arms the timer to expire in the given amount of ticks.
+ * A pending timer is moved to its new expiry.
+ * @param timer timer to arm
+ * @param ticks ticks from now until the timer expires
+ * @return int 0 on success, error code on failure
+ */
+int ktimer_add(struct ktimer* timer, uint32_t ticks)
+{
+	ERR_ON_NULL(timer);
+	ERR_ON_NULL(timer->callback);
+
+	CRITICAL_SECTION({
+		if(timer->slot != NULL){
+			__ktimer_unlink(timer);
+		}
+		timer->expires = tick + ticks;
+		__ktimer_insert(timer);
+	});
+
+	return ERROR_OK;
+}
+
+/**
+ * @brief Disarms the timer, deleting a timer that is not pending is a no-op.
+ * @param timer timer to disarm
+ * @return int 1 if the timer was pending, 0 if not.
+ */
+int ktimer_del(struct ktimer* timer)
+{
+	int pending = 0;
+	ERR_ON_NULL(timer);
+
+	CRITICAL_SECTION({
+		if(timer->slot != NULL){
+			__ktimer_unlink(timer);
+			pending = 1;
+		}
+	});
+
+	return pending;
+}
+
+int ktimer_pending(struct ktimer* timer)
+{
+	return timer->slot != NULL;
+}
+
 int time_get_difference(struct time* t1, struct time* t2)
 {
 	uint32_t time1 = (t1->hour*3600) + (t1->minute*60) + t1->second;
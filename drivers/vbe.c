@@ -13,6 +13,7 @@
 #include <colors.h>
 #include <libc.h>
 #include <font8.h>
+#include <gfx/glyph.h>
 #include <args.h>
 
 #include <arch/io.h>
@@ -113,13 +114,8 @@ void vesa_put_block(uint8_t* buffer, unsigned char c, int x, int y, int color)
 
 void vesa_put_char(uint8_t* buffer, unsigned char c, int x, int y, int color) 
 {
-    for (int l = 0; l < 8; l++) {
-        for (int i = 8; i >= 0; i--) {
-            if (font8x8_basic[c][l] & (1 << i)) {
-                putpixel(buffer, (x)+i,  (y)+l, color, vbe_info->pitch);
-            }
-        }
-    }
+    struct gfx_rect screen = GFX_RECT(0, 0, vbe_info->width, vbe_info->height);
+    gfx_text_blit_masked(buffer, vbe_info->pitch, &screen, x, y, &gfx_font_basic, (char*)&c, 1, color);
 }
 
 void vesa_put_char16(uint8_t* buffer, unsigned char c, int x, int y, int color)
@@ -154,8 +150,8 @@ void vesa_put_icon16(uint8_t* buffer, int x, int y)
 
 void vesa_write(uint8_t* buffer, int x, int y, const char* data, int size, int color)
 {
-	for (int i = 0; i < size; i++)
-		vesa_put_char(buffer, data[i], x+(i*PIXELS_PER_CHAR), y, color);
+	struct gfx_rect screen = GFX_RECT(0, 0, vbe_info->width, vbe_info->height);
+	gfx_text_blit_masked(buffer, vbe_info->pitch, &screen, x, y, &gfx_font_basic, data, size, color);
 }
 
 void vesa_write_str(uint8_t* buffer, int x, int y, const char* data, int color)
@@ -27,6 +27,7 @@
 #include <rtc.h>
 
 static struct superblock superblock;
+static struct superblock_hints hints;
 static struct inode* root_dir;
 static struct inode* current_dir;
 
@@ -41,6 +42,15 @@ static char* months[] = {"NAN", "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul",
 		return -1;\
 	}
 
+/**
+ * @brief Returns the allocation hints of the mounted file system.
+ * They are kept out of the superblock as it is read and written as is.
+ */
+struct superblock_hints* superblock_get_hints(struct superblock* sb)
+{
+	return &hints;
+}
+
 int init_ext()
 {
 	FS_START_LOCATION = (kernel_size/512)+2;
@@ -62,6 +72,9 @@ int init_ext()
 	superblock.inodes_start = FS_START_LOCATION + 3;
 	superblock.blocks_start = superblock.inodes_start + (superblock.ninodes/ INODES_PER_BLOCK);
 
+	hints.inode = 0;
+	hints.block = 0;
+
 	superblock.block_map = create_bitmap(superblock.nblocks);
 	superblock.inode_map = create_bitmap(superblock.ninodes);
 	read_block_offset((char*) superblock.block_map, get_bitmap_size(superblock.nblocks), 0, FS_BLOCK_BMAP_LOCATION);
@@ -126,6 +139,8 @@ void ext_create_file_system()
 
 	superblock.inodes_start = FS_START_LOCATION + 3;
 	superblock.blocks_start = superblock.inodes_start + (superblock.ninodes/ INODES_PER_BLOCK);
+	hints.inode = 0;
+	hints.block = 0;
 
 	superblock.block_map = create_bitmap(superblock.nblocks);
 	superblock.inode_map = create_bitmap(superblock.ninodes);
@@ -17,11 +17,14 @@
 #include <memory.h>
 #include <math.h>
 #include <sync.h>
+#include <bitmap.h>
 
 #define DIRECTORY_ROOT 0
 
 static struct fat_boot_table boot_table = {0};
 static byte_t* fat_table_memory = NULL;  /* pointer to the in-memory FAT table */
+static bitmap_t fat_dirty_map = NULL;    /* one bit per FAT sector modified since last sync */
+static struct fat16_stats fat16_stats = {0};
 
 /* Temporary "current" directory */
 static uint16_t current_dir_block = 0;
@@ -78,25 +81,62 @@ void fat16_set_fat_entry(uint32_t cluster, uint16_t value)
     acquire(&fat16_table_lock);
 
     uint32_t fat_offset = cluster * 2;  /* Each entry is 2 bytes */
-    *(uint16_t*)(fat_table_memory + fat_offset) = value;
+    if(*(uint16_t*)(fat_table_memory + fat_offset) != value){
+        *(uint16_t*)(fat_table_memory + fat_offset) = value;
+        set_bitmap(fat_dirty_map, fat_offset / 512);
+    }
 
     release(&fat16_table_lock);
 }
 
-void fat16_sync_fat_table()
+/**
+ * @brief Writes the FAT sectors modified since the last sync back to disk.
+ * Updates to the in memory FAT only mark their sector as dirty, so a write
+ * touching a few clusters costs a few sector writes instead of the whole table.
+ * @return int number of FAT sectors written.
+ */
+int fat16_sync_fat_table()
 {
     if(fat_table_memory == NULL){
-        return;
+        return 0;
     }
 
     acquire(&fat16_table_lock);
 
+    int written = 0;
     int start_block = get_fat_start_block();
-    for (uint16_t i = 0; i < boot_table.fat_blocks; i++) {
+    int i = bitmap_find_set(fat_dirty_map, boot_table.fat_blocks, 0);
+    while (i >= 0) {
         write_block(fat_table_memory + i * 512, start_block + i);
+        unset_bitmap(fat_dirty_map, i);
+        written++;
+
+        i = bitmap_find_set(fat_dirty_map, boot_table.fat_blocks, i + 1);
     }
 
+    fat16_stats.fat_sectors_written += written;
+    fat16_stats.syncs++;
+
     release(&fat16_table_lock);
+
+    return written;
+}
+
+/**
+ * @brief Copies the FAT write statistics, dirty is the number of FAT sectors waiting to be synced.
+ */
+int fat16_get_stats(struct fat16_stats* stats)
+{
+    ERR_ON_NULL(stats);
+
+    *stats = fat16_stats;
+    stats->fat_sectors = boot_table.fat_blocks;
+    stats->dirty = 0;
+    for (int i = 0; fat_dirty_map != NULL && i < boot_table.fat_blocks; i++) {
+        stats->dirty += get_bitmap(fat_dirty_map, i) ? 1 : 0;
+    }
+
+    return 0;
 }
 
 /* wrapper functions TODO: inline replace */
@@ -845,6 +885,13 @@ int fat16_load()
         return -3;
     }
 
+    fat_dirty_map = create_bitmap(boot_table.fat_blocks);
+    if(fat_dirty_map == NULL){
+        kfree(fat_table_memory);
+        fat_table_memory = NULL;
+        return -3;
+    }
+
     for (uint16_t i = 0; i < boot_table.fat_blocks; i++) {
         read_block(fat_table_memory + i * 512, get_fat_start_block() + i);
     }
@@ -32,6 +32,7 @@ static int fat16_rename(struct filesystem* fs, const char* path, const char* new
 static int fat16_stat(struct filesystem* fs, const char* path, struct file* file);
 static int fat16_list(struct filesystem* fs, const char* path, char* buf, int size);
 static int fat16_find(struct filesystem* fs, char* origin, const char* needle);
+static int fat16_sync(struct filesystem* fs);
 
 /* filesystem_ops struct */
 static struct filesystem_ops fat16_ops = {
@@ -45,7 +46,8 @@ static struct filesystem_ops fat16_ops = {
     .rename = fat16_rename,
     .stat = fat16_stat,
     .list = fat16_list,
-    .find = fat16_find
+    .find = fat16_find,
+    .sync = fat16_sync
 };
 
 
@@ -266,9 +268,28 @@ static int fat16_close(struct filesystem* fs, struct file* file)
     /* close the file */
     file->nlinks = 0;
 
+    /* flush FAT updates batched up while the file was open */
+    if(file->flags & FS_FILE_FLAG_WRITE){
+        fat16_sync_fat_table();
+    }
+
     return 0;
 }
 
+/**
+ * @brief Writes all dirty FAT sectors to disk.
+ * 
+ * @package fs
+ * @param fs The filesystem to use.
+ * @return int The number of sectors written, or a negative value on error.
+ */
+static int fat16_sync(struct filesystem* fs)
+{
+    FS_VALIDATE(fs);
+
+    return fat16_sync_fat_table();
+}
+
 /**
  * @brief Removes a file.
  * 
@@ -36,6 +36,17 @@ int fat16_read_data_from_cluster(uint32_t cluster, void *data, int data_length,
     return read_block_offset((byte_t *)data, data_length, offset, block_num);
 }
 
+/* Counts how many of the next clusters, at most max, follow cluster on disk. */
+static int __fat16_contiguous(uint32_t cluster, int max)
+{
+    int count = 1;
+    while (count < max && fat16_get_fat_entry(cluster) == cluster + 1) {
+        cluster++;
+        count++;
+    }
+    return count;
+}
+
 int fat16_read_data(int first_cluster, uint32_t start_offset, void* _buffer, int buffer_length, uint32_t max_length)
 {
     byte_t* buffer = (byte_t*) _buffer;
@@ -62,7 +73,16 @@ int fat16_read_data(int first_cluster, uint32_t start_offset, void* _buffer, int
     }
 
     byte_t *buf_pos = buffer;
+    int read_ahead = 0;  /* Clusters left of the run that was read into the cache */
     while (bytes_left_to_read > 0 && current_cluster != 0xFFFF) {
+        /* Read every run of consecutive clusters with one disk command */
+        if (read_ahead == 0) {
+            int clusters = (offset_within_cluster + bytes_left_to_read + 511) / 512;
+            read_ahead = __fat16_contiguous(current_cluster, clusters < DISK_RUN_MAX ? clusters : DISK_RUN_MAX);
+            read_block_ahead(GET_DIRECTORY_BLOCK(current_cluster), read_ahead);
+        }
+        read_ahead--;
+
         int bytes_to_read = (bytes_left_to_read > (512 - offset_within_cluster)) ? (512 - offset_within_cluster) : bytes_left_to_read;
         //dbgprintf("Read %d bytes from cluster 0x%x\n", bytes_to_read, current_cluster); 
         fat16_read_data_from_cluster(current_cluster, buf_pos, bytes_to_read, offset_within_cluster);
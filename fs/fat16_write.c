@@ -70,8 +70,6 @@ int fat16_write_data(int first_cluster, int offset, void* data, int data_length)
     int remaining_data_length = data_length;
     int data_offset = 0;
 
-    fat16_print_cluster_chain(first_cluster);
-
     /* Determine the cluster and inner cluster offset where we should start writing. */
     int cluster_offset;
     uint32_t current_cluster = fat16_find_cluster_by_offset(first_cluster, offset, &cluster_offset);
@@ -122,8 +120,6 @@ int fat16_write_data(int first_cluster, int offset, void* data, int data_length)
 
     //dbgprintf("Wrote %d bytes to cluster chain\n", data_length);
 
-    fat16_print_cluster_chain(first_cluster);
-    fat16_sync_fat_table();
-
+    /* The FAT is flushed on close, sync or by the periodic flush thread. */
     return data_length;  /* Success */
 }
\ No newline at end of file
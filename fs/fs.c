@@ -18,6 +18,10 @@
 #include <assert.h>
 #include <serial.h>
 #include <errors.h>
+#include <kthreads.h>
+#include <scheduler.h>
+#include <timer.h>
+#include <bcache.h>
 
 /* This determines the maximum of simultaneously open files */
 #define FS_MAX_FILES 256
@@ -303,5 +307,79 @@ int fs_write(int fd, void* buf, int size)
         return -3;
     }
 
+    /* other descriptors of the file no longer see what they opened */
+    for (int i = 0; i < FS_MAX_FILES; i++){
+        if(i != fd && fs_file_table[i].flags != 0 && fs_same_file(i, fd)){
+            fs_file_table[i].flags |= FS_FILE_FLAG_CHANGED;
+        }
+    }
+
     return ret;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Checks if the file was written through another descriptor since fd was opened.
+ * 
+ * @return int 1 if changed, 0 if not, negative on error.
+ */
+int fs_changed(int fd)
+{
+    if(fd < 0 || fd >= FS_MAX_FILES || fs_file_table[fd].flags == 0){
+        return -2;
+    }
+
+    return HAS_FLAG(fs_file_table[fd].flags, FS_FILE_FLAG_CHANGED) ? 1 : 0;
+}
+
+/**
+ * @brief Checks if two descriptors refer to the same file.
+ * 
+ * @return int 1 if they do, 0 if not or if either is not open.
+ */
+int fs_same_file(int fd, int other)
+{
+    if(fd < 0 || fd >= FS_MAX_FILES || fs_file_table[fd].flags == 0){
+        return 0;
+    }
+
+    if(other < 0 || other >= FS_MAX_FILES || fs_file_table[other].flags == 0){
+        return 0;
+    }
+
+    return fs_file_table[fd].directory == fs_file_table[other].directory
+        && fs_file_table[fd].identifier == fs_file_table[other].identifier;
+}
+
+/**
+ * @brief Flushes metadata the current filesystem has batched in memory,
+ * then writes all dirty blocks in the buffer cache to disk.
+ * 
+ * @return int number of blocks written to disk, or a negative value on error.
+ */
+int fs_sync()
+{
+    /* check if a filesystem is available */
+    if(fs_current == NULL){
+        return -1;
+    }
+
+    /* sync is optional */
+    if(fs_current->ops->sync != NULL && fs_current->ops->sync(fs_current) < 0){
+        return -2;
+    }
+
+    return bcache_sync();
+}
+
+/**
+ * @brief Periodically flushes the current filesystem so batched
+ * metadata does not stay in memory for long if a file is never closed.
+ */
+void __kthread_entry fsflushd()
+{
+    while (1){
+        kernel_sleep(TIMER_MS_TO_TICKS(FS_SYNC_INTERVAL));
+        fs_sync();
+    }
+}
+EXPORT_KTHREAD(fsflushd);
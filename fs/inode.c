@@ -16,13 +16,16 @@
 #include <serial.h>
 
 #include <libc.h>
+#include <memory.h>
 #include <diskdev.h>
 
 #define INODE_CACHE_SIZE 100
 #define INODE_TO_BLOCK(inode) (INODE_BLOCK(inode))
 #define INODE_BLOCK_OFFSET(block, i) ((i-(block*INODES_PER_BLOCK))*sizeof(struct inode))
 
-static struct inode __inode_cache[INODE_CACHE_SIZE];
+/* Cached inodes are allocated from a slab cache when they are first loaded */
+static struct inode* __inode_cache[INODE_CACHE_SIZE];
+static struct kmem_cache* __inode_kmem_cache = NULL;
 
 static void __inode_sync(struct inode* inode, struct superblock* sb)
 {
@@ -43,25 +46,32 @@ static int __inode_cache_insert(struct inode* inode, struct superblock* sb)
 	int i;
 	int lowest_nlink = 9999;
 
+	if(__inode_kmem_cache == NULL){
+		__inode_kmem_cache = kmem_cache_create("inode", sizeof(struct inode));
+	}
+
 	/* Check if there is a free cache slot and find cache with lowest nlink */
 	for (i = 0; i < INODE_CACHE_SIZE; i++){
-		if(__inode_cache[i].type == 0){
+		if(__inode_cache[i] == NULL){
+			__inode_cache[i] = kmem_cache_alloc(__inode_kmem_cache);
+			if(__inode_cache[i] == NULL) break;
+
 			dbgprintf("[FS] Caching inode %d.\n", inode->inode);
-			memcpy(&__inode_cache[i], inode, sizeof(struct inode));
+			memcpy(__inode_cache[i], inode, sizeof(struct inode));
 			return i;
 		}
-		if(__inode_cache[i].nlink < lowest_nlink){
-			lowest_nlink = __inode_cache[i].nlink;
+		if(__inode_cache[i]->nlink < lowest_nlink){
+			lowest_nlink = __inode_cache[i]->nlink;
 		}
 	}
 
 	/* if no free slot check if any file has been closed. */
 	for (i = 0; i < INODE_CACHE_SIZE; i++){
-		if(__inode_cache[i].nlink == 0){
-			__inode_sync(&__inode_cache[i], sb);
-			dbgprintf("[FS] Saving inode %d to disk..\n", __inode_cache[i].inode);
+		if(__inode_cache[i] != NULL && __inode_cache[i]->nlink == 0){
+			__inode_sync(__inode_cache[i], sb);
+			dbgprintf("[FS] Saving inode %d to disk..\n", __inode_cache[i]->inode);
 			dbgprintf("[FS] Caching inode %d.\n", inode->inode);
-			memcpy(&__inode_cache[i], inode, sizeof(struct inode));
+			memcpy(__inode_cache[i], inode, sizeof(struct inode));
 			return i;
 		}
 	}
@@ -94,32 +104,32 @@ static int __inode_load(inode_t inode, struct superblock* sb)
 
 static inline int __new_inode(struct superblock* sb)
 {
-	return get_free_bitmap(sb->inode_map, sb->ninodes)+1;
+	return bitmap_get_free_next(sb->inode_map, sb->ninodes, &superblock_get_hints(sb)->inode)+1;
 }
 
 static inline int __new_block(struct superblock* sb)
 {
-	return get_free_bitmap(sb->block_map, sb->nblocks)+1;
+	return bitmap_get_free_next(sb->block_map, sb->nblocks, &superblock_get_hints(sb)->block)+1;
 }
 
 void inodes_sync(struct superblock* sb)
 {
 	for (int i = 0; i < INODE_CACHE_SIZE; i++)
-		if(__inode_cache[i].type != 0)
-			__inode_sync(&__inode_cache[i], sb);
+		if(__inode_cache[i] != NULL)
+			__inode_sync(__inode_cache[i], sb);
 }
 
 struct inode* inode_get(inode_t inode, struct superblock* sb)
 {
 	for (int i = 0; i < INODE_CACHE_SIZE; i++){
-		if(__inode_cache[i].inode == inode){
-			return &__inode_cache[i];
+		if(__inode_cache[i] != NULL && __inode_cache[i]->inode == inode){
+			return __inode_cache[i];
 		}
 	}
 
 	int ret = __inode_load(inode, sb);
 	if(ret >= 0){
-		return &__inode_cache[ret];
+		return __inode_cache[ret];
 	}
 	return NULL;
 }
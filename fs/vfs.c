@@ -45,7 +45,7 @@ void mkdir(int argc, char* argv[])
     twritef("Created directory.\n");
 }
 
-void sync()
+void vfs_sync()
 {
 	twritef("[FS] Synchronizing filesystem.\n");
 	ext_sync();
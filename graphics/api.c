@@ -17,14 +17,11 @@
 #include <assert.h>
 #include <errors.h>
 
-int gfx_syscall_hook(int option, void* data, int flags)
+/**
+ * @brief Draws a single command into the window of the current process.
+ */
+static void __gfx_draw(int option, void* data)
 {
-    if(option >= GFX_DRAW_UNUSED || option < 0) return -1;
-    if(!(flags >= 0 && flags < 255))return -1;
-
-    ERR_ON_NULL(data);
-    ERR_ON_NULL($process->current);
-
     switch (option){
     case GFX_DRAW_CHAR_OPT:;
         struct gfx_char* c = (struct gfx_char*)data;
@@ -50,9 +47,71 @@ int gfx_syscall_hook(int option, void* data, int flags)
         kernel_gfx_draw_pixel($process->current->gfx_window, pixel->x, pixel->y, rgb_to_vga(pixel->color));
         break;
 
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Replays a batch of draw commands recorded by userspace, the caller commits once.
+ */
+static int __gfx_draw_batch(struct gfx_batch* batch)
+{
+    ERR_ON_NULL($process->current->gfx_window);
+
+    if(batch->count < 0 || batch->count > GFX_BATCH_MAX) return -ERROR_INVALID_ARGUMENTS;
+
+    for (int i = 0; i < batch->count; i++){
+        __gfx_draw(batch->commands[i].option, &batch->commands[i].pixel);
+    }
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Maps the back buffer of the window and describes it to userspace.
+ */
+static int __gfx_map_framebuffer(struct gfx_framebuffer* fb)
+{
+    struct window* w = $process->current->gfx_window;
+    ERR_ON_NULL(w);
+
+    uintptr_t addr = gfx_window_map_backbuffer(w);
+    if(addr == 0) return -ERROR_ALLOC;
+
+    fb->pixels = (unsigned char*) addr;
+    fb->pitch = w->backbuffer.pitch;
+    fb->width = w->inner_width;
+    fb->height = w->inner_height;
+
+    return ERROR_OK;
+}
+
+int gfx_syscall_hook(int option, void* data, int flags)
+{
+    if(option >= GFX_DRAW_UNUSED || option < 0) return -1;
+    if(!(flags >= 0 && flags < 255))return -1;
+
+    ERR_ON_NULL(data);
+    ERR_ON_NULL($process->current);
+
+    switch (option){
     case GFX_EVEN_LOOP_OPT:
         return gfx_event_loop((struct gfx_event*)data, flags);
+    case GFX_DRAW_BATCH_OPT:;
+        int ret = __gfx_draw_batch((struct gfx_batch*)data);
+        if(ret < 0) return ret;
+        break;
+    case GFX_MAP_FRAMEBUFFER_OPT:
+        return __gfx_map_framebuffer((struct gfx_framebuffer*)data);
+    case GFX_PRESENT_OPT:;
+        struct gfx_rectangle* area = (struct gfx_rectangle*)data;
+        ERR_ON_NULL($process->current->gfx_window);
+        ret = gfx_window_present($process->current->gfx_window, area->x, area->y, area->width, area->height);
+        if(ret < 0) return ret;
+        break;
     default:
+        __gfx_draw(option, data);
         break;
     }
     gfx_commit();
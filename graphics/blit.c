@@ -0,0 +1,119 @@
+/**
+ * @file blit.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Row based blitters for window composition.
+ * Opaque buffers are copied one clipped row at a time with memcpy.
+ * Buffers with a transparent color are tested 4 pixels at a time,
+ * so only words mixing transparent and opaque pixels are copied per pixel.
+ * @version 0.1
+ * @date 2024-03-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <gfx/blit.h>
+#include <libc.h>
+
+/* Pixels are read 4 at a time regardless of how the buffers were written. */
+typedef uint32_t __attribute__((__may_alias__)) __blit_u32;
+
+/* Any byte of v zero? (Bit Twiddling Hacks) */
+#define HAS_ZERO_BYTE(v) (((v) - 0x01010101) & ~(v) & 0x80808080)
+
+/**
+ * @brief Clips the destination rectangle at x, y to clip.
+ * @return struct gfx_rect visible part, empty if nothing is visible.
+ */
+static inline struct gfx_rect __blit_clip(struct gfx_rect* clip, int x, int y, int width, int height)
+{
+    struct gfx_rect area = GFX_RECT(x, y, width, height);
+    return gfx_rect_intersect(&area, clip);
+}
+
+/**
+ * @brief Copies an opaque buffer to dst at x, y.
+ */
+void gfx_blit(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, const uint8_t* src, int width, int height, int src_pitch)
+{
+    struct gfx_rect r = __blit_clip(clip, x, y, width, height);
+    if(GFX_RECT_EMPTY(&r)) return;
+
+    const uint8_t* from = src + (r.y - y) * src_pitch + (r.x - x);
+    uint8_t* to = dst + r.y * dst_pitch + r.x;
+
+    for (int row = 0; row < r.height; row++){
+        memcpy(to, from, r.width);
+        from += src_pitch;
+        to += dst_pitch;
+    }
+}
+
+/**
+ * @brief Copies a buffer to dst at x, y, skipping pixels of color key.
+ */
+void gfx_blit_masked(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, const uint8_t* src, int width, int height, int src_pitch, uint8_t key)
+{
+    struct gfx_rect r = __blit_clip(clip, x, y, width, height);
+    if(GFX_RECT_EMPTY(&r)) return;
+
+    const uint8_t* from = src + (r.y - y) * src_pitch + (r.x - x);
+    uint8_t* to = dst + r.y * dst_pitch + r.x;
+    uint32_t keys = key * 0x01010101;
+
+    for (int row = 0; row < r.height; row++){
+        int i = 0;
+        for (; i + 4 <= r.width; i += 4){
+            uint32_t pixels = *(const __blit_u32*)(from + i);
+            uint32_t diff = pixels ^ keys;
+
+            /* All four opaque, or all four transparent */
+            if(!HAS_ZERO_BYTE(diff)){
+                *(__blit_u32*)(to + i) = pixels;
+                continue;
+            }
+            if(diff == 0) continue;
+
+            for (int j = i; j < i + 4; j++){
+                if(from[j] != key) to[j] = from[j];
+            }
+        }
+
+        for (; i < r.width; i++){
+            if(from[i] != key) to[i] = from[i];
+        }
+
+        from += src_pitch;
+        to += dst_pitch;
+    }
+}
+
+/**
+ * @brief Scales src to fill dst, nearest neighbour.
+ * Destination rows mapping to the same source row are copied from the row above.
+ */
+void gfx_blit_scaled(uint8_t* dst, int dst_width, int dst_height, int dst_pitch, const uint8_t* src, int src_width, int src_height, int src_pitch)
+{
+    if(dst_width <= 0 || dst_height <= 0 || src_width <= 0 || src_height <= 0) return;
+
+    /* 16.16 fixed point source step per destination pixel */
+    uint32_t step_x = ((uint32_t)src_width << 16) / dst_width;
+    int last = -1;
+
+    for (int y = 0; y < dst_height; y++){
+        int sy = y * src_height / dst_height;
+        uint8_t* to = dst + y * dst_pitch;
+
+        if(sy == last){
+            memcpy(to, to - dst_pitch, dst_width);
+            continue;
+        }
+
+        const uint8_t* from = src + sy * src_pitch;
+        uint32_t sx = 0;
+        for (int x = 0; x < dst_width; x++){
+            to[x] = from[sx >> 16];
+            sx += step_x;
+        }
+        last = sy;
+    }
+}
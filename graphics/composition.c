@@ -90,6 +90,18 @@ int gfx_set_taskbar(pid_t pid)
     return ERROR_OK;
 }
 
+/**
+ * @brief Copies the compositor statistics of the last frame.
+ */
+int gfx_compositor_stats(struct ws_stats* stats)
+{
+    ERR_ON_NULL(ws);
+    ERR_ON_NULL(stats);
+
+    *stats = ws->stats;
+    return ERROR_OK;
+}
+
 void __kthread_entry gfx_compositor_main()
 {
     ws = ws_new();
@@ -0,0 +1,138 @@
+/**
+ * @file damage.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Screen damage list used by the compositor.
+ * @version 0.1
+ * @date 2024-03-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <gfx/damage.h>
+#include <math.h>
+
+struct gfx_rect gfx_rect_intersect(struct gfx_rect* a, struct gfx_rect* b)
+{
+    int x0 = MAX(a->x, b->x);
+    int y0 = MAX(a->y, b->y);
+    int x1 = MIN(a->x + a->width, b->x + b->width);
+    int y1 = MIN(a->y + a->height, b->y + b->height);
+
+    return GFX_RECT(x0, y0, x1 - x0, y1 - y0);
+}
+
+/**
+ * @brief Smallest rectangle containing both a and b, empty rectangles are ignored.
+ */
+struct gfx_rect gfx_rect_union(struct gfx_rect* a, struct gfx_rect* b)
+{
+    if(GFX_RECT_EMPTY(a)) return *b;
+    if(GFX_RECT_EMPTY(b)) return *a;
+
+    int x0 = MIN(a->x, b->x);
+    int y0 = MIN(a->y, b->y);
+    int x1 = MAX(a->x + a->width, b->x + b->width);
+    int y1 = MAX(a->y + a->height, b->y + b->height);
+
+    return GFX_RECT(x0, y0, x1 - x0, y1 - y0);
+}
+
+int gfx_rect_overlaps(struct gfx_rect* a, struct gfx_rect* b)
+{
+    struct gfx_rect r = gfx_rect_intersect(a, b);
+    return !GFX_RECT_EMPTY(&r);
+}
+
+void gfx_damage_init(struct gfx_damage* damage, int width, int height)
+{
+    damage->bounds = GFX_RECT(0, 0, width, height);
+    damage->count = 0;
+}
+
+void gfx_damage_clear(struct gfx_damage* damage)
+{
+    damage->count = 0;
+}
+
+static void __gfx_damage_remove(struct gfx_damage* damage, int index)
+{
+    damage->rects[index] = damage->rects[--damage->count];
+}
+
+/**
+ * @brief Adds a rectangle to the damage list.
+ * Overlapping rectangles are merged so no pixel is redrawn or flushed twice.
+ * When the list is full the rectangle is merged with the entry whose area
+ * grows the least.
+ * @param damage list to add to
+ * @param rect screen rectangle, clipped to the list bounds
+ */
+void gfx_damage_add(struct gfx_damage* damage, struct gfx_rect rect)
+{
+    rect = gfx_rect_intersect(&rect, &damage->bounds);
+    if(GFX_RECT_EMPTY(&rect)) return;
+
+    for (int i = 0; i < damage->count; i++){
+        if(!gfx_rect_overlaps(&damage->rects[i], &rect)) continue;
+
+        /* The union may overlap other entries, so it is added again. */
+        rect = gfx_rect_union(&damage->rects[i], &rect);
+        __gfx_damage_remove(damage, i);
+        i = -1;
+    }
+
+    if(damage->count < GFX_DAMAGE_MAX){
+        damage->rects[damage->count++] = rect;
+        return;
+    }
+
+    int best = 0;
+    int best_growth = -1;
+    for (int i = 0; i < damage->count; i++){
+        struct gfx_rect u = gfx_rect_union(&damage->rects[i], &rect);
+        int growth = GFX_RECT_AREA(&u) - GFX_RECT_AREA(&damage->rects[i]);
+        if(best_growth < 0 || growth < best_growth){
+            best = i;
+            best_growth = growth;
+        }
+    }
+
+    rect = gfx_rect_union(&damage->rects[best], &rect);
+    __gfx_damage_remove(damage, best);
+    gfx_damage_add(damage, rect);
+}
+
+/**
+ * @brief Damages the whole screen.
+ */
+void gfx_damage_all(struct gfx_damage* damage)
+{
+    damage->rects[0] = damage->bounds;
+    damage->count = 1;
+}
+
+int gfx_damage_overlaps(struct gfx_damage* damage, struct gfx_rect* rect)
+{
+    for (int i = 0; i < damage->count; i++){
+        if(gfx_rect_overlaps(&damage->rects[i], rect)) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks if a single damage rectangle covers the on screen part of rect.
+ * Overlapping rectangles are always merged, so this is the case for
+ * every rectangle that was added.
+ */
+int gfx_damage_contains(struct gfx_damage* damage, struct gfx_rect* rect)
+{
+    /* Only the part on screen can be damaged */
+    struct gfx_rect visible = gfx_rect_intersect(rect, &damage->bounds);
+    if(GFX_RECT_EMPTY(&visible)) return 1;
+
+    for (int i = 0; i < damage->count; i++){
+        struct gfx_rect r = gfx_rect_intersect(&damage->rects[i], &visible);
+        if(r.width == visible.width && r.height == visible.height) return 1;
+    }
+    return 0;
+}
@@ -12,6 +12,7 @@
 #include <gfx/events.h>
 #include <pcb.h>
 #include <font8.h>
+#include <gfx/glyph.h>
 #include <vbe.h>
 #include <args.h>
 #include <vbe.h>
@@ -39,7 +40,7 @@ int gfx_push_event(struct window* w, struct gfx_event* e)
 	});
 
 	/* TODO: Check for a block reason */
-	if(w->owner->state == BLOCKED) w->owner->state = RUNNING;
+	if(w->owner->state == BLOCKED) unblock(w->owner->pid);
 
 	return 0;
 }
@@ -95,6 +96,7 @@ int gfx_put_icon16(unsigned char icon[], int x, int y)
 			}
 		}
 	}
+	gfx_window_damage($process->current->gfx_window, x, y, 16, 16);
 	return 0;
 }
 
@@ -112,6 +114,7 @@ int gfx_put_icon32(unsigned char icon[], int x, int y)
 			}
 		}
 	}
+	gfx_window_damage($process->current->gfx_window, x, y, 32, 32);
 	return 0;
 }
 
@@ -169,6 +172,7 @@ int kernel_gfx_draw_rectangle(struct window* w, int x, int y, int width, int hei
 		for (i = x; i < (x+width); i++)
 			putpixel(w->inner, i, j, color, w->pitch);
 
+	gfx_window_damage(w, x, y, width, height);
 	return 0;
 }
 
@@ -182,6 +186,7 @@ int kernel_gfx_draw_pixel(struct window* w, int x, int y, color_t color)
 
 	putpixel(w->inner, x, y, color, w->pitch);
 
+	gfx_window_damage(w, x, y, 1, 1);
 	return 0;
 }
 
@@ -198,6 +203,8 @@ int kernel_gfx_draw_bitmap(struct window* w, int x, int y, int width, int height
 		for (i = x; i < (x+width); i++)
 			putpixel(w->inner, i, j, rgb_to_vga(bitmap[(j-y)*width+(i-x)]), w->pitch);
 
+	gfx_window_damage(w, x, y, width, height);
+
 	return 0;
 }
 
@@ -212,21 +219,33 @@ int kernel_gfx_draw_bitmap(struct window* w, int x, int y, int width, int height
  */
 int kernel_gfx_draw_char(struct window* w, int x, int y, unsigned char c, unsigned char color)
 {
-
 	ERR_ON_NULL(w);
 
-	//ENTER_CRITICAL();
-	for (int l = 0; l < 8; l++) {
-		for (int i = 8; i >= 0; i--) {
-			if (font8x8_basic[c][l] & (1 << i)) {
+	struct gfx_rect clip = GFX_RECT(0, 0, w->inner_width, w->inner_height);
+	gfx_text_blit_masked(w->inner, w->pitch, &clip, x, y, &gfx_font_basic, (char*)&c, 1, color);
+	gfx_window_damage(w, x, y, GFX_GLYPH_WIDTH, GFX_GLYPH_HEIGHT);
 
-				if((x)+i < 0 || (y)+l < 0 || (x)+i > w->inner_width || (y)+l > w->inner_height)
-					continue;
-				putpixel(w->inner, (x)+i, (y)+l, color, w->pitch);
-			}
-		}
-	}
-	//LEAVE_CRITICAL();
+	return 0;
+}
+
+/**
+ * @brief Draws len characters with their background, one row blit per character row.
+ * 
+ * @param x coordinate
+ * @param y coordiante
+ * @param str characters to draw
+ * @param len amount of characters
+ * @param color text color
+ * @param bg background color
+ * @return int 0 on success, less than 0 on error.
+ */
+int kernel_gfx_draw_glyphs(struct window* w, int x, int y, const char* str, int len, unsigned char color, unsigned char bg)
+{
+	ERR_ON_NULL(w);
+
+	struct gfx_rect clip = GFX_RECT(0, 0, w->inner_width, w->inner_height);
+	gfx_text_blit(w->inner, w->pitch, &clip, x, y, &gfx_font_basic, str, len, color, bg);
+	gfx_window_damage(w, x, y, len*GFX_GLYPH_WIDTH, GFX_GLYPH_HEIGHT);
 
 	return 0;
 }
@@ -239,9 +258,27 @@ void kernel_gfx_set_position(struct window* w, int x, int y)
 
 void gfx_commit()
 {
-	if($process->current->gfx_window == NULL)
+	gfx_window_commit($process->current->gfx_window);
+}
+
+/**
+ * @brief Hands everything drawn in w since the last commit to the window manager.
+ */
+void gfx_window_commit(struct window* w)
+{
+	if(w == NULL)
+		return;
+
+	/* Without a known drawn area the whole window is composed again. */
+	if(GFX_RECT_EMPTY(&w->pending)){
+		w->changed = 1;
 		return;
-	$process->current->gfx_window->changed = 1;
+	}
+
+	ENTER_CRITICAL();
+	w->dirty = gfx_rect_union(&w->dirty, &w->pending);
+	w->pending = GFX_RECT(0, 0, 0, 0);
+	LEAVE_CRITICAL();
 }
 
 /**
@@ -335,6 +372,9 @@ void kernel_gfx_draw_line(struct window* w, int x0, int y0, int x1, int y1, unsi
 
 	error = dx + dy;
 
+	/* Pixels are plotted with x and y swapped */
+	gfx_window_damage(w, y0 < y1 ? y0 : y1, x0 < x1 ? x0 : x1, ABS(t2) + 1, ABS(t1) + 1);
+
 	while(1)  
 	{  
 		putpixel(w->inner, y0, x0, color, w->pitch); 
@@ -389,6 +429,7 @@ void kernel_gfx_draw_circle(struct window* w, int xc, int yc, int r, unsigned ch
 {
     int x = 0, y = r;
     int d = 3 - 2 * r;
+    gfx_window_damage(w, xc - r, yc - r, 2*r + 1, 2*r + 1);
     kernel_gfx_draw_circle_helper(w, xc, yc, x, y, color, fill);
 
     while (y >= x)
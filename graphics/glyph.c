@@ -0,0 +1,181 @@
+/**
+ * @file glyph.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Glyph cache and text blitters for 8x8 bitmap fonts.
+ * A font is expanded once per color pair, after that every character
+ * is drawn as 8 row copies instead of 64 bit tests. Transparent text
+ * merges the color into the destination through masks of the font rows.
+ * @version 0.1
+ * @date 2024-03-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <gfx/glyph.h>
+#include <font8.h>
+#include <sync.h>
+#include <libc.h>
+
+/* Glyph rows are copied 4 pixels at a time. */
+typedef uint32_t __attribute__((__may_alias__)) __glyph_u32;
+
+struct gfx_font gfx_font_basic = {
+    .bitmap = font8x8_basic,
+    .glyphs = 128
+};
+
+/* One font expanded in one color pair */
+struct gfx_glyph_set {
+    struct gfx_font* font;
+    uint8_t fg, bg;
+    uint32_t used;
+    uint8_t pixels[GFX_GLYPH_MAX][GFX_GLYPH_WIDTH * GFX_GLYPH_HEIGHT];
+};
+
+static struct gfx_glyph_set __glyph_cache[GFX_GLYPH_CACHE_SIZE];
+static struct gfx_glyph_stats __glyph_stats;
+static uint32_t __glyph_clock = 0;
+/* Held while a set is in use so it is not replaced under the blitter */
+static spinlock_t __glyph_lock = SPINLOCK_UNLOCKED;
+
+static void __glyph_expand(struct gfx_glyph_set* set, struct gfx_font* font, uint8_t fg, uint8_t bg)
+{
+    set->font = font;
+    set->fg = fg;
+    set->bg = bg;
+
+    memset(set->pixels, bg, sizeof(set->pixels));
+    for (int c = 0; c < font->glyphs && c < GFX_GLYPH_MAX; c++){
+        uint8_t* pixel = set->pixels[c];
+        for (int l = 0; l < GFX_GLYPH_HEIGHT; l++){
+            for (int i = 0; i < GFX_GLYPH_WIDTH; i++, pixel++){
+                if(font->bitmap[c][l] & (1 << i)) *pixel = fg;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finds the expanded font for fg, bg, expanding it on a miss.
+ * Must be called with __glyph_lock held.
+ */
+static struct gfx_glyph_set* __glyph_lookup(struct gfx_font* font, uint8_t fg, uint8_t bg)
+{
+    struct gfx_glyph_set* oldest = &__glyph_cache[0];
+
+    __glyph_clock++;
+    for (int i = 0; i < GFX_GLYPH_CACHE_SIZE; i++){
+        struct gfx_glyph_set* set = &__glyph_cache[i];
+        if(set->font == font && set->fg == fg && set->bg == bg){
+            set->used = __glyph_clock;
+            __glyph_stats.hits++;
+            return set;
+        }
+        if(set->used < oldest->used) oldest = set;
+    }
+
+    __glyph_stats.misses++;
+    __glyph_expand(oldest, font, fg, bg);
+    oldest->used = __glyph_clock;
+    return oldest;
+}
+
+static inline const uint8_t* __glyph_pixels(struct gfx_glyph_set* set, unsigned char c)
+{
+    return set->pixels[c < GFX_GLYPH_MAX ? c : 0];
+}
+
+/**
+ * @brief Draws len characters of str at x, y, glyph backgrounds included.
+ * Each destination row is filled with one row copy per visible character.
+ */
+void gfx_text_blit(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, struct gfx_font* font, const char* str, int len, uint8_t fg, uint8_t bg)
+{
+    struct gfx_rect area = GFX_RECT(x, y, len * GFX_GLYPH_WIDTH, GFX_GLYPH_HEIGHT);
+    struct gfx_rect r = gfx_rect_intersect(&area, clip);
+    if(GFX_RECT_EMPTY(&r)) return;
+
+    /* Characters at least partly inside the clip */
+    int first = (r.x - x) / GFX_GLYPH_WIDTH;
+    int last = (r.x + r.width - 1 - x) / GFX_GLYPH_WIDTH;
+
+    spin_lock(&__glyph_lock);
+    struct gfx_glyph_set* set = __glyph_lookup(font, fg, bg);
+
+    for (int row = r.y; row < r.y + r.height; row++){
+        uint8_t* to = dst + row * dst_pitch;
+        int line = (row - y) * GFX_GLYPH_WIDTH;
+
+        for (int i = first; i <= last; i++){
+            const uint8_t* from = __glyph_pixels(set, str[i]) + line;
+            int gx = x + i * GFX_GLYPH_WIDTH;
+
+            if(gx >= r.x && gx + GFX_GLYPH_WIDTH <= r.x + r.width){
+                ((__glyph_u32*)(to + gx))[0] = ((const __glyph_u32*)from)[0];
+                ((__glyph_u32*)(to + gx))[1] = ((const __glyph_u32*)from)[1];
+                continue;
+            }
+
+            int start = gx < r.x ? r.x - gx : 0;
+            int end = gx + GFX_GLYPH_WIDTH > r.x + r.width ? r.x + r.width - gx : GFX_GLYPH_WIDTH;
+            memcpy(to + gx + start, from + start, end - start);
+        }
+    }
+
+    spin_unlock(&__glyph_lock);
+}
+
+/* Byte mask for each 4 bit group of a font row, bit i selects pixel i */
+#define NIBBLE_MASK(n) ((n & 1 ? 0xFF : 0) | (n & 2 ? 0xFF00 : 0) | (n & 4 ? 0xFF0000 : 0) | (n & 8 ? 0xFF000000 : 0))
+static const uint32_t __glyph_masks[16] = {
+    NIBBLE_MASK(0), NIBBLE_MASK(1), NIBBLE_MASK(2), NIBBLE_MASK(3),
+    NIBBLE_MASK(4), NIBBLE_MASK(5), NIBBLE_MASK(6), NIBBLE_MASK(7),
+    NIBBLE_MASK(8), NIBBLE_MASK(9), NIBBLE_MASK(10), NIBBLE_MASK(11),
+    NIBBLE_MASK(12), NIBBLE_MASK(13), NIBBLE_MASK(14), NIBBLE_MASK(15)
+};
+
+/**
+ * @brief Draws len characters of str at x, y, only the glyph pixels.
+ * Transparent text needs no expanded font, each font row becomes two word
+ * masks that merge fg into the destination.
+ */
+void gfx_text_blit_masked(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, struct gfx_font* font, const char* str, int len, uint8_t fg)
+{
+    struct gfx_rect area = GFX_RECT(x, y, len * GFX_GLYPH_WIDTH, GFX_GLYPH_HEIGHT);
+    struct gfx_rect r = gfx_rect_intersect(&area, clip);
+    if(GFX_RECT_EMPTY(&r)) return;
+
+    int first = (r.x - x) / GFX_GLYPH_WIDTH;
+    int last = (r.x + r.width - 1 - x) / GFX_GLYPH_WIDTH;
+    uint32_t color = fg * 0x01010101;
+
+    for (int row = r.y; row < r.y + r.height; row++){
+        uint8_t* to = dst + row * dst_pitch;
+        int line = row - y;
+
+        for (int i = first; i <= last; i++){
+            unsigned char c = str[i];
+            uint8_t bits = c < font->glyphs ? font->bitmap[c][line] : 0;
+            if(bits == 0) continue;
+
+            int gx = x + i * GFX_GLYPH_WIDTH;
+            if(gx >= r.x && gx + GFX_GLYPH_WIDTH <= r.x + r.width){
+                __glyph_u32* pixels = (__glyph_u32*)(to + gx);
+                uint32_t low = __glyph_masks[bits & 0xF];
+                uint32_t high = __glyph_masks[bits >> 4];
+                pixels[0] = (pixels[0] & ~low) | (color & low);
+                pixels[1] = (pixels[1] & ~high) | (color & high);
+                continue;
+            }
+
+            for (int j = 0; j < GFX_GLYPH_WIDTH; j++){
+                if((bits & (1 << j)) && gx + j >= r.x && gx + j < r.x + r.width) to[gx + j] = fg;
+            }
+        }
+    }
+}
+
+void gfx_glyph_stats(struct gfx_glyph_stats* stats)
+{
+    *stats = __glyph_stats;
+}
@@ -14,12 +14,14 @@
 #include <gfx/composition.h>
 #include <gfx/theme.h>
 #include <gfx/gfxlib.h>
+#include <gfx/blit.h>
 #include <colors.h>
 #include <serial.h>
 #include <vbe.h>
 #include <errors.h>
 #include <kutils.h>
 #include <lib/icons.h>
+#include <memory.h>
 
 //#define __WINDOWS_95
 
@@ -91,15 +93,12 @@ void gfx_draw_window(uint8_t* buffer, struct window* window)
 
     /* Copy inner window framebuffer to given buffer with relativ pitch.  If it is NOT hidden.*/
     if(window->inner != NULL && !HAS_FLAG(window->flags, GFX_IS_HIDDEN)){
-        int i, j, c = 0;
-        for (j = window->y+padding; j < (window->y+padding+window->inner_height); j++)
-            for (i = window->x+padding; i < (window->x+padding+window->inner_width); i++){
-                if(HAS_FLAG(window->flags, GFX_IS_TRANSPARENT) && window->inner[c] == 255){
-                    c++;
-                    continue;
-                }
-                putpixel(buffer, i, j, window->inner[c++], vbe_info->pitch);
-            }
+        struct gfx_rect screen = GFX_RECT(0, 0, vbe_info->width, vbe_info->height);
+        if(HAS_FLAG(window->flags, GFX_IS_TRANSPARENT)){
+            gfx_blit_masked(buffer, vbe_info->pitch, &screen, window->x+padding, window->y+padding, window->inner, window->inner_width, window->inner_height, window->pitch, GFX_TRANSPARENT_COLOR);
+        } else {
+            gfx_blit(buffer, vbe_info->pitch, &screen, window->x+padding, window->y+padding, window->inner, window->inner_width, window->inner_height, window->pitch);
+        }
     }
 
      if(!HAS_FLAG(window->flags, GFX_HIDE_HEADER)){            
@@ -184,6 +183,27 @@ void gfx_draw_window(uint8_t* buffer, struct window* window)
     return;
 }   
 
+/**
+ * @brief Screen area covered by the window, including the header
+ * above y and the moving outline on the right and bottom edges.
+ */
+struct gfx_rect gfx_window_bounds(struct window* w)
+{
+    return GFX_RECT(w->x, w->y - 4, w->width + 1, w->height + 5);
+}
+
+/**
+ * @brief Marks part of the inner buffer as drawn to, it is composed after the next commit.
+ */
+void gfx_window_damage(struct window* w, int x, int y, int width, int height)
+{
+    struct gfx_rect inner = GFX_RECT(0, 0, w->inner_width, w->inner_height);
+    struct gfx_rect r = GFX_RECT(x, y, width, height);
+
+    r = gfx_rect_intersect(&r, &inner);
+    w->pending = gfx_rect_union(&w->pending, &r);
+}
+
 void gfx_window_set_resizable()
 {
     $process->current->gfx_window->is_resizable = 1;
@@ -225,6 +245,78 @@ static void gfx_window_resize(struct window* w, int width, int height)
     kfree(old);
 }
 
+/**
+ * @brief Maps a back buffer for the window into its owner process.
+ * The back buffer is as large as the screen with the screen width as pitch,
+ * so the mapping stays valid when the window is resized or made fullscreen.
+ * It is a page aligned kernel allocation, kernel memory is identity mapped
+ * so its pages are mapped directly into the shared region of the process.
+ * @return uintptr_t address of the back buffer in the process, 0 on error.
+ */
+uintptr_t gfx_window_map_backbuffer(struct window* w)
+{
+    if(w->backbuffer.addr != 0) return w->backbuffer.addr;
+
+    int pitch = vbe_info->width;
+    int pages = ALIGN(pitch * vbe_info->height, PAGE_SIZE) / PAGE_SIZE;
+
+    void* alloc = kalloc((pages + 1) * PAGE_SIZE);
+    if(alloc == NULL) return 0;
+    uint8_t* pixels = (uint8_t*) ALIGN((uintptr_t) alloc, PAGE_SIZE);
+
+    uint32_t* frames = kalloc(pages * sizeof(uint32_t));
+    if(frames == NULL){
+        kfree(alloc);
+        return 0;
+    }
+    for (int i = 0; i < pages; i++){
+        frames[i] = (uint32_t) pixels + i * PAGE_SIZE;
+    }
+
+    uintptr_t addr = vmem_map_shared(w->owner, frames, pages);
+    kfree(frames);
+    if(addr == 0){
+        kfree(alloc);
+        return 0;
+    }
+
+    /* Start from what is on screen, so partial presents keep the rest. */
+    struct gfx_rect all = GFX_RECT(0, 0, w->inner_width, w->inner_height);
+    gfx_blit(pixels, pitch, &all, 0, 0, w->inner, w->inner_width, w->inner_height, w->pitch);
+
+    w->backbuffer.pixels = pixels;
+    w->backbuffer.addr = addr;
+    w->backbuffer.pitch = pitch;
+    w->backbuffer.pages = pages;
+    w->backbuffer._alloc = alloc;
+
+    return addr;
+}
+
+/**
+ * @brief Copies an area of the back buffer into the window.
+ * The copy is done without being preempted by the compositor,
+ * so it never composes a half presented frame.
+ * @return int 0 on success, less than 0 on error.
+ */
+int gfx_window_present(struct window* w, int x, int y, int width, int height)
+{
+    if(w->backbuffer.pixels == NULL) return -ERROR_INVALID_ARGUMENTS;
+
+    ENTER_CRITICAL();
+
+    struct gfx_rect area = GFX_RECT(x, y, width, height);
+    struct gfx_rect inner = GFX_RECT(0, 0, w->inner_width, w->inner_height);
+    area = gfx_rect_intersect(&area, &inner);
+
+    gfx_blit(w->inner, w->pitch, &area, 0, 0, w->backbuffer.pixels, w->inner_width, w->inner_height, w->backbuffer.pitch);
+    gfx_window_damage(w, area.x, area.y, area.width, area.height);
+
+    LEAVE_CRITICAL();
+
+    return ERROR_OK;
+}
+
 /**
  * @brief Default handler for click event from mouse on given window.
  * 
@@ -375,6 +467,11 @@ int gfx_destroy_window(struct window* w)
     
     gfx_composition_remove_window(w);
 
+    if(w->backbuffer.addr != 0){
+        vmem_unmap_shared(w->owner, w->backbuffer.addr, w->backbuffer.pages);
+        kfree(w->backbuffer._alloc);
+    }
+
     kfree(w->inner);
     w->owner->gfx_window = NULL;
     kfree(w);
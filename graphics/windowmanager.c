@@ -60,6 +60,10 @@ int init_windowmanager(struct windowmanager* wm, int flags)
     }
     memset(wm->composition_buffer, 0x0, VBE_SIZE());
 
+    /* first frame composes the whole screen */
+    gfx_damage_init(&wm->damage, vbe_info->width, vbe_info->height);
+    gfx_damage_init(&wm->redraw, vbe_info->width, vbe_info->height);
+    gfx_damage_all(&wm->damage);
 
     wm->spinlock = SPINLOCK_UNLOCKED;
     wm->windows = NULL;
@@ -83,20 +87,36 @@ int init_windowmanager(struct windowmanager* wm, int flags)
     return ERROR_OK;
 }
 
+/**
+ * @brief wm_default_changes adds the screen area of changed windows to wm->damage
+ * A moved, resized or otherwise changed window damages both where it was and
+ * where it is now, a window that only committed drawing damages the drawn area.
+ * @param wm windowmanager
+ * @return int 1 if any part of the screen needs to be composed again
+ */
 static int wm_default_changes(struct windowmanager* wm)
 {
     ERR_ON_NULL(wm);
     WM_VALIDATE(wm);
 
-    struct window* w = wm->windows;
+    ENTER_CRITICAL();
+    for (struct window* w = wm->windows; w != NULL; w = w->next){
+        struct gfx_rect bounds = gfx_window_bounds(w);
 
-    while(w != NULL){
-        if(w->changed)
-            return 1;
-        w = w->next;
+        if(w->changed || memcmp(&bounds, &w->drawn, sizeof(bounds)) != 0){
+            gfx_damage_add(&wm->damage, w->drawn);
+            gfx_damage_add(&wm->damage, bounds);
+        } else if(!GFX_RECT_EMPTY(&w->dirty)){
+            int padding = HAS_FLAG(w->flags, GFX_HIDE_HEADER) ? 0 : 8;
+            gfx_damage_add(&wm->damage, GFX_RECT(w->x + padding + w->dirty.x, w->y + padding + w->dirty.y, w->dirty.width, w->dirty.height));
+        }
+
+        w->drawn = bounds;
+        w->dirty = GFX_RECT(0, 0, 0, 0);
     }
+    LEAVE_CRITICAL();
 
-    return 0;
+    return wm->damage.count > 0;
 }
 
 
@@ -154,6 +174,9 @@ static int wm_default_workspace(struct windowmanager* wm, int workspace)
     /* set new workspace */
     wm->windows = wm->workspaces[workspace];
     wm->workspace = workspace;
+    ENTER_CRITICAL();
+    gfx_damage_all(&wm->damage);
+    LEAVE_CRITICAL();
 
     return ERROR_OK;
 }
@@ -196,6 +219,12 @@ static int wm_default_remove(struct windowmanager* wm, struct window* window)
     }
     wm->window_count--;
 
+    /* uncover whatever was behind the window */
+    ENTER_CRITICAL();
+    gfx_damage_add(&wm->damage, window->drawn);
+    LEAVE_CRITICAL();
+    window->drawn = GFX_RECT(0, 0, 0, 0);
+
     spin_unlock(&wm->spinlock);
 
     return ERROR_OK; 
@@ -280,6 +309,7 @@ static int wm_default_push_front(struct windowmanager* wm, struct window* window
 
 /**
  * @brief wm_default_draw draws the windows from back to front recursively
+ * Only windows overlapping wm->redraw are drawn, the rest of the composition buffer is untouched.
  * TODO: add a max depth to this to prevent stack overflow
  * @warning this can cause a stack overflow if there are too many windows
  * @param wm windowmanager
@@ -298,7 +328,10 @@ static int wm_default_draw(struct windowmanager* wm, struct window* window)
         wm->ops->draw(wm, window->next);
     }
     
-    window->draw->draw(wm->composition_buffer, window);
+    struct gfx_rect bounds = gfx_window_bounds(window);
+    if(gfx_damage_overlaps(&wm->redraw, &bounds)){
+        window->draw->draw(wm->composition_buffer, window);
+    }
 
     return ERROR_OK;
 }
@@ -12,6 +12,7 @@
 #include <gfx/windowserver.h>
 #include <keyboard.h>
 #include <gfx/gfxlib.h>
+#include <gfx/blit.h>
 #include <scheduler.h>
 #include <gfx/events.h>
 #include <memory.h>
@@ -85,6 +86,9 @@ static int ws_raw_wallpaper(struct windowserver* ws, char* path)
     for(int i = 0; i < 640*480; i++){
         ws->background[i] = rgb_to_vga(ws->background[i]);
     }
+    ENTER_CRITICAL();
+    gfx_damage_all(&ws->_wm->damage);
+    LEAVE_CRITICAL();
 
     return ERROR_OK;
 }
@@ -152,6 +156,9 @@ static int ws_fullscreen(struct windowserver* ws, struct window* window)
 
         ws->_is_fullscreen = true;
     }
+    ENTER_CRITICAL();
+    gfx_damage_all(&ws->_wm->damage);
+    LEAVE_CRITICAL();
 
     return ERROR_OK;
 }
@@ -173,6 +180,9 @@ static int ws_set_background(struct windowserver* ws, color_t color)
     WS_VALIDATE(ws);
 
     memset(ws->background, color, VBE_SIZE());
+    ENTER_CRITICAL();
+    gfx_damage_all(&ws->_wm->damage);
+    LEAVE_CRITICAL();
     // int j, i;
     // for (i = 0; i < 640; i++) {
     //     for (j = 0; j < 480; j++) {
@@ -200,12 +210,6 @@ static int ws_set_background_file(struct windowserver* ws, const char* path)
 
     int originalWidth = 320;  
     int originalHeight = 240; 
-    int targetWidth = vbe_info->width;    
-    int targetHeight = vbe_info->height;   
-
-     /* upscale image */
-    float scaleX = (float)targetWidth / (float)originalWidth;
-    float scaleY = (float)targetHeight / (float)originalHeight;
 
     ubyte_t* temp = kalloc(320*240);
     if(temp == NULL){
@@ -230,26 +234,18 @@ static int ws_set_background_file(struct windowserver* ws, const char* path)
     int out;
     decode_run_length(temp, ret, temp_window, &out);
 
-    for (int i = 0; i < originalWidth; i++){
-        for (int j = 0; j < originalHeight; j++){
-           
-            int screenX = (int)(i * scaleX);
-            int screenY = (int)(j * scaleY);
-
-           
-            unsigned char pixelValue = rgb_to_vga(temp_window[j * originalWidth + i]);
-
-           
-            for (int x = 0; x < scaleX; x++){
-                for (int y = 0; y < scaleY; y++){
-                    vesa_put_pixel(ws->background, screenX + x, screenY + y, pixelValue);
-                }
-            }
-        }
+    for (int i = 0; i < originalWidth*originalHeight; i++){
+        temp_window[i] = rgb_to_vga(temp_window[i]);
     }
 
+    /* upscale image */
+    gfx_blit_scaled(ws->background, vbe_info->width, vbe_info->height, vbe_info->pitch, temp_window, originalWidth, originalHeight, originalWidth);
+
     kfree(temp);
     kfree(temp_window);
+    ENTER_CRITICAL();
+    gfx_damage_all(&ws->_wm->damage);
+    LEAVE_CRITICAL();
     return ERROR_OK;
 }
 
@@ -310,41 +306,152 @@ static int __ws_key_event(struct windowserver* ws, unsigned char key)
     return ERROR_OK;
 }
 
+#define WS_CURSOR_SIZE 16
+/* "Workspace %d" in the bottom left corner */
+#define WS_WORKSPACE_LABEL() GFX_RECT(8, vbe_info->height - 8, 12*8, 8)
+
+/**
+ * @brief Grows the redraw area with rect if rect overlaps it.
+ * @return int 1 if the redraw area grew.
+ */
+static int __ws_redraw_overlapping(struct gfx_damage* redraw, struct gfx_rect rect)
+{
+    if(!gfx_damage_overlaps(redraw, &rect) || gfx_damage_contains(redraw, &rect)){
+        return 0;
+    }
+
+    gfx_damage_add(redraw, rect);
+    return 1;
+}
+
+/**
+ * @brief Computes the area that is redrawn to compose the damaged area.
+ * Windows, the workspace label and the mouse icon are always drawn whole,
+ * so the redraw area must cover everything overlapping it. Otherwise a
+ * window partly inside would be drawn over pixels that were not restored.
+ * Only the damage itself is flushed, everything else redraws to the same pixels.
+ */
+static void __ws_expand_damage(struct windowserver* ws, struct gfx_damage* damage)
+{
+    struct windowmanager* wm = ws->_wm;
+    int grown;
+
+    wm->redraw = *damage;
+    do {
+        grown = __ws_redraw_overlapping(&wm->redraw, WS_WORKSPACE_LABEL());
+        for (struct window* w = wm->windows; w != NULL; w = w->next){
+            grown |= __ws_redraw_overlapping(&wm->redraw, gfx_window_bounds(w));
+        }
+        grown |= __ws_redraw_overlapping(&wm->redraw, ws->cursor);
+    } while(grown);
+}
+
+/**
+ * @brief Copies the damaged rectangles row by row from src to dst.
+ * Both buffers have the layout of the screen.
+ * @return int bytes copied.
+ */
+static int __ws_copy_damage(uint8_t* dst, uint8_t* src, struct gfx_damage* damage)
+{
+    int bytes = 0;
+    int pitch = vbe_info->pitch;
+
+    for (int i = 0; i < damage->count; i++){
+        struct gfx_rect* r = &damage->rects[i];
+        for (int y = r->y; y < r->y + r->height; y++){
+            memcpy(dst + y*pitch + r->x, src + y*pitch + r->x, r->width);
+        }
+        bytes += r->width * r->height;
+    }
+
+    return bytes;
+}
+
+/**
+ * @brief Composes the damaged parts of the screen and flushes them to the framebuffer.
+ * The redraw area is restored from the background and the windows overlapping it
+ * are drawn back to front, only the damage itself is copied to the framebuffer.
+ * A fullscreen window draws straight into the composition buffer, so it is flushed whole.
+ * The frame works on a snapshot of the damage, damage added while it is composed
+ * or flushed is left for the next frame.
+ */
 static int ws_draw(struct windowserver* ws)
 {
     ERR_ON_NULL(ws);
     WS_VALIDATE(ws);
+
+    struct windowmanager* wm = ws->_wm;
     
     /* get state variables */
     int mouse_changed = mouse_get_event(&ws->m);
     get_current_time(&ws->time);
-    ws->window_changes = ws->_wm->ops->changes(ws->_wm);
     unsigned char key = kb_get_char(0);
 
     __ws_key_event(ws, key);
-    
-    if((ws->window_changes || mouse_changed ) && !ws->_is_fullscreen){
-        memcpy(ws->_wm->composition_buffer, ws->background, ws->_wm->composition_buffer_size);
+    ws->window_changes = wm->ops->changes(wm);
 
-        /* write current workspace at the right bottom of screen */
-        vesa_printf(ws->_wm->composition_buffer, 8, vbe_info->height -8, 0x1F, "Workspace %d", ws->workspace);
+    struct gfx_damage damage;
+    ENTER_CRITICAL();
+    if(mouse_changed && !ws->_is_fullscreen){
+        gfx_damage_add(&wm->damage, ws->cursor);
+        ws->cursor = GFX_RECT(ws->m.x, ws->m.y, WS_CURSOR_SIZE, WS_CURSOR_SIZE);
+        gfx_damage_add(&wm->damage, ws->cursor);
+    }
+    damage = wm->damage;
+    gfx_damage_clear(&wm->damage);
+    LEAVE_CRITICAL();
 
-        ws->_wm->ops->draw(ws->_wm, ws->_wm->windows);
-        vesa_put_icon16(ws->_wm->composition_buffer, ws->m.x, ws->m.y);
+    int restored = 0;
+    unsigned long long start = rdtsc();
+    if(damage.count > 0 && !ws->_is_fullscreen){
+        __ws_expand_damage(ws, &damage);
+        restored = __ws_copy_damage(wm->composition_buffer, ws->background, &wm->redraw);
+
+        struct gfx_rect label = WS_WORKSPACE_LABEL();
+        if(gfx_damage_overlaps(&wm->redraw, &label)){
+            /* write current workspace at the left bottom of screen */
+            vesa_printf(wm->composition_buffer, label.x, label.y, 0x1F, "Workspace %d", ws->workspace);
+        }
+
+        if(wm->windows != NULL){
+            wm->ops->draw(wm, wm->windows);
+        }
+
+        if(gfx_damage_overlaps(&wm->redraw, &ws->cursor)){
+            vesa_put_icon16(wm->composition_buffer, ws->m.x, ws->m.y);
+        }
     }
+    unsigned long long composed = rdtsc() - start;
 
     /* Move out of this module */
     kernel_yield();
 
-    ENTER_CRITICAL();
-    /* Copy buffer over to framebuffer. */
-    xmemcpy((uint8_t*)vbe_info->framebuffer, ws->_wm->composition_buffer, ws->_wm->composition_buffer_size);
+    if(ws->_is_fullscreen){
+        if(ws->window_changes){
+            gfx_damage_all(&damage);
+        } else {
+            gfx_damage_clear(&damage);
+        }
+    }
 
-    LEAVE_CRITICAL();
+    if(damage.count > 0){
+        start = rdtsc();
+
+        ENTER_CRITICAL();
+        /* Copy damaged parts of buffer over to framebuffer. */
+        int flushed = __ws_copy_damage((uint8_t*)vbe_info->framebuffer, wm->composition_buffer, &damage);
+        LEAVE_CRITICAL();
+
+        ws->stats.frames++;
+        ws->stats.frame_time = (uint32_t)(composed + rdtsc() - start);
+        ws->stats.restored = restored;
+        ws->stats.flushed = flushed;
+        ws->stats.total_flushed += flushed / 1024;
+    }
 
     if(mouse_changed){
         /* internal mouse event for windows */
-        ws->_wm->ops->mouse_event(ws->_wm, ws->m.x, ws->m.y, ws->m.flags);
+        wm->ops->mouse_event(wm, ws->m.x, ws->m.y, ws->m.flags);
     }
     //vesa_put_icon16((uint8_t*)vbe_info->framebuffer, ws->m.x, ws->m.y);
 
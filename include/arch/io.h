@@ -11,4 +11,7 @@ void outportb(uint16_t portid, uint8_t value);
 void outportw(uint16_t portid, uint16_t value);
 void outportl(uint16_t portid, uint32_t value);
 
+void insw(uint16_t portid, void* buf, uint32_t count);
+void outsw(uint16_t portid, const void* buf, uint32_t count);
+
 #endif /* __IO_H */
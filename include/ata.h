@@ -35,8 +35,42 @@
 
 #define ATA_CMD_IDENTIFY          0xEC
 #define ATA_CMD_CACHE_FLUSH       0xE7
+#define ATA_CMD_CACHE_FLUSH_EXT   0xEA
 #define ATA_CMD_READ_PIO          0x20
+#define ATA_CMD_READ_PIO_EXT      0x24
 #define ATA_CMD_WRITE_PIO         0x30
+#define ATA_CMD_WRITE_PIO_EXT     0x34
+#define ATA_CMD_READ_MULTIPLE     0xC4
+#define ATA_CMD_READ_MULTIPLE_EXT 0x29
+#define ATA_CMD_WRITE_MULTIPLE    0xC5
+#define ATA_CMD_WRITE_MULTIPLE_EXT 0x39
+#define ATA_CMD_SET_MULTIPLE      0xC6
+#define ATA_CMD_READ_DMA          0xC8
+#define ATA_CMD_READ_DMA_EXT      0x25
+#define ATA_CMD_WRITE_DMA         0xCA
+#define ATA_CMD_WRITE_DMA_EXT     0x35
+
+/* Device control register */
+#define ATA_CTRL_NIEN  0x02    // Disable device interrupts
+
+/* PCI bus master IDE registers, offsets from BAR4 */
+#define ATA_BMR_COMMAND  0x00
+#define ATA_BMR_STATUS   0x02
+#define ATA_BMR_PRDT     0x04
+
+#define ATA_BMR_CMD_START  0x01
+#define ATA_BMR_CMD_READ   0x08    // Transfer from device to memory
+#define ATA_BMR_SR_ERR     0x02
+#define ATA_BMR_SR_IRQ     0x04
+
+#define ATA_PCI_BAR4       0x20
+
+/* One PRD entry may describe up to 64KB, and may not cross a 64KB boundary */
+#define ATA_PRD_EOT        0x8000
+#define ATA_PRD_ENTRIES    4
+#define ATA_DMA_MAX_SECTORS 128
+
+#define ATA_LBA28_MAX      0x0FFFFFFF
 
 #define ATA_SR_BSY     0x80	   // BUSY
 #define ATA_SR_ERR     0x01    // Error
@@ -45,6 +79,8 @@
 
 
 #define ATA_IDENT_DEVICETYPE   0
+#define ATA_IDENT_MAX_MULTIPLE 94
+#define ATA_IDENT_CAPABILITIES 98
 
 #define ATA_IDENT_MODEL        54
 #define ATA_IDE_MODEL_LENGTH 41
@@ -65,7 +101,25 @@ struct ide_device {
    unsigned char  model[ATA_IDE_MODEL_LENGTH];   // Model in string.
 };
 
+struct ata_prd {
+   uint32_t address;
+   uint16_t size;     // 0 means 64KB
+   uint16_t flags;
+} __attribute__((packed));
+
+struct ata_info {
+   uint8_t dma;
+   uint8_t lba48;
+   uint8_t multiple;  // Sectors per READ/WRITE MULTIPLE block, 0 if unsupported.
+
+   uint32_t commands;
+   uint32_t sectors;
+   uint32_t interrupts;
+   uint32_t errors;
+};
+
 void ata_ide_init(struct pci_device* dev);
+int ata_get_info(struct ata_info* info);
 
 #endif /* ATA_H */
 
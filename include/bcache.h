@@ -0,0 +1,55 @@
+#ifndef __BCACHE_H
+#define __BCACHE_H
+
+#include <stdint.h>
+#include <kutils.h>
+#include <errors.h>
+
+#define BCACHE_BLOCK_SIZE 512
+#define BCACHE_DEFAULT_SIZE 64
+#define BCACHE_MAX_SIZE 1024
+#define BCACHE_HASH_SIZE 128
+/* Most blocks read or written with a single disk command */
+#define BCACHE_RUN_MAX 32
+
+/**
+ * @brief A cached disk block.
+ * Buffers are found through a hash on the block number and kept on
+ * a LRU list, a buffer is only reused once no one holds a reference.
+ */
+struct buffer {
+	uint32_t block;
+	uint8_t valid;
+	uint8_t dirty;
+	int refs;
+
+	struct buffer* hash_next;
+
+	/* LRU list, most recently used first */
+	struct buffer* prev;
+	struct buffer* next;
+
+	byte_t data[BCACHE_BLOCK_SIZE];
+};
+
+struct bcache_info {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t reads;      /* blocks read from disk */
+	uint32_t writes;     /* blocks written to disk */
+	int size;
+	int dirty;
+};
+
+error_t bcache_init(int size);
+
+struct buffer* bread(int block);
+struct buffer* bget(int block);
+int bread_ahead(int block, int count);
+void bdirty(struct buffer* buf);
+void brelse(struct buffer* buf);
+
+int bcache_sync();
+int bcache_get_info(struct bcache_info* info);
+
+#endif /* __BCACHE_H */
@@ -13,7 +13,19 @@ int get_free_bitmap(bitmap_t b, int n);
 void destroy_bitmap(bitmap_t b);
 int get_bitmap_size(int n);
 
+int get_bitmap(bitmap_t b, int i);
+
 int bitmap_get_continous(bitmap_t b, int n, int size);
 int bitmap_unset_continous(bitmap_t b, int start, int size);
+void bitmap_set_continous(bitmap_t b, int start, int size);
+
+/* Searches without modifying the bitmap, -1 if nothing was found. */
+int bitmap_find_free(bitmap_t b, int n, int start);
+int bitmap_find_set(bitmap_t b, int n, int start);
+int bitmap_find_continous(bitmap_t b, int n, int size, int start);
+
+/* Next-fit allocation, hint is a cursor owned by the caller. */
+int bitmap_get_free_next(bitmap_t b, int n, int* hint);
+int bitmap_get_continous_next(bitmap_t b, int n, int size, int* hint);
 
 #endif /* BITMAP_H */
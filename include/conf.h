@@ -11,6 +11,7 @@
 
 int kernel_config_load(char* filename);
 char* kernel_config_get_value(char* section, char* name);
+int kernel_config_get_int(char* section, char* name, int def);
 int config_list();
 bool_t kernel_config_check(char* section, char* name, char* value);
 
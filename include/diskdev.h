@@ -2,6 +2,10 @@
 #define  __DISK_H
 
 #include <ata.h>
+#include <bcache.h>
+
+/* Most blocks read ahead with one disk command */
+#define DISK_RUN_MAX BCACHE_RUN_MAX
 
 void attach_disk_dev(
     int (*read)(char* buffer, uint32_t from, uint32_t size), 
@@ -29,6 +33,7 @@ int write_block_offset(void* usr_buf, int size, int offset, int block);
 
 int read_block(void* buf, int block);
 int read_block_offset(void* usr_buf, int size, int offset, int block);
+int read_block_ahead(int block, int count);
 
 int disk_size();
 
@@ -4,6 +4,13 @@
 #include <stdint.h>
 #include <pci.h>
 
+/* Descriptor ring sizes, multiples of 8 so the ring length is a multiple of 128 bytes */
+#define E1000_RX_RING_SIZE 256
+#define E1000_TX_RING_SIZE 256
+
+/* Interrupt rate limit, the card raises at most this many interrupts per second */
+#define E1000_MAX_INT_RATE 8000
+
 #define E1000_VENDOR_ID 0x8086
 #define E1000_DEVICE_ID 0x100E
 
@@ -51,6 +58,7 @@
 /* Recieve */
 #define E1000_ICS      0x000C8  /* Interrupt Cause Set - WO */
 #define E1000_IMS      0x000D0  /* Interrupt Mask Set - RW */
+#define E1000_IMC      0x000D8  /* Interrupt Mask Clear - WO */
 #define E1000_RDBAL    0x02800  /* RX Descriptor Base Address Low - RW */
 #define E1000_RDBAH    0x02804  /* RX Descriptor Base Address High - RW */
 #define E1000_RDLEN    0x02808  /* RX Descriptor Length - RW */
@@ -66,10 +74,12 @@
 #define E1000_RA       0x05400  /* Receive Address - RW Array */
 #define E1000_RAH_AV  0x80000000        /* Receive descriptor valid */ 
 
+#define E1000_ITR      0x000C4  /* Interrupt Throttling Rate - RW, in 256ns units */
 #define E1000_RDTR     0x02820  /* RX Delay Timer - RW */
 #define E1000_RADV     0x0282C  /* RX Interrupt Absolute Delay Timer - RW */
 
 #define E1000_RXD_STAT_DD       0x01    /* Descriptor Done */
+#define E1000_RXD_STAT_EOP      0x02    /* End of Packet */
 #define E1000_ICR      0x000C0	/* Interrupt Cause Read - R/clr */
 
 #define E1000_IMS_RXT0    (1 << 7)  // Receive timer interrupt (Receive timer timeout)
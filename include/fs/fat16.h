@@ -78,13 +78,22 @@ struct fat16_file_identifier {
     int16_t index;
 };
 
+/* FAT write statistics, used to measure how many sectors each operation writes. */
+struct fat16_stats {
+    uint32_t fat_sectors_written;
+    uint32_t syncs;
+    uint32_t dirty;
+    uint32_t fat_sectors;
+};
+
 /* internal fat16 utility functions */
 uint16_t get_fat_start_block(void);
 uint16_t get_root_directory_start_block(void);
 uint16_t get_data_start_block();
 uint16_t fat16_get_fat_entry(uint32_t cluster);
 void fat16_set_fat_entry(uint32_t cluster, uint16_t value);
-void fat16_sync_fat_table(void);
+int fat16_sync_fat_table(void);
+int fat16_get_stats(struct fat16_stats* stats);
 void fat16_allocate_cluster(uint32_t cluster);
 void fat16_free_cluster(uint32_t cluster);
 uint32_t fat16_get_free_cluster(void);
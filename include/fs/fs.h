@@ -4,6 +4,7 @@
 #include <libc.h>
 
 #define FS_VERSION 1
+#define FS_SYNC_INTERVAL 5000 /* ms between periodic flushes */
 #define FS_VALIDATE(fs) if(!fs || fs->version != FS_VERSION) return -1;
 
 struct filesystem;
@@ -14,7 +15,9 @@ typedef enum __fs_file_flags {
     FS_FILE_FLAG_READ = 1 << 0,
     FS_FILE_FLAG_WRITE = 1 << 1,
     FS_FILE_FLAG_EXECUTE = 1 << 2,
-    FS_FILE_FLAG_CREATE = 1 << 3
+    FS_FILE_FLAG_CREATE = 1 << 3,
+    /* set when the file was written through another descriptor */
+    FS_FILE_FLAG_CHANGED = 1 << 4
 } fs_file_flag_t;
 
 struct file {
@@ -28,7 +31,7 @@ struct file {
     int size;
 };
 
-/* none of the functions can ever be NULL */
+/* none of the basic functions can ever be NULL */
 struct filesystem_ops {
     /* basic functionality */
     int (*write)(struct filesystem* fs, struct file* file, const void* buf, int size);
@@ -44,6 +47,7 @@ struct filesystem_ops {
     int (*stat)(struct filesystem* fs, const char* path, struct file* file);
     int (*list)(struct filesystem* fs, const char* path, char* buf, int size);
     int (*find)(struct filesystem* fs, char* path, const char* needle);
+    int (*sync)(struct filesystem* fs);
 };
 
 /* filesystem flags as enum */
@@ -80,8 +84,12 @@ int fs_seek(int fd, int offset, fs_seek_flag_t flag);
 
 int fs_open(const char* path, int flags);
 int fs_close(int fd);
+int fs_size(int fd);
 int fs_read(int fd, void* buf, int size);
 int fs_write(int fd, void* buf, int size);
+int fs_changed(int fd);
+int fs_same_file(int fd, int other);
+int fs_sync();
 struct filesystem* fs_get();
 
 
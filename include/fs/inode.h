@@ -37,6 +37,6 @@ struct inode* inode_get(inode_t inode, struct superblock* sb);
 void listdir();
 
 void inodes_sync(struct superblock* sb);
-void sync();
+void vfs_sync();
 
 #endif /* __inode_h */
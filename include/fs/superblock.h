@@ -24,6 +24,14 @@ struct superblock {
 
     inode_t root_inode;
 };
+
+/* Next-fit cursors into the inode and block bitmaps, only kept in memory. */
+struct superblock_hints {
+    int inode;
+    int block;
+};
+
+struct superblock_hints* superblock_get_hints(struct superblock* sb);
 /*
 
     File System Layout.
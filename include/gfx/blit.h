@@ -0,0 +1,21 @@
+#ifndef __GFX_BLIT_H
+#define __GFX_BLIT_H
+
+#include <stdint.h>
+#include <gfx/damage.h>
+
+/**
+ * Blitters used by the compositor to copy pixel buffers into the
+ * composition buffer. All buffers are 8 bits per pixel, pitches are
+ * in bytes. Destination writes are clipped to the clip rectangle,
+ * source coordinates follow the destination.
+ */
+
+/* Color of transparent pixels in GFX_IS_TRANSPARENT windows */
+#define GFX_TRANSPARENT_COLOR 255
+
+void gfx_blit(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, const uint8_t* src, int width, int height, int src_pitch);
+void gfx_blit_masked(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, const uint8_t* src, int width, int height, int src_pitch, uint8_t key);
+void gfx_blit_scaled(uint8_t* dst, int dst_width, int dst_height, int dst_pitch, const uint8_t* src, int src_width, int src_height, int src_pitch);
+
+#endif /* __GFX_BLIT_H */
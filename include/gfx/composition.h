@@ -3,6 +3,8 @@
 
 #include <gfx/window.h>
 
+struct ws_stats;
+
 void gfx_composition_add_window(struct window* w);
 void gfx_composition_remove_window(struct window* w);
 
@@ -14,5 +16,6 @@ int gfx_raw_background(char* path);
 int gfx_set_background_color(color_t color);
 
 int gfx_set_taskbar(pid_t pid);
+int gfx_compositor_stats(struct ws_stats* stats);
 
 #endif /* FCA672BC_C2FD_4772_BC32_C01EF99BEA47 */
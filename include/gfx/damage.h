@@ -0,0 +1,45 @@
+#ifndef __GFX_DAMAGE_H
+#define __GFX_DAMAGE_H
+
+#include <stdint.h>
+
+/**
+ * Damage tracking for the compositor.
+ *
+ * A damage list holds the screen rectangles that changed since the last
+ * frame. Only these are restored from the background, redrawn and flushed
+ * to the framebuffer. The list is bounded, when it is full a new rectangle
+ * is merged into the one it grows the least.
+ */
+
+#define GFX_DAMAGE_MAX 16
+
+/* Rectangle with exclusive right and bottom edges, empty if width or height <= 0 */
+struct gfx_rect {
+    int x, y;
+    int width, height;
+};
+
+struct gfx_damage {
+    int count;
+    struct gfx_rect rects[GFX_DAMAGE_MAX];
+    /* Screen area, all damage is clipped to it */
+    struct gfx_rect bounds;
+};
+
+#define GFX_RECT(_x, _y, _w, _h) ((struct gfx_rect){.x = (_x), .y = (_y), .width = (_w), .height = (_h)})
+#define GFX_RECT_EMPTY(r) ((r)->width <= 0 || (r)->height <= 0)
+#define GFX_RECT_AREA(r) (GFX_RECT_EMPTY(r) ? 0 : (r)->width * (r)->height)
+
+struct gfx_rect gfx_rect_intersect(struct gfx_rect* a, struct gfx_rect* b);
+struct gfx_rect gfx_rect_union(struct gfx_rect* a, struct gfx_rect* b);
+int gfx_rect_overlaps(struct gfx_rect* a, struct gfx_rect* b);
+
+void gfx_damage_init(struct gfx_damage* damage, int width, int height);
+void gfx_damage_clear(struct gfx_damage* damage);
+void gfx_damage_add(struct gfx_damage* damage, struct gfx_rect rect);
+void gfx_damage_all(struct gfx_damage* damage);
+int gfx_damage_overlaps(struct gfx_damage* damage, struct gfx_rect* rect);
+int gfx_damage_contains(struct gfx_damage* damage, struct gfx_rect* rect);
+
+#endif /* __GFX_DAMAGE_H */
@@ -25,6 +25,7 @@ void gfx_line(int x, int y, int length, int option, int color);
 int kernel_gfx_draw_rectangle(struct window* w, int x, int y, int width, int height, color_t color);
 int kernel_gfx_draw_char(struct window* w, int x, int y, unsigned char c, unsigned char color);
 int kernel_gfx_draw_text(struct window* w, int x, int y, char* str, unsigned char color);
+int kernel_gfx_draw_glyphs(struct window* w, int x, int y, const char* str, int len, unsigned char color, unsigned char bg);
 int kernel_gfx_draw_format_text(struct window* w, int x, int y, unsigned char color, char* fmt, ...);
 int kernel_gfx_draw_pixel(struct window* w, int x, int y, color_t color);
 int kernel_gfx_draw_bitmap(struct window* w, int x, int y, int width, int height, uint8_t* bitmap);
@@ -48,5 +49,6 @@ int gfx_button(int x, int y, int width, int height, char* name);
 int gfx_button_ext(int x, int y, int width, int height, char* name, color_t color);
 
 void gfx_commit();
+void gfx_window_commit(struct window* w);
 
 #endif // !__GFXLIB_H
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef __GFX_GLYPH_H
+#define __GFX_GLYPH_H
+
+#include <stdint.h>
+#include <gfx/damage.h>
+
+/**
+ * Glyph cache for 8x8 bitmap fonts.
+ *
+ * Drawing a character used to test every font bit and plot each pixel.
+ * The cache keeps whole fonts expanded to 8 bit pixels for the most
+ * recently used (font, foreground, background) combinations, so text is
+ * drawn by copying glyph rows. Transparent text is merged a word at a
+ * time using masks of the font rows. Buffers and clipping follow gfx/blit.h.
+ */
+
+#define GFX_GLYPH_WIDTH 8
+#define GFX_GLYPH_HEIGHT 8
+/* Glyphs kept per font, characters past the font are drawn blank */
+#define GFX_GLYPH_MAX 128
+/* Expanded fonts kept, the least recently used one is replaced */
+#define GFX_GLYPH_CACHE_SIZE 8
+
+struct gfx_font {
+    uint8_t (*bitmap)[GFX_GLYPH_HEIGHT];
+    int glyphs;
+};
+
+struct gfx_glyph_stats {
+    int hits;
+    int misses;
+};
+
+extern struct gfx_font gfx_font_basic;
+
+void gfx_text_blit(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, struct gfx_font* font, const char* str, int len, uint8_t fg, uint8_t bg);
+void gfx_text_blit_masked(uint8_t* dst, int dst_pitch, struct gfx_rect* clip, int x, int y, struct gfx_font* font, const char* str, int len, uint8_t fg);
+void gfx_glyph_stats(struct gfx_glyph_stats* stats);
+
+#endif /* __GFX_GLYPH_H */
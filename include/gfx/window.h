@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <gfx/events.h>
+#include <gfx/damage.h>
 struct window;
 #include <gfx/component.h>
 #include <terminal.h>
@@ -113,6 +114,21 @@ struct window {
 
     unsigned char flags;
     char changed;
+
+    /* Inner area drawn to since the last commit, and committed area not yet composed. */
+    struct gfx_rect pending;
+    struct gfx_rect dirty;
+    /* Screen area covered the last time the window was composed. */
+    struct gfx_rect drawn;
+
+    /* Back buffer mapped into the owner process, presented into inner. */
+    struct {
+        uint8_t* pixels;
+        uintptr_t addr;
+        int pitch;
+        int pages;
+        void* _alloc;
+    } backbuffer;
 };
 
 
@@ -121,6 +137,10 @@ struct window* gfx_new_window(int width, int height, window_flag_t flags);
 void gfx_draw_window(uint8_t* buffer, struct window* window);
 int gfx_destroy_window(struct window* w);
 void gfx_window_set_resizable();
+void gfx_window_damage(struct window* w, int x, int y, int width, int height);
+struct gfx_rect gfx_window_bounds(struct window* w);
+uintptr_t gfx_window_map_backbuffer(struct window* w);
+int gfx_window_present(struct window* w, int x, int y, int width, int height);
 
 
 #endif //  __WINDOW_H   
\ No newline at end of file
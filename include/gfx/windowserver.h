@@ -20,6 +20,18 @@ typedef enum window_server_flags {
 
 struct windowserver;
 
+/* compositor statistics, values are for the last composed frame */
+struct ws_stats {
+    uint32_t frames;
+    /* cycles spent composing and flushing */
+    uint32_t frame_time;
+    /* bytes copied from the background and to the framebuffer */
+    uint32_t restored;
+    uint32_t flushed;
+    /* bytes copied to the framebuffer since boot, in KB */
+    uint32_t total_flushed;
+};
+
 /* window server operations */
 struct window_server_ops {
     int (*init)(struct windowserver* ws);
@@ -59,8 +71,12 @@ struct windowserver {
 
     /* states */
     struct mouse m;
+    /* where the mouse icon was last drawn */
+    struct gfx_rect cursor;
     struct time time;
     int window_changes;
+
+    struct ws_stats stats;
     
     byte_t flags;
 };
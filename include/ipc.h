@@ -5,15 +5,35 @@
 #include <stdint.h>
 #include <rbuffer.h>
 
+struct pcb;
+
+/* Processes that can have a shared memory channel mapped at the same time */
+#define IPC_SHM_MAX_USERS 4
+
 /* IPC Message structure */
 struct ipc_message {
     unsigned char* data; // Pointer to the message data
     int length;          // Length of the message
 };
 
+/* Shared memory backing a channel, mapped into every process attached to it */
+struct ipc_shm {
+    uint32_t* frames;
+    int pages;
+    /* Process that opened the channel, it is closed when the owner exits */
+    struct pcb* owner;
+    int closed;
+
+    struct ipc_shm_user {
+        struct pcb* pcb;
+        uintptr_t addr;
+    } users[IPC_SHM_MAX_USERS];
+};
+
 /* IPC Channel structure */
 struct ipc_channel {
     struct ring_buffer* rbuf; // Ring buffer for the IPC channel
+    struct ipc_shm* shm;      // Shared memory, for channels opened with sys_ipc_shm_open
 };
 
 int sys_ipc_open();
@@ -22,4 +42,13 @@ int sys_ipc_send(int channel, void* data, int length);
 int sys_ipc_send(int channel, void* data, int length);
 int sys_ipc_receive(int channel, void* data, int length);
 
-#endif /* IPC_INTERFACE_H */
\ No newline at end of file
+int sys_ipc_shm_open(int size);
+int sys_ipc_shm_attach(int channel);
+int sys_ipc_shm_detach(int channel);
+
+int sys_futex_wait(uint32_t* addr, uint32_t expected, int timeout);
+int sys_futex_wake(uint32_t* addr);
+
+void ipc_cleanup_process(struct pcb* pcb);
+
+#endif /* IPC_INTERFACE_H */
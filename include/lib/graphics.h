@@ -28,6 +28,9 @@ enum gfx_lib_api_options {
     GFX_DRAW_LINE_OPT,
     GFX_EVEN_LOOP_OPT,
     GFX_DRAW_PIXEL,
+    GFX_DRAW_BATCH_OPT,
+    GFX_MAP_FRAMEBUFFER_OPT,
+    GFX_PRESENT_OPT,
     GFX_DRAW_UNUSED,
 };
 
@@ -71,6 +74,51 @@ struct gfx_char {
     unsigned char color;
 };
 
+/**
+ * Draw calls made between gfx_batch_begin() and gfx_batch_end() are recorded
+ * in a command buffer and drawn by the kernel with a single syscall, when the
+ * buffer is full, on gfx_batch_submit() and before waiting for events.
+ * Every thread draws to its own window, so each thread records into its own
+ * buffer and only submits its own commands.
+ */
+#define GFX_BATCH_MAX 256
+
+struct gfx_command {
+    int option;
+    union {
+        struct gfx_pixel pixel;
+        struct gfx_rectangle rectangle;
+        struct gfx_circle circle;
+        struct gfx_line line;
+        struct gfx_char c;
+    };
+};
+
+struct gfx_batch {
+    int count;
+    struct gfx_command commands[GFX_BATCH_MAX];
+};
+
+/**
+ * Window pixels mapped into the process. Apps draw straight into this back
+ * buffer, 8 bit colors like the window, and gfx_present() the changed area.
+ * The buffer covers the whole screen, so it stays valid when the window is
+ * resized, call gfx_map_framebuffer() again for the new width and height.
+ */
+struct gfx_framebuffer {
+    unsigned char* pixels;
+    int pitch;
+    int width;
+    int height;
+};
+
+int gfx_map_framebuffer(struct gfx_framebuffer* fb);
+int gfx_present(int x, int y, int width, int height);
+
+void gfx_batch_begin();
+int gfx_batch_submit();
+int gfx_batch_end();
+
 int gfx_draw_text(int x, int y, const char* text, unsigned char color);
 int gfx_draw_format_text(int x, int y, unsigned char color, const char* fmt, ...);
 int gfx_draw_char(int x, int y, char data, unsigned char color);
@@ -0,0 +1,169 @@
+#ifndef __LIB_IPC_RING_H
+#define __LIB_IPC_RING_H
+
+#include <stdint.h>
+#include <libc.h>
+#include <lib/syscall.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Single producer, single consumer byte ring in a shared memory IPC channel.
+ *
+ * The process opening the channel calls ipc_ring_init() on its mapping before
+ * passing the channel on. Producer and consumer then copy straight in and out
+ * of the shared pages, or use the _ptr functions to work on them in place.
+ * The kernel is only entered to sleep when the ring is empty or full, and to
+ * wake up a peer that is sleeping.
+ *
+ *  int ch = ipc_shm_open(IPC_RING_SIZE(64*1024));
+ *  struct ipc_ring* ring = ipc_shm_attach(ch);
+ *  ipc_ring_init(ring, IPC_RING_SIZE(64*1024));
+ */
+
+struct ipc_ring {
+    /* Bytes ever written and read, only changed by the producer and the consumer */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    /* Set while the consumer or producer sleeps on head or tail */
+    volatile uint32_t reader_waiting;
+    volatile uint32_t writer_waiting;
+    /* Capacity of the data following the header, a power of two */
+    uint32_t size;
+    uint32_t __reserved[3];
+};
+
+#define IPC_RING_SIZE(capacity) ((int)sizeof(struct ipc_ring) + (capacity))
+
+#define ipc_ring_data(ring) ((uint8_t*)((ring) + 1))
+#define ipc_ring_used(ring) ((ring)->head - (ring)->tail)
+#define ipc_ring_free(ring) ((ring)->size - ipc_ring_used(ring))
+
+static inline void ipc_ring_init(struct ipc_ring* ring, int bytes)
+{
+    uint32_t capacity = bytes - sizeof(struct ipc_ring);
+    uint32_t size = 1;
+    while(size * 2 <= capacity) size *= 2;
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->reader_waiting = 0;
+    ring->writer_waiting = 0;
+    ring->size = size;
+}
+
+/* Contiguous free space at the head, fill it and call ipc_ring_produce(). */
+static inline void* ipc_ring_write_ptr(struct ipc_ring* ring, int* len)
+{
+    uint32_t offset = ring->head & (ring->size - 1);
+    uint32_t free = ipc_ring_free(ring);
+    *len = free < ring->size - offset ? free : ring->size - offset;
+    return ipc_ring_data(ring) + offset;
+}
+
+/* Contiguous data at the tail, use it and call ipc_ring_consume(). */
+static inline const void* ipc_ring_read_ptr(struct ipc_ring* ring, int* len)
+{
+    uint32_t offset = ring->tail & (ring->size - 1);
+    uint32_t used = ipc_ring_used(ring);
+    *len = used < ring->size - offset ? used : ring->size - offset;
+    return ipc_ring_data(ring) + offset;
+}
+
+/* The barriers order the data against the counters, and the counters against the waiting flags. */
+static inline void ipc_ring_produce(struct ipc_ring* ring, int len)
+{
+    __sync_synchronize();
+    ring->head += len;
+    __sync_synchronize();
+    if(ring->reader_waiting) futex_wake(&ring->head);
+}
+
+static inline void ipc_ring_consume(struct ipc_ring* ring, int len)
+{
+    __sync_synchronize();
+    ring->tail += len;
+    __sync_synchronize();
+    if(ring->writer_waiting) futex_wake(&ring->tail);
+}
+
+/* Sleeps until the ring has data, or timeout milliseconds passed, negative waits forever. */
+static inline int ipc_ring_wait_readable(struct ipc_ring* ring, int timeout)
+{
+    int ret = 0;
+    while(ipc_ring_used(ring) == 0 && ret == 0){
+        ring->reader_waiting = 1;
+        __sync_synchronize();
+        uint32_t head = ring->head;
+        if(head != ring->tail) break;
+
+        /* Failed or timed out unless the head moved on */
+        ret = futex_wait(&ring->head, head, timeout);
+        if(ring->head != head) ret = 0;
+    }
+    ring->reader_waiting = 0;
+    return ipc_ring_used(ring) > 0 ? 0 : ret;
+}
+
+/* Sleeps until the ring has free space, or timeout milliseconds passed, negative waits forever. */
+static inline int ipc_ring_wait_writable(struct ipc_ring* ring, int timeout)
+{
+    int ret = 0;
+    while(ipc_ring_free(ring) == 0 && ret == 0){
+        ring->writer_waiting = 1;
+        __sync_synchronize();
+        uint32_t tail = ring->tail;
+        if(ring->head - tail != ring->size) break;
+
+        ret = futex_wait(&ring->tail, tail, timeout);
+        if(ring->tail != tail) ret = 0;
+    }
+    ring->writer_waiting = 0;
+    return ipc_ring_free(ring) > 0 ? 0 : ret;
+}
+
+/* Copies up to len bytes in, without blocking, returns the bytes written. */
+static inline int ipc_ring_write(struct ipc_ring* ring, const void* buf, int len)
+{
+    const uint8_t* from = (const uint8_t*) buf;
+    int written = 0;
+    while(written < len){
+        int room;
+        uint8_t* to = (uint8_t*) ipc_ring_write_ptr(ring, &room);
+        if(room == 0) break;
+
+        int n = len - written < room ? len - written : room;
+        memcpy(to, from + written, n);
+        written += n;
+        /* Publish each chunk, so the consumer can start on the first while the rest wraps */
+        ipc_ring_produce(ring, n);
+    }
+    return written;
+}
+
+/* Copies up to len bytes out, without blocking, returns the bytes read. */
+static inline int ipc_ring_read(struct ipc_ring* ring, void* buf, int len)
+{
+    uint8_t* to = (uint8_t*) buf;
+    int read = 0;
+    while(read < len){
+        int avail;
+        const uint8_t* from = (const uint8_t*) ipc_ring_read_ptr(ring, &avail);
+        if(avail == 0) break;
+
+        int n = len - read < avail ? len - read : avail;
+        memcpy(to + read, from, n);
+        read += n;
+        ipc_ring_consume(ring, n);
+    }
+    return read;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIB_IPC_RING_H */
@@ -0,0 +1,34 @@
+#ifndef __LIB_MALLOC_H
+#define __LIB_MALLOC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Size classes from 16 to 2048 bytes, larger allocations go to the kernel. */
+#define MALLOC_MIN_SHIFT    4
+#define MALLOC_CLASSES      8
+#define MALLOC_MAX_SMALL    (1 << (MALLOC_MIN_SHIFT + MALLOC_CLASSES - 1))
+
+#define MALLOC_ARENA_SIZE   (64*1024)
+#define MALLOC_MAX_ARENAS   32
+
+struct malloc_stats {
+    int mallocs;
+    int frees;
+    int large;
+    int arenas;
+    int syscalls;
+    int bytes;
+    int in_use[MALLOC_CLASSES];
+};
+
+int malloc_get_stats(struct malloc_stats* stats);
+void malloc_dump_stats();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIB_MALLOC_H */
@@ -28,6 +28,24 @@ void* zmalloc(int size);
 void* malloc(int size);
 void free(void* ptr);
 
+void* mmap(int size);
+
+int ipc_shm_open(int size);
+void* ipc_shm_attach(int channel);
+int ipc_shm_detach(int channel);
+int ipc_close(int channel);
+int futex_wait(volatile unsigned int* addr, unsigned int expected, int timeout);
+int futex_wake(volatile unsigned int* addr);
+
+/**
+ * Every thread has its own stack page table, so the 16 bytes above the initial
+ * stack pointer (VMEM_STACK) are private to the thread. The library keeps
+ * per thread state there, they start out zeroed.
+ */
+#define THREAD_LOCAL_BASE 0xEFFFFFF0
+#define THREAD_LOCAL(slot) (((void* volatile*) THREAD_LOCAL_BASE)[slot])
+#define THREAD_LOCAL_GFX_BATCH 0
+
 int thread_create(void* entry, void* arg, int flags);
 void yield();
 
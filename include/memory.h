@@ -6,6 +6,7 @@
 #include <errors.h>
 #include <kutils.h>
 #include <sync.h>
+#include <vmem_heap.h>
 
 #define create(type) ((type *)kcalloc(sizeof(type)))
 
@@ -20,9 +21,22 @@ extern int kernel_size;
 #define PMEM_END_ADDRESS 	 0x200000
 
 
+/* Initial user stack pointer, the 16 bytes above it are thread local (lib/syscall.h THREAD_LOCAL) */
 #define VMEM_STACK          0xEFFFFFF0
 #define VMEM_HEAP           0xE0000000
+/* The heap is mapped by a single page table */
+#define VMEM_HEAP_SIZE      0x400000
+#define VMEM_HEAP_PAGES     (VMEM_HEAP_SIZE/PAGE_SIZE)
+/* Shared memory, like IPC channels, is mapped by a single page table */
+#define VMEM_SHARED         0xD0000000
+#define VMEM_SHARED_SIZE    0x400000
+#define VMEM_SHARED_PAGES   (VMEM_SHARED_SIZE/PAGE_SIZE)
 #define VMEM_DATA           0x1000000
+/* The program image is mapped by a single page table */
+#define VMEM_DATA_SIZE      0x400000
+/* Stack pages are mapped on first touch, up to VMEM_STACK_SIZE below the top page */
+#define VMEM_STACK_SIZE     0x10000
+#define VMEM_STACK_BOTTOM   ((VMEM_STACK & ~PAGE_MASK) + PAGE_SIZE - VMEM_STACK_SIZE)
 
 #define SUPERVISOR          0
 #define PRESENT             1
@@ -77,29 +91,36 @@ struct memory_map {
 struct memory_map* memory_map_get();
 
 
-struct vmem_page_region {
-	int* bits;
-	uint32_t* basevaddr;
-	int refs;
-
-	int size;
-	int used;
-};
-
 struct virtual_allocations {
-	struct allocation* head;
-	struct allocation* tail;
+	struct vmem_heap heap;
+	/* Number of allocations touching each heap page, referenced pages are mapped on first touch. */
+	uint16_t* refs;
 
 	spinlock_t spinlock;
+
+	/* Program image the data section is paged in from, shared by all threads. */
+	struct vmem_image* image;
+
+	/* Page table of the shared region, created on the first mapping. */
+	uint32_t* shared_table;
 };
 
-struct allocation {
-	int* bits;
-	uint32_t* address;
+/* Program images are shared by every process running the same binary */
+#define VMEM_IMAGE_MAX          16
+#define VMEM_IMAGE_PATH_LENGTH  64
+
+struct vmem_image {
+	char path[VMEM_IMAGE_PATH_LENGTH];
+	/* Open program file, pages are read from it on first touch */
+	int fd;
 	int size;
-	int used;
-	struct vmem_page_region* region;
-	struct allocation* next;
+	/* Processes using the image, frames are freed when the last one exits */
+	int refs;
+	/* Private images are made when the table is full and are never shared */
+	bool_t shared;
+	/* Physical frame of every page read so far, mapped read only into each process */
+	uint32_t* frames;
+	mutex_t lock;
 };
 
 #define TABLE_INDEX(vaddr) ((vaddr >> PAGE_TABLE_BITS) & PAGE_TABLE_MASK)
@@ -119,6 +140,39 @@ void kfree(void* ptr);
 int kmemory_used();
 int kmemory_total();
 
+/* Slab caches for fixed size kernel objects */
+#define KMEM_CACHE_MAX          16
+#define KMEM_CACHE_NAME_LENGTH  12
+
+struct kmem_cache {
+	char name[KMEM_CACHE_NAME_LENGTH];
+	int size;
+	int per_slab;
+
+	/* Free objects, the first word of a free object links to the next */
+	void* free;
+
+	struct kmem_cache_stats {
+		uint32_t hits;
+		uint32_t misses;
+		int slabs;
+		int in_use;
+	} stats;
+};
+
+struct kmem_cache_info {
+	char name[KMEM_CACHE_NAME_LENGTH];
+	int size;
+	struct kmem_cache_stats stats;
+};
+
+struct kmem_cache* kmem_cache_create(char* name, int size);
+void* kmem_cache_alloc(struct kmem_cache* cache);
+void* kmem_cache_alloc_atomic(struct kmem_cache* cache);
+int kmem_cache_reserve(struct kmem_cache* cache, int count);
+void kmem_cache_free(struct kmem_cache* cache, void* obj);
+int kmem_cache_get_info(struct kmem_cache_info* info, int max);
+
 /* Permanent memory */
 void* palloc(int size);
 int pmemory_used();
@@ -129,6 +183,7 @@ void free(void* ptr);
 
 /* Assembly helper functions */
 void load_page_directory();
+void tlb_flush_addr(uint32_t addr);
 void enable_paging();
 
 /* Virtual memory API */
@@ -139,15 +194,22 @@ void vmem_cleanup_process(struct pcb* pcb);
 void vmem_cleanup_process_thead(struct pcb* thread);
 
 void vmem_init_process_thread(struct pcb* parent, struct pcb* thread);
-void vmem_init_process(struct pcb* pcb, byte_t* data, int size);
+void vmem_init_process(struct pcb* pcb, struct vmem_image* image);
+struct vmem_image* vmem_image_get(const char* path);
+void vmem_image_put(struct vmem_image* image);
+error_t vmem_page_fault(struct pcb* pcb, uintptr_t addr, uint32_t err);
+error_t vmem_copy_to_process(struct pcb* pcb, uintptr_t vaddr, const void* src, int size);
+error_t vmem_user_to_physical(struct pcb* pcb, uintptr_t vaddr, uintptr_t* paddr);
+
+uint32_t* vmem_shared_alloc(int pages);
+void vmem_shared_free(uint32_t* frames, int pages);
+uintptr_t vmem_map_shared(struct pcb* pcb, uint32_t* frames, int pages);
+void vmem_unmap_shared(struct pcb* pcb, uintptr_t addr, int pages);
+
 void vmem_stack_free(struct pcb* pcb, void* ptr);
 void* vmem_stack_alloc(struct pcb* pcb, int size);
-void vmem_dump_heap(struct allocation* allocation);
 
 int vmem_total_usage();
 
 int vmem_free_allocations(struct pcb* pcb);
-
-void vmem_free_allocation(struct allocation* allocation);
-int vmem_continious_allocation_map(struct pcb* pcb, struct allocation* allocation, uint32_t* address, int num, int access);
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef __NET_CHECKSUM_H
+#define __NET_CHECKSUM_H
+
+#include <stdint.h>
+
+/**
+ * Internet checksum (RFC 1071) shared by IPv4, ICMP, UDP and TCP.
+ *
+ * Partial sums are 32 bit one's complement accumulators, they can be
+ * chained across buffers as long as every buffer starts at an even
+ * offset of the packet, and are turned into the final checksum with
+ * csum_fold(). All sums are over the data as it is in memory, so the
+ * result is stored in the header as is, without byte swapping.
+ */
+
+uint32_t csum_partial(const void* buf, int len, uint32_t sum);
+uint32_t csum_partial_copy(void* dst, const void* src, int len, uint32_t sum);
+uint16_t csum_fold(uint32_t sum);
+
+/* Adds the IPv4 pseudo header to the partial sum, addresses in network byte order. */
+uint32_t csum_pseudo(uint32_t saddr, uint32_t daddr, uint8_t proto, uint16_t len, uint32_t sum);
+
+/* Updates check after a 16 bit word of the checksummed data changed from old to new (RFC 1624). */
+uint16_t csum_update16(uint16_t check, uint16_t old, uint16_t updated);
+
+// call with checksum(hdr, hdr->ihl * 4, 0);
+uint16_t checksum(void *addr, int count, int start_sum);
+
+uint16_t transport_checksum(uint32_t saddr, uint32_t daddr, uint8_t proto, uint8_t *data, uint16_t len);
+
+#endif /* __NET_CHECKSUM_H */
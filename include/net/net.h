@@ -69,10 +69,28 @@ struct net_info {
     int dropped;
     int sent;
     int recvd;
+
+    /* netd batching */
+    int rx_batches;
+    int tx_batches;
+    int rx_batch_max;   /* largest number of packets handled in one batch */
+    int tx_batch_max;
+    int polled;         /* frames received by polling devices */
+    int poll_rounds;    /* rounds where netd kept polling instead of sleeping */
+    int rx_overflow;    /* packets dropped because the RX queue was full */
 };
+
+/* Packets netd handles per round before it gives other threads a chance to run */
+#define NET_RX_BUDGET 64
+#define NET_TX_BUDGET 64
+/* Received packets waiting for netd, beyond this they are dropped */
+#define NET_RX_QUEUE_MAX 1024
 error_t net_get_info(struct net_info* info);
 
 void __callback net_incoming_packet(struct netdev* dev);
+void __callback net_incoming_skb(struct netdev* dev, struct sk_buff* skb);
+void __callback net_schedule_poll(struct netdev* dev);
+void __callback net_wake();
 int net_register_interface(struct net_interface* interface);
 int net_send_skb(struct sk_buff* skb);
 
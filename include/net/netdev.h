@@ -6,6 +6,8 @@
 
 #define MAX_NETDEV_NAME_SIZE 20
 
+struct sk_buff;
+
 /**
  * @brief Main struct that keeps track of a network interface card, especially its stats and read / write functions.
  * 
@@ -23,7 +25,16 @@ struct netdev {
 
     int32_t (*read)(char* buffer, uint32_t size);
     int32_t (*write)(char* buffer, uint32_t size);
-    int32_t (*poll)();
+    /**
+     * Optional, receives at most budget frames. Devices with a poll function
+     * mask their RX interrupt and call net_schedule_poll(), netd then polls
+     * until less than budget frames are returned and the interrupt is enabled again.
+     */
+    int32_t (*poll)(int budget);
+    volatile uint8_t poll_scheduled;
+
+    /* Optional zero copy transmit, the device owns the skb and frees it once sent. */
+    int32_t (*transmit)(struct sk_buff* skb);
 };
 extern struct netdev current_netdev;  
 
@@ -40,6 +40,8 @@ struct networkmanager {
     uint8_t if_count;
 
     struct pcb* instance;
+    /* netd blocks here while there are no packets to handle */
+    wait_queue_t wait;
 
     struct kref ref;
 };
@@ -57,25 +57,71 @@ struct skb_queue {
 
 #define SKB_QUEUE_READY(queue) queue->size > 0
 
+/* Size of the packet buffer attached to each skb */
+#define SKB_DATA_SIZE 0x600
+/* Packets drivers can receive in interrupt context before netd refills the caches */
+#define SKB_RX_RESERVE 64
+/* Space reserved in front of the payload for the ethernet, IP and transport headers */
+#define SKB_HEADROOM 64
+
+/**
+ * Outgoing packets are built back to front: the payload is written once
+ * after skb_reserve() and every layer skb_push()es its header in front of it.
+ * skb->data always points at the first byte of the packet, skb->len is its length.
+ */
+
+/* Moves an empty skb's data forward, leaving n bytes of headroom. */
+static inline void skb_reserve(struct sk_buff* skb, int n)
+{
+    skb->data += n;
+    skb->tail += n;
+}
+
+/* Extends the packet by n bytes at the end, returns a pointer to them. */
+static inline uint8_t* skb_put(struct sk_buff* skb, int n)
+{
+    uint8_t* old = skb->tail;
+    skb->tail += n;
+    skb->len += n;
+    return old;
+}
+
+/* Extends the packet by n bytes at the start, returns the new start. */
+static inline uint8_t* skb_push(struct sk_buff* skb, int n)
+{
+    skb->data -= n;
+    skb->len += n;
+    return skb->data;
+}
+
+/* Strips n bytes from the start of the packet, returns the new start. */
+static inline uint8_t* skb_pull(struct sk_buff* skb, int n)
+{
+    skb->data += n;
+    skb->len -= n;
+    return skb->data;
+}
+
+/* Shortens the packet to len bytes, dropping link layer padding. */
+static inline void skb_trim(struct sk_buff* skb, int len)
+{
+    if(skb->len > len){
+        skb->len = len;
+        skb->tail = skb->data + len;
+    }
+}
+
 struct skb_queue* skb_new_queue();
 void skb_free_queue(struct skb_queue* queue);
 
 struct sk_buff* skb_new();
 void skb_free(struct sk_buff* skb);
 
-#define ALLOCATE_SKB(skb)               \
-    (skb)->data = kalloc(0x600);         \
-    memset((skb)->data, 0, 0x600);       \
-    (skb)->head = skb->data;            \
-    (skb)->tail = skb->head;            \
-    (skb)->end = skb->head+0x600;       \
-    (skb)->len = 0;
-
-#define FREE_SKB(skb)           \
-    if((skb)->head != NULL)     \
-        kfree((skb)->head);      \
-    (skb)->len = -1;            \
-    (skb)->head = NULL;
+uint8_t* skb_alloc_data();
+uint8_t* skb_alloc_data_atomic();
+void skb_free_data(uint8_t* data);
+void skb_cache_reserve(int count);
+struct sk_buff* skb_new_from_data(uint8_t* data, int len);
 
 #include <net/arp.h>
 #include <net/ipv4.h>
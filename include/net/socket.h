@@ -9,6 +9,8 @@ struct sock;
 #include <net/skb.h>
 #include <lib/net.h>
 #include <pcb.h>
+#include <timer.h>
+#include <net/sockhash.h>
 
 struct sockets {
     struct sock** sockets;
@@ -48,11 +50,14 @@ struct sock {
     /* if tcp socket */
     struct tcp_connection* tcp;
 
-    /* Should be a queue? Can multiple pcbs read from same socket? */
-    volatile struct pcb* waiting;
+    /* PCBs waiting for the socket state to change */
+    wait_queue_t wait;
     struct pcb* owner;
 
     struct sock* accept_sock;
+
+    /* Demultiplexing table linkage */
+    struct sock_hash_node hash;
 };
 
 #include <net/tcp.h>
@@ -63,6 +68,9 @@ struct sock {
 
 #define NET_MAX_BUFFER_SIZE 4096*4
 
+/* Timeouts in ticks */
+#define NET_CONNECT_TIMEOUT TIMER_MS_TO_TICKS(2000)
+
 void net_sock_bind(struct sock* socket, unsigned short port, unsigned int ip);
 int net_sock_read_skb(struct sock* socket);
 
@@ -72,7 +80,6 @@ void net_init_sockets();
 int get_total_sockets();
 
 error_t net_sock_is_established(struct sock* sk);
-error_t net_sock_awaiting_ack(struct sock* sk);
 error_t net_sock_data_ready(struct sock* sk, unsigned int length);
 error_t net_sock_add_data(struct sock* sock, struct sk_buff* skb);
 
@@ -84,6 +91,8 @@ struct sock* sock_find_listen_tcp(uint16_t d_port);
 
 int net_sock_accept(struct sock* sock, struct sock* new);
 int net_prepare_tcp_sock(struct sock* sock, uint16_t port, struct sockaddr_in* addr);
+void net_sock_hash_connection(struct sock* sock);
+void net_sock_hash_listen(struct sock* sock);
 struct sock* net_sock_find_tcp(uint16_t s_port, uint16_t d_port, uint32_t ip);
 struct sock* net_socket_find_udp(uint32_t ip, uint16_t port);
 
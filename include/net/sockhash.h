@@ -0,0 +1,44 @@
+#ifndef __SOCKHASH_H
+#define __SOCKHASH_H
+
+#include <stdint.h>
+
+struct sock;
+
+/* Bucket counts, must be powers of 2 */
+#define SOCK_HASH_CONN_SIZE 256
+#define SOCK_HASH_PORT_SIZE 64
+
+/**
+ * @brief Hash table linkage embedded in every socket.
+ * A socket is in at most one table at a time: connected TCP sockets are
+ * hashed on their 4-tuple, listening TCP and bound UDP sockets on their port.
+ */
+struct sock_hash_node {
+	struct sock_hash_node* next;
+	struct sock_hash_node** pprev;	/* NULL if not hashed */
+
+	uint32_t ip;		/* remote address for connections, bound address otherwise */
+	uint16_t lport;
+	uint16_t rport;
+
+	struct sock* sock;
+};
+
+struct sock_hash {
+	struct sock_hash_node* conn[SOCK_HASH_CONN_SIZE];
+	struct sock_hash_node* listen[SOCK_HASH_PORT_SIZE];
+	struct sock_hash_node* udp[SOCK_HASH_PORT_SIZE];
+};
+
+/* The table does no locking, callers serialize access. */
+void sock_hash_add_conn(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t lport, uint16_t rport, uint32_t ip);
+void sock_hash_add_listen(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t port);
+void sock_hash_add_udp(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t port, uint32_t ip);
+void sock_hash_remove(struct sock_hash_node* node);
+
+struct sock* sock_hash_find_conn(struct sock_hash* hash, uint16_t lport, uint16_t rport, uint32_t ip);
+struct sock* sock_hash_find_listen(struct sock_hash* hash, uint16_t port);
+struct sock* sock_hash_find_udp(struct sock_hash* hash, uint16_t port, uint32_t ip);
+
+#endif /* __SOCKHASH_H */
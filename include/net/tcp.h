@@ -5,13 +5,13 @@
 #include <libc.h>
 #include <sync.h>
 #include <rbuffer.h>
+#include <timer.h>
 
 /* TCP STATES */
 typedef enum {
 	TCP_CREATED,
 	TCP_CLOSED,	    /* represents no connection state at all. */
 	TCP_LISTEN,    	/* represents waiting for a connection request from any remote TCP and port. */
-	TCP_WAIT_ACK,
 	TCP_SYN_RCVD, 	/* represents waiting for a confirming connection request acknowledgment after having both received and sent a connection request. */
 	TCP_SYN_SENT, 	/* represents waiting for a matching connection request after having sent a connection request. */
 	/* Between SYN_SENT and ESTABLISHED a new socket is created. */
@@ -27,6 +27,8 @@ typedef enum {
 	
 } tcp_state_t;
 
+struct tcb;
+
 struct tcp_connection {
 	volatile tcp_state_t state;
 
@@ -49,11 +51,28 @@ struct tcp_connection {
 	uint32_t sip;
 
 	uint16_t backlog;
+
+	/* Send side state, attached once the connection is established. */
+	struct tcb* tcb;
 };
 
 #include <net/socket.h>
 
-#define TCP_MSS        512
+/* Largest segment payload, fills a 1500 byte ethernet frame. */
+#define TCP_MSS        1460
+/* Initial retransmission timeout and its bounds in ticks */
+#define TCP_RTO        TIMER_MS_TO_TICKS(1000)
+#define TCP_RTO_MIN    TIMER_MS_TO_TICKS(200)
+#define TCP_RTO_MAX    TIMER_MS_TO_TICKS(60000)
+/* Retransmissions of the same segment before the connection is dropped */
+#define TCP_RETRIES    6
+/* Bytes that can be queued for sending, must be a power of 2 */
+#define TCP_SEND_BUFFER 0x4000
+
+/* Sequence number comparisons, handles wrap around. */
+#define TCP_SEQ_LT(a, b)  ((int32_t)((a) - (b)) < 0)
+#define TCP_SEQ_LEQ(a, b) ((int32_t)((a) - (b)) <= 0)
+#define TCP_SEQ_GT(a, b)  ((int32_t)((a) - (b)) > 0)
 
 
 #define TCP_HTONS(hdr) \
@@ -105,6 +124,18 @@ struct tcp_header
     uint16_t urg_ptr;
 };
 
+/**
+ * @brief A segment that has been sent but not yet acknowledged.
+ * The payload itself stays in the send buffer of the TCB.
+ */
+struct tcp_segment {
+	uint32_t seq;
+	uint32_t len;
+	uint32_t sent;			/* tick of the last transmission */
+	uint8_t retransmitted;	/* RTT is not sampled from retransmitted segments */
+	struct tcp_segment* next;
+};
+
 /**
  * @brief Transmission Control Block
  * The maintenance of a TCP
@@ -122,9 +153,27 @@ struct tcb {
 	uint32_t sip;
 
 	struct ring_buffer* rbuf;
-	struct ring_buffer* sbuf;
 
-	struct skb_queue* retransmit;
+	/**
+	 * @brief Send buffer holding data from SND.UNA up to snd_end.
+	 * The byte with sequence number seq is stored at sbuf[seq % TCP_SEND_BUFFER].
+	 */
+	uint8_t* sbuf;
+	uint32_t snd_end;
+
+	/* Segments in flight, oldest first */
+	struct tcp_segment* retransmit;
+	struct tcp_segment* retransmit_tail;
+
+	struct ktimer rto_timer;
+	volatile uint8_t rto_expired;
+	uint32_t rto;		/* current retransmission timeout in ticks */
+	uint32_t srtt;		/* smoothed round trip time */
+	uint32_t rttvar;	/* round trip time variation */
+	uint8_t rtt_valid;
+	uint8_t backoff;	/* retransmissions of the oldest segment */
+
+	mutex_t lock;
 	
 	/**
 	 * @brief Send Sequence Variables
@@ -166,7 +215,7 @@ int tcp_new_connection(struct sock* sock, uint16_t dst_port, uint16_t src_port);
 int tcp_free_connection(struct sock* sock);
 
 int tcp_connect(struct sock* sock);
-int tcp_send_segment(struct sock* sock, uint8_t* data, uint32_t len, uint8_t push);
+int tcp_send(struct sock* sock, uint8_t* data, uint32_t len);
 int tcp_parse(struct sk_buff* skb);
 
 int tcp_read(struct sock* sock, uint8_t* buffer, unsigned int length);
@@ -177,5 +226,8 @@ int tcp_close_connection(struct sock* sock);
 int tcp_retry_all();
 int tcp_retry_queue_size();
 
+int tcp_retransmit_pending();
+int tcp_retransmit_expired();
+
 #endif
 
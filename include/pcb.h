@@ -2,6 +2,7 @@
 #define PCB_H
 
 struct pcb;
+struct ktimer;
 
 #include <libc.h>
 #include <sync.h>
@@ -50,6 +51,15 @@ typedef enum pcb_flags {
     PCB_FLAG_KERNEL = 1 << 1,
 } pcb_flag_t;
 
+/* Scheduling priorities, lower value is scheduled first. */
+#define PCB_PRIORITY_LEVELS 8
+typedef enum pcb_priorities {
+    PCB_PRIORITY_HIGH = 0,
+    PCB_PRIORITY_NORMAL = 3,
+    PCB_PRIORITY_LOW = 6,
+    PCB_PRIORITY_IDLE = 7
+} pcb_priority_t;
+
 struct pcb_state {
     uint32_t eax;
     uint32_t ecx;
@@ -78,7 +88,8 @@ struct pcb {
     char name[PCB_MAX_NAME_LENGTH];
     volatile pcb_state_t state;
     int16_t pid;
-    uint16_t sleep;
+    uint32_t sleep;
+    uint8_t priority;
     uint32_t stackptr;
     uint32_t* page_dir;
     uint32_t data_size;
@@ -103,6 +114,8 @@ struct pcb {
     int used_memory;
 
     struct pcb* parent;
+    /* Queue the pcb is currently linked into, NULL if none. */
+    struct pcb_queue* queue;
     struct pcb *next;
     struct pcb *prev;
 }__attribute__((__packed__));
@@ -147,12 +160,13 @@ struct pcb_queue_operations {
 /**
  * @brief This defines a PCB queue.
  * The pcb_queue structure defines a PCB queue, which contains a set of operations defined
- * by the pcb_queue_operations structure. It also contains a pointer to the head of the queue,
+ * by the pcb_queue_operations structure. It also contains a pointer to the head and tail of the queue,
  * a spinlock to protect access to the queue, and a count of the total number of PCBs in the queue.
  */
 struct pcb_queue {
 	struct pcb_queue_operations* ops;
 	struct pcb* _list;
+	struct pcb* _tail;
 	spinlock_t spinlock;
 	int total;
 };
@@ -162,6 +176,7 @@ void start_pcb(struct pcb* pcb);
 
 struct pcb* pcb_get_by_pid(int pid);
 struct pcb* pcb_get_by_name(char* name);
+struct ktimer* pcb_get_timer(struct pcb* pcb);
 
 error_t pcb_create_kthread( void (*entry)(), char* name, int argc, char** argv);
 error_t pcb_create_thread(struct pcb* parent, void (*entry)(), void* arg, byte_t flags);
@@ -33,6 +33,7 @@ struct scheduler_ops {
     error_t (*sleep)(struct scheduler* sched, int time);
     error_t (*exit)(struct scheduler* sched);
     error_t (*yield)(struct scheduler* sched);
+    error_t (*wake)(struct scheduler* sched, struct pcb* pcb);
     struct pcb* (*consume)(struct scheduler* sched);
 };
 
@@ -46,6 +47,16 @@ struct scheduler {
     struct pcb_queue* queue;
     struct pcb_queue* priority;
 
+    /* Per priority runqueues, bit n in bitmap is set when levels[n] is not empty. */
+    struct {
+        struct pcb_queue* levels[PCB_PRIORITY_LEVELS];
+        uint32_t bitmap;
+    } runqueue;
+
+    /* Wait structures, never visited when picking the next PCB. */
+    struct pcb_queue* sleeping;
+    struct pcb_queue* blocked;
+
     struct {
         struct pcb* running;
     } ctx;
@@ -53,6 +64,7 @@ struct scheduler {
 
 
 error_t sched_init_default(struct scheduler* sched, sched_flag_t flags);
+error_t sched_init_priority(struct scheduler* sched, sched_flag_t flags);
 
 /* asm functions */
 void pcb_restore_ctx();
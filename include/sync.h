@@ -19,15 +19,53 @@ void spin_lock(int volatile *p);
 void spin_unlock(int volatile *p);
 typedef int volatile spinlock_t;
 
+/* Timeout for waiting on a wait queue until woken up */
+#define WAIT_QUEUE_FOREVER -1
+
+typedef struct _wait_queue {
+    struct pcb_queue* waiters;
+} wait_queue_t;
+
+void wait_queue_init(wait_queue_t* wq);
+void wait_queue_free(wait_queue_t* wq);
+int wait_queue_block(wait_queue_t* wq, int timeout);
+int wake_up_one(wait_queue_t* wq);
+int wake_up_all(wait_queue_t* wq);
+
 typedef struct _mutex {
     lock_state_t state;
-    struct pcb_queue* blocked;
+    wait_queue_t blocked;
 } mutex_t;
 
 void mutex_init(mutex_t* l);
 void acquire(mutex_t* l);
 void release(mutex_t* l);
 
+/**
+ * @brief Blocks the current pcb on wq until condition is true.
+ * The condition is checked with interrupts disabled so a wakeup
+ * between checking it and blocking cannot be lost.
+ */
+#define wait_event(wq, condition) \
+    do { \
+        ENTER_CRITICAL(); \
+        while(!(condition)){ \
+            wait_queue_block(wq, WAIT_QUEUE_FOREVER); \
+        } \
+        LEAVE_CRITICAL(); \
+    } while (0)
+
+/* Same as wait_event, but gives up after ticks, the caller checks condition again. */
+#define wait_event_timeout(wq, condition, ticks) \
+    do { \
+        int __deadline = timer_get_tick() + (ticks); \
+        ENTER_CRITICAL(); \
+        while(!(condition)){ \
+            if(!wait_queue_block(wq, __deadline - timer_get_tick())) break; \
+        } \
+        LEAVE_CRITICAL(); \
+    } while (0)
+
 /* Assuming that obj has a lock, acquire it and run the code before releasing. */
 #define LOCK(obj, code_block) \
     acquire(&obj->lock); \
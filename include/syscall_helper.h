@@ -47,7 +47,17 @@ enum {
     SYSCALL_SYSTEM,
     SYSCALL_SCREEN_PUT,
     SYSCALL_SCREEN_GET,
-    SYSCALL_SET_CURSOR
+    SYSCALL_SET_CURSOR,
+
+    /* Memory system calls */
+    SYSCALL_MMAP,
+
+    /* Shared memory IPC system calls */
+    SYSCALL_IPC_SHM_OPEN,
+    SYSCALL_IPC_SHM_ATTACH,
+    SYSCALL_IPC_SHM_DETACH,
+    SYSCALL_FUTEX_WAIT,
+    SYSCALL_FUTEX_WAKE
 };
 
 #endif /* __SYSCALL_HELPER_H */
@@ -50,6 +50,23 @@ struct terminal_ops {
     unsigned char (*getchar)(struct terminal* term);
 };
 
+/**
+ * @brief Characters last drawn by a graphics terminal, one per 8x8 cell.
+ * A commit compares the text against the cells and only redraws those that changed.
+ */
+struct terminal_grid {
+    char* chars;
+    color_t* colors;
+    int cols;
+    int rows;
+
+    /* Window, size and background the cells were drawn for */
+    struct window* screen;
+    int width;
+    int height;
+    color_t bg;
+};
+
 struct terminal {
     char* textbuffer;
 
@@ -64,6 +81,8 @@ struct terminal {
     color_t org_text_color;
     color_t text_color;
     color_t bg_color;
+
+    struct terminal_grid grid;
 };
 
 struct terminal* terminal_create(terminal_flags_t flags);
@@ -6,10 +6,37 @@
 
 #define TIME_TO_INT(time) (((time)->hour*3600) + ((time)->minute*60) + (time)->second)
 
+/* Frequency the PIT is programmed with, one tick is 1ms. */
+#define TIMER_HZ 1000
+#define TIMER_MS_TO_TICKS(ms) (((ms)*TIMER_HZ)/1000)
+
+typedef void (*ktimer_callback_t)(void* arg);
+
+/**
+ * @brief A kernel timer.
+ * Timers are embedded into the structure waiting on them and linked
+ * into the timer wheel while pending. The callback is called from the
+ * PIT interrupt, with interrupts disabled, and must not block.
+ */
+struct ktimer {
+    uint32_t expires;
+    ktimer_callback_t callback;
+    void* arg;
+
+    /* Wheel slot the timer is currently linked into, NULL if not pending. */
+    struct ktimer** slot;
+    struct ktimer* next;
+    struct ktimer* prev;
+};
 
 void init_pit(uint32_t frequency);
 struct time* get_datetime();
 int timer_get_tick();
 int time_get_difference();
 
-#endif // !TIMER_H
\ No newline at end of file
+void ktimer_init(struct ktimer* timer, ktimer_callback_t callback, void* arg);
+int ktimer_add(struct ktimer* timer, uint32_t ticks);
+int ktimer_del(struct ktimer* timer);
+int ktimer_pending(struct ktimer* timer);
+
+#endif // !TIMER_H
@@ -0,0 +1,41 @@
+#ifndef __VMEM_HEAP_H
+#define __VMEM_HEAP_H
+
+#include <stdint.h>
+
+/**
+ * @brief A contiguous range of a heap, either allocated or free.
+ * Extents are kept in an AVL tree ordered by address, every node also
+ * stores the largest free extent of its subtree so a first fit search
+ * only walks a single path.
+ */
+struct vmem_extent {
+	uintptr_t start;
+	int size;
+	int max_free;
+
+	int8_t free;
+	int8_t height;
+
+	struct vmem_extent* left;
+	struct vmem_extent* right;
+};
+
+struct vmem_heap {
+	struct vmem_extent* root;
+	uintptr_t start;
+	int size;
+
+	/* Bytes and number of live allocations */
+	int used;
+	int allocations;
+};
+
+void vmem_heap_init(struct vmem_heap* heap, uintptr_t start, int size);
+void vmem_heap_destroy(struct vmem_heap* heap);
+
+uintptr_t vmem_heap_alloc(struct vmem_heap* heap, int size);
+int vmem_heap_free(struct vmem_heap* heap, uintptr_t addr);
+int vmem_heap_size(struct vmem_heap* heap, uintptr_t addr);
+
+#endif /* __VMEM_HEAP_H */
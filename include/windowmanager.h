@@ -29,7 +29,7 @@ struct windowmanager_ops {
     int (*add)(struct windowmanager *wm, struct window *window);
     /* remove window */
     int (*remove)(struct windowmanager *wm, struct window *window);
-    /* draw all windows */
+    /* draw all windows overlapping the redraw area */
     int (*draw)(struct windowmanager *wm, struct window *window);
     int (*push_front)(struct windowmanager *wm, struct window *window);
     int (*push_back)(struct windowmanager *wm, struct window *window);
@@ -40,6 +40,7 @@ struct windowmanager_ops {
     int (*init)(struct windowmanager *wm, int flags);
     int (*destroy)(struct windowmanager *wm);
 
+    /* collect window damage, returns 1 if the screen changed */
     int (*changes)(struct windowmanager *wm);
 };
 
@@ -50,6 +51,10 @@ struct windowmanager {
     uint8_t* composition_buffer;
     struct window *windows;
 
+    /* Screen areas that changed, and the larger area redrawn to compose them. */
+    struct gfx_damage damage;
+    struct gfx_damage redraw;
+
     /* workspaces */
     struct window* workspaces[WM_MAX_WORKSPACES];
     int workspace;
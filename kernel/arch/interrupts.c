@@ -89,11 +89,21 @@ void print_page_fault_info(unsigned long cr2) {
 
 void page_fault_interrupt(unsigned long cr2, unsigned long err)
 {
+	/* Pages of processes are mapped on first touch, faults before scheduling have no address space */
+	struct pcb* pcb = $process->current;
+	if(pcb != NULL && pcb->allocations != NULL && vmem_page_fault(pcb, cr2, err) == ERROR_OK){
+		return;
+	}
+
     uint32_t *ebp = (uint32_t*) __builtin_frame_address(0);
    	__backtrace_from((uintptr_t*)ebp);
 	
 	print_page_fault_info(cr2);
 
+	if(pcb == NULL){
+		kernel_panic("Page fault without a running pcb.");
+	}
+
 	pcb_dbg_print($process->current);
 	if($process->current->is_process && $process->current->in_kernel == false){
 		struct msgbox* box = msgbox_create(MSGBOX_TYPE_WARNING, MSGBOX_BUTTON_OK, "Crash Report", " A program has crashed!", NULL);
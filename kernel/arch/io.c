@@ -34,4 +34,14 @@ void outportw(uint16_t portid, uint16_t value)
 void outportl(uint16_t portid, uint32_t value)
 {
     asm volatile("outl %%eax, %%dx":: "d"(portid), "a"(value));
-}
\ No newline at end of file
+}
+/* String variants, transfer count words between a port and memory. */
+void insw(uint16_t portid, void* buf, uint32_t count)
+{
+    asm volatile("cld; rep insw" : "+D"(buf), "+c"(count) : "d"(portid) : "memory");
+}
+
+void outsw(uint16_t portid, const void* buf, uint32_t count)
+{
+    asm volatile("cld; rep outsw" : "+S"(buf), "+c"(count) : "d"(portid) : "memory");
+}
@@ -0,0 +1,403 @@
+/**
+ * @file bcache.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Block buffer cache between the filesystems and the disk device.
+ * Blocks are looked up through a hash on the block number, unused buffers
+ * are recycled in least recently used order. Writes only mark the buffer
+ * dirty, dirty buffers are written back when they are evicted or on sync.
+ * @version 0.1
+ * @date 2024-02-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <bcache.h>
+#include <diskdev.h>
+#include <memory.h>
+#include <libc.h>
+#include <sync.h>
+#include <serial.h>
+
+static struct bcache {
+	struct buffer* buffers;
+	int size;
+
+	struct buffer* hash[BCACHE_HASH_SIZE];
+
+	/* LRU list, head is most recently used */
+	struct buffer* head;
+	struct buffer* tail;
+
+	struct bcache_info info;
+	mutex_t lock;
+} __bcache = {0};
+
+#define BCACHE_HASH(block) ((uint32_t)(block) % BCACHE_HASH_SIZE)
+
+/* Runs of consecutive blocks are moved through here with one disk command */
+static byte_t __bcache_run[BCACHE_RUN_MAX * BCACHE_BLOCK_SIZE];
+
+static void __lru_remove(struct buffer* buf)
+{
+	if(buf->prev) buf->prev->next = buf->next;
+	else __bcache.head = buf->next;
+
+	if(buf->next) buf->next->prev = buf->prev;
+	else __bcache.tail = buf->prev;
+
+	buf->prev = NULL;
+	buf->next = NULL;
+}
+
+static void __lru_push(struct buffer* buf)
+{
+	buf->prev = NULL;
+	buf->next = __bcache.head;
+	if(__bcache.head) __bcache.head->prev = buf;
+	__bcache.head = buf;
+	if(__bcache.tail == NULL) __bcache.tail = buf;
+}
+
+static void __hash_remove(struct buffer* buf)
+{
+	struct buffer** iter = &__bcache.hash[BCACHE_HASH(buf->block)];
+	while(*iter != NULL){
+		if(*iter == buf){
+			*iter = buf->hash_next;
+			break;
+		}
+		iter = &(*iter)->hash_next;
+	}
+	buf->hash_next = NULL;
+}
+
+static struct buffer* __lookup(int block)
+{
+	struct buffer* buf = __bcache.hash[BCACHE_HASH(block)];
+	while(buf != NULL && (!buf->valid || buf->block != (uint32_t)block)){
+		buf = buf->hash_next;
+	}
+	return buf;
+}
+
+/**
+ * @brief Writes the dirty buffers of consecutive blocks from block on with a single disk write.
+ * @return int number of blocks written, negative on error.
+ */
+static int __writeback_run(int block)
+{
+	struct buffer* run[BCACHE_RUN_MAX];
+	int count = 0;
+
+	while(count < BCACHE_RUN_MAX){
+		struct buffer* buf = __lookup(block + count);
+		if(buf == NULL || !buf->dirty){
+			break;
+		}
+		memcpy(__bcache_run + count * BCACHE_BLOCK_SIZE, buf->data, BCACHE_BLOCK_SIZE);
+		run[count++] = buf;
+	}
+
+	int ret = disk_device_get()->write((char*)__bcache_run, block, count);
+	if(ret < 0){
+		return ret;
+	}
+
+	for(int i = 0; i < count; i++){
+		run[i]->dirty = 0;
+	}
+	__bcache.info.writes += count;
+	__bcache.info.dirty -= count;
+	return count;
+}
+
+static int __writeback(struct buffer* buf)
+{
+	int ret = disk_device_get()->write((char*)buf->data, buf->block, 1);
+	if(ret < 0){
+		return ret;
+	}
+
+	buf->dirty = 0;
+	__bcache.info.writes++;
+	__bcache.info.dirty--;
+	return 0;
+}
+
+/**
+ * @brief Finds the least recently used buffer no one holds.
+ * Dirty victims are written back before they are reused.
+ */
+static struct buffer* __evict()
+{
+	for(struct buffer* buf = __bcache.tail; buf != NULL; buf = buf->prev){
+		if(buf->refs > 0){
+			continue;
+		}
+
+		if(buf->dirty && __writeback(buf) < 0){
+			continue;
+		}
+
+		if(buf->valid){
+			__hash_remove(buf);
+			buf->valid = 0;
+		}
+		return buf;
+	}
+	return NULL;
+}
+
+static error_t __bcache_alloc(int size)
+{
+	if(size < 1) size = 1;
+	if(size > BCACHE_MAX_SIZE) size = BCACHE_MAX_SIZE;
+
+	struct buffer* buffers = kalloc(size * sizeof(struct buffer));
+	if(buffers == NULL){
+		return -ERROR_ALLOC;
+	}
+	memset(buffers, 0, size * sizeof(struct buffer));
+
+	__bcache.buffers = buffers;
+	__bcache.size = size;
+	__bcache.head = NULL;
+	__bcache.tail = NULL;
+	memset(__bcache.hash, 0, sizeof(__bcache.hash));
+
+	for(int i = 0; i < size; i++){
+		__lru_push(&buffers[i]);
+	}
+
+	__bcache.info.size = size;
+	__bcache.info.dirty = 0;
+	return ERROR_OK;
+}
+
+/**
+ * @brief Sets up, or resizes, the buffer cache.
+ * Resizing writes back all dirty buffers and fails if any buffer is in use.
+ *
+ * @param size number of cached blocks
+ * @return error_t ERROR_OK on success
+ */
+error_t bcache_init(int size)
+{
+	if(__bcache.buffers == NULL){
+		mutex_init(&__bcache.lock);
+		return __bcache_alloc(size);
+	}
+
+	if(size == __bcache.size){
+		return ERROR_OK;
+	}
+
+	acquire(&__bcache.lock);
+	for(int i = 0; i < __bcache.size; i++){
+		struct buffer* buf = &__bcache.buffers[i];
+		if(buf->refs > 0 || (buf->dirty && __writeback(buf) < 0)){
+			release(&__bcache.lock);
+			return -ERROR_UNKNOWN;
+		}
+	}
+
+	struct buffer* old = __bcache.buffers;
+	int old_size = __bcache.size;
+
+	error_t err = __bcache_alloc(size);
+	if(err < 0){
+		release(&__bcache.lock);
+		return err;
+	}
+	kfree(old);
+	release(&__bcache.lock);
+
+	dbgprintf("[BCACHE] Resized from %d to %d blocks\n", old_size, __bcache.size);
+
+	return ERROR_OK;
+}
+
+static void __insert(struct buffer* buf, int block)
+{
+	buf->block = block;
+	buf->valid = 1;
+	buf->dirty = 0;
+	buf->hash_next = __bcache.hash[BCACHE_HASH(block)];
+	__bcache.hash[BCACHE_HASH(block)] = buf;
+}
+
+static struct buffer* __bget(int block, int read)
+{
+	if(__bcache.buffers == NULL && bcache_init(BCACHE_DEFAULT_SIZE) < 0){
+		return NULL;
+	}
+
+	acquire(&__bcache.lock);
+
+	struct buffer* buf = __lookup(block);
+	if(buf != NULL){
+		__bcache.info.hits++;
+	} else {
+		__bcache.info.misses++;
+
+		buf = __evict();
+		if(buf == NULL){
+			release(&__bcache.lock);
+			return NULL;
+		}
+
+		if(read && disk_device_get()->read((char*)buf->data, block, 1) < 0){
+			release(&__bcache.lock);
+			return NULL;
+		}
+		__bcache.info.reads += read ? 1 : 0;
+
+		__insert(buf, block);
+	}
+
+	buf->refs++;
+	__lru_remove(buf);
+	__lru_push(buf);
+
+	release(&__bcache.lock);
+
+	return buf;
+}
+
+/**
+ * @brief Returns a referenced buffer holding the contents of block.
+ * @return struct buffer* buffer, NULL if every buffer is in use or the read failed.
+ */
+struct buffer* bread(int block)
+{
+	return __bget(block, 1);
+}
+
+/**
+ * @brief Returns a referenced buffer for block without reading it from disk.
+ * Only for callers that overwrite the whole block.
+ */
+struct buffer* bget(int block)
+{
+	return __bget(block, 0);
+}
+
+/**
+ * @brief Reads the blocks block .. block+count-1 that are not cached yet.
+ * Each run of missing blocks is read with a single disk command instead of
+ * one per block, later bread() calls for them are hits.
+ * @return int number of blocks read from disk, negative on error.
+ */
+int bread_ahead(int block, int count)
+{
+	if(__bcache.buffers == NULL && bcache_init(BCACHE_DEFAULT_SIZE) < 0){
+		return -ERROR_ALLOC;
+	}
+
+	/* Leave room for the blocks callers are holding or just read */
+	int max = __bcache.size / 2 < BCACHE_RUN_MAX ? __bcache.size / 2 : BCACHE_RUN_MAX;
+	int read = 0;
+	int i = 0;
+
+	acquire(&__bcache.lock);
+	while(i < count){
+		if(__lookup(block + i) != NULL){
+			i++;
+			continue;
+		}
+
+		int start = i;
+		while(i < count && i - start < max && __lookup(block + i) == NULL){
+			i++;
+		}
+
+		int n = i - start;
+		if(n <= 1){
+			/* Not worth it, bread() reads single blocks itself */
+			continue;
+		}
+
+		if(disk_device_get()->read((char*)__bcache_run, block + start, n) < 0){
+			release(&__bcache.lock);
+			return read > 0 ? read : -ERROR_UNKNOWN;
+		}
+		__bcache.info.reads += n;
+
+		for(int j = 0; j < n; j++){
+			struct buffer* buf = __evict();
+			if(buf == NULL){
+				release(&__bcache.lock);
+				return read;
+			}
+
+			memcpy(buf->data, __bcache_run + j * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+			__insert(buf, block + start + j);
+			__lru_remove(buf);
+			__lru_push(buf);
+			read++;
+		}
+	}
+	release(&__bcache.lock);
+
+	return read;
+}
+
+void bdirty(struct buffer* buf)
+{
+	acquire(&__bcache.lock);
+	if(!buf->dirty){
+		buf->dirty = 1;
+		__bcache.info.dirty++;
+	}
+	release(&__bcache.lock);
+}
+
+void brelse(struct buffer* buf)
+{
+	acquire(&__bcache.lock);
+	buf->refs--;
+	release(&__bcache.lock);
+}
+
+/**
+ * @brief Writes all dirty buffers back to disk.
+ * Dirty buffers of consecutive blocks are written with a single disk command.
+ * @return int number of blocks written.
+ */
+int bcache_sync()
+{
+	if(__bcache.buffers == NULL){
+		return 0;
+	}
+
+	int written = 0;
+	acquire(&__bcache.lock);
+	for(int i = 0; i < __bcache.size; i++){
+		struct buffer* buf = &__bcache.buffers[i];
+		while(buf->valid && buf->dirty){
+			/* Start at the first dirty block of the run buf is part of */
+			int start = buf->block;
+			struct buffer* prev;
+			while(start > 0 && (prev = __lookup(start - 1)) != NULL && prev->dirty){
+				start--;
+			}
+
+			int ret = __writeback_run(start);
+			if(ret < 0){
+				break;
+			}
+			written += ret;
+		}
+	}
+	release(&__bcache.lock);
+
+	return written;
+}
+
+int bcache_get_info(struct bcache_info* info)
+{
+	ERR_ON_NULL(info);
+
+	*info = __bcache.info;
+	return 0;
+}
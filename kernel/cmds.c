@@ -17,9 +17,13 @@
 #include <terminal.h>
 #include <memory.h>
 #include <fs/fs.h>
+#include <fs/fat16.h>
 #include <work.h>
 #include <conf.h>
 #include <gfx/theme.h>
+#include <gfx/composition.h>
+#include <gfx/windowserver.h>
+#include <gfx/glyph.h>
 #include <kevents.h>
 #include <lib/lz.h>
 
@@ -246,7 +250,7 @@ static int help(int argc, char* argv[])
     twritef("  list            tree         reset\n");
     twritef("  view            kill         about\n");
     twritef("  file            exec         xxd\n");
-    twritef("                  fdisk        bg\n");
+    twritef("  sync            fdisk        bg\n");
     twritef("Network:          meminfo      sh\n");
     twritef(" socks            conf         echo\n");
     twritef(" ifconfig         services     cc\n");
@@ -494,6 +498,29 @@ static int file(int argc, char* argv[]){
 }
 EXPORT_KSYMBOL(file);
 
+static int sync(int argc, char* argv[]){
+    if(fs_get() == NULL){
+        twritef("No filesystem mounted.\n");
+        return -1;
+    }
+
+    int written = fs_sync();
+    if(written < 0){
+        twritef("Failed to sync filesystem\n");
+        return -1;
+    }
+
+    twritef("Synced %d sectors\n", written);
+
+    if(fs_get()->type == MBR_TYPE_FAT16_LBA){
+        struct fat16_stats stats;
+        fat16_get_stats(&stats);
+        twritef("FAT: %d sectors written in %d syncs\n", stats.fat_sectors_written, stats.syncs);
+    }
+    return 0;
+}
+EXPORT_KSYMBOL(sync);
+
 #include <net/socket.h>
 #include <net/net.h>
 #include <net/ipv4.h>
@@ -652,6 +679,26 @@ static int clear(){
 }
 EXPORT_KSYMBOL(clear);
 
+static int wsstat(int argc, char* argv[])
+{
+    struct ws_stats stats;
+    if(gfx_compositor_stats(&stats) < 0){
+        twritef("Window server is not running.\n");
+        return 1;
+    }
+
+    twritef("Frames:     %d\n", stats.frames);
+    twritef("Frame time: %d cycles\n", stats.frame_time);
+    twritef("Restored:   %d bytes\n", stats.restored);
+    twritef("Flushed:    %d bytes, %d KB total\n", stats.flushed, stats.total_flushed);
+
+    struct gfx_glyph_stats glyphs;
+    gfx_glyph_stats(&glyphs);
+    twritef("Glyphs:     %d hits, %d misses\n", glyphs.hits, glyphs.misses);
+    return 0;
+}
+EXPORT_KSYMBOL(wsstat);
+
 static int panic(int argc, char *argv[])
 {
     if(argc < 2) {
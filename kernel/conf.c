@@ -178,6 +178,23 @@ char* kernel_config_get_value(char* section, char* name)
     return NULL;
 }
 
+/**
+ * @brief Returns the value of a key as an integer.
+ * 
+ * @param section section to look in
+ * @param name key to look for
+ * @param def value returned if the key is missing
+ * @return int value of the key
+ */
+int kernel_config_get_int(char* section, char* name, int def)
+{
+    char* val = kernel_config_get_value(section, name);
+    if(val == NULL || *val == '\0'){
+        return def;
+    }
+    return atoi(val);
+}
+
 bool_t kernel_config_check(char* section, char* name, char* value)
 {
     char* val = kernel_config_get_value(section, name);
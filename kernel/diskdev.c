@@ -14,6 +14,7 @@
 #include <terminal.h>
 #include <errors.h>
 #include <serial.h>
+#include <bcache.h>
 
 static struct diskdev disk_device;
 
@@ -60,18 +61,41 @@ int write_block(void* _buf, int block)
         return -1;
     }
 
-    return disk_device.write(buf, block, 1);
+    /* The whole block is overwritten, so there is no need to read it first. */
+    struct buffer* b = bget(block);
+    if(b == NULL){
+        return disk_device.write(buf, block, 1);
+    }
+
+    memcpy(b->data, buf, BCACHE_BLOCK_SIZE);
+    bdirty(b);
+    brelse(b);
+
+    return 1;
 }
 
 int write_block_offset(void* _usr_buf, int size, int offset, int block)
 {
-    char buf[512];
-    void* usr_buf = (void*) _usr_buf;
+    ERR_ON_NULL(_usr_buf);
 
-    disk_device.read((char*)buf, block, 1);
-    memcpy(&buf[offset], usr_buf, size);
+    if(disk_device.write == NULL){
+        dbgprintf("[DISK] No write function attached\n");
+        return -1;
+    }
 
-    return write_block(buf, block);
+    struct buffer* b = bread(block);
+    if(b == NULL){
+        char buf[512];
+        disk_device.read((char*)buf, block, 1);
+        memcpy(&buf[offset], _usr_buf, size);
+        return disk_device.write(buf, block, 1);
+    }
+
+    memcpy(&b->data[offset], _usr_buf, size);
+    bdirty(b);
+    brelse(b);
+
+    return 1;
 }
 
 int read_block(void* _buf, int block)
@@ -82,19 +106,50 @@ int read_block(void* _buf, int block)
         return -1;
     }
 
-    //dbgprintf("[DISK] read: 0x%x. Block %d\n", buf, block*512);
-    return disk_device.read(buf, block, 1);
+    struct buffer* b = bread(block);
+    if(b == NULL){
+        return disk_device.read(buf, block, 1);
+    }
+
+    memcpy(buf, b->data, BCACHE_BLOCK_SIZE);
+    brelse(b);
+
+    return 1;
+}
+
+/**
+ * @brief Reads count blocks from block on into the buffer cache,
+ * so callers reading them one at a time do not issue a disk command per block.
+ * @return int number of blocks read from disk, negative on error.
+ */
+int read_block_ahead(int block, int count)
+{
+    if(disk_device.read == NULL){
+        return -1;
+    }
+
+    return bread_ahead(block, count);
 }
 
 int read_block_offset(void* _usr_buf, int size, int offset, int block)
 {
     ERR_ON_NULL(_usr_buf);
 
-    char buf[512];
-    byte_t* usr_buf = (byte_t*) _usr_buf;
+    if(disk_device.read == NULL){
+        dbgprintf("[DISK] No read function attached\n");
+        return -1;
+    }
 
-    read_block((char*)buf, block);
-    memcpy(usr_buf, &buf[offset], size);
+    struct buffer* b = bread(block);
+    if(b == NULL){
+        char buf[512];
+        disk_device.read((char*)buf, block, 1);
+        memcpy(_usr_buf, &buf[offset], size);
+        return size;
+    }
+
+    memcpy(_usr_buf, &b->data[offset], size);
+    brelse(b);
 
-    return size;   
-}
\ No newline at end of file
+    return size;
+}
@@ -58,8 +58,9 @@ enable_paging:
     pushl %ebp
     movl %esp, %ebp
 
+    /* Paging, and write protect so kernel writes to shared read only pages fault too */
     mov %cr0, %eax
-    or $0x80000000, %eax
+    or $0x80010000, %eax
     mov %eax, %cr0
     
     movl %ebp, %esp
@@ -2,6 +2,10 @@
  * @file ipc.c
  * @author Joe Bayer (joexbayer)
  * @brief Inter process communication.
+ * Channels are either a small kernel ring buffer, where every send and receive
+ * copies through the kernel, or shared memory mapped into every attached process.
+ * Shared memory channels move data without entering the kernel, processes
+ * block on words in them with sys_futex_wait() and sys_futex_wake().
  * @version 0.1
  * @date 2024-01-10
  * 
@@ -13,31 +17,72 @@
 #include <memory.h>
 #include <syscalls.h>
 #include <syscall_helper.h>
+#include <scheduler.h>
+#include <timer.h>
+#include <pcb.h>
 
 #define IPC_MAX_CHANNELS 16
 #define IPC_MAX_SIZE 1024
 
+/* Waiters are hashed on the physical address of the word they wait on */
+#define IPC_FUTEX_BUCKETS 16
+
 #define IPC_VALID_CHANNEL(channel) if(channel < 0 || channel >= IPC_MAX_CHANNELS || channels[channel].rbuf == NULL) {return -1;}
+#define IPC_VALID_SHM(channel) if(channel < 0 || channel >= IPC_MAX_CHANNELS || channels[channel].shm == NULL) {return -ERROR_INVALID_ARGUMENTS;}
 
 /* handel to channel implementation */
 static struct ipc_channel channels[IPC_MAX_CHANNELS] = {0};
 
+static wait_queue_t futex_queues[IPC_FUTEX_BUCKETS] = {0};
+
+/* Called in a critical section, the slot is taken before it is enabled again. */
 static int __ipc_alloc_channel() {
     for (int i = 0; i < IPC_MAX_CHANNELS; i++)
-        if (!channels[i].rbuf)
+        if (!channels[i].rbuf && !channels[i].shm)
             return i;
     return -1;
 }
 
+/* Threads share the address space of their process, mappings belong to the process. */
+static struct pcb* __ipc_owner()
+{
+    struct pcb* current = $process->current;
+    return current->is_process == PCB_THREAD ? current->parent : current;
+}
+
+/* Frees the shared memory once the channel is closed and no process has it mapped. */
+static void __ipc_shm_put(int channel)
+{
+    struct ipc_shm* shm = channels[channel].shm;
+    if(!shm->closed) return;
+
+    for (int i = 0; i < IPC_SHM_MAX_USERS; i++){
+        if(shm->users[i].pcb != NULL) return;
+    }
+
+    channels[channel].shm = NULL;
+    vmem_shared_free(shm->frames, shm->pages);
+    kfree(shm);
+}
+
 /* userspace interface */
 int sys_ipc_open()
 {
+    struct ring_buffer* rbuf = rbuffer_new(IPC_MAX_SIZE);
+    if(rbuf == NULL){
+        return -1;
+    }
+
+    ENTER_CRITICAL();
     int channel = __ipc_alloc_channel();
     if (channel < 0) {
+        LEAVE_CRITICAL();
+        rbuffer_free(rbuf);
         return -1;
     }
 
-    channels[channel].rbuf = rbuffer_new(IPC_MAX_SIZE);
+    channels[channel].rbuf = rbuf;
+    LEAVE_CRITICAL();
     return channel;
 }
 EXPORT_SYSCALL(SYSCALL_IPC_OPEN, sys_ipc_open);
@@ -45,6 +90,13 @@ EXPORT_SYSCALL(SYSCALL_IPC_OPEN, sys_ipc_open);
 
 int sys_ipc_close(int channel)
 {
+    if(channel >= 0 && channel < IPC_MAX_CHANNELS && channels[channel].shm != NULL){
+        CRITICAL_SECTION({
+            channels[channel].shm->closed = 1;
+            __ipc_shm_put(channel);
+        });
+        return 0;
+    }
     IPC_VALID_CHANNEL(channel);
 
     rbuffer_free(channels[channel].rbuf);
@@ -70,3 +122,194 @@ int sys_ipc_receive(int channel, void* data, int length)
     return channels[channel].rbuf->ops->read(channels[channel].rbuf, data, length);
 }
 EXPORT_SYSCALL(SYSCALL_IPC_RECEIVE, sys_ipc_receive);
+
+/**
+ * @brief Opens a channel backed by size bytes of zeroed shared memory.
+ * The memory is freed when the channel is closed and the last process
+ * detaches, or when the process that opened it exits.
+ * @param size bytes, rounded up to whole pages
+ * @return int channel, or negative error.
+ */
+int sys_ipc_shm_open(int size)
+{
+    if(size <= 0 || size > VMEM_SHARED_SIZE){
+        return -ERROR_INVALID_ARGUMENTS;
+    }
+
+    struct ipc_shm* shm = create(struct ipc_shm);
+    if(shm == NULL){
+        return -ERROR_ALLOC;
+    }
+
+    shm->pages = ALIGN(size, PAGE_SIZE) / PAGE_SIZE;
+    shm->frames = vmem_shared_alloc(shm->pages);
+    if(shm->frames == NULL){
+        kfree(shm);
+        return -ERROR_ALLOC;
+    }
+    shm->owner = __ipc_owner();
+
+    ENTER_CRITICAL();
+    int channel = __ipc_alloc_channel();
+    if(channel < 0){
+        LEAVE_CRITICAL();
+        vmem_shared_free(shm->frames, shm->pages);
+        kfree(shm);
+        return -ERROR_INDEX;
+    }
+
+    channels[channel].shm = shm;
+    LEAVE_CRITICAL();
+
+    return channel;
+}
+EXPORT_SYSCALL(SYSCALL_IPC_SHM_OPEN, sys_ipc_shm_open);
+
+/**
+ * @brief Maps the shared memory of channel into the calling process.
+ * Addresses of the shared region are negative as int, so errors are returned as 0 like mmap.
+ * @return int address of the mapping, 0 on error.
+ */
+int sys_ipc_shm_attach(int channel)
+{
+    if(channel < 0 || channel >= IPC_MAX_CHANNELS || channels[channel].shm == NULL){
+        return 0;
+    }
+
+    struct pcb* owner = __ipc_owner();
+    struct ipc_shm* shm = channels[channel].shm;
+    struct ipc_shm_user* slot = NULL;
+    uintptr_t addr = 0;
+
+    ENTER_CRITICAL();
+    for (int i = 0; i < IPC_SHM_MAX_USERS; i++){
+        if(shm->users[i].pcb == owner){
+            addr = shm->users[i].addr;
+            LEAVE_CRITICAL();
+            return (int) addr;
+        }
+        if(shm->users[i].pcb == NULL && slot == NULL) slot = &shm->users[i];
+    }
+
+    if(!shm->closed && slot != NULL){
+        addr = vmem_map_shared($process->current, shm->frames, shm->pages);
+        if(addr != 0){
+            slot->pcb = owner;
+            slot->addr = addr;
+        }
+    }
+    LEAVE_CRITICAL();
+
+    return (int) addr;
+}
+EXPORT_SYSCALL(SYSCALL_IPC_SHM_ATTACH, sys_ipc_shm_attach);
+
+/**
+ * @brief Unmaps the shared memory of channel from the calling process.
+ */
+int sys_ipc_shm_detach(int channel)
+{
+    IPC_VALID_SHM(channel);
+
+    struct pcb* owner = __ipc_owner();
+    struct ipc_shm* shm = channels[channel].shm;
+    int ret = -ERROR_INVALID_ARGUMENTS;
+
+    ENTER_CRITICAL();
+    for (int i = 0; i < IPC_SHM_MAX_USERS; i++){
+        if(shm->users[i].pcb != owner) continue;
+
+        vmem_unmap_shared($process->current, shm->users[i].addr, shm->pages);
+        shm->users[i].pcb = NULL;
+        __ipc_shm_put(channel);
+        ret = ERROR_OK;
+        break;
+    }
+    LEAVE_CRITICAL();
+
+    return ret;
+}
+EXPORT_SYSCALL(SYSCALL_IPC_SHM_DETACH, sys_ipc_shm_detach);
+
+/**
+ * @brief Detaches an exiting process from all channels and closes the ones it opened.
+ * Called before its address space is freed.
+ */
+void ipc_cleanup_process(struct pcb* pcb)
+{
+    ENTER_CRITICAL();
+    for (int c = 0; c < IPC_MAX_CHANNELS; c++){
+        struct ipc_shm* shm = channels[c].shm;
+        if(shm == NULL) continue;
+
+        for (int i = 0; i < IPC_SHM_MAX_USERS; i++){
+            if(shm->users[i].pcb != pcb) continue;
+
+            vmem_unmap_shared(pcb, shm->users[i].addr, shm->pages);
+            shm->users[i].pcb = NULL;
+        }
+
+        if(shm->owner == pcb) shm->closed = 1;
+        __ipc_shm_put(c);
+    }
+    LEAVE_CRITICAL();
+}
+
+static wait_queue_t* __futex_queue(uintptr_t paddr)
+{
+    wait_queue_t* wq = &futex_queues[(paddr >> 2) % IPC_FUTEX_BUCKETS];
+    if(wq->waiters == NULL){
+        wait_queue_init(wq);
+    }
+    return wq;
+}
+
+/**
+ * @brief Blocks until woken up by sys_futex_wake(), if *addr still equals expected.
+ * The word is looked up by physical address, so processes mapping the same
+ * shared memory at different addresses wait on the same word.
+ * Wakeups can be spurious, callers check their condition again.
+ * @param addr word to wait on, 4 byte aligned
+ * @param expected value *addr has to have for the caller to block
+ * @param timeout milliseconds to wait for, negative to wait forever
+ * @return int 0 when woken up, -ERROR_AGAIN if *addr changed, -ERROR_TIMEOUT on timeout.
+ */
+int sys_futex_wait(uint32_t* addr, uint32_t expected, int timeout)
+{
+    uintptr_t paddr;
+    if(addr == NULL || ((uintptr_t) addr & 3) || vmem_user_to_physical($process->current, (uintptr_t) addr, &paddr) < 0){
+        return -ERROR_INVALID_ARGUMENTS;
+    }
+
+    int ticks = timeout < 0 ? WAIT_QUEUE_FOREVER : TIMER_MS_TO_TICKS(timeout);
+    int woken;
+
+    /* Checking the word and blocking cannot be split by a wake */
+    ENTER_CRITICAL();
+    wait_queue_t* wq = __futex_queue(paddr);
+    if(*(volatile uint32_t*) paddr != expected){
+        LEAVE_CRITICAL();
+        return -ERROR_AGAIN;
+    }
+    woken = wait_queue_block(wq, ticks);
+    LEAVE_CRITICAL();
+
+    return woken ? 0 : -ERROR_TIMEOUT;
+}
+EXPORT_SYSCALL(SYSCALL_FUTEX_WAIT, sys_futex_wait);
+
+/**
+ * @brief Wakes up the processes waiting on addr.
+ * Everyone waiting in the same bucket is woken up, they check their word again.
+ * @return int number of woken up processes.
+ */
+int sys_futex_wake(uint32_t* addr)
+{
+    uintptr_t paddr;
+    if(addr == NULL || vmem_user_to_physical($process->current, (uintptr_t) addr, &paddr) < 0){
+        return -ERROR_INVALID_ARGUMENTS;
+    }
+
+    return wake_up_all(__futex_queue(paddr));
+}
+EXPORT_SYSCALL(SYSCALL_FUTEX_WAKE, sys_futex_wake);
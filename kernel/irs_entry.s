@@ -157,6 +157,7 @@ page_fault_error:
 .global _page_fault_entry
 _page_fault_entry:
     cli
+    addl $1, __cli_cnt
 
     movl	%eax, (page_fault_save)
     popl	%eax
@@ -184,4 +185,5 @@ _page_fault_entry:
     popl	%ds
     popal
 
+    subl $1, __cli_cnt
     iret
@@ -44,6 +44,7 @@
 #include <errors.h>
 #include <mbr.h>
 #include <diskdev.h>
+#include <bcache.h>
 
 #include <arch/tss.h>
 
@@ -165,8 +166,8 @@ void kernel(uint32_t magic)
 	}
 	kernel_boot_printf("Peripherals initialized.");
 
-	/* initilize the default scheduler */
-	PANIC_ON_ERR(sched_init_default(get_scheduler(), 0));
+	/* initilize the multilevel priority scheduler */
+	PANIC_ON_ERR(sched_init_priority(get_scheduler(), 0));
 	kernel_boot_printf("Scheduler initialized.");
 
 	/* initilize net structs */
@@ -229,6 +230,7 @@ void kernel(uint32_t magic)
 	ksyms_init();
 
 	kernel_config_load("sysutil/default.cfg");
+	bcache_init(kernel_config_get_int("disk", "cache", BCACHE_DEFAULT_SIZE));
 
 	$services->usermanager = usermanager_create();
 	$services->usermanager->ops->load($services->usermanager);
@@ -245,12 +247,16 @@ void kernel(uint32_t magic)
 		start("textshell", 0, NULL);	
 	}	
 
+	if(disk_attached()){
+		start("fsflushd", 0, NULL);
+	}
+
 	if(kernel_config_check("network", "netd", "enable")){
 		start("netd", 0, NULL);
 	}
 	kernel_boot_printf("Deamons initialized.");
 
-	init_pit(1000);
+	init_pit(TIMER_HZ);
 	kernel_boot_printf("Timer initialized.");
 
 	dbgprintf("Critical counter: %d\n", __cli_cnt);
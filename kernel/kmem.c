@@ -26,8 +26,6 @@
 
 #define KMEM_BLOCK_SIZE 		256
 #define KMEM_BLOCKS_PER_BYTE 	8
-#define KMEM_BITMAP_INDEX(addr) ((addr - KERNEL_MEMORY_START) / KMEM_BLOCK_SIZE / KMEM_BLOCKS_PER_BYTE)
-#define KMEM_BITMAP_OFFSET(addr) ((addr - KERNEL_MEMORY_START) / KMEM_BLOCK_SIZE % KMEM_BLOCKS_PER_BYTE)
 
 /* values determined by memory map, set at runtime */
 static uint32_t KERNEL_MEMORY_START = 0;
@@ -36,33 +34,8 @@ static uint32_t KERNEL_MEMORY_END = 0;
 static uint8_t*   __kmemory_bitmap;
 static spinlock_t __kmemory_lock = 0;
 static uint32_t   __kmemory_used = 0;
-
-static inline int __kmemory_find_blocks(int num_blocks, int total_blocks)
-{
-    int free_blocks = 0;
-    for (int i = 0; i < total_blocks; i++) {
-        uint32_t index = KMEM_BITMAP_INDEX(KERNEL_MEMORY_START + i * KMEM_BLOCK_SIZE);
-        uint32_t offset = KMEM_BITMAP_OFFSET(KERNEL_MEMORY_START + i * KMEM_BLOCK_SIZE);
-        if (!(__kmemory_bitmap[index] & (1 << offset))) {
-            free_blocks++;
-            if (free_blocks == num_blocks) {
-                return i - num_blocks + 1;
-            }
-        } else {
-            free_blocks = 0;
-        }
-    }
-    return -1;  /* No free block found */
-}
-
-static inline void __kmemory_mark_blocks(int start_block, int num_blocks)
-{
-    for (int i = start_block; i < start_block + num_blocks; i++) {
-        uint32_t index = KMEM_BITMAP_INDEX(KERNEL_MEMORY_START + i * KMEM_BLOCK_SIZE);
-        uint32_t offset = KMEM_BITMAP_OFFSET(KERNEL_MEMORY_START + i * KMEM_BLOCK_SIZE);
-        __kmemory_bitmap[index] |= (1 << offset);
-    }
-}
+/* Next-fit cursor into the bitmap, block after the last allocation. */
+static int        __kmemory_hint = 0;
 
 static inline void __kmemory_write_metadata(int start_block, int num_blocks)
 {
@@ -93,7 +66,7 @@ void* kalloc(int size)
 
 	spin_lock(&__kmemory_lock);
 
-    int start_block = __kmemory_find_blocks(num_blocks, total_blocks);
+    int start_block = bitmap_get_continous_next(__kmemory_bitmap, total_blocks, num_blocks, &__kmemory_hint);
     if (start_block == -1) {
         /* No contiguous free region of memory was found */
         uint32_t *ebp = (uint32_t*) __builtin_frame_address(0);
@@ -103,7 +76,6 @@ void* kalloc(int size)
         kernel_panic("Out of memory!");
     }
 
-    __kmemory_mark_blocks(start_block, num_blocks);
     __kmemory_write_metadata(start_block, num_blocks);
 
     void* ptr = (void*)(KERNEL_MEMORY_START + start_block * KMEM_BLOCK_SIZE + sizeof(int));
@@ -159,11 +131,7 @@ void kfree(void* ptr)
 	dbgprintf("[MEMORY] %s freeing %d blocks of data\n", $process->current->name, num_blocks);
 
 	/* Mark the blocks as free in the bitmap */
-	for (int i = 0; i < num_blocks; i++) {
-		uint32_t index = KMEM_BITMAP_INDEX(KERNEL_MEMORY_START + (block_index + i) * KMEM_BLOCK_SIZE);
-		uint32_t offset = KMEM_BITMAP_OFFSET(KERNEL_MEMORY_START + (block_index + i) * KMEM_BLOCK_SIZE);
-		__kmemory_bitmap[index] &= ~(1 << offset);
-	}
+	bitmap_unset_continous(__kmemory_bitmap, block_index, num_blocks);
 
     __kmemory_used -= num_blocks * KMEM_BLOCK_SIZE;
 	spin_unlock(&__kmemory_lock);
@@ -222,5 +190,6 @@ void kmem_init()
     memset(__kmemory_bitmap, 0, (memory_map_get()->kernel.total) / KMEM_BLOCK_SIZE / KMEM_BLOCKS_PER_BYTE);
 
 	__kmemory_lock = 0;
+	__kmemory_hint = 0;
     dbgprintf("Lock 0x%x initiated by %s\n", &__kmemory_lock, $process->current->name);
 }
\ No newline at end of file
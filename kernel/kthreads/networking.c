@@ -15,7 +15,6 @@
 #include <serial.h>
 #include <assert.h>
 #include <kthreads.h>
-#include <work.h>
 
 #include <net/networkmanager.h>
 #include <net/interface.h>
@@ -37,7 +36,7 @@
 #define dbgprintf(...)
 #endif // !#define KDEBUG_NET_DAEMON
 
-#define MAX_PACKET_SIZE 0x600
+#define MAX_PACKET_SIZE SKB_DATA_SIZE
 
 struct networkmanager netd = {
     .state = NETD_UNINITIALIZED,
@@ -83,11 +82,26 @@ static void __net_config_loopback()
     net_arp_add_entry(&entry);
 }
 
+/* Consumes the skb */
 static void __net_transmit_skb(struct sk_buff* skb)
 {
-    if(skb == NULL || skb->interface == NULL) return;
+    int ret;
+    if(skb == NULL) return;
+    if(skb->interface == NULL){
+        skb_free(skb);
+        return;
+    }
+
+    /* Zero copy devices send straight from the skb and free it once done. */
+    struct netdev* dev = skb->interface->device;
+    if(dev != NULL && dev->transmit != NULL){
+        dev->sent++;
+        ret = dev->transmit(skb);
+    } else {
+        ret = skb->interface->ops->send(skb->interface, skb->data, skb->len);
+        skb_free(skb);
+    }
 
-    int ret = skb->interface->ops->send(skb->interface, skb->head, skb->len);
     if(ret < 0){
         warningf("Failed to send packet %d\n", ret);
         return;
@@ -125,9 +139,19 @@ void __callback net_incoming_packet(struct netdev* dev)
     if(dev == NULL) return;
 
     struct net_interface* interface = __net_interface(dev);
-    if(interface == NULL) return;
+    if(interface == NULL || netd.skb_rx_queue == NULL) return;
+
+    if(netd.skb_rx_queue->size >= NET_RX_QUEUE_MAX){
+        netd.stats.rx_overflow++;
+        netd.stats.dropped++;
+        return;
+    }
 
     struct sk_buff* skb = skb_new();
+    if(skb == NULL){
+        netd.stats.dropped++;
+        return;
+    }
     skb->len = dev->read((byte_t*)skb->data, MAX_PACKET_SIZE);
     if(skb->len <= 0) {
         dbgprintf("Received an empty packet.\n");
@@ -142,10 +166,55 @@ void __callback net_incoming_packet(struct netdev* dev)
     netd.packets++;
     netd.stats.recvd++;
 
-    if(netd.instance != NULL && netd.instance->state == BLOCKED){ 
-        netd.instance->state = RUNNING;
+    wake_up_one(&netd.wait);
+
+}
+
+/**
+ * @brief Queues a received packet for netd, for devices that hand over their own buffers.
+ * The skb is consumed.
+ */
+void __callback net_incoming_skb(struct netdev* dev, struct sk_buff* skb)
+{
+    struct net_interface* interface = __net_interface(dev);
+    if(interface == NULL || netd.skb_rx_queue == NULL){
+        netd.stats.dropped++;
+        skb_free(skb);
+        return;
+    }
+
+    if(netd.skb_rx_queue->size >= NET_RX_QUEUE_MAX){
+        netd.stats.rx_overflow++;
+        netd.stats.dropped++;
+        skb_free(skb);
+        return;
     }
+    skb->interface = interface;
+    dev->received++;
+
+    netd.skb_rx_queue->ops->add(netd.skb_rx_queue, skb);
+    netd.packets++;
+    netd.stats.recvd++;
 
+    wake_up_one(&netd.wait);
+}
+
+/**
+ * @brief Called from a device interrupt, netd polls the device until it is drained.
+ * The device keeps its RX interrupt masked until then.
+ */
+void __callback net_schedule_poll(struct netdev* dev)
+{
+    dev->poll_scheduled = 1;
+    wake_up_one(&netd.wait);
+}
+
+/**
+ * @brief Wakes netd from interrupt context, used by timers that leave their work to netd.
+ */
+void __callback net_wake()
+{
+    wake_up_one(&netd.wait);
 }
 
 struct net_interface* net_get_iface(uint32_t ip)
@@ -224,9 +293,7 @@ int net_send_skb(struct sk_buff* skb)
     RETURN_ON_ERR(netd.skb_tx_queue->ops->add(netd.skb_tx_queue, skb));
     netd.packets++;
 
-    if(netd.instance != NULL && netd.instance->state == BLOCKED){ 
-        netd.instance->state = RUNNING;
-    }
+    wake_up_one(&netd.wait);
 
     return 0;
 }
@@ -278,18 +345,77 @@ static int net_handle_recieve(struct sk_buff* skb)
     return 1;
 }
 
-static int net_handle_recieve_wrapper(void* data)
+static int __net_poll_pending()
 {
-    struct sk_buff* skb = (struct sk_buff*)data;
-    if(skb == NULL) return -1;
+    for (int i = 0; i < netd.if_count; i++){
+        struct netdev* dev = netd.ifs[i]->device;
+        if(dev != NULL && dev->poll != NULL && dev->poll_scheduled) return 1;
+    }
+    return 0;
+}
 
-    int ret = net_handle_recieve(skb);
-    if(ret < 0){
-        dbgprintf("Failed to handle packet\n");
-        return 0;
+/**
+ * @brief Polls every device that asked for it, up to budget frames each.
+ * A device returning a full budget stays scheduled, others go back to interrupt mode.
+ * @return int 1 if a device still has frames waiting.
+ */
+static int __net_poll_devices(int budget)
+{
+    int pending = 0;
+    for (int i = 0; i < netd.if_count; i++){
+        struct netdev* dev = netd.ifs[i]->device;
+        if(dev == NULL || dev->poll == NULL || !dev->poll_scheduled) continue;
+
+        /* Cleared first, the interrupt may schedule the device again once it is re-enabled. */
+        dev->poll_scheduled = 0;
+        int polled = dev->poll(budget);
+        netd.stats.polled += polled;
+
+        if(polled >= budget){
+            dev->poll_scheduled = 1;
+            pending = 1;
+        }
+    }
+    return pending;
+}
+
+static int __net_transmit_batch(int budget)
+{
+    int sent = 0;
+    while(sent < budget && SKB_QUEUE_READY(netd.skb_tx_queue)){
+        struct sk_buff* skb = netd.skb_tx_queue->ops->remove(netd.skb_tx_queue);
+        if(skb == NULL) break;
+
+        __net_transmit_skb(skb);
+        sent++;
     }
 
-    return 0;
+    if(sent > 0){
+        netd.stats.tx_batches++;
+        if(sent > netd.stats.tx_batch_max) netd.stats.tx_batch_max = sent;
+    }
+    return sent;
+}
+
+/* Received packets are parsed by netd itself, instead of one work per packet. */
+static int __net_receive_batch(int budget)
+{
+    int received = 0;
+    while(received < budget && SKB_QUEUE_READY(netd.skb_rx_queue)){
+        struct sk_buff* skb = netd.skb_rx_queue->ops->remove(netd.skb_rx_queue);
+        if(skb == NULL) break;
+
+        if(net_handle_recieve(skb) < 0){
+            dbgprintf("Failed to handle packet\n");
+        }
+        received++;
+    }
+
+    if(received > 0){
+        netd.stats.rx_batches++;
+        if(received > netd.stats.rx_batch_max) netd.stats.rx_batch_max = received;
+    }
+    return received;
 }
 
 /**
@@ -301,6 +427,7 @@ void __kthread_entry networking_main()
     if(netd.state == NETD_UNINITIALIZED){
         netd.skb_rx_queue = skb_new_queue();
         netd.skb_tx_queue = skb_new_queue();
+        wait_queue_init(&netd.wait);
     }
 
     netd.instance = $process->current;
@@ -322,38 +449,30 @@ void __kthread_entry networking_main()
     
     //start("udp_server", 0, NULL);
     //start("tcp_server", 0, NULL); 
-    int todos =0;
     while(1){
-        
-        todos = netd.skb_tx_queue->size + netd.skb_rx_queue->size + tcp_retry_queue_size();
-        /**
-         * @brief Query RX an    TX queue for netd.packets.
-         */
-        if(SKB_QUEUE_READY(netd.skb_tx_queue)){
-            dbgprintf("Sending new SKB from TX queue\n");
-            struct sk_buff* skb = netd.skb_tx_queue->ops->remove(netd.skb_tx_queue);
-            assert(skb != NULL);
+        /* Sleep until a device needs polling or there are packets to send or receive. */
+        wait_event(&netd.wait, __net_poll_pending() || SKB_QUEUE_READY(netd.skb_tx_queue) || SKB_QUEUE_READY(netd.skb_rx_queue) || tcp_retry_queue_size() > 0 || tcp_retransmit_pending());
 
-            __net_transmit_skb(skb);
-            skb_free(skb);
-        }
+        /* Drivers receive from interrupt context and only take reserved buffers */
+        skb_cache_reserve(SKB_RX_RESERVE);
 
-        if(SKB_QUEUE_READY(netd.skb_rx_queue)){
-            dbgprintf("Receiving new SKB from RX queue\n");
-            struct sk_buff* skb = netd.skb_rx_queue->ops->remove(netd.skb_rx_queue);
-            assert(skb != NULL);
-
-            /* Offload skb parsing to worker thread. */
-            work_queue_add(&net_handle_recieve_wrapper, (void*)skb, NULL);
-            //net_handle_recieve(skb);
-        }
+        int busy = 0;
+        busy |= __net_poll_devices(NET_RX_BUDGET);
+        busy |= __net_transmit_batch(NET_TX_BUDGET) == NET_TX_BUDGET;
+        busy |= __net_receive_batch(NET_RX_BUDGET) == NET_RX_BUDGET;
 
         tcp_retry_all();
-
-        if(todos == 0){
-            //$process->current->state = BLOCKED;
+        if(tcp_retransmit_pending()){
+            tcp_retransmit_expired();
         }
 
-        kernel_yield();
+        /**
+         * A full budget means more work is waiting, stay in polling mode
+         * without sleeping, but let other threads run between rounds.
+         */
+        if(busy){
+            netd.stats.poll_rounds++;
+            kernel_yield();
+        }
     }
 }
\ No newline at end of file
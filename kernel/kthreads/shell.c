@@ -28,6 +28,7 @@
 #include <serial.h>
 
 #include <diskdev.h>
+#include <bcache.h>
 
 #include <gfx/gfxlib.h>
 #include <gfx/theme.h>
@@ -400,6 +401,18 @@ void fdisk(int argc, char* argv[])
 	twritef("Attached: %d\n", dev->attached);
 	twritef("Read:     %x\n", dev->read);
 	twritef("Write:    %x\n", dev->write);
+
+	struct bcache_info info;
+	bcache_get_info(&info);
+	int lookups = info.hits + info.misses;
+	twritef("Cache:    %d blocks, %d dirty\n", info.size, info.dirty);
+	twritef("Hits:     %d/%d (%d%%)\n", info.hits, lookups, lookups ? (int)((info.hits*100)/lookups) : 0);
+	twritef("Disk I/O: %d reads, %d writes\n", info.reads, info.writes);
+
+	struct ata_info ata;
+	if(ata_get_info(&ata) == 0 && ata.commands > 0){
+		twritef("ATA:      %s, %d sectors in %d commands\n", ata.dma ? "DMA" : "PIO", ata.sectors, ata.commands);
+	}
 }
 EXPORT_KSYMBOL(fdisk);
 
@@ -131,7 +131,7 @@ static void sysinf_draw_mem(struct window* w, struct tab* tab)
     w->draw->textf(w, 30, 45+30, 0,     "Permanent:     %d MB", map->permanent.total / 1024 / 1024);
 
     char* kernel = "Usage";
-    SECTION(w, 24, HEIGHT/2+10, WIDTH-48, HEIGHT/2-48, kernel);
+    SECTION(w, 24, HEIGHT/2+10, WIDTH/2-24, HEIGHT/2-48, kernel);
 
     /* memory usage with rectangles based on percentage */
     int kernel_usage = (int)(((float)info.kernel.used / (float)info.kernel.total)*100);
@@ -150,7 +150,14 @@ static void sysinf_draw_mem(struct window* w, struct tab* tab)
     w->draw->rect(w, 31, HEIGHT/2+10+10+10+10+10+11, permanent_usage, 8, COLOR_VGA_GREEN);
     w->draw->textf(w, 30, HEIGHT/2+10+10+10+10+10+10+12, 0, "Permanent: %d%", permanent_usage);
 
-    gfx_put_icon32(computer_icon, 175, HEIGHT/2+10+10+10+5);
+    /* Slab cache hits / misses */
+    struct kmem_cache_info caches[KMEM_CACHE_MAX];
+    int count = kmem_cache_get_info(caches, KMEM_CACHE_MAX);
+
+    SECTION(w, WIDTH/2+6, HEIGHT/2+10, WIDTH/2-30, HEIGHT/2-48, "Slabs");
+    for (int i = 0; i < count && i < 7; i++){
+        w->draw->textf(w, WIDTH/2+12, HEIGHT/2+10+10+(i*10), 0, "%s %d/%d", caches[i].name, caches[i].stats.hits, caches[i].stats.misses);
+    }
 }
 
 static void sysinf_draw_net(struct window* w, struct tab* tab)
@@ -16,6 +16,8 @@
 #include <bitmap.h>
 #include <assert.h>
 #include <kutils.h>
+#include <syscalls.h>
+#include <syscall_helper.h>
 
 #define MB(mb) (mb*1024*1024)
 #define KB(kb) (kb*1024)
@@ -130,6 +132,24 @@ void* malloc(unsigned int size)
 	return ptr;
 }
 
+/**
+ * @brief Allocates an arena of whole pages from the calling process heap.
+ * Used by the userspace allocator, which carves small allocations out of it
+ * without further system calls. Arenas live as long as the process.
+ * Only the size is page granular, the start is aligned like malloc().
+ * @param size Size of the arena, rounded up to whole pages.
+ * @return int start of the arena, 0 if out of memory.
+ */
+int sys_mmap(int size)
+{
+	if(size <= 0){
+		return 0;
+	}
+
+	return (int) malloc(ALIGN(size, PAGE_SIZE));
+}
+EXPORT_SYSCALL(SYSCALL_MMAP, sys_mmap);
+
 void* calloc(int size, int val)
 {
 	void* m = malloc(size);
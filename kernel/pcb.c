@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <kthreads.h>
 #include <kutils.h>
+#include <timer.h>
 #include <libc.h>
 #include <errors.h>
 
@@ -25,12 +26,15 @@
 #include <syscall_helper.h>
 
 #include <fs/fs.h>
+#include <ipc.h>
 
 #include <user.h>
 #include <admin.h>
 #include <usermanager.h>
 
 static struct pcb pcb_table[MAX_NUM_OF_PCBS];
+/* Sleep timers, kept out of the packed struct pcb so they stay aligned */
+static struct ktimer pcb_timers[MAX_NUM_OF_PCBS];
 static struct process __process = {
 	.current = &(struct pcb){
 		.name = "kernel",
@@ -52,6 +56,8 @@ static int pcb_count = 0;
 
 static void __pcb_free(struct pcb* pcb)
 {
+	ktimer_del(pcb_get_timer(pcb));
+	memset(pcb_get_timer(pcb), 0, sizeof(struct ktimer));
 	memset(pcb, 0, sizeof(struct pcb));
 	pcb->state = STOPPED;
 	pcb->parent = NULL;
@@ -138,6 +144,8 @@ static struct pcb* __pcb_get_free()
 			pcb->current_directory = 0;
 			pcb->yields = 0;
 			pcb->in_kernel = false;
+			pcb->priority = PCB_PRIORITY_NORMAL;
+			pcb->queue = NULL;
 
 			return pcb;
 		}
@@ -190,11 +198,12 @@ static int __pcb_init_virt_args(struct pcb* pcb, int argc, char** argv)
 		return -ERROR_ALLOC;
 	}
 
-	/* get physical address */
-	uint32_t* heap_table = (uint32_t*)(pcb->page_dir[DIRECTORY_INDEX(VMEM_HEAP)] & ~PAGE_MASK);
-	uint32_t heap_page = (uint32_t)((uint32_t*)heap_table)[TABLE_INDEX((uint32_t)virtual_args)]& ~PAGE_MASK;
+	/* Build the args here, they can straddle two pages of the process heap */
+	struct args* _args = create(struct args);
+	if(_args == NULL){
+		return -ERROR_ALLOC;
+	}
 
-	struct args* _args = (struct args*)(heap_page);
 	/* copy over args */
 	_args->argc = argc;
 	for (int i = 0; i < argc; i++){
@@ -202,7 +211,14 @@ static int __pcb_init_virt_args(struct pcb* pcb, int argc, char** argv)
 		_args->argv[i] = virtual_args->data[i];
 		dbgprintf("Arg %d: %s (0x%x)\n", i, _args->data[i], _args->argv[i]);
 	}
-	pcb->args = _args->argc;
+
+	int ret = vmem_copy_to_process(pcb, (uintptr_t) virtual_args, _args, sizeof(struct args));
+	kfree(_args);
+	if(ret < 0){
+		return ret;
+	}
+
+	pcb->args = argc;
 	pcb->argv = virtual_args->argv;
 
 	return ERROR_OK;
@@ -261,6 +277,9 @@ void pcb_kill(int pid)
 {
 	if(pid < 0 || pid > MAX_NUM_OF_PCBS) return;
 	pcb_table[pid].state = ZOMBIE;
+
+	/* A waiting pcb has to be put back on the runqueue to be cleaned up. */
+	get_scheduler()->ops->wake(get_scheduler(), &pcb_table[pid]);
 }
 
 void Genesis()
@@ -270,6 +289,9 @@ void Genesis()
 
 void idletask(){
 	dbgprintf("Hello world!\n");
+
+	/* Only run when nothing else is ready, the scheduler is never left without a pcb. */
+	$process->current->priority = PCB_PRIORITY_IDLE;
 	while(1){
 		if(__cli_cnt>0) warningf("Critical: %d\n", __cli_cnt);
 		kernel_yield();
@@ -281,6 +303,15 @@ struct pcb* pcb_get_by_pid(int pid)
 	return &pcb_table[pid];
 }
 
+/**
+ * @brief Returns the sleep timer of a pcb.
+ * Timers live outside the packed struct pcb so their members stay aligned.
+ */
+struct ktimer* pcb_get_timer(struct pcb* pcb)
+{
+	return &pcb_timers[pcb - pcb_table];
+}
+
 struct pcb* pcb_get_by_name(char* name)
 {
 	for (int i = 0; i < MAX_NUM_OF_PCBS; i++){
@@ -341,6 +372,7 @@ int pcb_cleanup_routine(void* arg)
 	
 	switch (pcb->is_process){
 	case PCB_PROCESS:
+		ipc_cleanup_process(pcb);
 		vmem_cleanup_process(pcb);
 		break;
 	case PCB_THREAD:
@@ -416,32 +448,24 @@ error_t pcb_create_process(char* program, int argc, char** argv, pcb_flag_t flag
 {
 	AUTHORIZED_GUARD(CTRL_PROC_CREATE | SYSTEM_FULL_ACCESS | ADMIN_FULL_ACCESS);
 
-	#define MAX_PROGRAM_SIZE 128*1024
-
-	char* buf;
-	int ret, size;
+	int ret;
 	struct pcb* pcb;
+	struct vmem_image* image;
 
-	/* Load program into memory */
-	buf = kalloc(MAX_PROGRAM_SIZE);
-	if(buf == NULL){return -ERROR_ALLOC;}
-	
-	ret = fs_load_from_file(program, buf, MAX_PROGRAM_SIZE);
-	if(ret < 0){
+	/* The program is paged in as it runs and shared with other instances, see vmem_page_fault() */
+	image = vmem_image_get(program);
+	if(image == NULL){
 		dbgprintf("Error loading %s\n", program);
-		
-		kfree(buf);
 		return -ERROR_FILE_NOT_FOUND;
 	}
-	size = ret;
 
 	pcb = __pcb_init_process(flags, VMEM_DATA);
 	if(pcb == NULL){
-		kfree(buf);
+		vmem_image_put(image);
         return -ERROR_NULL_POINTER;
     }
 
-	pcb->data_size = size;
+	pcb->data_size = image->size;
 	memcpy(pcb->name, program, strlen(program)+1);
 
 	pcb->term = $process->current->term;
@@ -450,12 +474,12 @@ error_t pcb_create_process(char* program, int argc, char** argv, pcb_flag_t flag
 
 	pcb->thread_eip = 0;
 
-	/* Memory map data */
-	vmem_init_process(pcb, buf, size);
+	/* Memory map data, the process owns the image reference from here */
+	vmem_init_process(pcb, image);
 
 	ret = __pcb_init_virt_args(pcb, argc, argv);
 	if(ret < 0){
-		kfree(buf);
+		vmem_cleanup_process(pcb);
 		__pcb_free(pcb);
 
 		return -ERROR_ALLOC;
@@ -465,7 +489,6 @@ error_t pcb_create_process(char* program, int argc, char** argv, pcb_flag_t flag
 	// TODO: Check for errors
 
 	pcb_count++;
-	kfree(buf);
 
 	dbgprintf("Created new process! %d\n", __cli_cnt);
 	/* Run */
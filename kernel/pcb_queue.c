@@ -37,7 +37,7 @@ static struct pcb_queue_operations pcb_queue_default_ops = {
  * @brief Creates a new PCB queue.
  *
  * The `pcb_new_queue()` function allocates memory for a new `pcb_queue` structure and initializes its members.
- * The `_list` member is set to `NULL`, and the queue's operations and spinlock are attached and initialized.
+ * The `_list` and `_tail` members are set to `NULL`, and the queue's operations and spinlock are attached and initialized.
  *
  * @return A pointer to the newly created `pcb_queue` structure. NULL on error.
  */ 
@@ -49,6 +49,7 @@ struct pcb_queue* pcb_new_queue()
 	}
 
 	queue->_list = NULL;
+	queue->_tail = NULL;
 	queue->ops = &pcb_queue_default_ops;
 	queue->spinlock = 0;
 	queue->total = 0;
@@ -57,12 +58,12 @@ struct pcb_queue* pcb_new_queue()
 }
 
 /**
- * @brief Pushes a PCB onto the single linked PCB queue.
+ * @brief Pushes a PCB onto the end of the double linked PCB queue.
  *
  * The `__pcb_queue_push()` function adds a PCB to the end of the specified queue. The function takes a pointer to
  * the `pcb_queue` structure and a pointer to the `pcb` structure to be added as arguments. The function uses
- * a spinlock to protect the critical section and adds the PCB to the end of the queue by traversing the current
- * list of PCBs and adding the new PCB to the end.
+ * a spinlock to protect the critical section and links the PCB in after the current tail, which makes the
+ * operation constant time regardless of the size of the queue.
  *
  * @param queue A pointer to the `pcb_queue` structure to add the `pcb` to.
  * @param pcb A pointer to the `pcb` structure to add to the queue.
@@ -74,29 +75,27 @@ static error_t __pcb_queue_push(struct pcb_queue* queue, struct pcb* pcb)
 		return -ERROR_PCB_QUEUE_NULL;
 	}
 
-	/* This approach is suboptimal for large pcb queues, as you have to iterate over all pcbs */
 	SPINLOCK(queue, {
 
-		struct pcb* current = queue->_list;
-		if(current == NULL){
-			queue->_list = pcb;
-			break;
-		}
-		while (current->next != NULL){
-			current = current->next;
-		}
-		current->next = pcb;
 		pcb->next = NULL;
-		queue->total++;
+		pcb->prev = queue->_tail;
 
+		if(queue->_tail == NULL){
+			queue->_list = pcb;
+		} else {
+			queue->_tail->next = pcb;
+		}
+		queue->_tail = pcb;
 
+		pcb->queue = queue;
+		queue->total++;
 	});
 
 	return ERROR_OK;
 }
 
 /**
- * @brief Adds a PCB to the single linked PCB queue.
+ * @brief Adds a PCB to the front of the double linked PCB queue.
  *
  * The `__pcb_queue_add()` function adds a PCB to the beginning of the specified queue. The function takes a pointer to
  * the `pcb_queue` structure and a pointer to the `pcb` structure to be added as arguments. The function uses
@@ -116,9 +115,17 @@ static error_t __pcb_queue_add(struct pcb_queue* queue, struct pcb* pcb)
 	SPINLOCK(queue, {
 
 		/* Add the pcb to the front of the queue */
+		pcb->prev = NULL;
 		pcb->next = queue->_list; /* Set the next pointer of the new pcb to the current head of the queue */
+
+		if(queue->_list == NULL){
+			queue->_tail = pcb;
+		} else {
+			queue->_list->prev = pcb;
+		}
 		queue->_list = pcb; /* Set the head of the queue to the new pcb */
 
+		pcb->queue = queue;
 		queue->total++;
 
 	});
@@ -133,35 +140,35 @@ static error_t __pcb_queue_add(struct pcb_queue* queue, struct pcb* pcb)
  * `pcb_queue` structure and a pointer to the `pcb` structure to be removed as arguments. The function uses a
  * spinlock to protect the critical section and removes the specified PCB from the queue by modifying the pointers
  * of the previous and next PCBs in the queue to bypass the removed PCB.
+ * The PCB's queue pointer is used to check membership, so removing a PCB which is not in the queue is a no-op.
  *
  * @param queue A pointer to the `pcb_queue` structure to remove the `pcb` from.
  * @param pcb A pointer to the `pcb` structure to remove from the queue.
  */
 static void __pcb_queue_remove(struct pcb_queue* queue, struct pcb* pcb)
 {
-	if(queue == NULL || pcb == NULL || queue->_list == NULL){
+	if(queue == NULL || pcb == NULL || queue->_list == NULL || pcb->queue != queue){
 		return;
 	}
 
 	SPINLOCK(queue, {
 
-		if(queue->_list == pcb){
+		if(pcb->prev == NULL){
 			queue->_list = pcb->next;
-			break;
-		}
-
-
-		/* Remove pcb from linked list queue */
-		struct pcb* current = queue->_list;
-		while ( current->next != NULL && current->next != pcb){
-			current = current->next;
+		} else {
+			pcb->prev->next = pcb->next;
 		}
 
-		if(current->next == NULL){
-			break;
+		if(pcb->next == NULL){
+			queue->_tail = pcb->prev;
+		} else {
+			pcb->next->prev = pcb->prev;
 		}
 
-		current->next = pcb->next;
+		pcb->next = NULL;
+		pcb->prev = NULL;
+		pcb->queue = NULL;
+		queue->total--;
 	});
 
 }
@@ -189,8 +196,16 @@ static struct pcb* __pcb_queue_pop(struct pcb_queue* queue)
 		front = queue->_list;
 		queue->_list = front->next;
 
+		if(queue->_list == NULL){
+			queue->_tail = NULL;
+		} else {
+			queue->_list->prev = NULL;
+		}
+
 		front->next = NULL;
 		front->prev = NULL;
+		front->queue = NULL;
+		queue->total--;
 	});
 
     return front;
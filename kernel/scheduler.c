@@ -28,8 +28,21 @@ static error_t sched_sleep(struct scheduler* sched, int time);
 static struct pcb* sched_consume(struct scheduler* sched);
 static error_t sched_exit(struct scheduler* sched);
 
+static error_t sched_wake(struct scheduler* sched, struct pcb* pcb);
+
 static error_t sched_round_robin(struct scheduler* sched);
 
+/* multilevel priority operator functions */
+static error_t sched_priority_prioritize(struct scheduler* sched, struct pcb* pcb);
+static error_t sched_priority(struct scheduler* sched);
+static error_t sched_priority_add(struct scheduler* sched, struct pcb* pcb);
+static error_t sched_priority_block(struct scheduler* sched, struct pcb* pcb);
+static error_t sched_priority_sleep(struct scheduler* sched, int time);
+static error_t sched_priority_exit(struct scheduler* sched);
+static error_t sched_priority_wake(struct scheduler* sched, struct pcb* pcb);
+
+static error_t sched_priority_switch(struct scheduler* sched);
+
 /* Default scheduler operations */
 static struct scheduler_ops sched_default_ops = {
     .prioritize = &sched_prioritize,
@@ -39,7 +52,21 @@ static struct scheduler_ops sched_default_ops = {
     .exit = &sched_exit,
     .yield = &sched_default,
     .consume = &sched_consume,
-    .block = &sched_block
+    .block = &sched_block,
+    .wake = &sched_wake
+};
+
+/* Multilevel priority scheduler operations */
+static struct scheduler_ops sched_priority_ops = {
+    .prioritize = &sched_priority_prioritize,
+    .add = &sched_priority_add,
+    .schedule = &sched_priority,
+    .sleep = &sched_priority_sleep,
+    .exit = &sched_priority_exit,
+    .yield = &sched_priority,
+    .consume = &sched_consume,
+    .block = &sched_priority_block,
+    .wake = &sched_priority_wake
 };
 
 /* Default scheduler instance */
@@ -47,6 +74,9 @@ static struct scheduler sched_default_instance = {
     .ops = &sched_default_ops,
     .queue = NULL,
     .priority = NULL,
+    .runqueue.bitmap = 0,
+    .sleeping = NULL,
+    .blocked = NULL,
     .ctx.running = NULL,
     .yields = 0,
     .exits = 0,
@@ -85,6 +115,43 @@ error_t sched_init_default(struct scheduler* sched, sched_flag_t flags)
     return ERROR_OK;
 }
 
+/**
+ * @brief Initializes the multilevel priority scheduler
+ * Sets up one runqueue per priority level, the boost queue (priority)
+ * and the wait structures for sleeping and blocked PCBs.
+ * @param sched  The scheduler to initialize
+ * @param flags  Flags to set on the scheduler
+ * @return error_t  0 on success, error code on failure
+ */
+error_t sched_init_priority(struct scheduler* sched, sched_flag_t flags)
+{
+    ERR_ON_NULL(sched);
+    if(sched->flags & SCHED_INITIATED){
+        return -ERROR_SCHED_EXISTS;
+    }
+
+    sched->ops = &sched_priority_ops;
+
+    for (int i = 0; i < PCB_PRIORITY_LEVELS; i++){
+        sched->runqueue.levels[i] = pcb_new_queue();
+        if(sched->runqueue.levels[i] == NULL){
+            return -ERROR_PCB_QUEUE_CREATE;
+        }
+    }
+    sched->runqueue.bitmap = 0;
+
+    sched->priority = pcb_new_queue();
+    sched->sleeping = pcb_new_queue();
+    sched->blocked = pcb_new_queue();
+    if(sched->priority == NULL || sched->sleeping == NULL || sched->blocked == NULL){
+        return -ERROR_PCB_QUEUE_CREATE;
+    }
+
+    sched->flags = flags | SCHED_INITIATED;
+
+    return ERROR_OK;
+}
+
 /**
  * @brief Puts the current running process to sleep for the given time
  * 
@@ -173,6 +240,40 @@ static error_t sched_block(struct scheduler* sched, struct pcb* pcb)
     return ERROR_OK;
 }
 
+/**
+ * @brief Makes the given pcb the running pcb
+ * Updates the kernel stack used on privilege changes and switches page directory.
+ * @param sched  The scheduler to set running on
+ * @param next  The pcb to run
+ */
+static inline void __sched_set_running(struct scheduler* sched, struct pcb* next)
+{
+    sched->ctx.running = next;
+    $process->current = next;
+
+    if(next->is_process){
+        tss.esp_0 = (uint32_t)next->kebp;
+        tss.ss_0 = GDT_KERNEL_DS;
+    }
+
+    load_page_directory(next->page_dir);
+}
+
+/**
+ * @brief This is where the new process is started
+ * This calls the start_pcb function and sets up the page directory.
+ * Should only be called once for each pcb.
+ * @param sched  The scheduler to start on
+ * @param next  The new pcb to start
+ */
+static void __sched_start_new(struct scheduler* sched, struct pcb* next)
+{
+    __sched_set_running(sched, next);
+    //load_data_segments(GDT_KERNEL_DS);
+    start_pcb(next);
+    kernel_panic("Illegal return of 'start_pcb'");/* not sure if it should return or break */
+}
+
 /**
  * @brief round robin scheduler
  * 
@@ -211,25 +312,8 @@ static error_t sched_round_robin(struct scheduler* sched)
         switch (next->state){
         case RUNNING:
             break;
-        case PCB_NEW:{
-                /**
-                 * @brief This is where the new process is started
-                 * This calls the start_pcb function and sets up the page directory.
-                 * Should only be called once for each pcb.
-                 */
-
-                if(next->is_process){
-                    tss.esp_0 = (uint32_t)next->kebp;
-                    tss.ss_0 = GDT_KERNEL_DS;
-                }
-
-                sched->ctx.running = next;
-                $process->current = next;
-                load_page_directory(next->page_dir);
-                //load_data_segments(GDT_KERNEL_DS);
-                start_pcb(next);
-                kernel_panic("Illegal return of 'start_pcb'");/* not sure if it should return or break */
-            }
+        case PCB_NEW:
+            __sched_start_new(sched, next);
             break; /* Never reached. */
         case ZOMBIE:{
                 /**
@@ -248,7 +332,7 @@ static error_t sched_round_robin(struct scheduler* sched)
                  * If the pcb's sleep time is less than the current tick we can wake it up
                  * and schedule it as running, else it will be put at the end of the queue.
                  */
-                if(next->sleep < timer_get_tick()){
+                if((int32_t)(timer_get_tick() - next->sleep) > 0){
                     next->state = RUNNING;
                     break;
                 }
@@ -263,15 +347,7 @@ static error_t sched_round_robin(struct scheduler* sched)
         }
     } while(next->state != RUNNING);
     
-    sched->ctx.running = next;
-    $process->current = next;
-
-    if(next->is_process){
-        tss.esp_0 = (uint32_t)next->kebp;
-        tss.ss_0 = GDT_KERNEL_DS;
-    }
-
-    load_page_directory(sched->ctx.running->page_dir);
+    __sched_set_running(sched, next);
     return ERROR_OK;
 }
 
@@ -354,6 +430,395 @@ static error_t sched_add(struct scheduler* sched, struct pcb* pcb)
     return ERROR_OK;
 }
 
+/**
+ * @brief Wakes the given pcb if it is blocked or sleeping
+ * The round robin scheduler keeps waiting PCBs in its queue,
+ * so it is enough to mark the pcb as running.
+ * @param sched  The scheduler to wake on
+ * @param pcb  The pcb to wake
+ * @return int 0 on success, error code on failure
+ */
+static error_t sched_wake(struct scheduler* sched, struct pcb* pcb)
+{
+    ERR_ON_NULL(pcb);
+    SCHED_VALIDATE(sched);
+
+    if((pcb->queue == sched->queue || pcb->queue == NULL) && (pcb->state == BLOCKED || pcb->state == SLEEPING)){
+        pcb->state = RUNNING;
+    }
+
+    return ERROR_OK;
+}
+
+/* Multilevel priority scheduler */
+
+/**
+ * @brief Puts the pcb on the runqueue of its priority level
+ * The level is marked as ready in the runqueue bitmap.
+ */
+static inline void __sched_enqueue(struct scheduler* sched, struct pcb* pcb)
+{
+    int level = pcb->priority < PCB_PRIORITY_LEVELS ? pcb->priority : PCB_PRIORITY_LEVELS-1;
+
+    sched->runqueue.levels[level]->ops->push(sched->runqueue.levels[level], pcb);
+    sched->runqueue.bitmap |= (1 << level);
+}
+
+/**
+ * @brief Removes the pcb from the runqueue of its priority level
+ * Clears the level in the runqueue bitmap if it is now empty.
+ */
+static inline void __sched_dequeue_level(struct scheduler* sched, struct pcb* pcb, int level)
+{
+    struct pcb_queue* queue = sched->runqueue.levels[level];
+
+    queue->ops->remove(queue, pcb);
+    if(queue->_list == NULL){
+        sched->runqueue.bitmap &= ~(1 << level);
+    }
+}
+
+/**
+ * @brief Returns the next pcb to run
+ * Boosted PCBs in the priority queue are always picked first,
+ * then the first pcb of the highest priority non empty level.
+ * The level is found with a single bit scan of the bitmap.
+ */
+static inline struct pcb* __sched_dequeue(struct scheduler* sched)
+{
+    struct pcb* next = sched->priority->ops->pop(sched->priority);
+    if(next != NULL){
+        return next;
+    }
+
+    if(sched->runqueue.bitmap == 0){
+        return NULL;
+    }
+
+    int level = __builtin_ctz(sched->runqueue.bitmap);
+    next = sched->runqueue.levels[level]->ops->peek(sched->runqueue.levels[level]);
+    __sched_dequeue_level(sched, next, level);
+
+    return next;
+}
+
+/**
+ * @brief Timer callback for sleeping PCBs, called from the PIT interrupt.
+ * Moves the pcb onto its runqueue exactly when its deadline expires.
+ */
+static void __sched_sleep_expired(void* arg)
+{
+    struct scheduler* sched = get_scheduler();
+    sched->ops->wake(sched, (struct pcb*)arg);
+}
+
+/**
+ * @brief Places the pcb in the structure matching its state.
+ * Ready PCBs go on their runqueue, sleeping and blocked PCBs on the wait structures.
+ * ZOMBIE PCBs are never queued again, a work thread will deal with cleaning up the pcb.
+ */
+static void __sched_park(struct scheduler* sched, struct pcb* pcb)
+{
+    switch (pcb->state){
+    case SLEEPING:
+        /* The sleep timer moves the pcb back to its runqueue. */
+        sched->sleeping->ops->push(sched->sleeping, pcb);
+        break;
+    case BLOCKED:
+        /* PCBs blocked on a mutex are already owned by its queue. */
+        if(pcb->queue == NULL){
+            sched->blocked->ops->push(sched->blocked, pcb);
+        }
+        break;
+    case ZOMBIE:
+        work_queue_add(&pcb_cleanup_routine, (void*)((int)pcb->pid), NULL);
+        break;
+    case RUNNING:
+    case PCB_NEW:
+    default:
+        __sched_enqueue(sched, pcb);
+        break;
+    }
+}
+
+/**
+ * @brief Returns true if the queue belongs to the given scheduler.
+ */
+static inline bool_t __sched_owns_queue(struct scheduler* sched, struct pcb_queue* queue)
+{
+    if(queue == NULL) return false;
+    if(queue == sched->priority || queue == sched->sleeping || queue == sched->blocked) return true;
+
+    for (int i = 0; i < PCB_PRIORITY_LEVELS; i++){
+        if(queue == sched->runqueue.levels[i]) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Unlinks the pcb from whichever scheduler structure it is on.
+ */
+static inline void __sched_unlink(struct scheduler* sched, struct pcb* pcb)
+{
+    for (int i = 0; i < PCB_PRIORITY_LEVELS; i++){
+        if(pcb->queue == sched->runqueue.levels[i]){
+            __sched_dequeue_level(sched, pcb, i);
+            return;
+        }
+    }
+    pcb->queue->ops->remove(pcb->queue, pcb);
+}
+
+/**
+ * @brief Multilevel priority scheduler
+ * Parks the current running pcb and picks the next one without
+ * visiting any blocked or sleeping PCBs.
+ * @param sched  The scheduler to schedule on
+ * @return int 0 on success, error code on failure
+ */
+static error_t sched_priority_switch(struct scheduler* sched)
+{
+    struct pcb* next;
+
+    ERR_ON_NULL(sched);
+    SCHED_VALIDATE(sched);
+    ASSERT_CRITICAL();
+
+    if(sched->ctx.running != NULL){
+        __sched_park(sched, sched->ctx.running);
+        sched->ctx.running = NULL;
+    }
+
+    while(1){
+        next = __sched_dequeue(sched);
+        if(next == NULL){
+            warningf("Queue is empty");
+            return -ERROR_PCB_QUEUE_EMPTY;
+        }
+
+        switch (next->state){
+        case RUNNING:
+            __sched_set_running(sched, next);
+            return ERROR_OK;
+        case PCB_NEW:
+            __sched_start_new(sched, next);
+            break; /* Never reached. */
+        default:
+            /* State changed while queued, place it where it belongs. */
+            __sched_park(sched, next);
+            break;
+        }
+    }
+}
+
+/* Multilevel priority scheduler behavior */
+static error_t sched_priority(struct scheduler* sched)
+{
+    ERR_ON_NULL(sched);
+    SCHED_VALIDATE(sched);
+
+    CRITICAL_SECTION({
+        /* If no running process, get one from the runqueues */
+        if (sched->ctx.running == NULL){
+            sched->ctx.running = __sched_dequeue(sched);
+            /* Temporary fix */
+            $process->current = sched->ctx.running;
+        }
+
+        sched->ctx.running->yields++;
+        sched->yields++;
+
+        pcb_save_context(sched->ctx.running);
+
+        PANIC_ON_ERR(sched_priority_switch(sched));
+
+        pcb_restore_context(sched->ctx.running);
+    });
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Puts the current running process to sleep for the given time
+ * The pcb is placed in the sleep queue when it is switched out and
+ * its timer wakes it up when the deadline expires. Sleeping PCBs
+ * can be woken up early with the wake operation.
+ * @param sched  The scheduler to sleep on
+ * @param time  The time to sleep for in ticks
+ * @return int  0 on success, error code on failure
+ */
+static error_t sched_priority_sleep(struct scheduler* sched, int time)
+{
+    struct pcb* pcb;
+
+    ERR_ON_NULL(sched);
+    SCHED_VALIDATE(sched);
+
+    assert(sched->ctx.running != NULL);
+
+    CRITICAL_SECTION({
+        pcb = sched->ctx.running;
+        pcb->sleep = timer_get_tick() + time;
+        pcb->state = SLEEPING;
+
+        if(!ktimer_pending(pcb_get_timer(pcb))){
+            ktimer_init(pcb_get_timer(pcb), &__sched_sleep_expired, pcb);
+        }
+        ktimer_add(pcb_get_timer(pcb), time > 0 ? time : 0);
+    });
+
+    (void)sched->ops->schedule(sched);
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Boosts the given pcb so it is picked before any runqueue.
+ * Waiting PCBs are woken up and moved to the priority queue.
+ * @param sched  The scheduler to prioritize on
+ * @param pcb  The pcb to prioritize
+ * @return int  0 on success, error code on failure
+ */
+static error_t sched_priority_prioritize(struct scheduler* sched, struct pcb* pcb)
+{
+    ERR_ON_NULL(sched);
+    ERR_ON_NULL(pcb);
+    SCHED_VALIDATE(sched);
+
+    /* The running pcb will be queued when it is switched out. */
+    if(pcb == sched->ctx.running){
+        return ERROR_OK;
+    }
+
+    CRITICAL_SECTION({
+        if(__sched_owns_queue(sched, pcb->queue)){
+            __sched_unlink(sched, pcb);
+
+            if(pcb->state == BLOCKED || pcb->state == SLEEPING){
+                pcb->state = RUNNING;
+            }
+            sched->priority->ops->push(sched->priority, pcb);
+        }
+    });
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Adds the given pcb to the runqueue of its priority
+ * 
+ * @param sched  The scheduler to add to
+ * @param pcb The pcb to add
+ * @return int 0 on success, error code on failure
+ */
+static error_t sched_priority_add(struct scheduler* sched, struct pcb* pcb)
+{
+    ERR_ON_NULL(pcb);
+    SCHED_VALIDATE(sched);
+
+    CRITICAL_SECTION({
+        __sched_enqueue(sched, pcb);
+    });
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Blocks the given (consumed) pcb
+ * PCBs not already owned by a wait queue are put on the blocked list,
+ * they are not visited again until woken.
+ * @param sched  The scheduler to block on
+ * @param pcb  The pcb to block
+ * @return int  0 on success, error code on failure
+ */
+static error_t sched_priority_block(struct scheduler* sched, struct pcb* pcb)
+{
+    ERR_ON_NULL(sched);
+    ERR_ON_NULL(pcb);
+    SCHED_VALIDATE(sched);
+
+    /* At this point current running should have been consumed */
+    assert(sched->ctx.running == NULL);
+
+    CRITICAL_SECTION({
+        pcb->state = BLOCKED;
+        pcb->blocked_count++;
+        if(pcb->queue == NULL){
+            sched->blocked->ops->push(sched->blocked, pcb);
+        }
+
+        pcb_save_context(pcb);
+
+        assert(sched_priority_switch(sched) == ERROR_OK);
+
+        pcb_restore_context(sched->ctx.running);
+    });
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Exits the current running pcb
+ * The pcb is marked as ZOMBIE and handed to the worker for cleanup when switched out.
+ * @param sched The scheduler to exit on
+ * @return int 0 on success, error code on failure
+ */
+static error_t sched_priority_exit(struct scheduler* sched)
+{
+    ERR_ON_NULL(sched);
+    SCHED_VALIDATE(sched);
+
+    sched->exits++;  
+
+    sched->ctx.running->state = ZOMBIE;
+    dbgprintf("Process %s exited\n", sched->ctx.running->name);
+    
+    CRITICAL_SECTION({
+
+        pcb_save_context(sched->ctx.running);
+
+        PANIC_ON_ERR(sched_priority_switch(sched));
+
+        pcb_restore_context(sched->ctx.running);
+    });
+
+    return ERROR_OK;
+}
+
+/**
+ * @brief Wakes up a blocked or sleeping pcb
+ * Moves the pcb from the wait structure back onto its runqueue in constant time.
+ * A pcb that marked itself as blocked but has not yet been switched out is simply kept running.
+ * The sleep timer of a pcb woken up early is cancelled.
+ * @param sched  The scheduler to wake on
+ * @param pcb  The pcb to wake
+ * @return int 0 on success, error code on failure
+ */
+static error_t sched_priority_wake(struct scheduler* sched, struct pcb* pcb)
+{
+    ERR_ON_NULL(pcb);
+    SCHED_VALIDATE(sched);
+
+    CRITICAL_SECTION({
+        ktimer_del(pcb_get_timer(pcb));
+
+        if(pcb->queue != NULL && (pcb->queue == sched->blocked || pcb->queue == sched->sleeping)){
+            pcb->queue->ops->remove(pcb->queue, pcb);
+
+            /* Killed PCBs keep their state so they are cleaned up. */
+            if(pcb->state != ZOMBIE){
+                pcb->state = RUNNING;
+            }
+            __sched_enqueue(sched, pcb);
+
+        } else if(pcb->queue == NULL && (pcb->state == BLOCKED || pcb->state == SLEEPING)){
+            pcb->state = RUNNING;
+        }
+    });
+
+    return ERROR_OK;
+}
+
 struct scheduler* get_scheduler()
 {
     return &sched_default_instance;
@@ -386,6 +851,8 @@ void block()
 
 void unblock(int pid)
 {
-    //pcb_set_running(pid);
+    if(pid < 0 || pid >= MAX_NUM_OF_PCBS) return;
+
+    get_scheduler()->ops->wake(get_scheduler(), pcb_get_by_pid(pid));
 }
 
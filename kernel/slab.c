@@ -0,0 +1,191 @@
+/**
+ * @file slab.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Slab caches for frequently allocated kernel objects.
+ * @version 0.1
+ * @date 2024-02-12
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+#include <kconfig.h>
+#include <memory.h>
+#include <serial.h>
+#include <kutils.h>
+#include <libc.h>
+
+#ifndef KDEBUG_MEMORY
+#undef dbgprintf
+#define dbgprintf(...)
+#endif
+
+/* Slabs are allocated from kalloc, sized so the kalloc metadata fits in the last block. */
+#define KMEM_SLAB_SIZE (8*1024 - sizeof(int))
+
+static struct kmem_cache __kmem_caches[KMEM_CACHE_MAX];
+static int __kmem_cache_count = 0;
+
+/**
+ * @brief Allocates a new slab and carves it into free objects.
+ * Slabs are never given back to kalloc, objects are reused through the free list.
+ * kalloc() can yield while waiting for its lock, so this is never called from interrupt context.
+ * @return int 0 on success, error code on failure
+ */
+static int __kmem_cache_grow(struct kmem_cache* cache)
+{
+	byte_t* slab = kalloc(cache->per_slab * cache->size);
+	ERR_ON_NULL(slab);
+
+	CRITICAL_SECTION({
+		for (int i = cache->per_slab-1; i >= 0; i--){
+			void* obj = slab + i*cache->size;
+			*(void**)obj = cache->free;
+			cache->free = obj;
+		}
+		cache->stats.slabs++;
+	});
+
+	dbgprintf("[SLAB] %s grew to %d slabs\n", cache->name, cache->stats.slabs);
+
+	return ERROR_OK;
+}
+
+/* Pops the first free object, NULL if the cache is empty. Counted as a hit or miss if count is set. */
+static void* __kmem_cache_pop(struct kmem_cache* cache, bool_t count)
+{
+	void* obj = NULL;
+
+	CRITICAL_SECTION({
+		obj = cache->free;
+		if(obj != NULL){
+			cache->free = *(void**)obj;
+			cache->stats.in_use++;
+		}
+		if(count){
+			if(obj != NULL) cache->stats.hits++;
+			else cache->stats.misses++;
+		}
+	});
+
+	return obj;
+}
+
+/**
+ * @brief Creates a new cache of objects with the given size.
+ * No memory is allocated until the first object is allocated.
+ * @param name name shown in statistics
+ * @param size size of each object
+ * @return struct kmem_cache* NULL on failure
+ */
+struct kmem_cache* kmem_cache_create(char* name, int size)
+{
+	struct kmem_cache* cache = NULL;
+	if(size <= 0) return NULL;
+
+	CRITICAL_SECTION({
+		if(__kmem_cache_count < KMEM_CACHE_MAX){
+			cache = &__kmem_caches[__kmem_cache_count++];
+		}
+	});
+
+	if(cache == NULL){
+		warningf("Out of kmem caches\n");
+		return NULL;
+	}
+
+	memset(cache, 0, sizeof(struct kmem_cache));
+	memcpy(cache->name, name, strlen(name) < KMEM_CACHE_NAME_LENGTH ? strlen(name) : KMEM_CACHE_NAME_LENGTH-1);
+
+	/* Objects have to be large enough to link them into the free list. */
+	cache->size = ALIGN(size < (int)sizeof(void*) ? (int)sizeof(void*) : size, PTR_SIZE);
+	cache->per_slab = KMEM_SLAB_SIZE / cache->size;
+	if(cache->per_slab == 0){
+		cache->per_slab = 1;
+	}
+
+	return cache;
+}
+
+/**
+ * @brief Allocates a object from the cache, growing it when empty.
+ * Growing allocates with kalloc(), so this must not be called from
+ * interrupt context, use kmem_cache_alloc_atomic() there.
+ * @param cache cache to allocate from
+ * @return void* NULL on failure, the object is not zeroed.
+ */
+void* kmem_cache_alloc(struct kmem_cache* cache)
+{
+	ERR_ON_NULL_PTR(cache);
+
+	void* obj = __kmem_cache_pop(cache, true);
+	while(obj == NULL){
+		if(__kmem_cache_grow(cache) != ERROR_OK) return NULL;
+		obj = __kmem_cache_pop(cache, false);
+	}
+
+	return obj;
+}
+
+/**
+ * @brief Allocates a object from the free list only, the cache never grows.
+ * Safe to call from interrupt context. Callers keep enough objects free with
+ * kmem_cache_reserve() from thread context.
+ * @param cache cache to allocate from
+ * @return void* NULL if the cache is empty, the object is not zeroed.
+ */
+void* kmem_cache_alloc_atomic(struct kmem_cache* cache)
+{
+	ERR_ON_NULL_PTR(cache);
+	return __kmem_cache_pop(cache, true);
+}
+
+/**
+ * @brief Grows the cache until at least count objects are free.
+ * Must be called from thread context, see kmem_cache_alloc().
+ * @param cache cache to fill
+ * @param count free objects wanted
+ * @return int 0 on success, error code if kalloc() failed
+ */
+int kmem_cache_reserve(struct kmem_cache* cache, int count)
+{
+	ERR_ON_NULL(cache);
+
+	while(cache->stats.slabs * cache->per_slab - cache->stats.in_use < count){
+		if(__kmem_cache_grow(cache) != ERROR_OK) return -ERROR_ALLOC;
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * @brief Returns the object to its cache.
+ * @param cache cache the object was allocated from
+ * @param obj object to free
+ */
+void kmem_cache_free(struct kmem_cache* cache, void* obj)
+{
+	if(cache == NULL || obj == NULL) return;
+
+	CRITICAL_SECTION({
+		*(void**)obj = cache->free;
+		cache->free = obj;
+		cache->stats.in_use--;
+	});
+}
+
+/**
+ * @brief Copies statistics of all caches into info.
+ * @param info array to fill
+ * @param max number of entries in info
+ * @return int number of entries filled
+ */
+int kmem_cache_get_info(struct kmem_cache_info* info, int max)
+{
+	int i;
+	for (i = 0; i < __kmem_cache_count && i < max; i++){
+		memcpy(info[i].name, __kmem_caches[i].name, KMEM_CACHE_NAME_LENGTH);
+		info[i].size = __kmem_caches[i].size;
+		info[i].stats = __kmem_caches[i].stats;
+	}
+	return i;
+}
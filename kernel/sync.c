@@ -15,6 +15,8 @@
 #include <pcb.h>
 #include <serial.h>
 #include <assert.h>
+#include <memory.h>
+#include <timer.h>
 
 #ifndef KDEBUG_SYNC
 #undef dbgprintf
@@ -29,6 +31,153 @@ void spin_unlock(spinlock_t* lock) {
     __sync_lock_release(lock);
 }
 
+/**
+ * @brief Initializes the given wait queue.
+ * 
+ * @param wq Wait queue to initialize.
+ */
+void wait_queue_init(wait_queue_t* wq)
+{
+    wq->waiters = pcb_new_queue();
+}
+
+/**
+ * @brief Wakes up all waiters and frees the given wait queue.
+ * 
+ * @param wq Wait queue to free.
+ */
+void wait_queue_free(wait_queue_t* wq)
+{
+    if(wq->waiters == NULL) return;
+
+    wake_up_all(wq);
+    kfree(wq->waiters);
+    wq->waiters = NULL;
+}
+
+/**
+ * @brief Timer callback for timed waits, called from the PIT interrupt.
+ * Takes the pcb off the wait queue it is blocked on and makes it runnable.
+ */
+static void __wait_queue_expired(void* arg)
+{
+    struct pcb* pcb = (struct pcb*)arg;
+
+    /* Already woken up, but not yet running again. */
+    if(pcb->state != BLOCKED || pcb->queue == NULL){
+        return;
+    }
+
+    pcb->queue->ops->remove(pcb->queue, pcb);
+    pcb->state = RUNNING;
+    get_scheduler()->ops->add(get_scheduler(), pcb);
+}
+
+/**
+ * @brief Blocks the current pcb on the wait queue until woken up or the timeout expires.
+ * Has to be called with interrupts disabled after checking the wait condition,
+ * use wait_event() or wait_event_timeout(). Other threads run outside of the
+ * critical section while blocked, it is entered again before returning.
+ * @param wq Wait queue to block on.
+ * @param timeout Ticks to wait for or WAIT_QUEUE_FOREVER.
+ * @return int 1 if woken up, 0 if the timeout expired.
+ */
+int wait_queue_block(wait_queue_t* wq, int timeout)
+{
+    struct pcb* current;
+    struct scheduler* sched = get_scheduler();
+
+    ASSERT_CRITICAL();
+    if(timeout != WAIT_QUEUE_FOREVER && timeout <= 0){
+        return 0;
+    }
+
+    current = sched->ops->consume(sched);
+    wq->waiters->ops->push(wq->waiters, current);
+
+    if(timeout != WAIT_QUEUE_FOREVER){
+        ktimer_init(pcb_get_timer(current), &__wait_queue_expired, current);
+        ktimer_add(pcb_get_timer(current), timeout);
+    }
+
+    dbgprintf("Blocking on wait queue 0x%x (%d: %s)\n", wq, current->pid, current->name);
+
+    /**
+     * The critical depth is global, the threads run while this one is blocked
+     * must not inherit it. Keep it on this stack and take it back once woken.
+     */
+    int depth = __cli_cnt;
+    __cli_cnt = 0;
+
+    sched->ops->block(sched, current);
+
+    /* Switching back may have enabled interrupts, the caller still expects them off. */
+    asm ("cli");
+    __cli_cnt = depth;
+
+    if(timeout == WAIT_QUEUE_FOREVER){
+        return 1;
+    }
+
+    /* The timer is still pending if we were woken up before it expired. */
+    return ktimer_del(pcb_get_timer(current));
+}
+
+/**
+ * @brief Moves the given pcb from the wait queue to its runqueue.
+ */
+static inline void __wake_up(struct pcb* pcb)
+{
+    /* Killed PCBs keep their state so they are cleaned up. */
+    if(pcb->state != ZOMBIE){
+        pcb->state = RUNNING;
+    }
+    get_scheduler()->ops->add(get_scheduler(), pcb);
+}
+
+/**
+ * @brief Wakes up the first pcb waiting on the wait queue.
+ * Safe to call from interrupt context.
+ * @param wq Wait queue to wake up.
+ * @return int number of woken up PCBs.
+ */
+int wake_up_one(wait_queue_t* wq)
+{
+    struct pcb* pcb = NULL;
+    if(wq->waiters == NULL) return 0;
+
+    CRITICAL_SECTION({
+        pcb = wq->waiters->ops->pop(wq->waiters);
+        if(pcb != NULL){
+            __wake_up(pcb);
+        }
+    });
+
+    return pcb != NULL;
+}
+
+/**
+ * @brief Wakes up all PCBs waiting on the wait queue.
+ * Safe to call from interrupt context.
+ * @param wq Wait queue to wake up.
+ * @return int number of woken up PCBs.
+ */
+int wake_up_all(wait_queue_t* wq)
+{
+    int woken = 0;
+    struct pcb* pcb;
+    if(wq->waiters == NULL) return 0;
+
+    CRITICAL_SECTION({
+        while((pcb = wq->waiters->ops->pop(wq->waiters)) != NULL){
+            __wake_up(pcb);
+            woken++;
+        }
+    });
+
+    return woken;
+}
+
 /**
  * @brief Initializes the given lock. Most importantly it sets the blocked list.
  * 
@@ -36,7 +185,7 @@ void spin_unlock(spinlock_t* lock) {
  */
 void mutex_init(mutex_t* l)
 {
-    l->blocked = pcb_new_queue();
+    wait_queue_init(&l->blocked);
     l->state = UNLOCKED;
     dbgprintf("Lock 0x%x initiated by %s\n", l, $process->current->name);
 }
@@ -51,35 +200,21 @@ void acquire(mutex_t* l)
 {
     dbgprintf("Locking 0x%x\n", l);
 
-    struct pcb* current;
-
     ENTER_CRITICAL();
-    switch (l->state){
-    case LOCKED:
-        current = get_scheduler()->ops->consume(get_scheduler());
-        l->blocked->ops->push(l->blocked, current);
-
-        dbgprintf("Blocking on lock 0x%x (%d: %s)\n", l, current->pid, current->name);
-
-        get_scheduler()->ops->block(get_scheduler(), current);
-        break;  
-    
-    case UNLOCKED:
-        l->state = LOCKED;
-        break;
-    
-    default:
+    while(l->state == LOCKED){
+        wait_queue_block(&l->blocked, WAIT_QUEUE_FOREVER);
+    }
+
+    if(l->state != UNLOCKED){
         warningf("Invalid lock state: %d\n", l->state);
         assert(0);
-        break;
     }
-
-    assert(l->state == LOCKED);
+    l->state = LOCKED;
     LEAVE_CRITICAL();
 }
 
 /**
- * @brief Unlocks the given lock, if a process is blocked, unblock it.
+ * @brief Unlocks the given lock, if a process is blocked, wake it up.
  * 
  * @param l Lock to unlock.
  */
@@ -91,16 +226,7 @@ void release(mutex_t* l)
     }
 
     ENTER_CRITICAL();
-    struct pcb* blocked = l->blocked->ops->pop(l->blocked);
-    if(blocked != NULL){
-        get_scheduler()->ops->add(get_scheduler(), blocked);
-        blocked->state = RUNNING;
-
-        assert(l->state == LOCKED);
-        LEAVE_CRITICAL();
-        return;
-    }
-    //assert(l->state != UNLOCKED);
     l->state = UNLOCKED;
+    wake_up_one(&l->blocked);
     LEAVE_CRITICAL();
-}
\ No newline at end of file
+}
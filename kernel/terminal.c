@@ -35,7 +35,7 @@ void terminal_set_color(color_t color)
 	$process->current->term->text_color = color;
 }
 
-static void __terminal_syntax(unsigned char c)
+static void __terminal_syntax(struct terminal* term, unsigned char c)
 {
 	/* Set different colors for different syntax elements */
 	switch (c) {
@@ -43,16 +43,16 @@ static void __terminal_syntax(unsigned char c)
 		case '/':
 		case '\\':
 			/* Highlight preprocessor directives */
-			terminal_set_color(COLOR_VGA_MISC);
+			term->text_color = COLOR_VGA_MISC;
 			break;
 		case '"':
 		case ':':
 		case '-':
 			/* Highlight string literals and character literals */
-			terminal_set_color(COLOR_VGA_GREEN);
+			term->text_color = COLOR_VGA_GREEN;
 			break;
 		default:
-			terminal_set_color($process->current->term->org_text_color);
+			term->text_color = term->org_text_color;
 			break;
 	}
 }
@@ -206,6 +206,10 @@ int terminal_destroy(struct terminal* term)
 		return 0;
 	}
 
+	if(term->grid.chars != NULL){
+		kfree(term->grid.chars);
+	}
+
 	kfree(term);
 	return 0;
 }
@@ -483,28 +487,99 @@ static int __terminal_commit_textmode(struct terminal* term)
 	return 0;
 }
 
+/**
+ * @brief Sizes the cell grid to the terminal window and clears both.
+ * Used when the window, its size or the background changed since the last commit.
+ */
+static int __terminal_grid_reset(struct terminal* term)
+{
+	struct terminal_grid* grid = &term->grid;
+	struct window* screen = term->screen;
+
+	/* Text starts at 1, 2 and partially visible cells are drawn clipped */
+	int cols = (screen->inner_width - 1 + 7) / 8;
+	int rows = (screen->inner_height - 2 + 7) / 8;
+
+	if(grid->chars == NULL || grid->cols != cols || grid->rows != rows){
+		if(grid->chars != NULL) kfree(grid->chars);
+
+		grid->chars = kalloc(cols*rows*(sizeof(char) + sizeof(color_t)));
+		if(grid->chars == NULL){
+			grid->cols = 0;
+			grid->rows = 0;
+			return -1;
+		}
+		grid->colors = (color_t*)&grid->chars[cols*rows];
+		grid->cols = cols;
+		grid->rows = rows;
+	}
+
+	memset(grid->chars, ' ', cols*rows);
+	memset(grid->colors, term->bg_color, cols*rows);
+	grid->screen = screen;
+	grid->width = screen->inner_width;
+	grid->height = screen->inner_height;
+	grid->bg = term->bg_color;
+
+	kernel_gfx_draw_rectangle(screen, 0, 0, screen->inner_width, screen->inner_height, term->bg_color);
+
+	return 0;
+}
+
 static int __terminal_commit_graphics(struct terminal* term)
 {
 	if(term == NULL || term->screen == NULL) return -1;
 
-	/* Currently unsed */
-	//struct gfx_theme* theme = kernel_gfx_current_theme();
-	
-	int x = 0, y = 0;
-	kernel_gfx_draw_rectangle(term->screen, 0, 0, term->screen->inner_width, term->screen->inner_height, term->bg_color);
-	for (int i = term->tail; i < term->head; i++){
-		if(term->textbuffer[i] == '\n'){
-			x = 0;
-			y++;
-			continue;
+	struct terminal_grid* grid = &term->grid;
+	struct window* screen = term->screen;
+
+	if(grid->chars == NULL || grid->screen != screen || grid->width != screen->inner_width || grid->height != screen->inner_height || grid->bg != term->bg_color){
+		if(__terminal_grid_reset(term) < 0) return -1;
+	}
+
+	int i = term->tail;
+	for (int y = 0; y < grid->rows; y++){
+		char* chars = &grid->chars[y*grid->cols];
+		color_t* colors = &grid->colors[y*grid->cols];
+		int start = -1;
+		int color = -1;
+
+		/* One pass past the last cell to draw the final run */
+		for (int x = 0; x <= grid->cols; x++){
+			char c = ' ';
+			color_t fg = term->bg_color;
+			if(x < grid->cols && i < term->head && term->textbuffer[i] != '\n'){
+				c = term->textbuffer[i++];
+				__terminal_syntax(term, c);
+				fg = c == ' ' ? term->bg_color : term->text_color;
+			}
+
+			int changed = x < grid->cols && (chars[x] != c || colors[x] != fg);
+
+			/* Changed cells sharing a color are drawn together, blanks fit in any run */
+			if(start >= 0 && (!changed || (c != ' ' && color >= 0 && color != fg))){
+				kernel_gfx_draw_glyphs(screen, 1 + start*8, 2 + y*8, &chars[start], x - start, color >= 0 ? color : term->org_text_color, term->bg_color);
+				start = -1;
+				color = -1;
+			}
+			if(!changed) continue;
+
+			chars[x] = c;
+			colors[x] = fg;
+			if(start < 0) start = x;
+			if(c != ' ') color = fg;
 		}
 
-		__terminal_syntax(term->textbuffer[i]);
-		kernel_gfx_draw_char(term->screen, 1 + x*8, 2+ y*8, term->textbuffer[i], term->text_color);
-		x++;
+		/* Skip what does not fit on the line */
+		while(i < term->head && term->textbuffer[i] != '\n'){
+			__terminal_syntax(term, term->textbuffer[i++]);
+		}
+		if(i < term->head) i++;
 	}
 
-	term->screen->changed = 1;
+	if(!GFX_RECT_EMPTY(&screen->pending)){
+		gfx_window_commit(screen);
+	}
 
 	return 0;
 }
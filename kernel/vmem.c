@@ -14,6 +14,9 @@
 #include <sync.h>
 #include <bitmap.h>
 #include <assert.h>
+#include <vmem_heap.h>
+#include <kutils.h>
+#include <fs/fs.h>
 
 #undef dbgprintf
 #define dbgprintf(...)
@@ -23,6 +26,7 @@ struct virtual_memory_allocator;
 /* allocator prototypes */
 static uint32_t* vmem_alloc(struct virtual_memory_allocator* vmem);
 static void vmem_free(struct virtual_memory_allocator* vmem, void* addr);
+static void vmem_heap_unmap(struct pcb* pcb, uintptr_t addr, int size);
 
 uint32_t* kernel_page_dir = NULL;
 
@@ -51,6 +55,8 @@ struct virtual_memory_allocator {
 	int used_pages;
 	int total_pages;
 	bitmap_t pages;
+	/* Next-fit cursor into pages */
+	int hint;
 
 	uint32_t start;
 	uint32_t end;
@@ -65,6 +71,9 @@ struct virtual_memory_allocator* vmem_default = &__vmem_default;
 static struct virtual_memory_allocator __vmem_manager;
 struct virtual_memory_allocator* vmem_manager = &__vmem_manager;
 
+static struct vmem_image vmem_images[VMEM_IMAGE_MAX];
+static mutex_t vmem_images_lock;
+
 /* HELPER FUNCTIONS */
 static inline uint32_t* vmem_get_page_table(struct pcb* pcb, uint32_t addr)
 {
@@ -86,6 +95,32 @@ static inline void vmem_add_table(uint32_t* directory, uint32_t vaddr, uint32_t*
 	directory[DIRECTORY_INDEX(vaddr)] = (((uint32_t) table) & ~PAGE_MASK) | (access == 0 ? vmem_default_permissions : vmem_user_permissions);
 }
 
+/* Directories and tables start empty, every entry not present. */
+static uint32_t* vmem_alloc_zeroed()
+{
+	uint32_t* page = vmem_default->ops->alloc(vmem_default);
+	if(page != NULL) memset(page, 0, PAGE_SIZE);
+	return page;
+}
+
+/**
+ * @brief Frees every page mapped by table with all of flags set, and then the table.
+ * @return int number of pages freed.
+ */
+static int vmem_free_table(uint32_t* table, uint32_t flags)
+{
+	int freed = 0;
+	for (int i = 0; i < 1024; i++){
+		if((table[i] & flags) != flags) continue;
+
+		vmem_default->ops->free(vmem_default, (void*)(table[i] & ~PAGE_MASK));
+		freed++;
+	}
+	vmem_default->ops->free(vmem_default, table);
+
+	return freed + 1;
+}
+
 /**
  * Allocates a page of virtual memory from the given virtual memory allocator.
  * @param struct virtual_memory_allocator* vmem: pointer to virtual memory allocator
@@ -97,7 +132,7 @@ static uint32_t* vmem_alloc(struct virtual_memory_allocator* vmem)
 	
 	LOCK(vmem, {
 
-		int bit = get_free_bitmap(vmem->pages, vmem->total_pages);
+		int bit = bitmap_get_free_next(vmem->pages, vmem->total_pages, &vmem->hint);
 		assert(bit != -1);
 
 		paddr = (uint32_t*) (vmem->start + (bit * PAGE_SIZE));
@@ -131,106 +166,48 @@ static void vmem_free(struct virtual_memory_allocator* vmem, void* addr)
 	});
 }
 
-static int vmem_page_align_size(int size)
-{
-	int multiple = PAGE_SIZE;
-    int closest;
-    int quotient = size / multiple;
-    int remainder = size % multiple;
-
-    if (remainder > 0) {
-        closest = (quotient + 1) * multiple;
-    } else {
-        closest = quotient * multiple;
-    }
-
-	return closest;
-}
-
-static struct vmem_page_region* vmem_create_page_region(struct pcb* pcb, void* base, int num, int access)
+/**
+ * @brief Marks the heap pages covered by [addr, addr+size) as used.
+ * Every heap page counts the allocations touching it, a physical page
+ * is only allocated when a referenced page is first touched, see vmem_page_fault().
+ */
+static void vmem_heap_map(struct pcb* pcb, uintptr_t addr, int size)
 {
-	struct vmem_page_region* allocation = create(struct vmem_page_region);
-	if(allocation == NULL){
-		return NULL;
-	}
+	uint16_t* refs = pcb->allocations->refs;
 
-	allocation->bits = kalloc(sizeof(int)*num);
-	if(allocation->bits == NULL){
-		kfree(allocation);
-		return NULL;
+	int first = (addr - VMEM_HEAP) / PAGE_SIZE;
+	int last = (addr + size - 1 - VMEM_HEAP) / PAGE_SIZE;
+	for (int i = first; i <= last; i++){
+		refs[i]++;
 	}
-
-	allocation->refs = 0;
-	allocation->size = num*PAGE_SIZE;
-	allocation->used = 0;
-	allocation->basevaddr = base;
-
-	uint32_t* heap_table = vmem_get_page_table(pcb, VMEM_HEAP);
-	for (int i = 0; i < num; i++){
-		/*
-		 * 1. Allocate a page
-		 * 2. Map it to virtual heap
-		 * 3. add it to bits
-		 */
-		uint32_t paddr = (uint32_t)vmem_default->ops->alloc(vmem_default);
-		if(paddr == 0){
-			kfree(allocation->bits);
-			for (int j = 0; j < i; j++){
-				vmem_default->ops->free(vmem_default, (void*) (VMEM_START_ADDRESS + (allocation->bits[j] * PAGE_SIZE)));
-			}
-			return NULL;
-		}
-		int bit = (paddr - VMEM_START_ADDRESS)/PAGE_SIZE;
-		allocation->bits[i] = bit;
-		//dbgprintf("Allocating %d continious blocks on heap 0x%x.\n", num, heap_table);
-		vmem_map(heap_table, (uint32_t)allocation->basevaddr+(i*PAGE_SIZE), paddr, access);
-	}
-
-	return allocation;
 }
 
-static int vmem_page_region_alloc(struct vmem_page_region* pages, int size)
+/**
+ * @brief Drops the references of [addr, addr+size) and returns
+ * pages no longer used by any allocation to vmem_default.
+ */
+static void vmem_heap_unmap(struct pcb* pcb, uintptr_t addr, int size)
 {
-	ERR_ON_NULL(pages);
+	if(size <= 0) return;
 
-	pages->used += size;
-	pages->refs++;
+	uint16_t* refs = pcb->allocations->refs;
+	uint32_t* heap_table = vmem_get_page_table(pcb, VMEM_HEAP);
 
-	return 0;
-}
+	int first = (addr - VMEM_HEAP) / PAGE_SIZE;
+	int last = (addr + size - 1 - VMEM_HEAP) / PAGE_SIZE;
+	for (int i = first; i <= last; i++){
+		if(--refs[i] > 0) continue;
 
-static int vmem_free_page_region(struct pcb* pcb, struct vmem_page_region* region, int size)
-{
-	ERR_ON_NULL(region);
-	if(region->refs > 1){
-		region->refs--;
-		region->used -= size;
-		return 0;
-	}
+		uint32_t vaddr = VMEM_HEAP + (i * PAGE_SIZE);
+		if(!(heap_table[TABLE_INDEX(vaddr)] & PRESENT)) continue;
 
-	dbgprintf("Freeing %d pages. 0x%x\n", region->size/PAGE_SIZE, region->basevaddr);
+		uint32_t paddr = heap_table[TABLE_INDEX(vaddr)] & ~PAGE_MASK;
+		vmem_unmap(heap_table, vaddr);
+		tlb_flush_addr(vaddr);
 
-	int num_pages = region->size / PAGE_SIZE;
-	dbgprintf("Freeing %d pages\n", num_pages);
-	for (int i = 0; i < num_pages; i++){
-		if(region->bits[i] == 0) continue;
-		
-		/* Free the physical page */
-		void* paddr = (void*) (vmem_default->start + (region->bits[i] * PAGE_SIZE));
 		vmem_default->ops->free(vmem_default, (void*) paddr);
-
-		/* Unmap the virtual page */
-		void* vaddr = (void*) (region->basevaddr + (i * PAGE_SIZE));
-		dbgprintf("Unmapping 0x%x\n", vaddr);
-		uint32_t* heap_table = vmem_get_page_table(pcb, (uint32_t)vaddr);
-		dbgprintf("Table: 0x%x\n", heap_table);
-
-		vmem_unmap(heap_table, (uint32_t)vaddr);
+		pcb->used_memory -= PAGE_SIZE;
 	}
-	kfree(region->bits);
-	kfree(region);
-
-	return 0;
 }
 
 int vmem_free_allocations(struct pcb* pcb)
@@ -238,29 +215,20 @@ int vmem_free_allocations(struct pcb* pcb)
 	uint32_t heap_table = (uint32_t)pcb->page_dir[DIRECTORY_INDEX(VMEM_HEAP)] & ~PAGE_MASK;
 	assert(heap_table != 0);
 
-	if(pcb->allocations->head == NULL){
-		kfree(pcb->allocations);
-		return 0;
-	}
 	ENTER_CRITICAL();
-	
-	/* Free all malloc allocation */
-	struct allocation* iter = pcb->allocations->head;
-	/**
-	 * @brief Very weird bug: a corrupt allocation at 0x1b0004
-	 * causes a page fault when trying to free it.
-	 * This somehow fixes it, but I have no idea why.
-	 */
-	while(iter != NULL && (int)iter != 0x1b0004){
-		struct allocation* old = iter;
-		iter = iter->next;
 
-		dbgprintf("Freeing %d bytes of data from 0x%x (0x%x)\n", old->size, old->address, old);
-		dbgprintf("head: 0x%x\n", pcb->allocations->head);
-		vmem_free_page_region(pcb, old->region, old->size);
-	
-		kfree(old);
+	/* Free all touched pages still referenced by malloc allocations */
+	if(pcb->allocations->refs != NULL){
+		for (int i = 0; i < VMEM_HEAP_PAGES; i++){
+			uint32_t* entry = &((uint32_t*)heap_table)[i];
+			if(pcb->allocations->refs[i] == 0 || !(*entry & PRESENT)) continue;
+
+			vmem_default->ops->free(vmem_default, (void*)(*entry & ~PAGE_MASK));
+			*entry = 0;
+		}
+		kfree(pcb->allocations->refs);
 	}
+	vmem_heap_destroy(&pcb->allocations->heap);
 
 	vmem_default->ops->free(vmem_default, (void*) heap_table);
 	
@@ -273,274 +241,451 @@ int vmem_free_allocations(struct pcb* pcb)
 }
 
 /**
- * @brief Allocates a chunk of virtual memory for the specified process control block (PCB).
- * The vmem_continious_allocation_map() function is responsible for allocating a contiguous block of virtual memory for the given PCB.
- * @param pcb A pointer to the process control block (PCB) for which memory needs to be allocated.
- * @param allocation A pointer to the allocation structure that contains the allocation information.
- * @param address A pointer to the start of the allocated memory block.
- * @param num The number of pages to be allocated.
- * @param access The access permissions for the allocated pages.
- * @return int 0 if the allocation succeeds, or -1 if the allocation fails.
+ * @brief Frees a virtual heap allocation
+ * 
+ * @param pcb Process to free from.
+ * @param ptr Pointer to the address to free.
  */
-int __deprecated vmem_continious_allocation_map(struct pcb* pcb, struct allocation* allocation, uint32_t* address, int num, int access)
+void vmem_stack_free(struct pcb* pcb, void* ptr)
 {
+	int size = vmem_heap_free(&pcb->allocations->heap, (uintptr_t) ptr);
+	if(size < 0){
+		warningf("Trying to free unknown allocation 0x%x.\n", ptr);
+		return;
+	}
 
-	return -1;
+	vmem_heap_unmap(pcb, (uintptr_t) ptr, size);
+	dbgprintf("Free %d bytes of data from 0x%x\n", size, ptr);
 }
 
 /**
- * @brief Frees a chunk of virtual memory for the specified process control block (PCB).
- * 
- * @param allocation 
+ * @brief Allocates a chunk of virtual memory for the specified process control block (PCB).
+ * The address is picked first fit from the process heap extents (see vmem_heap.c),
+ * the pages it covers are mapped on demand and shared with neighbouring allocations.
+ * Callers serialize on pcb->allocations->spinlock.
+ * @param pcb A pointer to the process control block (PCB) for which memory needs to be allocated.
+ * @param _size The size of memory to be allocated in bytes.
+ * @return A pointer to the start of the allocated memory block, or NULL if the allocation fails.
  */
-void __deprecated vmem_free_allocation(struct allocation* allocation)
+void* vmem_stack_alloc(struct pcb* pcb, int _size)
 {
+	struct virtual_allocations* allocations = pcb->allocations;
+	int size = ALIGN(_size, PTR_SIZE);
+
+	/* Heaps are set up on the first allocation. */
+	if(allocations->refs == NULL){
+		allocations->refs = kcalloc(VMEM_HEAP_PAGES * sizeof(uint16_t));
+		if(allocations->refs == NULL){
+			warningf("Out memory\n");
+			return NULL;
+		}
+		vmem_heap_init(&allocations->heap, VMEM_HEAP, VMEM_HEAP_SIZE);
+	}
 
+	uintptr_t addr = vmem_heap_alloc(&allocations->heap, size);
+	if(addr == 0){
+		warningf("Out of heap memory\n");
+		return NULL;
+	}
+
+	vmem_heap_map(pcb, addr, size);
+
+	dbgprintf("Allocated %d bytes of data to 0x%x\n", _size, addr);
+	return (void*) addr;
 }
 
+/* Fills in a newly claimed image, its pages are read on first touch. */
+static void vmem_image_init(struct vmem_image* image, const char* path, int length, int fd, int size, bool_t shared)
+{
+	memcpy(image->path, path, length);
+	image->fd = fd;
+	image->size = size;
+	image->refs = 1;
+	image->shared = shared;
+	image->frames = vmem_alloc_zeroed();
+	mutex_init(&image->lock);
+}
 
 /**
- * @brief Frees a virtual stack allocation
- * 
- * @param pcb Process to free from.
- * @param ptr Pointer to the address to free.
+ * @brief Opens the program at path, sharing the image with running instances of it.
+ * An image is only shared if it was opened from the same file and that file has not
+ * been written since, otherwise the binary gets a fresh image. When every slot of the
+ * table is in use the program gets a private image instead.
+ * @return struct vmem_image* referenced image, NULL on error.
  */
-void vmem_stack_free(struct pcb* pcb, void* ptr)
+struct vmem_image* vmem_image_get(const char* path)
 {
-	/* Check if allocation is first in list */
+	struct vmem_image* image = NULL;
 
-	if(pcb->allocations->head == NULL){
-		warningf("Trying to free allocation from empty list.\n");
-		return;
+	int length = strlen(path) + 1;
+	if(length > VMEM_IMAGE_PATH_LENGTH){
+		return NULL;
 	}
 
-	if(ptr == pcb->allocations->head->address){
-		struct allocation* old = pcb->allocations->head;
-		pcb->allocations->head = pcb->allocations->head->next;
-		pcb->used_memory -= old->size;
+	int fd = fs_open(path, FS_FILE_FLAG_READ);
+	if(fd < 0){
+		return NULL;
+	}
 
-		vmem_free_page_region(pcb, old->region, old->size);
-		
-		dbgprintf("[1] Free %d bytes of data from 0x%x\n", old->size, old->address);
-		return;
+	int size = fs_size(fd);
+	if(size <= 0 || size > VMEM_DATA_SIZE){
+		dbgprintf("[IMAGE] Invalid program size %d for %s\n", size, path);
+		fs_close(fd);
+		return NULL;
+	}
+
+	acquire(&vmem_images_lock);
+	for (int i = 0; i < VMEM_IMAGE_MAX; i++){
+		struct vmem_image* entry = &vmem_images[i];
+		if(entry->refs > 0 && entry->size == size && memcmp(entry->path, path, length) == 0
+			&& fs_same_file(entry->fd, fd) && fs_changed(entry->fd) == 0){
+			entry->refs++;
+			release(&vmem_images_lock);
+
+			fs_close(fd);
+			dbgprintf("[IMAGE] Sharing %s (%d users)\n", path, entry->refs);
+			return entry;
+		}
+		if(entry->refs == 0 && image == NULL) image = entry;
 	}
 
-	/* Iterates over all allocations to find ptr */
-	struct allocation* iter = pcb->allocations->head;
-	while(iter->next != NULL){
-		if(iter->next->address == ptr){
-			
-			struct allocation* save = iter->next;
-			iter->next = iter->next->next;
-			pcb->used_memory -= save->size;
+	if(image == NULL){
+		release(&vmem_images_lock);
 
-			vmem_free_page_region(pcb, save->region, save->size);
-			
-			dbgprintf("[2] Free %d bytes of data from 0x%x\n", save->size, save->address);
-			return;
+		/* The program still runs, it just does not share its pages */
+		image = kalloc(sizeof(struct vmem_image));
+		if(image == NULL){
+			fs_close(fd);
+			return NULL;
 		}
-		iter = iter->next;
+		dbgprintf("[IMAGE] No free program images, %s gets a private image\n", path);
+
+		vmem_image_init(image, path, length, fd, size, false);
+		return image;
 	}
+
+	vmem_image_init(image, path, length, fd, size, true);
+	release(&vmem_images_lock);
+
+	return image;
 }
 
 /**
- * 
- * @brief Allocates a chunk of virtual memory for the specified process control block (PCB).
- * The vmem_stack_alloc() function is responsible for allocating a contiguous block of virtual memory for the given PCB.
- * It uses a page-aligned size and ensures that the allocation aligns with page boundaries for efficient memory management.
- * If the PCB's allocations list is empty, the function allocates memory from the beginning of the virtual memory heap.
- * Otherwise, it traverses the list of existing allocations to find a suitable gap for the new allocation. If a suitable space is found,
- * the function inserts the new allocation into the list and updates the memory map accordingly.
- * In case no suitable gap is found in the existing allocations, the function adds the new allocation at the end, extending the virtual memory heap.
- * It then updates the memory map to include the newly allocated pages.
- * @param pcb A pointer to the process control block (PCB) for which memory needs to be allocated.
- * @param _size The size of memory to be allocated in bytes.
- * @return A pointer to the start of the allocated memory block, or NULL if the allocation fails.
- * @note The function uses page-aligned sizes and ensures efficient memory utilization.
- * @note The function assumes that the vmem_continious_allocation_map() function is defined and handles memory mapping.
- * @note The function uses kalloc() to allocate memory for internal data structures (e.g., struct allocation and bits array).
- * TODO: Needs to be synchronized among threads.
+ * @brief Drops a reference to image, the last user frees its frames and closes the file.
  */
-void* vmem_stack_alloc(struct pcb* pcb, int _size)
+void vmem_image_put(struct vmem_image* image)
 {
-	int size = vmem_page_align_size(_size);
-	int num_pages = size / PAGE_SIZE;
+	if(!image->shared){
+		vmem_free_table(image->frames, PRESENT);
+		fs_close(image->fd);
+		kfree(image);
+		return;
+	}
 
-	struct allocation* allocation = create(struct allocation);
-	if(allocation == NULL){
-		warningf("Out memory\n");
-		return NULL;
+	acquire(&vmem_images_lock);
+	if(--image->refs > 0){
+		release(&vmem_images_lock);
+		return;
 	}
-	
-	allocation->size = _size;
-	allocation->used = _size;
 
-	/**
-	 * @brief Part1: Default case
-	 * Create a physical page allocation and attach it to the virtual allocation.
-	 * Setup the allocation size and adress and add it to the pcb.
-	 */
-	if(pcb->allocations->head == NULL){
+	vmem_free_table(image->frames, PRESENT);
+	fs_close(image->fd);
+	image->frames = NULL;
+	image->path[0] = 0;
+	release(&vmem_images_lock);
+}
 
-		struct vmem_page_region* physical = vmem_create_page_region(pcb, (void*)VMEM_HEAP, num_pages, USER);
-		if(physical == NULL){
-			kfree(allocation);
-			warningf("Out of heap memory\n");
-			return NULL;
+/**
+ * @brief Returns the shared frame holding the image page at vaddr, reading it on first use.
+ * The part of the page past the end of the image is cleared.
+ * @return uint32_t physical address of the frame, 0 on error.
+ */
+static uint32_t vmem_image_frame(struct vmem_image* image, uintptr_t vaddr)
+{
+	int offset = vaddr - VMEM_DATA;
+	int size = image->size - offset < PAGE_SIZE ? image->size - offset : PAGE_SIZE;
+	uint32_t* frame = &image->frames[offset / PAGE_SIZE];
+
+	/* The lock also covers the file offset shared by all users of the image */
+	acquire(&image->lock);
+	if(*frame & PRESENT){
+		release(&image->lock);
+		return *frame & ~PAGE_MASK;
+	}
+
+	byte_t* page = (byte_t*) vmem_default->ops->alloc(vmem_default);
+	int ret = fs_seek(image->fd, offset, FS_SEEK_START);
+	if(ret >= 0){
+		ret = fs_read(image->fd, page, size);
+	}
+
+	if(ret < size){
+		release(&image->lock);
+		warningf("Failed to read page 0x%x of %s\n", vaddr, image->path);
+		vmem_default->ops->free(vmem_default, page);
+		return 0;
+	}
+
+	if(size < PAGE_SIZE){
+		memset(page + size, 0, PAGE_SIZE - size);
+	}
+
+	*frame = (uint32_t) page | PRESENT;
+	release(&image->lock);
+
+	return (uint32_t) page;
+}
+
+/**
+ * @brief Gives the process a private, writable copy of the shared image frame at vaddr.
+ */
+static error_t vmem_image_copy(struct pcb* pcb, uint32_t* table, uintptr_t vaddr, uint32_t frame)
+{
+	uint32_t* page = vmem_default->ops->alloc(vmem_default);
+	if(page == NULL){
+		return -ERROR_OUT_OF_MEMORY;
+	}
+
+	memcpy(page, (void*) frame, PAGE_SIZE);
+	vmem_map(table, vaddr, (uint32_t) page, USER);
+	tlb_flush_addr(vaddr);
+	pcb->used_memory += PAGE_SIZE;
+
+	dbgprintf("[FAULT] Copied 0x%x on write for %s\n", vaddr, pcb->name);
+
+	return ERROR_OK;
+}
+
+/**
+ * @brief Resolves a page fault by mapping the page on first touch.
+ * Image pages are mapped read only to frames shared by every process running
+ * the same binary, and copied to a private page on the first write.
+ * Stack pages and heap pages referenced by an allocation start out zeroed.
+ * Other faults on mapped pages and on addresses outside of these regions are not resolved.
+ * @param pcb process that faulted
+ * @param addr faulting address
+ * @param err page fault error code
+ * @return error_t ERROR_OK if the page is mapped and the access can be retried.
+ */
+error_t vmem_page_fault(struct pcb* pcb, uintptr_t addr, uint32_t err)
+{
+	struct virtual_allocations* allocations = pcb->allocations;
+	if(allocations == NULL){
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	addr &= ~PAGE_MASK;
+	if(!(pcb->page_dir[DIRECTORY_INDEX(addr)] & PRESENT)){
+		/* Threads created before the shared table pick it up on first use */
+		if(addr >= VMEM_SHARED && addr < VMEM_SHARED + VMEM_SHARED_SIZE && allocations->shared_table != NULL){
+			vmem_add_table(pcb->page_dir, VMEM_SHARED, allocations->shared_table, USER);
+			return ERROR_OK;
 		}
-		allocation->region = physical;
-		
-		vmem_page_region_alloc(physical, _size);
+		return -ERROR_ACCESS_DENIED;
+	}
 
-		allocation->address = (uint32_t*) VMEM_HEAP;
-		allocation->size = _size;
-		allocation->next = NULL;
+	struct vmem_image* image = allocations->image;
+	bool_t in_image = image != NULL && addr >= VMEM_DATA && addr < VMEM_DATA + (uint32_t) image->size;
 
-		pcb->allocations->head = allocation;
-		pcb->used_memory += size;
+	uint32_t* table = vmem_get_page_table(pcb, addr);
+	uint32_t entry = table[TABLE_INDEX(addr)];
 
-		dbgprintf("[1] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-		return (void*) allocation->address;
+	/* Only writes to shared image pages are resolved on mapped pages. */
+	if(err & PRESENT){
+		if(!(err & READ_WRITE) || !in_image || !(entry & PRESENT)){
+			return -ERROR_ACCESS_DENIED;
+		}
+		if(entry & READ_WRITE){
+			return ERROR_OK;
+		}
+		return vmem_image_copy(pcb, table, addr, entry & ~PAGE_MASK);
 	}
 
-	/**
-	 * @brief Part 1.5: If first allocation is freed, allocate from start of heap.
-	 */
-	if(pcb->allocations->head->address > (uint32_t*) VMEM_HEAP && pcb->allocations->head->address <= (uint32_t*) VMEM_HEAP+size){
+	if(entry & PRESENT){
+		return ERROR_OK;
+	}
 
-		/* TODO: Clean this up, redudent code */
-		struct vmem_page_region* physical = vmem_create_page_region(pcb, (void*)VMEM_HEAP, num_pages, USER);
-		if(physical == NULL){
-			kfree(allocation);
-			warningf("Out of heap memory\n");
-			return NULL;
+	if(in_image){
+		uint32_t frame = vmem_image_frame(image, addr);
+		if(frame == 0){
+			return -ERROR_FILE_NOT_FOUND;
+		}
+
+		/* Reading the image can block, another thread may have mapped the page meanwhile. */
+		if(table[TABLE_INDEX(addr)] & PRESENT){
+			return ERROR_OK;
+		}
+
+		/* Writing to a page never read skips mapping the shared frame */
+		if(err & READ_WRITE){
+			return vmem_image_copy(pcb, table, addr, frame);
 		}
-		allocation->region = physical;
-		
-		vmem_page_region_alloc(physical, _size);
 
-		allocation->address = (uint32_t*) VMEM_HEAP;
-		allocation->size = _size;
-		allocation->next = NULL;
+		table[TABLE_INDEX(addr)] = frame | USER | PRESENT;
+		return ERROR_OK;
+	}
 
-		dbgprintf("[1.5] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-		return (void*) allocation->address;
+	bool_t stack = addr >= VMEM_STACK_BOTTOM && addr <= VMEM_STACK;
+	bool_t heap = addr >= VMEM_HEAP && addr < VMEM_HEAP + VMEM_HEAP_SIZE
+		&& allocations->refs != NULL && allocations->refs[(addr - VMEM_HEAP) / PAGE_SIZE] > 0;
+	if(!stack && !heap){
+		return -ERROR_ACCESS_DENIED;
 	}
 
-	/**
-	 * @brief Part 2: Find spot for allocation.
-	 * Iterate over all allocations and find a spot where the next allocation is far enough away.
-	 * Two options, first option is finding a free allocation inside a already allocated phsyical page region.
-	 * Then we can simply add new allocation to the exisitng one physical one.
-	 * Second option is we need to allocate a new physical page allocation, between two existing ones.
-	 */
-	struct allocation* iter = pcb->allocations->head;
-	while(iter->next != NULL){
-
-		/**
-		 * @brief This case checks if there is space inside a single physical allocation (between virtual allocations).
-		 * Also, means the physical area is already mapped so we can attach to the existing one.
-		 */
-		if((uint32_t)(iter->next->address) - ((uint32_t)(iter->address)+iter->size) >= (uint32_t)_size && iter->region == iter->next->region){
-			
-			/* Found spot for allocation */
-			allocation->address = (uint32_t*)((uint32_t)(iter->address)+iter->size);
-			allocation->region = iter->region;
-
-			struct allocation* next = iter->next;
-			iter->next = allocation;
-			allocation->next = next;
-
-			vmem_page_region_alloc(iter->region, _size);
-			dbgprintf("[2] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-			return (void*) allocation->address;
+	uint32_t* page = vmem_alloc_zeroed();
+	if(page == NULL){
+		return -ERROR_OUT_OF_MEMORY;
+	}
+
+	vmem_map(table, addr, (uint32_t) page, USER);
+	pcb->used_memory += PAGE_SIZE;
+
+	dbgprintf("[FAULT] Mapped 0x%x for %s\n", addr, pcb->name);
+
+	return ERROR_OK;
+}
+
+/**
+ * @brief Copies into the address space of pcb, which does not have to be the running process.
+ * Pages that were never touched are mapped first, shared image pages are copied.
+ */
+error_t vmem_copy_to_process(struct pcb* pcb, uintptr_t vaddr, const void* src, int size)
+{
+	const byte_t* from = src;
+
+	while(size > 0){
+		error_t err = vmem_page_fault(pcb, vaddr, READ_WRITE);
+		if(err < 0){
+			return err;
 		}
-	
-		/**
-		 * @brief This case checks if there is space at the end of a phsyical region.
-		 * Only is possible if the next allocation is in a different physical region.
-		 * @note This is mostly for reusing the virtual heap address space.
-		 */
-		int space_at_end = ((uint32_t)(iter->region->basevaddr)+iter->region->size) - ((uint32_t)(iter->address)+iter->size);
-		if(iter->region != iter->next->region && space_at_end >= _size)
-		{
-			/* Found spot for allocation */
-			allocation->address = (uint32_t*)((uint32_t)(iter->address)+iter->size);
-			allocation->region = iter->region;
-
-			struct allocation* next = iter->next;
-			iter->next = allocation;
-			allocation->next = next;
-
-			vmem_page_region_alloc(iter->region, _size);
-
-			dbgprintf("[2.5] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-			return (void*) allocation->address;
 
+		uint32_t* table = vmem_get_page_table(pcb, vaddr);
+		if(!(table[TABLE_INDEX(vaddr)] & READ_WRITE)){
+			err = vmem_page_fault(pcb, vaddr, PRESENT | READ_WRITE);
+			if(err < 0){
+				return err;
+			}
 		}
+		byte_t* page = (byte_t*)(table[TABLE_INDEX(vaddr)] & ~PAGE_MASK);
 
-		iter = iter->next;
+		int offset = vaddr & PAGE_MASK;
+		int len = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+		memcpy(page + offset, from, len);
+
+		from += len;
+		vaddr += len;
+		size -= len;
 	}
 
-	/**
-	 * @brief Part 2.5: Check if there is space at the end of the last allocation.
-	 * This avoids creating new physical page allocations.
-	 */
-	int space_at_end = ((uint32_t)(iter->region->basevaddr)+iter->region->size) - ((uint32_t)(iter->address)+iter->size);
-	if(space_at_end >= _size)
-	{
-		/* Found spot for allocation */
-		allocation->address = (uint32_t*)((uint32_t)(iter->address)+iter->size);
-		allocation->region = iter->region;
+	return ERROR_OK;
+}
 
-		struct allocation* next = iter->next;
-		iter->next = allocation;
-		allocation->next = next;
+/**
+ * @brief Translates a user address of pcb to its physical address, mapping the page if needed.
+ * The page is resolved as written to, so a shared image page is copied first and
+ * the address stays the same after the process writes to it.
+ */
+error_t vmem_user_to_physical(struct pcb* pcb, uintptr_t vaddr, uintptr_t* paddr)
+{
+	error_t err = vmem_page_fault(pcb, vaddr, READ_WRITE);
+	if(err < 0){
+		return err;
+	}
 
-		vmem_page_region_alloc(iter->region, _size);
+	uint32_t* table = vmem_get_page_table(pcb, vaddr);
+	if((table[TABLE_INDEX(vaddr)] & PRESENT) && !(table[TABLE_INDEX(vaddr)] & READ_WRITE)){
+		err = vmem_page_fault(pcb, vaddr, PRESENT | READ_WRITE);
+		if(err < 0){
+			return err;
+		}
+	}
 
-		dbgprintf("[3] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-		return (void*) allocation->address;
+	uint32_t directory = pcb->page_dir[DIRECTORY_INDEX(vaddr)];
+	uint32_t entry = table[TABLE_INDEX(vaddr)];
+	if(!(directory & USER) || !(entry & USER) || !(entry & PRESENT)){
+		return -ERROR_ACCESS_DENIED;
 	}
 
-	/**
-	 * @brief Part 3: No spot found, allocate at end of heap.
-	 * At this point we have not found a spot inbetween existing allocations, so append at the end.
-	 * This means we need to allocate a new physical page allocation.
-	 * @note "iter" will point to the last element in the allocation list.
-	 */
-	struct vmem_page_region* physical = vmem_create_page_region(pcb, (void*)((byte_t*)iter->region->basevaddr + iter->region->size), num_pages, USER);
-	if(physical == NULL){
-		kfree(allocation);
-		warningf("Out of heap memory\n");
+	*paddr = (entry & ~PAGE_MASK) | (vaddr & PAGE_MASK);
+	return ERROR_OK;
+}
+
+/**
+ * @brief Allocates zeroed frames to be shared between processes.
+ * @return uint32_t* array of the physical frames, NULL on error.
+ */
+uint32_t* vmem_shared_alloc(int pages)
+{
+	if(pages <= 0 || pages > VMEM_SHARED_PAGES){
+		return NULL;
+	}
+
+	uint32_t* frames = kalloc(pages * sizeof(uint32_t));
+	if(frames == NULL){
 		return NULL;
 	}
-	allocation->region = physical;
 
-	allocation->address = (uint32_t*)((uint32_t)(iter->region->basevaddr)+iter->region->size);
-	vmem_page_region_alloc(allocation->region, _size);
-	allocation->next = NULL;
+	for (int i = 0; i < pages; i++){
+		frames[i] = (uint32_t) vmem_alloc_zeroed();
+		if(frames[i] == 0){
+			vmem_shared_free(frames, i);
+			return NULL;
+		}
+	}
+
+	return frames;
+}
 
-	pcb->used_memory += size;
-	iter->next = allocation;
-	dbgprintf("[3.5] Allocated %d bytes of data to 0x%x\n", _size, allocation->address);
-	return (void*) allocation->address;
+void vmem_shared_free(uint32_t* frames, int pages)
+{
+	for (int i = 0; i < pages; i++){
+		vmem_default->ops->free(vmem_default, (void*) frames[i]);
+	}
+	kfree(frames);
 }
 
-void vmem_dump_heap(struct allocation* allocation)
+/**
+ * @brief Maps frames at the first free range of the shared region of pcb.
+ * The frames stay owned by the caller, the process never frees them.
+ * @return uintptr_t address of the mapping, 0 if there is no room.
+ */
+uintptr_t vmem_map_shared(struct pcb* pcb, uint32_t* frames, int pages)
 {
-	dbgprintf(" ------- Memory Heap --------\n");
-	struct allocation* iter = allocation;
-	struct vmem_page_region* region = NULL;
-	while(iter != NULL){
-		if(region != iter->region){
-			region = iter->region;
-			dbgprintf(" ------- Region 0x%x -> 0x%x (%d/%d) %d refs --------\n", region->basevaddr, region->basevaddr+region->size, region->used, region->size, region->refs);
+	struct virtual_allocations* allocations = pcb->allocations;
+	if(pcb->is_process == PCB_KTHREAD || allocations == NULL || pages <= 0){
+		return 0;
+	}
+
+	if(allocations->shared_table == NULL){
+		allocations->shared_table = vmem_alloc_zeroed();
+	}
+	uint32_t* table = allocations->shared_table;
+	vmem_add_table(pcb->page_dir, VMEM_SHARED, table, USER);
+
+	/* First fit over the entries of the table */
+	int free = 0;
+	for (int i = 0; i < VMEM_SHARED_PAGES; i++){
+		free = table[i] & PRESENT ? 0 : free + 1;
+		if(free < pages) continue;
+
+		uintptr_t addr = VMEM_SHARED + (i - pages + 1) * PAGE_SIZE;
+		for (int j = 0; j < pages; j++){
+			vmem_map(table, addr + j * PAGE_SIZE, frames[j], USER);
 		}
-		dbgprintf("     0x%x --- size %d\n", iter->address, iter->used);
-		iter = iter->next;
+
+		return addr;
+	}
+
+	return 0;
+}
+
+void vmem_unmap_shared(struct pcb* pcb, uintptr_t addr, int pages)
+{
+	uint32_t* table = pcb->allocations->shared_table;
+	for (int i = 0; i < pages; i++){
+		vmem_unmap(table, addr + i * PAGE_SIZE);
+		tlb_flush_addr(addr + i * PAGE_SIZE);
 	}
-	dbgprintf(" -------     &End     --------\n");
 }
 
 /**
@@ -560,23 +705,14 @@ void vmem_init_process_thread(struct pcb* parent, struct pcb* thread)
 	 */
 	
 	/* inheret directory */
-	uint32_t* thread_directory = vmem_default->ops->alloc(vmem_default);
+	uint32_t* thread_directory = vmem_alloc_zeroed();
 	for (int i = 0; i < 1024; i++){
 		/* copy over pages, this will include heap and data */
 		if(parent->page_dir[i] != 0) thread_directory[i] = parent->page_dir[i];
 	}
 
-	/* Allocate table for stack */
-	uint32_t* thread_stack_table = vmem_default->ops->alloc(vmem_default);
-	
-	/* create 8kb stack, 2 4kb pages */
-	uint32_t* thread_stack_page = vmem_default->ops->alloc(vmem_default);
-	memset(thread_stack_page, 0, PAGE_SIZE);
-	vmem_map(thread_stack_table, VMEM_STACK, (uint32_t) thread_stack_page, USER);
-
-	uint32_t* thread_stack_page2 = vmem_default->ops->alloc(vmem_default);
-	memset(thread_stack_page2, 0, PAGE_SIZE);
-	vmem_map(thread_stack_table, VMEM_STACK+PAGE_SIZE, (uint32_t) thread_stack_page2, USER);
+	/* Own table for the stack, pages are mapped as the stack grows */
+	uint32_t* thread_stack_table = vmem_alloc_zeroed();
 
 	/* Insert and replace stack in directory. */
 	vmem_add_table(thread_directory, VMEM_STACK, thread_stack_table, USER);
@@ -589,25 +725,18 @@ void vmem_init_process_thread(struct pcb* parent, struct pcb* thread)
 
 /**
  * @brief Initializes the virtual memory for the specified process control block (PCB).
- * The vmem_init_process() function is responsible for initializing the virtual memory for the given PCB.
+ * Only the directory and page tables are allocated, data, stack and heap pages
+ * are mapped when they are first touched, see vmem_page_fault().
  * @param pcb A pointer to the process control block (PCB) for which memory needs to be initialized.
- * @param data in memory data to be copied into the process data section.
- * @param size size of the data to be copied.
- * TODO: Should probably be on demand paging.
+ * @param image program image from vmem_image_get(), its reference is owned by the process from here.
  */
-void vmem_init_process(struct pcb* pcb, byte_t* data, int size)
+void vmem_init_process(struct pcb* pcb, struct vmem_image* image)
 {
-	int allocated_pages = 0;
-
 	/* Allocate directory and tables for data and stack */
-	uint32_t* process_directory = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	uint32_t* process_data_table = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	uint32_t* process_stack_table = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	uint32_t* process_heap_table = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
+	uint32_t* process_directory = vmem_alloc_zeroed();
+	uint32_t* process_data_table = vmem_alloc_zeroed();
+	uint32_t* process_stack_table = vmem_alloc_zeroed();
+	uint32_t* process_heap_table = vmem_alloc_zeroed();
 
 	dbgprintf("[INIT PROCESS] Directory: 0x%x\n", process_directory);
 	dbgprintf("[INIT PROCESS] Data: 	 0x%x\n", process_data_table);
@@ -619,41 +748,6 @@ void vmem_init_process(struct pcb* pcb, byte_t* data, int size)
 		if(kernel_page_dir[i] != 0) process_directory[i] = kernel_page_dir[i];
 	}
 
-	uint32_t* process_data_page;
-	/* Map the process data to a page */
-	int i = 0;
-	while (size > PAGE_SIZE){
-		process_data_page = vmem_default->ops->alloc(vmem_default);
-		allocated_pages++;
-		/* copy in process data. */
-		memcpy(process_data_page, &data[i*PAGE_SIZE], PAGE_SIZE);
-		vmem_map(process_data_table, VMEM_DATA+(i*PAGE_SIZE), (uint32_t) process_data_page, USER);
-		size -= PAGE_SIZE;
-		i++;
-	}
-	/* fill in rest. */
-	process_data_page = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	memcpy(process_data_page, &data[i*PAGE_SIZE], size);
-	vmem_map(process_data_table, VMEM_DATA+(i*PAGE_SIZE), (uint32_t) process_data_page, USER);
-	dbgprintf("[INIT PROCESS] Finished mapping data.\n");
-
-	/* Map the process stack 8Kb to a page */
-	uint32_t* process_stack_page = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	memset(process_stack_page, 0, PAGE_SIZE);
-	dbgprintf("[INIT PROCESS] Finished allocating 1/2 stack page.\n");
-	vmem_map(process_stack_table, VMEM_STACK, (uint32_t) process_stack_page, USER);
-	dbgprintf("[INIT PROCESS] Finished mapping 1/2 stack page.\n");
-
-	uint32_t* process_stack_page2 = vmem_default->ops->alloc(vmem_default);
-	allocated_pages++;
-	dbgprintf("[INIT PROCESS] Finished allocating 2/2 stack page.\n");
-	memset(process_stack_page2, 0, PAGE_SIZE);
-	dbgprintf("[INIT PROCESS] Finished clearing 2/2 stack page.\n");
-	vmem_map(process_stack_table, VMEM_STACK-PAGE_SIZE, (uint32_t) process_stack_page2, USER);
-	dbgprintf("[INIT PROCESS] Finished mapping stack.\n");
-
 	/* Insert page and data tables in directory. */
 	vmem_add_table(process_directory, VMEM_HEAP, process_heap_table, USER);
 	vmem_add_table(process_directory, VMEM_STACK, process_stack_table, USER);
@@ -663,11 +757,12 @@ void vmem_init_process(struct pcb* pcb, byte_t* data, int size)
 	if(pcb->allocations == NULL){
 		kernel_panic("Out of memory while allocating virtual memory allocations.");
 	}
-	pcb->allocations->head = NULL;
+	pcb->allocations->refs = NULL;
 	pcb->allocations->spinlock = 0;
+	pcb->allocations->image = image;
+	pcb->allocations->shared_table = NULL;
 
-
-	dbgprintf("[INIT PROCESS] Process paging setup done: allocated %d pages.\n", allocated_pages);
+	dbgprintf("[INIT PROCESS] Process paging setup done.\n");
 	pcb->page_dir = (uint32_t*)process_directory;
 }
 
@@ -687,12 +782,7 @@ void vmem_cleanup_process_thead(struct pcb* thread)
 	 */
 
 	uint32_t stack_table = (uint32_t)thread->page_dir[DIRECTORY_INDEX(VMEM_STACK)] & ~PAGE_MASK;
-	uint32_t stack_page = (uint32_t)((uint32_t*)(thread->page_dir[DIRECTORY_INDEX(VMEM_STACK)] & ~PAGE_MASK))[TABLE_INDEX(VMEM_STACK)]& ~PAGE_MASK;
-	uint32_t stack_page2 = (uint32_t)((uint32_t*)(thread->page_dir[DIRECTORY_INDEX((VMEM_STACK-PAGE_SIZE))] & ~PAGE_MASK))[TABLE_INDEX(VMEM_STACK)]& ~PAGE_MASK;
-
-	vmem_default->ops->free(vmem_default, (void*) stack_page);
-	vmem_default->ops->free(vmem_default, (void*) stack_page2);
-	vmem_default->ops->free(vmem_default, (void*) stack_table);
+	vmem_free_table((uint32_t*) stack_table, PRESENT);
 
 	vmem_default->ops->free(vmem_default, (void*) thread->page_dir);
 
@@ -702,6 +792,7 @@ void vmem_cleanup_process_thead(struct pcb* thread)
  * @brief Frees all virtual memory pages allocated for the specified process control block (PCB).
  * The vmem_cleanup_process() function is responsible for freeing all virtual memory pages allocated for the given PCB.
  * It first frees all data pages, then the stack pages, and finally the heap pages.
+ * Only pages that were touched are mapped, so only those are freed.
  * @param pcb A pointer to the process control block (PCB) for which memory needs to be freed.
  * @return void
  * @note The function uses the vmem_default_ops structure to free the virtual memory pages.
@@ -723,27 +814,13 @@ void vmem_cleanup_process(struct pcb* pcb)
 	uint32_t directory = (uint32_t)pcb->page_dir;
 
 	/**
-	 * Free all data pages, first get correct data table then
-	 * free all pages based on the size of pcb.
+	 * Free the data pages copied on write, read only pages belong to the shared image.
 	 */
 	uint32_t data_table = (uint32_t)pcb->page_dir[DIRECTORY_INDEX(VMEM_DATA)] & ~PAGE_MASK;
 	assert(data_table != 0);
 
-	int size = pcb->data_size;
-	int i = 0;
-	while(size > 4096){
-		uint32_t data_page = (uint32_t)((uint32_t*)(pcb->page_dir[DIRECTORY_INDEX(VMEM_DATA)] & ~PAGE_MASK))[TABLE_INDEX((VMEM_DATA+(i*4096)))]& ~PAGE_MASK;
-		vmem_default->ops->free(vmem_default, (void*) data_page);
-		freed_pages++;
-		size -= 4096;
-		i++;
-	}
-	uint32_t data_page = (uint32_t)((uint32_t*)(pcb->page_dir[DIRECTORY_INDEX(VMEM_DATA)] & ~PAGE_MASK))[TABLE_INDEX((VMEM_DATA+(i*4096)))]& ~PAGE_MASK;
-	
-	vmem_default->ops->free(vmem_default, (void*) data_page);
-	freed_pages++;
-	vmem_default->ops->free(vmem_default, (void*) data_table);
-	freed_pages++;
+	freed_pages += vmem_free_table((uint32_t*) data_table, PRESENT | READ_WRITE);
+	vmem_image_put(pcb->allocations->image);
 
 	dbgprintf("[Memory] Cleaning up data from pcb [DONE].\n");
 
@@ -751,18 +828,18 @@ void vmem_cleanup_process(struct pcb* pcb)
 	 * Free all stack pages
 	 */
 	uint32_t stack_table = (uint32_t)pcb->page_dir[DIRECTORY_INDEX(VMEM_STACK)] & ~PAGE_MASK;
-	uint32_t stack_page = (uint32_t)((uint32_t*)(pcb->page_dir[DIRECTORY_INDEX(VMEM_STACK)] & ~PAGE_MASK))[TABLE_INDEX(VMEM_STACK)]& ~PAGE_MASK;
-	uint32_t stack_page2 = (uint32_t)((uint32_t*)(pcb->page_dir[DIRECTORY_INDEX((VMEM_STACK-PAGE_SIZE))] & ~PAGE_MASK))[TABLE_INDEX(VMEM_STACK)]& ~PAGE_MASK;
-
-	vmem_default->ops->free(vmem_default, (void*) stack_page);
-	freed_pages++;
-	vmem_default->ops->free(vmem_default, (void*) stack_page2);
-	freed_pages++;
-	vmem_default->ops->free(vmem_default, (void*) stack_table);
-	freed_pages++;
+	freed_pages += vmem_free_table((uint32_t*) stack_table, PRESENT);
 
 	dbgprintf("[Memory] Cleaning up stack from pcb [DONE].\n");
 
+	/**
+	 * Shared frames belong to their owner, only the table is freed.
+	 */
+	if(pcb->allocations->shared_table != NULL){
+		vmem_default->ops->free(vmem_default, pcb->allocations->shared_table);
+		freed_pages++;
+	}
+
 	/**
 	 * Free all heap allocated memory.
 	 */
@@ -834,6 +911,7 @@ int vmem_allocator_create(struct virtual_memory_allocator* allocator, int from,
 	allocator->total_pages = (to-from)/PAGE_SIZE;
 	allocator->ops = &vmem_default_ops;
 	allocator->used_pages = 0;
+	allocator->hint = 0;
 	allocator->pages = create_bitmap(allocator->total_pages);
 	mutex_init(&allocator->lock);
 	dbgprintf("Created new allocator\n");
@@ -881,6 +959,7 @@ void vmem_init()
 	dbgprintf("Manager start: 0x%x - 0x%x (%d)\n", VMEM_MANAGER_START, VMEM_MANAGER_END, VMEM_MANAGER_PAGES);
 
 	vmem_allocator_create(vmem_manager, VMEM_MANAGER_START, VMEM_MANAGER_END);
+	mutex_init(&vmem_images_lock);
 	dbgprintf("Default: 0x%x - 0x%x (%d)\n", VMEM_START_ADDRESS, VMEM_END_ADDRESS, VMEM_TOTAL_PAGES);
 
 	dbgprintf("[VIRTUAL MEMORY] %d free pagable pages.\n", VMEM_TOTAL_PAGES);
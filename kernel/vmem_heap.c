@@ -0,0 +1,343 @@
+/**
+ * @file vmem_heap.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Address ordered extent allocator used for process heaps.
+ * The heap is split into extents stored in an AVL tree keyed on address.
+ * Each node caches the largest free extent in its subtree, giving
+ * O(log n) first fit allocation, lookup on free and coalescing.
+ * The allocator only hands out addresses, mapping pages is up to the caller.
+ * @version 0.1
+ * @date 2024-02-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <vmem_heap.h>
+#include <memory.h>
+#include <kutils.h>
+
+static struct kmem_cache* __extent_cache = NULL;
+
+static inline int __height(struct vmem_extent* node)
+{
+	return node == NULL ? 0 : node->height;
+}
+
+static inline int __max_free(struct vmem_extent* node)
+{
+	return node == NULL ? 0 : node->max_free;
+}
+
+static inline void __update(struct vmem_extent* node)
+{
+	int lh = __height(node->left);
+	int rh = __height(node->right);
+	node->height = (lh > rh ? lh : rh) + 1;
+
+	int best = node->free ? node->size : 0;
+	if(__max_free(node->left) > best) best = __max_free(node->left);
+	if(__max_free(node->right) > best) best = __max_free(node->right);
+	node->max_free = best;
+}
+
+static struct vmem_extent* __rotate_right(struct vmem_extent* node)
+{
+	struct vmem_extent* left = node->left;
+	node->left = left->right;
+	left->right = node;
+	__update(node);
+	__update(left);
+	return left;
+}
+
+static struct vmem_extent* __rotate_left(struct vmem_extent* node)
+{
+	struct vmem_extent* right = node->right;
+	node->right = right->left;
+	right->left = node;
+	__update(node);
+	__update(right);
+	return right;
+}
+
+static struct vmem_extent* __balance(struct vmem_extent* node)
+{
+	__update(node);
+
+	int balance = __height(node->left) - __height(node->right);
+	if(balance > 1){
+		if(__height(node->left->left) < __height(node->left->right)){
+			node->left = __rotate_left(node->left);
+		}
+		return __rotate_right(node);
+	}
+
+	if(balance < -1){
+		if(__height(node->right->right) < __height(node->right->left)){
+			node->right = __rotate_right(node->right);
+		}
+		return __rotate_left(node);
+	}
+
+	return node;
+}
+
+static struct vmem_extent* __insert(struct vmem_extent* root, struct vmem_extent* node)
+{
+	if(root == NULL){
+		node->left = NULL;
+		node->right = NULL;
+		__update(node);
+		return node;
+	}
+
+	if(node->start < root->start){
+		root->left = __insert(root->left, node);
+	} else {
+		root->right = __insert(root->right, node);
+	}
+	return __balance(root);
+}
+
+static struct vmem_extent* __remove_min(struct vmem_extent* root, struct vmem_extent** min)
+{
+	if(root->left == NULL){
+		*min = root;
+		return root->right;
+	}
+	root->left = __remove_min(root->left, min);
+	return __balance(root);
+}
+
+/**
+ * @brief Unlinks the extent starting at start from the tree.
+ * The node itself is not freed.
+ */
+static struct vmem_extent* __remove(struct vmem_extent* root, uintptr_t start)
+{
+	if(root == NULL){
+		return NULL;
+	}
+
+	if(start < root->start){
+		root->left = __remove(root->left, start);
+	} else if(start > root->start){
+		root->right = __remove(root->right, start);
+	} else {
+		if(root->left == NULL) return root->right;
+		if(root->right == NULL) return root->left;
+
+		/* Replace with the successor */
+		struct vmem_extent* min;
+		struct vmem_extent* right = __remove_min(root->right, &min);
+		min->left = root->left;
+		min->right = right;
+		root = min;
+	}
+	return __balance(root);
+}
+
+static struct vmem_extent* __find(struct vmem_extent* root, uintptr_t start)
+{
+	while(root != NULL && root->start != start){
+		root = start < root->start ? root->left : root->right;
+	}
+	return root;
+}
+
+/* Closest extent before and after start */
+static struct vmem_extent* __prev(struct vmem_extent* root, uintptr_t start)
+{
+	struct vmem_extent* best = NULL;
+	while(root != NULL){
+		if(root->start < start){
+			best = root;
+			root = root->right;
+		} else {
+			root = root->left;
+		}
+	}
+	return best;
+}
+
+static struct vmem_extent* __next(struct vmem_extent* root, uintptr_t start)
+{
+	struct vmem_extent* best = NULL;
+	while(root != NULL){
+		if(root->start > start){
+			best = root;
+			root = root->left;
+		} else {
+			root = root->right;
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief Finds the lowest addressed free extent of at least size bytes.
+ */
+static struct vmem_extent* __first_fit(struct vmem_extent* root, int size)
+{
+	while(root != NULL && root->max_free >= size){
+		if(__max_free(root->left) >= size){
+			root = root->left;
+		} else if(root->free && root->size >= size){
+			return root;
+		} else {
+			root = root->right;
+		}
+	}
+	return NULL;
+}
+
+static struct vmem_extent* __new_extent(uintptr_t start, int size, int free)
+{
+	if(__extent_cache == NULL){
+		__extent_cache = kmem_cache_create("vmem", sizeof(struct vmem_extent));
+		if(__extent_cache == NULL) return NULL;
+	}
+
+	struct vmem_extent* extent = kmem_cache_alloc(__extent_cache);
+	if(extent == NULL){
+		return NULL;
+	}
+
+	extent->start = start;
+	extent->size = size;
+	extent->free = free;
+	extent->left = NULL;
+	extent->right = NULL;
+	return extent;
+}
+
+static void __destroy(struct vmem_extent* root)
+{
+	if(root == NULL) return;
+
+	__destroy(root->left);
+	__destroy(root->right);
+	kmem_cache_free(__extent_cache, root);
+}
+
+void vmem_heap_init(struct vmem_heap* heap, uintptr_t start, int size)
+{
+	heap->root = NULL;
+	heap->start = start;
+	heap->size = size;
+	heap->used = 0;
+	heap->allocations = 0;
+}
+
+void vmem_heap_destroy(struct vmem_heap* heap)
+{
+	__destroy(heap->root);
+	vmem_heap_init(heap, heap->start, heap->size);
+}
+
+/**
+ * @brief Allocates size bytes from the heap, first fit by address.
+ *
+ * @param heap heap to allocate from
+ * @param size bytes to allocate, rounded up to pointer size
+ * @return uintptr_t address of allocation, 0 if there is no space.
+ */
+uintptr_t vmem_heap_alloc(struct vmem_heap* heap, int size)
+{
+	if(size <= 0){
+		return 0;
+	}
+	size = ALIGN(size, PTR_SIZE);
+
+	/* The whole heap starts out as a single free extent. */
+	if(heap->root == NULL){
+		struct vmem_extent* all = __new_extent(heap->start, heap->size, 1);
+		if(all == NULL){
+			return 0;
+		}
+		heap->root = __insert(NULL, all);
+	}
+
+	struct vmem_extent* extent = __first_fit(heap->root, size);
+	if(extent == NULL){
+		return 0;
+	}
+	uintptr_t addr = extent->start;
+
+	if(extent->size == size){
+		heap->root = __remove(heap->root, addr);
+		extent->free = 0;
+		heap->root = __insert(heap->root, extent);
+	} else {
+		/* Split, the front is allocated and the rest stays free. */
+		struct vmem_extent* used = __new_extent(addr, size, 0);
+		if(used == NULL){
+			return 0;
+		}
+
+		heap->root = __remove(heap->root, addr);
+		extent->start += size;
+		extent->size -= size;
+		heap->root = __insert(heap->root, extent);
+		heap->root = __insert(heap->root, used);
+	}
+
+	heap->used += size;
+	heap->allocations++;
+
+	return addr;
+}
+
+/**
+ * @brief Frees the allocation starting at addr and coalesces it with free neighbours.
+ *
+ * @param heap heap to free from
+ * @param addr address returned by vmem_heap_alloc
+ * @return int size of the freed allocation, or error code if addr is not allocated.
+ */
+int vmem_heap_free(struct vmem_heap* heap, uintptr_t addr)
+{
+	struct vmem_extent* extent = __find(heap->root, addr);
+	if(extent == NULL || extent->free){
+		return -ERROR_INVALID_ARGUMENTS;
+	}
+	int size = extent->size;
+
+	heap->root = __remove(heap->root, addr);
+	extent->free = 1;
+
+	struct vmem_extent* prev = __prev(heap->root, addr);
+	if(prev != NULL && prev->free && prev->start + prev->size == addr){
+		heap->root = __remove(heap->root, prev->start);
+		extent->start = prev->start;
+		extent->size += prev->size;
+		kmem_cache_free(__extent_cache, prev);
+	}
+
+	struct vmem_extent* next = __next(heap->root, addr);
+	if(next != NULL && next->free && extent->start + extent->size == next->start){
+		heap->root = __remove(heap->root, next->start);
+		extent->size += next->size;
+		kmem_cache_free(__extent_cache, next);
+	}
+
+	heap->root = __insert(heap->root, extent);
+
+	heap->used -= size;
+	heap->allocations--;
+
+	return size;
+}
+
+/**
+ * @brief Size of the allocation starting at addr.
+ * @return int size in bytes, or error code if addr is not allocated.
+ */
+int vmem_heap_size(struct vmem_heap* heap, uintptr_t addr)
+{
+	struct vmem_extent* extent = __find(heap->root, addr);
+	if(extent == NULL || extent->free){
+		return -ERROR_INVALID_ARGUMENTS;
+	}
+	return extent->size;
+}
@@ -21,26 +21,23 @@
 #define dbgprintf(...)
 #endif
 
-/* Limits amount of works in queue and eliminates the need for kalloc */
-#define WORK_POOL_SIZE 25
-static struct work __work_pool[WORK_POOL_SIZE];
+/**
+ * Works are added from interrupt context (scheduler cleanup, timers), so they
+ * are taken from a slab cache without growing it. The workers keep WORK_RESERVE
+ * works free from thread context.
+ */
+#define WORK_RESERVE 32
+static struct kmem_cache* __work_cache = NULL;
 static int works_in_queue = 0;
 
-static struct work* get_new_work() {
-    struct work* new = NULL;
+/* Idle workers block here until new work is added */
+static wait_queue_t work_wait = {0};
 
-    CRITICAL_SECTION({
+static struct work* get_new_work() {
+    struct work* new = kmem_cache_alloc_atomic(__work_cache);
+    if(new == NULL) return NULL;
 
-        for (int i = 0; i < WORK_POOL_SIZE; i++){
-            if(__work_pool[i].in_use == 0){
-                __work_pool[i].in_use = 1;
-                new = &__work_pool[i];
-                break;
-            }
-        }
-        
-    });
-    
+    new->in_use = 1;
     return new;
 }
 
@@ -85,6 +82,7 @@ int work_queue_add(int (*fn)(void*), void* arg, void(*callback)(int))
             queue.tail = work;
         }
         works_in_queue++;
+        wake_up_one(&work_wait);
     });
 
     return 0;
@@ -92,9 +90,10 @@ int work_queue_add(int (*fn)(void*), void* arg, void(*callback)(int))
 
 void init_worker()
 {
-    for (int i = 0; i < WORK_POOL_SIZE; i++){
-        __work_pool[i].in_use = 0;
-    }
+    __work_cache = kmem_cache_create("work", sizeof(struct work));
+    assert(__work_cache != NULL);
+    assert(kmem_cache_reserve(__work_cache, WORK_RESERVE) == ERROR_OK);
+    wait_queue_init(&work_wait);
 }
 
 static int workers = 0;
@@ -107,11 +106,8 @@ void worker_thread()
     while (1) {
 
         ENTER_CRITICAL();
-        if(queue.head == NULL) {
-            /* Should block */
-            LEAVE_CRITICAL();
-            kernel_yield();
-            continue;
+        while(queue.head == NULL) {
+            wait_queue_block(&work_wait, WAIT_QUEUE_FOREVER);
         }
 
         ASSERT_CRITICAL();
@@ -132,6 +128,8 @@ void worker_thread()
             work->callback(ret);
         }
         work->in_use = 0;
-        work->next = NULL;
+        kmem_cache_free(__work_cache, work);
+
+        kmem_cache_reserve(__work_cache, WORK_RESERVE);
     }
 }
\ No newline at end of file
@@ -45,59 +45,226 @@ void destroy_bitmap(bitmap_t b)
     kfree((void*) b);
 }
 
-inline int __continous_helper(bitmap_t b, int start, int size)
+/* Bitmaps are scanned 32 bits at a time, bit i lives in word i/32 (little endian). */
+typedef uint32_t __attribute__((__may_alias__)) bitmap_word_t;
+
+#define BITMAP_WORD_BITS 32
+#define BITMAP_FULL_WORD 0xFFFFFFFF
+
+/**
+ * @brief Reads the word containing bit i.
+ * Bits past n are returned as set so they are never handed out,
+ * the tail word is assembled byte by byte to avoid reading past the map.
+ */
+static inline uint32_t __bitmap_word(bitmap_t b, int n, int i)
+{
+    int word = i / BITMAP_WORD_BITS;
+    int base = word * BITMAP_WORD_BITS;
+
+    if(base + BITMAP_WORD_BITS <= n){
+        return ((bitmap_word_t*) b)[word];
+    }
+
+    uint32_t value = BITMAP_FULL_WORD << (n - base);
+    for (int j = 0; j < get_bitmap_size(n) - (base / 8); j++){
+        value |= ((uint32_t) b[(base / 8) + j]) << (j * 8);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Finds the first cleared bit at or after start.
+ * Full words are skipped, the bit inside a word is found with a single ctz.
+ * @return index of bit or n if none.
+ */
+static int __bitmap_next_zero(bitmap_t b, int n, int start)
+{
+    int i = start;
+    while (i < n){
+        /* Treat bits below i in the current word as set. */
+        uint32_t word = __bitmap_word(b, n, i) | ~(BITMAP_FULL_WORD << (i % BITMAP_WORD_BITS));
+        if(word != BITMAP_FULL_WORD){
+            int bit = (i & ~(BITMAP_WORD_BITS-1)) + __builtin_ctz(~word);
+            return bit < n ? bit : n;
+        }
+        i = (i & ~(BITMAP_WORD_BITS-1)) + BITMAP_WORD_BITS;
+    }
+    return n;
+}
+
+/**
+ * @brief Finds the first set bit at or after start, stopping at limit.
+ * @return index of bit or limit if none.
+ */
+static int __bitmap_next_one(bitmap_t b, int n, int start, int limit)
+{
+    int i = start;
+    while (i < limit){
+        uint32_t word = __bitmap_word(b, n, i) & (BITMAP_FULL_WORD << (i % BITMAP_WORD_BITS));
+        if(word != 0){
+            int bit = (i & ~(BITMAP_WORD_BITS-1)) + __builtin_ctz(word);
+            return bit < limit ? bit : limit;
+        }
+        i = (i & ~(BITMAP_WORD_BITS-1)) + BITMAP_WORD_BITS;
+    }
+    return limit;
+}
+
+/**
+ * @brief Finds the first cleared bit at or after start without setting it.
+ * 
+ * @param b bitmap
+ * @param n number of bits in the bitmap
+ * @param start bit to start searching from
+ * @return int index of bit, -1 if none is free.
+ */
+int bitmap_find_free(bitmap_t b, int n, int start)
+{
+    int bit = __bitmap_next_zero(b, n, start < 0 ? 0 : start);
+    return bit < n ? bit : -1;
+}
+
+/**
+ * @brief Finds the first set bit at or after start.
+ * 
+ * @param b bitmap
+ * @param n number of bits in the bitmap
+ * @param start bit to start searching from
+ * @return int index of bit, -1 if none is set.
+ */
+int bitmap_find_set(bitmap_t b, int n, int start)
+{
+    if(start < 0) start = 0;
+
+    int bit = __bitmap_next_one(b, n, start, n);
+    return bit < n ? bit : -1;
+}
+
+/**
+ * @brief Finds the first run of size cleared bits at or after start without setting them.
+ * 
+ * @param b bitmap
+ * @param n number of bits in the bitmap
+ * @param size length of run
+ * @param start bit to start searching from
+ * @return int index of first bit in run, -1 if none is found.
+ */
+int bitmap_find_continous(bitmap_t b, int n, int size, int start)
 {
-    for (int j = 0; j < size; j++)
-    {
-        if(get_bitmap(b, start+j) != 0){
+    if(size <= 0) return -1;
+
+    int i = start < 0 ? 0 : start;
+    while (i < n){
+        int zero = __bitmap_next_zero(b, n, i);
+        if(zero + size > n){
             return -1;
         }
+
+        int one = __bitmap_next_one(b, n, zero, zero + size);
+        if(one - zero >= size){
+            return zero;
+        }
+        i = one + 1;
     }
-    return 0;
+    return -1;
+}
+
+void bitmap_set_continous(bitmap_t b, int start, int size)
+{
+    int i = start;
+    int end = start + size;
+
+    for (; i < end && i % 8; i++) set_bitmap(b, i);
+    for (; i + 8 <= end; i += 8) b[i / 8] = 0xFF;
+    for (; i < end; i++) set_bitmap(b, i);
 }
 
 int bitmap_unset_continous(bitmap_t b, int start, int size)
 {
-    for (int i = start; i < (start+size); i++)
-    {
-        unset_bitmap(b, i);
-    }
+    int i = start;
+    int end = start + size;
+
+    for (; i < end && i % 8; i++) unset_bitmap(b, i);
+    for (; i + 8 <= end; i += 8) b[i / 8] = 0;
+    for (; i < end; i++) unset_bitmap(b, i);
+
     return 0;
 }
 
 int bitmap_get_continous(bitmap_t b, int n, int size)
 {
-    for (int i = 0; i < n; i++)
-    {
-        if(get_bitmap(b, i) == 0)
-        {
-            
-            int ret = __continous_helper(b, i, size);
-
-            if(ret < 0)
-                break;
-
-            for (int j = 0; j < size; j++)
-            {
-                set_bitmap(b, i+j);
-            }
-            return i;
-        }
+    int start = bitmap_find_continous(b, n, size, 0);
+    if(start < 0){
+        return -1;
     }
 
-    return -1;
+    bitmap_set_continous(b, start, size);
+    return start;
 }
 
 int get_free_bitmap(bitmap_t b, int n)
 {
-    for (int i = 0; i < n; i++)
-    {
-        if(get_bitmap(b, i) == 0)
-        {
-            set_bitmap(b, i);
-            return i;
-        }
+    int bit = bitmap_find_free(b, n, 0);
+    if(bit < 0){
+        return -1;
     }
-    
-    return -1;
-}
\ No newline at end of file
+
+    set_bitmap(b, bit);
+    return bit;
+}
+
+/**
+ * @brief Next-fit version of get_free_bitmap.
+ * Searching starts at *hint and wraps around to the start of the map,
+ * the hint is moved past the returned bit so the next search continues from there.
+ * 
+ * @param b bitmap
+ * @param n number of bits in the bitmap
+ * @param hint rotating cursor owned by the caller
+ * @return int index of bit, -1 if none is free.
+ */
+int bitmap_get_free_next(bitmap_t b, int n, int* hint)
+{
+    int start = (*hint >= 0 && *hint < n) ? *hint : 0;
+
+    int bit = bitmap_find_free(b, n, start);
+    if(bit < 0 && start > 0){
+        bit = bitmap_find_free(b, n, 0);
+    }
+
+    if(bit < 0){
+        return -1;
+    }
+
+    set_bitmap(b, bit);
+    *hint = bit + 1;
+    return bit;
+}
+
+/**
+ * @brief Next-fit version of bitmap_get_continous.
+ * 
+ * @param b bitmap
+ * @param n number of bits in the bitmap
+ * @param size length of run
+ * @param hint rotating cursor owned by the caller
+ * @return int index of first bit in run, -1 if none is found.
+ */
+int bitmap_get_continous_next(bitmap_t b, int n, int size, int* hint)
+{
+    int start = (*hint >= 0 && *hint < n) ? *hint : 0;
+
+    int bit = bitmap_find_continous(b, n, size, start);
+    if(bit < 0 && start > 0){
+        bit = bitmap_find_continous(b, n, size, 0);
+    }
+
+    if(bit < 0){
+        return -1;
+    }
+
+    bitmap_set_continous(b, bit, size);
+    *hint = bit + size;
+    return bit;
+}
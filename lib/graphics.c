@@ -18,6 +18,89 @@
 extern "C" {
 #endif
 
+/* The batch of the calling thread, NULL when drawing immediately. */
+static inline struct gfx_batch* __gfx_batch()
+{
+	return (struct gfx_batch*) THREAD_LOCAL(THREAD_LOCAL_GFX_BATCH);
+}
+
+/**
+ * @brief Draws immediately, or records the command when batching.
+ * A full batch is submitted before recording more.
+ */
+static int __gfx_draw(int option, void* data, int size)
+{
+	struct gfx_batch* batch = __gfx_batch();
+	if(batch == NULL){
+		return gfx_draw_syscall(option, data, 0);
+	}
+
+	if(batch->count == GFX_BATCH_MAX){
+		gfx_batch_submit();
+	}
+
+	struct gfx_command* cmd = &batch->commands[batch->count++];
+	cmd->option = option;
+	memcpy(&cmd->pixel, data, size);
+
+	return 0;
+}
+
+/**
+ * @brief Starts recording draw calls of the calling thread instead of drawing them one syscall at a time.
+ * Without memory for the batch draw calls stay immediate.
+ */
+void gfx_batch_begin()
+{
+	struct gfx_batch* batch = __gfx_batch();
+	if(batch != NULL){
+		gfx_batch_submit();
+		return;
+	}
+
+	batch = malloc(sizeof(struct gfx_batch));
+	if(batch == NULL){
+		return;
+	}
+
+	batch->count = 0;
+	THREAD_LOCAL(THREAD_LOCAL_GFX_BATCH) = batch;
+}
+
+/**
+ * @brief Draws all commands recorded by the calling thread with one syscall.
+ * @return int 0 on success, less than 0 on error.
+ */
+int gfx_batch_submit()
+{
+	struct gfx_batch* batch = __gfx_batch();
+	if(batch == NULL || batch->count == 0){
+		return 0;
+	}
+
+	int ret = gfx_draw_syscall(GFX_DRAW_BATCH_OPT, batch, 0);
+	batch->count = 0;
+
+	return ret;
+}
+
+/**
+ * @brief Submits recorded commands and goes back to drawing immediately.
+ */
+int gfx_batch_end()
+{
+	struct gfx_batch* batch = __gfx_batch();
+	if(batch == NULL){
+		return 0;
+	}
+
+	int ret = gfx_batch_submit();
+	THREAD_LOCAL(THREAD_LOCAL_GFX_BATCH) = NULL;
+	free(batch);
+
+	return ret;
+}
+
 int gfx_draw_char(int x, int y, char data, unsigned char color)
 {
     struct gfx_char c = {
@@ -26,7 +109,7 @@ int gfx_draw_char(int x, int y, char data, unsigned char color)
         .x = x,
         .y = y
     };
-    gfx_draw_syscall(GFX_DRAW_CHAR_OPT, &c, 0);
+    __gfx_draw(GFX_DRAW_CHAR_OPT, &c, sizeof(c));
 
     return 0;
 }
@@ -39,7 +122,7 @@ int gfx_draw_pixel(int x, int y, unsigned char color)
 		.color = color
 	};
 
-	gfx_draw_syscall(GFX_DRAW_PIXEL, &p, 0);
+	__gfx_draw(GFX_DRAW_PIXEL, &p, sizeof(p));
 
 	return 0;
 }
@@ -54,7 +137,7 @@ int gfx_draw_circle(int x, int y, int r, unsigned char color, char fill)
 		.color = color
 	};
 
-	gfx_draw_syscall(GFX_DRAW_CIRCLE_OPT, &c, 0);
+	__gfx_draw(GFX_DRAW_CIRCLE_OPT, &c, sizeof(c));
 
 	return 0;
 }
@@ -69,7 +152,7 @@ int gfx_draw_line(int x0, int y0, int x1, int y1, unsigned char color)
 		.color = color
 	};
 
-	gfx_draw_syscall(GFX_DRAW_LINE_OPT, &line, 0);
+	__gfx_draw(GFX_DRAW_LINE_OPT, &line, sizeof(line));
 
 	return 0;
 }
@@ -85,7 +168,7 @@ int gfx_draw_rectangle_rgb(int x, int y, int width, int height, unsigned char co
 		.palette = GFX_RGB
 	};
 
-	gfx_draw_syscall(GFX_DRAW_RECTANGLE_OPT, &rect, 0);
+	__gfx_draw(GFX_DRAW_RECTANGLE_OPT, &rect, sizeof(rect));
 
 	return 0;
 }
@@ -101,7 +184,7 @@ int gfx_draw_rectangle(int x, int y, int width, int height, unsigned char color)
 		.palette = GFX_VGA
 	};
 
-    gfx_draw_syscall(GFX_DRAW_RECTANGLE_OPT, &rect, 0);
+    __gfx_draw(GFX_DRAW_RECTANGLE_OPT, &rect, sizeof(rect));
 
     return 0;
 }
@@ -119,15 +202,43 @@ int gfx_draw_text(int x, int y, const char* text, unsigned char color)
     for (int i = 0; i < len; i++)
     {
         c.data = text[i];
-        gfx_draw_syscall(GFX_DRAW_CHAR_OPT, &c, 0);
+        __gfx_draw(GFX_DRAW_CHAR_OPT, &c, sizeof(c));
         c.x += 8;
     }
     
     return 0;
 }
 
+/**
+ * @brief Maps the pixels of the window into the process.
+ * @return int 0 on success, less than 0 on error.
+ */
+int gfx_map_framebuffer(struct gfx_framebuffer* fb)
+{
+	return gfx_draw_syscall(GFX_MAP_FRAMEBUFFER_OPT, fb, 0);
+}
+
+/**
+ * @brief Puts an area of the mapped framebuffer on screen.
+ */
+int gfx_present(int x, int y, int width, int height)
+{
+	struct gfx_rectangle area = {
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height
+	};
+
+	/* Batched draws happened before, and may be covered by the framebuffer */
+	gfx_batch_submit();
+	return gfx_draw_syscall(GFX_PRESENT_OPT, &area, 0);
+}
+
 int gfx_get_event(struct gfx_event* event, gfx_event_flag_t flags)
 {
+	/* Everything drawn so far should be on screen while waiting */
+	gfx_batch_submit();
 	return gfx_draw_syscall(GFX_EVEN_LOOP_OPT, event, flags);
 }
 
@@ -0,0 +1,261 @@
+/**
+ * @file malloc.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Userspace heap allocator with size class free lists.
+ * Small allocations are carved out of arenas of whole pages allocated with
+ * the mmap system call, so malloc and free only trap into the kernel
+ * when a new arena is needed. Larger allocations go straight to the kernel.
+ * @version 0.1
+ * @date 2024-01-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <syscall_helper.h>
+#include <lib/syscall.h>
+#include <lib/malloc.h>
+#include <lib/printf.h>
+#include <stdint.h>
+#include <libc.h>
+
+/* Every chunk is prefixed with a tag holding its size class. */
+#define MALLOC_MAGIC        0xA110C000
+#define MALLOC_TAG(class)   (MALLOC_MAGIC | (class))
+#define MALLOC_TAG_CLASS(tag) ((tag) & 0xFF)
+#define MALLOC_TAG_VALID(tag) (((tag) & ~0xFF) == MALLOC_MAGIC && MALLOC_TAG_CLASS(tag) < MALLOC_CLASSES)
+
+#define MALLOC_HEADER_SIZE  sizeof(uint32_t)
+#define MALLOC_CLASS_SIZE(class) (1 << (MALLOC_MIN_SHIFT + (class)))
+
+struct malloc_free_chunk {
+    struct malloc_free_chunk* next;
+};
+
+struct malloc_arena {
+    uintptr_t start;
+    uintptr_t end;
+};
+
+static struct malloc_state {
+    struct malloc_free_chunk* free[MALLOC_CLASSES];
+
+    struct malloc_arena arenas[MALLOC_MAX_ARENAS];
+    int narenas;
+
+    /* Bump pointer into the newest arena */
+    uintptr_t top;
+    uintptr_t end;
+
+    struct malloc_stats stats;
+    volatile int lock;
+} __malloc = {0};
+
+/* Threads share the heap, so the allocator is protected by a yielding spinlock. */
+static inline void __malloc_lock()
+{
+    while(__sync_lock_test_and_set(&__malloc.lock, 1)){
+        yield();
+    }
+}
+
+static inline void __malloc_unlock()
+{
+    __sync_lock_release(&__malloc.lock);
+}
+
+static inline int __malloc_class(int size)
+{
+    int bits = 32 - __builtin_clz(size + MALLOC_HEADER_SIZE - 1);
+    return bits > MALLOC_MIN_SHIFT ? bits - MALLOC_MIN_SHIFT : 0;
+}
+
+static int __malloc_in_arena(void* ptr)
+{
+    for (int i = 0; i < __malloc.narenas; i++){
+        if((uintptr_t)ptr >= __malloc.arenas[i].start && (uintptr_t)ptr < __malloc.arenas[i].end){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a new arena from the kernel and makes it the bump arena.
+ * The unused tail of the previous arena is handed to the free lists.
+ * @return int 0 on success, -1 if no arena could be mapped.
+ */
+static int __malloc_new_arena()
+{
+    if(__malloc.narenas >= MALLOC_MAX_ARENAS){
+        return -1;
+    }
+
+    void* arena = mmap(MALLOC_ARENA_SIZE);
+    __malloc.stats.syscalls++;
+    if(arena == NULL){
+        return -1;
+    }
+
+    /* Split the leftover of the old arena into the largest chunks that fit. */
+    for (int class = MALLOC_CLASSES-1; class >= 0; class--){
+        while(__malloc.end - __malloc.top >= (uintptr_t)MALLOC_CLASS_SIZE(class)){
+            *(uint32_t*)__malloc.top = MALLOC_TAG(class);
+            struct malloc_free_chunk* chunk = (struct malloc_free_chunk*)(__malloc.top + MALLOC_HEADER_SIZE);
+            chunk->next = __malloc.free[class];
+            __malloc.free[class] = chunk;
+            __malloc.top += MALLOC_CLASS_SIZE(class);
+        }
+    }
+
+    __malloc.arenas[__malloc.narenas].start = (uintptr_t)arena;
+    __malloc.arenas[__malloc.narenas].end = (uintptr_t)arena + MALLOC_ARENA_SIZE;
+    __malloc.narenas++;
+
+    __malloc.top = (uintptr_t)arena;
+    __malloc.end = (uintptr_t)arena + MALLOC_ARENA_SIZE;
+    __malloc.stats.arenas++;
+
+    return 0;
+}
+
+static void* __malloc_small(int class)
+{
+    struct malloc_free_chunk* chunk = __malloc.free[class];
+    if(chunk != NULL){
+        __malloc.free[class] = chunk->next;
+        return chunk;
+    }
+
+    if(__malloc.end - __malloc.top < (uintptr_t)MALLOC_CLASS_SIZE(class)){
+        if(__malloc_new_arena() < 0){
+            return NULL;
+        }
+    }
+
+    *(uint32_t*)__malloc.top = MALLOC_TAG(class);
+    void* ptr = (void*)(__malloc.top + MALLOC_HEADER_SIZE);
+    __malloc.top += MALLOC_CLASS_SIZE(class);
+
+    return ptr;
+}
+
+/**
+ * @brief Allocates straight from the kernel, freed with SYSCALL_FREE.
+ */
+static void* __malloc_large(int size)
+{
+    void* ptr = (void*)invoke_syscall(SYSCALL_MALLOC, size, 0, 0);
+
+    __malloc_lock();
+    __malloc.stats.syscalls++;
+    if(ptr != NULL){
+        __malloc.stats.large++;
+        __malloc.stats.mallocs++;
+    }
+    __malloc_unlock();
+    return ptr;
+}
+
+void* malloc(int size)
+{
+    if(size <= 0){
+        return NULL;
+    }
+
+    /* Large allocations are page granular in the kernel anyway. */
+    if(size > MALLOC_MAX_SMALL - (int)MALLOC_HEADER_SIZE){
+        return __malloc_large(size);
+    }
+
+    int class = __malloc_class(size);
+
+    __malloc_lock();
+    void* ptr = __malloc_small(class);
+    if(ptr != NULL){
+        __malloc.stats.mallocs++;
+        __malloc.stats.in_use[class]++;
+        __malloc.stats.bytes += MALLOC_CLASS_SIZE(class);
+    }
+    __malloc_unlock();
+
+    /* Out of arenas, the kernel may still have memory. */
+    if(ptr == NULL){
+        return __malloc_large(size);
+    }
+
+    return ptr;
+}
+
+void free(void* ptr)
+{
+    if(ptr == NULL){
+        return;
+    }
+
+    __malloc_lock();
+    if(!__malloc_in_arena(ptr)){
+        /* Large allocation, or memory handed out by the kernel. */
+        __malloc.stats.frees++;
+        __malloc.stats.syscalls++;
+        __malloc_unlock();
+
+        invoke_syscall(SYSCALL_FREE, (int)ptr, 0, 0);
+        return;
+    }
+
+    uint32_t tag = *(uint32_t*)((uintptr_t)ptr - MALLOC_HEADER_SIZE);
+    if(!MALLOC_TAG_VALID(tag)){
+        __malloc_unlock();
+        return;
+    }
+
+    int class = MALLOC_TAG_CLASS(tag);
+    struct malloc_free_chunk* chunk = (struct malloc_free_chunk*) ptr;
+    chunk->next = __malloc.free[class];
+    __malloc.free[class] = chunk;
+
+    __malloc.stats.frees++;
+    __malloc.stats.in_use[class]--;
+    __malloc.stats.bytes -= MALLOC_CLASS_SIZE(class);
+    __malloc_unlock();
+}
+
+int malloc_get_stats(struct malloc_stats* stats)
+{
+    if(stats == NULL){
+        return -1;
+    }
+
+    __malloc_lock();
+    *stats = __malloc.stats;
+    __malloc_unlock();
+
+    return 0;
+}
+
+/**
+ * @brief Prints the allocation statistics of the calling process to its terminal.
+ * Called by the runtime when main returns, see crt0.s.
+ */
+void malloc_dump_stats()
+{
+    struct malloc_stats stats;
+    malloc_get_stats(&stats);
+
+    printf("malloc: %d allocs, %d frees, %d large\n", stats.mallocs, stats.frees, stats.large);
+    printf("malloc: %d arenas, %d syscalls, %d bytes in use\n", stats.arenas, stats.syscalls, stats.bytes);
+    for (int i = 0; i < MALLOC_CLASSES; i++){
+        if(stats.in_use[i] == 0) continue;
+        printf("  %d: %d in use\n", MALLOC_CLASS_SIZE(i), stats.in_use[i]);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
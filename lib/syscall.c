@@ -113,14 +113,39 @@ void* zmalloc(int size)
     return ptr;
 }
 
-void* malloc(int size)
+void* mmap(int size)
 {
-    return (void*)invoke_syscall(SYSCALL_MALLOC, size, 0, 0);
+    return (void*)invoke_syscall(SYSCALL_MMAP, size, 0, 0);
 }
 
-void free(void* ptr)
+int ipc_shm_open(int size)
 {
-    invoke_syscall(SYSCALL_FREE, (int)ptr, 0, 0);
+    return invoke_syscall(SYSCALL_IPC_SHM_OPEN, size, 0, 0);
+}
+
+void* ipc_shm_attach(int channel)
+{
+    return (void*)invoke_syscall(SYSCALL_IPC_SHM_ATTACH, channel, 0, 0);
+}
+
+int ipc_shm_detach(int channel)
+{
+    return invoke_syscall(SYSCALL_IPC_SHM_DETACH, channel, 0, 0);
+}
+
+int ipc_close(int channel)
+{
+    return invoke_syscall(SYSCALL_IPC_CLOSE, channel, 0, 0);
+}
+
+int futex_wait(volatile unsigned int* addr, unsigned int expected, int timeout)
+{
+    return invoke_syscall(SYSCALL_FUTEX_WAIT, (int)addr, (int)expected, timeout);
+}
+
+int futex_wake(volatile unsigned int* addr)
+{
+    return invoke_syscall(SYSCALL_FUTEX_WAKE, (int)addr, 0, 0);
 }
 
 int fclose(int fd)
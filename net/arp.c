@@ -102,23 +102,25 @@ int net_arp_find_entry(uint32_t ip, uint8_t* mac)
 static void __net_arp_send(struct arp_content* content, struct arp_header* hdr)
 {
 	struct sk_buff* skb = skb_new();
-
-	skb->proto = ARP;
-	int ret = net_ethernet_add_header(skb, content->dip);
-	if(ret <= 0){
+	if(skb == NULL){
 		return;
 	}
+	skb_reserve(skb, SKB_HEADROOM);
+
+	skb->proto = ARP;
+	uint32_t dip = content->dip;
 
 	ARP_HTONS(hdr);
 	ARPC_HTONL(content);
 
-	memcpy(skb->data, hdr, sizeof(struct arp_header));
-	skb->data += sizeof(struct arp_header);
-	skb->len += sizeof(struct arp_header);
+	memcpy(skb_put(skb, sizeof(struct arp_header)), hdr, sizeof(struct arp_header));
+	memcpy(skb_put(skb, sizeof(struct arp_content)), content, sizeof(struct arp_content));
 
-	memcpy(skb->data, content, sizeof(struct arp_content));
-	skb->data += sizeof(struct arp_content);
-	skb->len += sizeof(struct arp_content);
+	int ret = net_ethernet_add_header(skb, dip);
+	if(ret <= 0){
+		skb_free(skb);
+		return;
+	}
 
 	net_send_skb(skb);
 	
@@ -178,7 +180,7 @@ int8_t arp_parse(struct sk_buff* skb)
 {
 	struct arp_header* a_hdr = (struct arp_header*) skb->data;
 	skb->hdr.arp = a_hdr;
-	skb->data = skb->data + sizeof(struct arp_header);
+	skb_pull(skb, sizeof(struct arp_header));
 
 	ARP_NTOHS(a_hdr);
 
@@ -0,0 +1,168 @@
+/**
+ * @file checksum.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Internet checksum used by all protocols.
+ * Data is summed 32 bits at a time into a 64 bit accumulator, which the
+ * compiler turns into add with carry pairs, and the carries are folded
+ * back in at the end. Since 2^16 and 2^32 are both 1 modulo 0xffff this
+ * gives the same result as the RFC 1071 16 bit loop in half the iterations.
+ * @version 0.1
+ * @date 2024-02-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <net/checksum.h>
+#include <net/utils.h>
+
+/* Packet headers are read through these, whatever type they were written as. */
+typedef uint32_t __attribute__((__may_alias__)) __csum_u32;
+typedef uint16_t __attribute__((__may_alias__)) __csum_u16;
+
+static inline uint32_t __fold64(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	return (uint32_t) sum;
+}
+
+/**
+ * @brief Adds len bytes at buf to the partial sum.
+ * @return uint32_t new partial sum, finish with csum_fold().
+ */
+uint32_t csum_partial(const void* buf, int len, uint32_t sum)
+{
+	const uint8_t* ptr = buf;
+	uint64_t acc = sum;
+
+	while(len >= 16){
+		const __csum_u32* words = (const __csum_u32*) ptr;
+		acc += (uint64_t) words[0];
+		acc += (uint64_t) words[1];
+		acc += (uint64_t) words[2];
+		acc += (uint64_t) words[3];
+		ptr += 16;
+		len -= 16;
+	}
+
+	while(len >= 4){
+		acc += *(const __csum_u32*) ptr;
+		ptr += 4;
+		len -= 4;
+	}
+
+	if(len >= 2){
+		acc += *(const __csum_u16*) ptr;
+		ptr += 2;
+		len -= 2;
+	}
+
+	/* Left-over byte is the first byte of a zero padded word */
+	if(len > 0){
+		acc += *ptr;
+	}
+
+	return __fold64(acc);
+}
+
+/**
+ * @brief Copies len bytes from src to dst and adds them to the partial sum.
+ * Used to checksum payloads while they are copied into the packet buffer.
+ * @return uint32_t new partial sum, finish with csum_fold().
+ */
+uint32_t csum_partial_copy(void* dst, const void* src, int len, uint32_t sum)
+{
+	const uint8_t* from = src;
+	uint8_t* to = dst;
+	uint64_t acc = sum;
+
+	while(len >= 16){
+		const __csum_u32* in = (const __csum_u32*) from;
+		__csum_u32* out = (__csum_u32*) to;
+		uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+		out[0] = a;
+		out[1] = b;
+		out[2] = c;
+		out[3] = d;
+		acc += (uint64_t) a;
+		acc += (uint64_t) b;
+		acc += (uint64_t) c;
+		acc += (uint64_t) d;
+		from += 16;
+		to += 16;
+		len -= 16;
+	}
+
+	while(len >= 4){
+		uint32_t a = *(const __csum_u32*) from;
+		*(__csum_u32*) to = a;
+		acc += a;
+		from += 4;
+		to += 4;
+		len -= 4;
+	}
+
+	if(len >= 2){
+		uint16_t a = *(const __csum_u16*) from;
+		*(__csum_u16*) to = a;
+		acc += a;
+		from += 2;
+		to += 2;
+		len -= 2;
+	}
+
+	if(len > 0){
+		*to = *from;
+		acc += *from;
+	}
+
+	return __fold64(acc);
+}
+
+/**
+ * @brief Folds a partial sum to 16 bits and complements it.
+ */
+uint16_t csum_fold(uint32_t sum)
+{
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t) ~sum;
+}
+
+uint32_t csum_pseudo(uint32_t saddr, uint32_t daddr, uint8_t proto, uint16_t len, uint32_t sum)
+{
+	uint64_t acc = (uint64_t) sum + saddr + daddr + htons(proto) + htons(len);
+	return __fold64(acc);
+}
+
+/**
+ * @brief Incrementally updates a checksum, HC' = ~(~HC + ~m + m').
+ * @param check checksum as stored in the header
+ * @param old previous value of the changed word, as stored in memory
+ * @param updated new value of the changed word, as stored in memory
+ * @return uint16_t updated checksum.
+ */
+uint16_t csum_update16(uint16_t check, uint16_t old, uint16_t updated)
+{
+	uint32_t sum = (uint16_t) ~check;
+	sum += (uint16_t) ~old;
+	sum += updated;
+	return csum_fold(sum);
+}
+
+uint16_t checksum(void *addr, int count, int start_sum)
+{
+	return csum_fold(csum_partial(addr, count, (uint32_t) start_sum));
+}
+
+/**
+ * @brief Checksum of a UDP or TCP packet including the pseudo header.
+ * @param saddr source address, host byte order
+ * @param daddr destination address, host byte order
+ * @param len packet length, network byte order
+ */
+uint16_t transport_checksum(uint32_t saddr, uint32_t daddr, uint8_t proto, uint8_t *data, uint16_t len)
+{
+	uint32_t sum = csum_pseudo(htonl(saddr), htonl(daddr), proto, ntohs(len), 0);
+	return checksum(data, ntohs(len), sum);
+}
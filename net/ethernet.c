@@ -23,19 +23,23 @@ static void net_ethernet_print(struct ethernet_header* hdr)
     dbgprintf("Ethernet Source: %x %x %x %x %x %x\n", hdr->smac[0], hdr->smac[1], hdr->smac[2], hdr->smac[3], hdr->smac[4], hdr->smac[5]);
 }
 
+/**
+ * @brief Pushes the ethernet header in front of the packet.
+ * @param skb skb with the network layer packet at skb->data
+ * @param ip next hop (in network byte order)
+ * @return int 0 on success, negative if the next hop has no ARP entry.
+ */
 int net_ethernet_add_header(struct sk_buff* skb, uint32_t ip)
 {
-    skb->len += ETHER_HDR_LENGTH;
-    struct ethernet_header e_hdr = {
-        .ethertype = htons(skb->proto)
-    };
-
-    int ret = net_arp_find_entry(ntohl(ip), (uint8_t*)&e_hdr.dmac);
+    uint8_t dmac[6];
+    int ret = net_arp_find_entry(ntohl(ip), dmac);
     if(ret < 0) return ret;
 
-    memcpy(&e_hdr.smac, skb->interface->device->mac, 6);
-    memcpy(skb->data, &e_hdr, ETHER_HDR_LENGTH);
-    skb->data += ETHER_HDR_LENGTH;
+    struct ethernet_header* e_hdr = (struct ethernet_header*) skb_push(skb, ETHER_HDR_LENGTH);
+    memcpy(e_hdr->dmac, dmac, 6);
+    memcpy(e_hdr->smac, skb->interface->device->mac, 6);
+    e_hdr->ethertype = htons(skb->proto);
+    skb->hdr.eth = e_hdr;
 
     //net_ethernet_print(&e_hdr);
 
@@ -50,7 +54,7 @@ int8_t net_ethernet_parse(struct sk_buff* skb)
     header->ethertype = ntohs(header->ethertype);
 
     skb->hdr.eth = header;
-    skb->data += ETHER_HDR_LENGTH;
+    skb_pull(skb, ETHER_HDR_LENGTH);
 
     uint8_t broadcastmac[] = {255, 255, 255, 255, 255, 255};
     if(memcmp(header->dmac, skb->interface->device->mac, 6) == 0 || memcmp(skb->hdr.eth->dmac, (uint8_t*)&broadcastmac, 6) == 0){
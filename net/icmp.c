@@ -21,24 +21,28 @@ void net_icmp_handle(struct sk_buff* skb)
         return;
     dbgprintf("Ping reply from %i: icmp_seq= %d ttl=64\n", skb->hdr.ip->saddr, skb->hdr.icmp->sequence/256);
 
-    skb->hdr.icmp->type = ICMP_REPLY;
-    skb->hdr.icmp->csum = 0;
-    skb->hdr.icmp->csum = checksum(skb->hdr.icmp, skb->len, 0);
+    /* The reply echoes the request, header and payload back in wire order. */
+    int len = sizeof(struct icmp) + skb->len;
+    if(len > SKB_DATA_SIZE - SKB_HEADROOM)
+        return;
 
-    struct icmp response;
-    memcpy(&response, &skb->hdr.icmp, sizeof(struct icmp));
+    /* Only the type changes, so the checksum is updated instead of recomputed over the payload. */
+    struct icmp* icmp = skb->hdr.icmp;
+    ICMP_NTOHS(icmp);
+    uint16_t old = icmp->type | icmp->code << 8;
+    icmp->type = ICMP_REPLY;
+    icmp->csum = csum_update16(icmp->csum, old, icmp->type | icmp->code << 8);
 
     struct sk_buff* _skb = skb_new();
+    if(_skb == NULL) return;
+    skb_reserve(_skb, SKB_HEADROOM);
+
+    memcpy(skb_put(_skb, len), skb->hdr.icmp, len);
 
-    if(net_ipv4_add_header(_skb, skb->hdr.ip->saddr, ICMPV4, sizeof(struct icmp)) < 0){
+    if(net_ipv4_add_header(_skb, skb->hdr.ip->saddr, ICMPV4) < 0){
         skb_free(_skb);
 	    return;
     }
-
-    memcpy(_skb->data, &response, sizeof(struct icmp));
-
-	_skb->len += sizeof(struct icmp);
-	_skb->data += sizeof(struct icmp);
 	
 	net_send_skb(_skb);
 }  
@@ -51,6 +55,8 @@ int net_icmp_response()
 int net_icmp_request(uint32_t ip)
 {
     struct sk_buff* skb = skb_new();
+    ERR_ON_NULL(skb);
+    skb_reserve(skb, SKB_HEADROOM);
 
     struct icmp ping = {
         .type = ICMP_V4_ECHO,
@@ -60,18 +66,15 @@ int net_icmp_request(uint32_t ip)
         .csum = 0
     };
 
-    if(net_ipv4_add_header(skb, ip, ICMPV4, sizeof(struct icmp)) < 0){
-        skb_free(skb);
-		return -1;
-    }
-
     ICMP_NTOHS(&ping);
     ping.csum = checksum(&ping, sizeof(struct icmp), 0);
 
-    memcpy(skb->data, &ping, sizeof(struct icmp));
+    memcpy(skb_put(skb, sizeof(struct icmp)), &ping, sizeof(struct icmp));
 
-	skb->len += sizeof(struct icmp);
-	skb->data += sizeof(struct icmp);
+    if(net_ipv4_add_header(skb, ip, ICMPV4) < 0){
+        skb_free(skb);
+		return -1;
+    }
 	
 	net_send_skb(skb);
 
@@ -97,13 +100,13 @@ int net_icmp_parse(struct sk_buff* skb)
 {
     struct icmp* icmp_hdr = (struct icmp * ) skb->data;
     skb->hdr.icmp = icmp_hdr;
-    skb->data = skb->data + sizeof(struct icmp);
 
     // calculate checksum, should be 0.
     uint16_t csum_icmp = checksum(icmp_hdr, skb->len, 0);
     if( 0 != csum_icmp){
         return -1;
     }
+    skb_pull(skb, sizeof(struct icmp));
     ICMP_HTONS(icmp_hdr);
 
     return 0;
@@ -47,15 +47,14 @@ int net_ipv4_print(struct ip_header* hdr)
 }
 
 /**
- * @brief Creates and attaches IP header to SKB
+ * @brief Pushes the IP and ethernet headers in front of the packet.
  * 
- * @param skb skb to modify
+ * @param skb skb with the transport packet at skb->data
  * @param ip destination IP (in host byte order)
  * @param proto TCP / UDP
- * @param length length of message.
  * @return int 
  */
-int net_ipv4_add_header(struct sk_buff* skb, uint32_t ip, uint8_t proto, uint32_t length)
+int net_ipv4_add_header(struct sk_buff* skb, uint32_t ip, uint8_t proto)
 {
     /* Setup interface */
     uint32_t next_hop = route(ip);
@@ -70,7 +69,7 @@ int net_ipv4_add_header(struct sk_buff* skb, uint32_t ip, uint8_t proto, uint32_
         .version = IPV4,
         .ihl = 0x05,
         .tos = 0,
-        .len = length+hdr.ihl*4,
+        .len = skb->len+hdr.ihl*4,
         .frag_offset = 0x4000,
         .ttl = 64,
         .proto = proto,
@@ -84,6 +83,10 @@ int net_ipv4_add_header(struct sk_buff* skb, uint32_t ip, uint8_t proto, uint32_
 
     skb->proto = IP;
 
+    /* Add IP header to packet */
+    skb->hdr.ip = (struct ip_header*) skb_push(skb, hdr.ihl * 4);
+    memcpy(skb->hdr.ip, &hdr, sizeof(struct ip_header));
+
     /* Add ethernet header */
 	int ret = net_ethernet_add_header(skb, next_hop);
 	if(ret < 0){
@@ -91,12 +94,6 @@ int net_ipv4_add_header(struct sk_buff* skb, uint32_t ip, uint8_t proto, uint32_
 		return ret;
 	}
 
-    /* Add IP header to packet */
-    memcpy(skb->data, &hdr, sizeof(struct ip_header));
-    skb->hdr.ip = (struct ip_header*) skb->data;
-    skb->len += hdr.ihl * 4;
-    skb->data += hdr.ihl * 4;
-
     dbgprintf("Added IPv4 header.\n");
 
     return 0;
@@ -143,7 +140,12 @@ int net_ipv4_parse(struct sk_buff* skb)
     }
 
     IP_NTOHL(hdr);
-    skb->data = skb->data+hdr_len;
+    if(hdr->len < hdr_len || hdr->len > skb->len){
+        dbgprintf("Invalid IPv4 length %d\n", hdr->len);
+        return -1;
+    }
+    skb_pull(skb, hdr_len);
+    skb_trim(skb, hdr->len - hdr_len);
     net_ipv4_print(hdr);
 
     if(BROADCAST_IP != ntohl(skb->hdr.ip->daddr) && ntohl(skb->hdr.ip->daddr) != (uint32_t)skb->interface->ip){
@@ -158,8 +160,7 @@ int net_ipv4_parse(struct sk_buff* skb)
             .sip = ntohl(hdr->saddr)
         };
 
-        struct ethernet_header* ehdr= (struct ethernet_header*) skb->head;
-        memcpy(&content.smac, ehdr->smac, 6);
+        memcpy(&content.smac, skb->hdr.eth->smac, 6);
 
         net_arp_add_entry(&content);
     }
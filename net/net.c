@@ -16,6 +16,7 @@
 #include <assert.h>
 #include <scheduler.h>
 #include <errors.h>
+#include <timer.h>
 
 /**
  * @brief Binds a IP and Port to a socket, mainly used for the server side.
@@ -83,18 +84,25 @@ error_t kernel_recv(struct sock* socket, void *buffer, int length, int flags)
     return read;
 }
 
+/**
+ * @brief Recieve on socket with a timeout.
+ * The calling pcb sleeps on the timer wheel until data arrives or the timeout expires.
+ * @param socket Socket to read from
+ * @param buffer Buffer to copy data into
+ * @param length Max length to copy.
+ * @param flags flags..
+ * @param timeout timeout in seconds.
+ * @return int bytes read, 0 on timeout.
+ */
 error_t kernel_recv_timeout(struct sock* socket, void *buffer, int length, int flags, int timeout)
 {
-    int time_start = get_time();
-
-    int read = -1;
-    while(read == -1){
-        if(get_time() - time_start > timeout+3)return 0;
-
+    wait_event_timeout(&socket->wait, net_sock_data_ready(socket, length), timeout*TIMER_HZ);
+    if(!net_sock_data_ready(socket, length)){
+        dbgprintf(" [%d] Recv timed out\n", socket);
+        return 0;
     }
 
-    return read;
-
+    return net_sock_read(socket, buffer, length);
 }
 
 error_t kernel_connect(struct sock* socket, const struct sockaddr *address, socklen_t address_len)
@@ -113,18 +121,16 @@ error_t kernel_connect(struct sock* socket, const struct sockaddr *address, sock
     memcpy(sptr, addr, sizeof(struct sockaddr_in));
 
     socket->tcp->state = TCP_SYN_SENT;
+    net_sock_hash_connection(socket);
     tcp_connect(socket);
 
     dbgprintf(" [%d] Connecting...\n", socket);
-    /* block or spin */
-
-    int time_start = get_time();
-    while(socket->tcp->state != TCP_ESTABLISHED){
-        if(get_time() - time_start > 2){
-            dbgprintf(" [%d] Connection timed out\n", socket);
-            return -1;
-        }
-        kernel_yield();
+
+    /* Sleep until the SYN/ACK wakes us up or the timeout expires. */
+    wait_event_timeout(&socket->wait, socket->tcp->state == TCP_ESTABLISHED, NET_CONNECT_TIMEOUT);
+    if(socket->tcp->state != TCP_ESTABLISHED){
+        dbgprintf(" [%d] Connection timed out\n", socket);
+        return -1;
     }
 
     dbgprintf(" [%d] succesfully connected!\n", socket);
@@ -218,38 +224,22 @@ struct sock* kernel_accept(struct sock* socket, struct sockaddr *address, sockle
 error_t kernel_listen(struct sock* socket, int backlog)
 {
     tcp_new_connection(socket, 0, socket->bound_port);
+    net_sock_hash_listen(socket);
     return tcp_set_listening(socket, backlog);
 }
 
 error_t kernel_send(struct sock* socket, void *message, int length, int flags)
 {
-    /* for the time being, only send messages under 1500 bytes */
-    if(length > 1400){
-        return -ERROR_MSS_SIZE;
-    }
-
-    if(socket == NULL || (socket->tcp == NULL && socket->tcp->state == TCP_CLOSED)){
+    if(socket == NULL || socket->tcp == NULL || socket->tcp->state == TCP_CLOSED){
         return -ERROR_INVALID_SOCKET;
     }
 
+    wait_event(&socket->wait, net_sock_is_established(socket) || socket->tcp->state == TCP_CLOSED);
+
     /**
-     * This should not be done by the process calling this function. 
-     * Instead by another process, perhaps the worker thread.
-     * Or simply start a async function. The original thread should simply 
-     * block / spin and be notified when data has been sent.
-     * 
-     * Currently we only accept tiny messages so this is not needed yet...
+     * The data is copied into the connections send buffer and segmented by TCP,
+     * we only block while the send buffer is full, not until the data is acked.
      */
-    WAIT(!net_sock_is_established(socket));
-    
-    /* TODO: if message was bigger than 1400, send 1400 at a time, simple stop and wait. */
     dbgprintf(" [%d] Sending %d bytes\n", socket->socket, length);
-    socket->tcp->state = TCP_WAIT_ACK;
-    tcp_send_segment(socket, message, length, 1);
-
-    /* Move this into tcp_send_segment */
-    //WAIT(net_sock_awaiting_ack(socket));
-
-    /* Split into smaller "messages" of needed. */
-    return length;
+    return tcp_send(socket, message, length);
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include <serial.h>
 #include <sync.h>
 #include <assert.h>
+#include <kutils.h>
 
 static int __skb_queue_add(struct skb_queue* skb_queue, struct sk_buff* skb);
 static struct sk_buff* __skb_queue_remove(struct skb_queue* skb_queue);
@@ -21,6 +22,29 @@ struct skb_queue_operations skb_queue_ops = {
 	.remove = &__skb_queue_remove
 };
 
+/* Every packet allocates a skb and a packet buffer, both are served from slab caches. */
+static struct kmem_cache* __skb_cache = NULL;
+static struct kmem_cache* __skb_data_cache = NULL;
+
+static void __skb_init_caches()
+{
+	__skb_cache = kmem_cache_create("skb", sizeof(struct sk_buff));
+	__skb_data_cache = kmem_cache_create("skb data", SKB_DATA_SIZE);
+	assert(__skb_cache != NULL && __skb_data_cache != NULL);
+	skb_cache_reserve(SKB_RX_RESERVE);
+}
+EXPORT_KCTOR(__skb_init_caches);
+
+/**
+ * @brief Keeps count skbs and packet buffers free for drivers receiving in interrupt context.
+ * Must be called from thread context, netd refills the caches every round.
+ */
+void skb_cache_reserve(int count)
+{
+	kmem_cache_reserve(__skb_cache, count);
+	kmem_cache_reserve(__skb_data_cache, count);
+}
+
 
 void skb_free_queue(struct skb_queue* queue)
 {
@@ -96,18 +120,84 @@ static struct sk_buff* __skb_queue_remove(struct skb_queue* skb_queue)
 
 void skb_free(struct sk_buff* skb)
 {
-	FREE_SKB(skb);
-	kfree(skb);
+	if(skb->head != NULL){
+		kmem_cache_free(__skb_data_cache, skb->head);
+	}
+	skb->len = -1;
+	skb->head = NULL;
+
+	kmem_cache_free(__skb_cache, skb);
 }
 
+/**
+ * @brief Allocates a skb with an empty packet buffer.
+ * The buffer is not cleared, each layer writes every byte it sends.
+ * Senders skb_reserve() SKB_HEADROOM before adding the payload.
+ */
 struct sk_buff* skb_new()
 {
-	struct sk_buff* new = (struct sk_buff*) kalloc(sizeof(struct sk_buff));
+	struct sk_buff* new = kmem_cache_alloc(__skb_cache);
+	if(new == NULL) return NULL;
+
+	memset(new, 0, sizeof(struct sk_buff));
+	new->netdevice = &current_netdev;
+
+	new->data = kmem_cache_alloc(__skb_data_cache);
+	if(new->data == NULL){
+		kmem_cache_free(__skb_cache, new);
+		return NULL;
+	}
+
+	new->head = new->data;
+	new->tail = new->head;
+	new->end = new->head+SKB_DATA_SIZE;
+	new->len = 0;
+
+	return new;
+}
+
+/**
+ * @brief Allocates a packet buffer without a skb.
+ * Used by drivers which DMA straight into packet buffers and later
+ * hand the buffer over with skb_new_from_data().
+ */
+uint8_t* skb_alloc_data()
+{
+	return kmem_cache_alloc(__skb_data_cache);
+}
+
+/* Same as skb_alloc_data(), but only takes reserved buffers, safe in interrupt context. */
+uint8_t* skb_alloc_data_atomic()
+{
+	return kmem_cache_alloc_atomic(__skb_data_cache);
+}
+
+void skb_free_data(uint8_t* data)
+{
+	kmem_cache_free(__skb_data_cache, data);
+}
+
+/**
+ * @brief Wraps a filled packet buffer in a new skb, without copying it.
+ * The skb owns the buffer and frees it with skb_free().
+ * Only takes reserved skbs, so drivers can call it from interrupt context.
+ * @param data buffer from skb_alloc_data()
+ * @param len bytes of packet data in the buffer
+ * @return struct sk_buff*, NULL on failure.
+ */
+struct sk_buff* skb_new_from_data(uint8_t* data, int len)
+{
+	struct sk_buff* new = kmem_cache_alloc_atomic(__skb_cache);
 	if(new == NULL) return NULL;
 
 	memset(new, 0, sizeof(struct sk_buff));
 	new->netdevice = &current_netdev;
-	ALLOCATE_SKB(new);
+
+	new->head = data;
+	new->data = data;
+	new->tail = data + len;
+	new->end = data + SKB_DATA_SIZE;
+	new->len = len;
 
 	return new;
 }
@@ -120,10 +210,11 @@ struct sk_buff* skb_new()
  */
 struct sk_buff* skb_consume(struct sk_buff* skb)
 {
-	struct sk_buff* new = create(struct sk_buff);
+	struct sk_buff* new = kmem_cache_alloc(__skb_cache);
+	if(new == NULL) return NULL;
 
 	memcpy(new, skb, sizeof(struct sk_buff));
-	kfree(skb);
+	kmem_cache_free(__skb_cache, skb);
 
 	return new;
 }
\ No newline at end of file
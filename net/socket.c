@@ -26,6 +26,10 @@ static struct sock** socket_table;
 static int total_sockets;
 static bitmap_t port_map;
 static bitmap_t socket_map;
+/* Ephemeral ports are handed out round robin. */
+static int port_hint = 0;
+/* Incoming packets are matched to sockets through these tables */
+static struct sock_hash sock_hash;
 
 static const char* socket_type_str[] = {
     "SOCK",
@@ -72,13 +76,36 @@ const char* socket_protocol_to_str(int protocol){
 
 inline static unsigned short __get_free_port()
 {
-    return ntohs(get_free_bitmap(port_map, NET_NUMBER_OF_DYMANIC_PORTS) + NET_DYNAMIC_PORT_START);
+    return ntohs(bitmap_get_free_next(port_map, NET_NUMBER_OF_DYMANIC_PORTS, &port_hint) + NET_DYNAMIC_PORT_START);
 }
 
 void net_sock_bind(struct sock* socket, unsigned short port, unsigned int ip)
 {
     socket->bound_ip = ip;
     socket->bound_port = port == 0 ? __get_free_port() : port;
+
+    if(socket->type == SOCK_DGRAM){
+        CRITICAL_SECTION({
+            sock_hash_add_udp(&sock_hash, &socket->hash, socket, socket->bound_port, socket->bound_ip);
+        });
+    }
+}
+
+/**
+ * @brief Hashes a TCP socket on its 4-tuple, needs bound_port and recv_addr.
+ */
+void net_sock_hash_connection(struct sock* sock)
+{
+    CRITICAL_SECTION({
+        sock_hash_add_conn(&sock_hash, &sock->hash, sock, sock->bound_port, sock->recv_addr.sin_port, ntohl(sock->recv_addr.sin_addr.s_addr));
+    });
+}
+
+void net_sock_hash_listen(struct sock* sock)
+{
+    CRITICAL_SECTION({
+        sock_hash_add_listen(&sock_hash, &sock->hash, sock, sock->bound_port);
+    });
 }
 
 /* Currently deprecated */
@@ -107,11 +134,7 @@ error_t net_sock_read(struct sock* sock, uint8_t* buffer, unsigned int length)
 {
 	dbgprintf(" [SOCK] Waiting for data... %d\n", sock);
 	/* Should be blocking */
-    while(!net_sock_data_ready(sock, length)){
-        sock->waiting = $process->current;
-        $process->current->state = BLOCKED;
-	    kernel_yield();
-    }
+    wait_event(&sock->wait, net_sock_data_ready(sock, length));
     
     if(sock->data_ready == -1){
         dbgprintf(" [SOCK] Socket closed!\n");
@@ -162,12 +185,7 @@ static inline error_t net_sock_add_data_segment(struct sock* sock, struct sk_buf
     sock->recvd += skb->data_len;
     sock->data_ready = sock->tcp == NULL ? 1 : skb->hdr.tcp->psh;
 
-    if(sock->waiting->state == BLOCKED){
-        /* need to clear waiting before setting it to run */
-        volatile struct pcb* pcb = sock->waiting;
-        sock->waiting = NULL;
-        pcb->state = RUNNING;
-    }
+    wake_up_all(&sock->wait);
 
     sock->rx += skb->data_len;
 
@@ -229,13 +247,6 @@ error_t net_sock_is_established(struct sock* sk)
     return sk->tcp->state == TCP_ESTABLISHED;
 }
 
-/* returns true if socket is waiting for an ack */
-error_t net_sock_awaiting_ack(struct sock* sk)
-{
-    assert(sk->tcp != NULL);
-    return sk->tcp->state == TCP_WAIT_ACK;
-}
-
 error_t net_sock_data_ready(struct sock* sk, unsigned int length)
 {
     assert(sk != NULL);
@@ -244,59 +255,39 @@ error_t net_sock_data_ready(struct sock* sk, unsigned int length)
 
 struct sock* sock_find_listen_tcp(uint16_t d_port)
 {
-    for (int i = 0; i < NET_NUMBER_OF_SOCKETS; i++){   
-        if(socket_table[i] == NULL || socket_table[i]->tcp == NULL)
-            continue;
+    struct sock* sk;
 
-        if(socket_table[i]->bound_port == d_port &&  socket_table[i]->tcp->state == TCP_LISTEN)
-            return socket_table[i];
-    }
+    ENTER_CRITICAL();
+    sk = sock_hash_find_listen(&sock_hash, d_port);
+    LEAVE_CRITICAL();
 
-    return NULL;
-}
+    if(sk == NULL || sk->tcp == NULL || sk->tcp->state != TCP_LISTEN)
+        return NULL;
 
+    return sk;
+}
 
+/**
+ * @brief Finds the socket for an incoming TCP segment.
+ * Connected sockets are looked up on their 4-tuple, segments without a
+ * connection go to the socket listening on the destination port.
+ */
 struct sock* net_sock_find_tcp(uint16_t s_port, uint16_t d_port, uint32_t ip)
 {
-    //dbgprintf("[TCP] Looking for socket destintation %d: source %d\n", htons(d_port), htons(s_port));
-    struct sock* _sk = NULL; /* save listen socket incase no established connection is found. */
-
-    for (int i = 0; i < NET_NUMBER_OF_SOCKETS; i++){
-        if(socket_table[i] == NULL || socket_table[i]->tcp == NULL)
-            continue;
-
-    //    dbgprintf("[TCP] %s (%i:%d %i:%d) %s\n",
-    //         socket_table[i]->owner->name,
-    //         ntohl(socket_table[i]->recv_addr.sin_addr.s_addr), htons(socket_table[i]->recv_addr.sin_port),
-    //         htons(socket_table[i]->bound_ip), htons(socket_table[i]->bound_port),
-    //         tcp_state_to_str(socket_table[i]->tcp->state)); 
-    }
-    
-    for (int i = 0; i < NET_NUMBER_OF_SOCKETS; i++){
-        if(socket_table[i] == NULL || socket_table[i]->tcp == NULL)
-            continue;
+    struct sock* sk;
 
-        
-        if(socket_table[i]->bound_port == d_port && (socket_table[i]->tcp->state == TCP_LISTEN || socket_table[i]->tcp->state == TCP_SYN_RCVD)){
-            _sk = socket_table[i];
+    ENTER_CRITICAL();
+    sk = sock_hash_find_conn(&sock_hash, d_port, s_port, ip);
+    /* Accepted sockets are hashed before they are ready, until then the listener handles them. */
+    if(sk == NULL || sk->tcp == NULL || sk->tcp->state == TCP_PREPARE){
+        sk = sock_hash_find_listen(&sock_hash, d_port);
+        if(sk != NULL && (sk->tcp == NULL || (sk->tcp->state != TCP_LISTEN && sk->tcp->state != TCP_SYN_RCVD))){
+            sk = NULL;
         }
-
-        if(socket_table[i]->bound_port == d_port && socket_table[i]->recv_addr.sin_port == s_port
-            && socket_table[i]->tcp->state != TCP_LISTEN
-            && socket_table[i]->tcp->state != TCP_SYN_RCVD
-            && socket_table[i]->tcp->state != TCP_PREPARE
-            && ntohl(socket_table[i]->recv_addr.sin_addr.s_addr) == ip
-            //&& (socket_table[i]->tcp->state == TCP_ESTABLISHED || socket_table[i]->tcp->state == TCP_SYN_SENT)
-            ){
-                //dbgprintf("[TCP] Found socket %d\n", i);
-                return socket_table[i];
-            }
     }
+    LEAVE_CRITICAL();
 
-    if(_sk != NULL){
-        //dbgprintf("[TCP] Found socket %d\n", _sk->socket);
-    }
-    return _sk;
+    return sk;
 }
 
 int net_prepare_tcp_sock(struct sock* sock, uint16_t port, struct sockaddr_in* addr)
@@ -313,6 +304,7 @@ int net_prepare_tcp_sock(struct sock* sock, uint16_t port, struct sockaddr_in* a
         return -1;
     }
     sock->tcp->state = TCP_PREPARE;
+    net_sock_hash_connection(sock);
     return 0;
 }
 
@@ -322,17 +314,14 @@ int net_sock_accept(struct sock* sock, struct sock* new)
 }
 
 struct sock* net_socket_find_udp(uint32_t ip, uint16_t port) 
-{   
-    /* Interate over sockets and add packet if socket exists with matching port and IP */
-    for (int i = 0; i < NET_NUMBER_OF_SOCKETS; i++){
-        if(socket_table[i] == NULL)
-            continue;
-
-        if(socket_table[i]->bound_port == htons(port) && (socket_table[i]->bound_ip == ip || socket_table[i]->bound_ip == INADDR_ANY)) {
-            return socket_table[i];
-        }
-    }
-    return NULL;
+{
+    struct sock* sk;
+
+    ENTER_CRITICAL();
+    sk = sock_hash_find_udp(&sock_hash, htons(port), ip);
+    LEAVE_CRITICAL();
+
+    return sk;
 }
 
 void kernel_sock_shutdown(struct sock* socket, int how)
@@ -344,6 +333,10 @@ void kernel_sock_shutdown(struct sock* socket, int how)
 
 void kernel_sock_cleanup(struct sock* socket)
 {
+    CRITICAL_SECTION({
+        sock_hash_remove(&socket->hash);
+    });
+
     tcp_free_connection(socket);
 
     while(SKB_QUEUE_READY(socket->skb_queue)){
@@ -353,6 +346,7 @@ void kernel_sock_cleanup(struct sock* socket)
 
     skb_free_queue(socket->skb_queue);
     rbuffer_free(socket->recv_buffer);
+    wait_queue_free(&socket->wait);
 
     kfree((void*) socket);
     unset_bitmap(socket_map, (int)socket->socket);
@@ -431,7 +425,7 @@ struct sock* kernel_socket_create(int domain, int type, int protocol)
         return NULL;
     }
 
-    socket_table[current]->waiting = NULL;
+    wait_queue_init(&(socket_table[current]->wait));
     socket_table[current]->accept_sock = NULL;
 
     socket_table[current]->owner = $process->current;
@@ -453,4 +447,5 @@ void net_init_sockets()
     port_map = create_bitmap(NET_NUMBER_OF_DYMANIC_PORTS);
     socket_map = create_bitmap(NET_NUMBER_OF_SOCKETS);
     total_sockets = 0;
+    memset(&sock_hash, 0, sizeof(sock_hash));
 }
\ No newline at end of file
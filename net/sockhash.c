@@ -0,0 +1,123 @@
+/**
+ * @file sockhash.c
+ * @author Joe Bayer (joexbayer)
+ * @brief Socket demultiplexing tables.
+ * Incoming segments are matched to sockets through hash tables instead of
+ * scanning the socket table, keeping the lookup cost flat as sockets are added.
+ * @version 0.1
+ * @date 2024-02-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include <net/sockhash.h>
+#include <lib/net.h>
+#include <libc.h>
+
+/* Multiplicative hash, the top bits are the best mixed. */
+#define SOCK_HASH_BITS(size) (__builtin_ctz(size))
+static inline uint32_t __hash(uint32_t key, int size)
+{
+	return (key * 2654435761u) >> (32 - SOCK_HASH_BITS(size));
+}
+
+static inline uint32_t __conn_hash(uint16_t lport, uint16_t rport, uint32_t ip)
+{
+	return __hash(ip ^ ((uint32_t)lport << 16 | rport), SOCK_HASH_CONN_SIZE);
+}
+
+static void __insert(struct sock_hash_node** bucket, struct sock_hash_node* node)
+{
+	node->next = *bucket;
+	if(node->next != NULL) node->next->pprev = &node->next;
+	node->pprev = bucket;
+	*bucket = node;
+}
+
+static void __set(struct sock_hash_node* node, struct sock* sock, uint16_t lport, uint16_t rport, uint32_t ip)
+{
+	node->sock = sock;
+	node->lport = lport;
+	node->rport = rport;
+	node->ip = ip;
+}
+
+void sock_hash_add_conn(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t lport, uint16_t rport, uint32_t ip)
+{
+	sock_hash_remove(node);
+	__set(node, sock, lport, rport, ip);
+	__insert(&hash->conn[__conn_hash(lport, rport, ip)], node);
+}
+
+void sock_hash_add_listen(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t port)
+{
+	sock_hash_remove(node);
+	__set(node, sock, port, 0, 0);
+	__insert(&hash->listen[__hash(port, SOCK_HASH_PORT_SIZE)], node);
+}
+
+void sock_hash_add_udp(struct sock_hash* hash, struct sock_hash_node* node, struct sock* sock, uint16_t port, uint32_t ip)
+{
+	sock_hash_remove(node);
+	__set(node, sock, port, 0, ip);
+	__insert(&hash->udp[__hash(port, SOCK_HASH_PORT_SIZE)], node);
+}
+
+/**
+ * @brief Unlinks node from whichever table it is in, does nothing if it is not hashed.
+ */
+void sock_hash_remove(struct sock_hash_node* node)
+{
+	if(node->pprev == NULL){
+		return;
+	}
+
+	*node->pprev = node->next;
+	if(node->next != NULL) node->next->pprev = node->pprev;
+
+	node->next = NULL;
+	node->pprev = NULL;
+}
+
+/**
+ * @brief Finds the connected socket for a 4-tuple.
+ * @param lport local port, network order
+ * @param rport remote port, network order
+ * @param ip remote address
+ * @return struct sock* socket, NULL if there is no connection.
+ */
+struct sock* sock_hash_find_conn(struct sock_hash* hash, uint16_t lport, uint16_t rport, uint32_t ip)
+{
+	struct sock_hash_node* node = hash->conn[__conn_hash(lport, rport, ip)];
+	for(; node != NULL; node = node->next){
+		if(node->lport == lport && node->rport == rport && node->ip == ip){
+			return node->sock;
+		}
+	}
+	return NULL;
+}
+
+struct sock* sock_hash_find_listen(struct sock_hash* hash, uint16_t port)
+{
+	struct sock_hash_node* node = hash->listen[__hash(port, SOCK_HASH_PORT_SIZE)];
+	for(; node != NULL; node = node->next){
+		if(node->lport == port){
+			return node->sock;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Finds the UDP socket bound to port on ip, or on any address.
+ */
+struct sock* sock_hash_find_udp(struct sock_hash* hash, uint16_t port, uint32_t ip)
+{
+	struct sock_hash_node* node = hash->udp[__hash(port, SOCK_HASH_PORT_SIZE)];
+	for(; node != NULL; node = node->next){
+		if(node->lport == port && (node->ip == ip || node->ip == INADDR_ANY)){
+			return node->sock;
+		}
+	}
+	return NULL;
+}
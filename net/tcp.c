@@ -29,15 +29,30 @@ static struct skb_queue* retry_queue = NULL;
 static struct tcp_manager {
 	struct tcb* tcbs[TCB_MAX];
 	int tcb_count;
+	mutex_t lock;
 } tcp_manager = {0};
 
+/* In flight segments are allocated from a slab cache */
+static struct kmem_cache* __segment_cache = NULL;
+
+/* Set by the RTO timers, netd retransmits for every TCB marked rto_expired */
+static volatile int __tcp_rto_pending = 0;
+
 /* Prototypes */
 static int tcp_state_machine(struct sk_buff* skb);
+static void __tcp_rto_expired(void* arg);
 
 int tcp_init()
 {
 	/* initialize the TCP manager */
 	tcp_manager.tcb_count = 0;
+	mutex_init(&tcp_manager.lock);
+
+	__segment_cache = kmem_cache_create("tcp segment", sizeof(struct tcp_segment));
+	if(__segment_cache == NULL){
+		dbgprintf("[TCP] Failed to create segment cache!\n");
+		return -1;
+	}
 
 	/* create the retry queue */
 	retry_queue = skb_new_queue();
@@ -113,53 +128,73 @@ struct tcb* tcb_new()
 		goto tcb_new_error;
 	}
 
-	tcb->sbuf = rbuffer_new(1024);
+	tcb->sbuf = kalloc(TCP_SEND_BUFFER);
 	if(tcb->sbuf == NULL){
 		dbgprintf("[TCP] Failed to allocate send buffer!\n");
 		goto tcb_new_error;
 	}
 
-	tcb->retransmit = skb_new_queue();
-	if(tcb->retransmit == NULL){
-		dbgprintf("[TCP] Failed to allocate retransmit queue!\n");
-		goto tcb_new_error;
-	}
+	tcb->retransmit = NULL;
+	tcb->retransmit_tail = NULL;
+	tcb->rto = TCP_RTO;
+	ktimer_init(&tcb->rto_timer, __tcp_rto_expired, tcb);
+	mutex_init(&tcb->lock);
+
 	/* register in manager */
+	acquire(&tcp_manager.lock);
 	tcp_manager.tcbs[tcp_manager.tcb_count++] = tcb;
+	release(&tcp_manager.lock);
 
 	tcb->state = TCP_CREATED;
 
 	return tcb;
 
 tcb_new_error:
-	if(tcb != NULL) kfree(tcb);
 	if(tcb != NULL && tcb->rbuf != NULL) rbuffer_free(tcb->rbuf);
-	if(tcb != NULL && tcb->sbuf != NULL) rbuffer_free(tcb->sbuf);
-	if(tcb != NULL && tcb->retransmit != NULL) skb_free_queue(tcb->retransmit);
+	if(tcb != NULL && tcb->sbuf != NULL) kfree(tcb->sbuf);
+	if(tcb != NULL) kfree(tcb);
 	return NULL;
 }
 
+/**
+ * @brief Unregisters and frees a TCB, dropping any unacknowledged data.
+ */
+void tcb_free(struct tcb* tcb)
+{
+	ktimer_del(&tcb->rto_timer);
+
+	acquire(&tcp_manager.lock);
+	for (int i = 0; i < tcp_manager.tcb_count; i++){
+		if(tcp_manager.tcbs[i] == tcb){
+			tcp_manager.tcbs[i] = tcp_manager.tcbs[--tcp_manager.tcb_count];
+			tcp_manager.tcbs[tcp_manager.tcb_count] = NULL;
+			break;
+		}
+	}
+	release(&tcp_manager.lock);
 
-#define IS_TCP_SOCKET(sock) (sock->type == SOCK_STREAM && sock->tcp != NULL)
+	while(tcb->retransmit != NULL){
+		struct tcp_segment* seg = tcb->retransmit;
+		tcb->retransmit = seg->next;
+		kmem_cache_free(__segment_cache, seg);
+	}
 
-#define TCP_BLOCK(sock)\
-	sock->waiting = $process->current;\
-	$process->current->state = BLOCKED;\
-	dbgprintf("[TCP] Blocking process %d on socket %d: CLI: %d\n", $process->current->pid, sock->socket, __cli_cnt);\
-	kernel_yield();
+	rbuffer_free(tcb->rbuf);
+	kfree(tcb->sbuf);
+	kfree(tcb);
+}
+
+
+#define IS_TCP_SOCKET(sock) (sock->type == SOCK_STREAM && sock->tcp != NULL)
 
 #define TCP_UNBLOCK(sock)\
-	if(sock->waiting != NULL){\
-		sock->waiting->state = RUNNING;\
-		sock->waiting = NULL;\
-	}
+	wake_up_all(&(sock)->wait);
 
 
 static const char* tcp_state_str[] = {
 	"TCP_CREATED",
 	"TCP_CLOSED",
 	"TCP_LISTEN",
-	"TCP_WAIT_ACK",
 	"TCP_SYN_RCVD",
 	"TCP_SYN_SENT",
 	"TCP_ESTABLISHED",
@@ -203,6 +238,9 @@ int tcp_new_connection(struct sock* sock, uint16_t dst_port, uint16_t src_port)
 int tcp_free_connection(struct sock* sock)
 {
 	/* TODO: check for active connections */
+	if(sock->tcp != NULL && sock->tcp->tcb != NULL){
+		tcb_free(sock->tcp->tcb);
+	}
 	kfree(sock->tcp);
 	sock->tcp = NULL;
 
@@ -228,45 +266,10 @@ inline int tcp_set_listening(struct sock* sock, int backlog)
 	return 1;
 }
 
-uint16_t tcp_calculate_checksum(uint32_t src_ip, uint32_t dest_ip, unsigned short *data, int size)
-{
-    register unsigned long sum = 0;
-    unsigned short tcpLen = size;
-    struct tcp_header *tcphdrp = (struct tcp_header*)(data);
-
-    /* the source ip */
-    sum += (src_ip>>16)&0xFFFF;
-    sum += (src_ip)&0xFFFF;
-    /* the dest ip */
-    sum += (dest_ip>>16)&0xFFFF;
-    sum += (dest_ip)&0xFFFF;
-    /* protocol and reserved: 6 */
-    sum += htons(TCP);
-    /* the length  */
-    sum += htons(tcpLen);
- 
-    /* add the IP payload */
-    /* initialize checksum to 0 */
-    tcphdrp->check = 0;
-    while (tcpLen > 1) {
-        sum += * data++;
-        tcpLen -= 2;
-    }
-    /* if any bytes left, pad the bytes and add */
-    if(tcpLen > 0) {
-        sum += ((*data)&htons(0xFF00));
-    }
-      /* Fold 32-bit sum to 16 bits: add carrier to result */
-      while (sum>>16) {
-          sum = (sum & 0xffff) + (sum >> 16);
-      }
-      sum = ~sum;
-
-	return sum;
-}
 /**
  * @brief Sends a TCP segment.
- * Function sends given data as a TCP segment.
+ * Function sends given data as a TCP segment. The payload is copied once
+ * into the skb and checksummed during the copy, the headers are pushed in front of it.
  * @warning Calls net_send_skb() which frees the SKB.
  * @param sock generic socket to send from.
  * @param hdr TCP header to send.
@@ -278,33 +281,34 @@ uint16_t tcp_calculate_checksum(uint32_t src_ip, uint32_t dest_ip, unsigned shor
 static int __tcp_send(struct sock* sock, struct tcp_header* hdr, struct sk_buff* skb, uint8_t* data, uint32_t len)
 {
 	int ret;
+	uint32_t sum = 0;
 
 	dbgprintf("[TCP - %d] <- TCP packet: %d syn, %d ack, %d fin %d push (src port: %d, dest port: %d)\n", 
 		timer_get_tick(), hdr->syn, hdr->ack, hdr->fin, hdr->psh, htons(hdr->source), htons(hdr->dest));
 
-	if(net_ipv4_add_header(skb, sock->recv_addr.sin_addr.s_addr, TCP, sizeof(struct tcp_header)+len) < 0){
-		skb_free(skb);
-		return -1;
+	skb_reserve(skb, SKB_HEADROOM);
+	if(len > 0){
+		sum = csum_partial_copy(skb_put(skb, len), data, len, 0);
 	}
-	TCP_HTONS(hdr);
 
-	memcpy(skb->data, hdr, sizeof(struct tcp_header));
-	hdr = (struct tcp_header*) skb->data;
-
-	skb->len += sizeof(struct tcp_header);
-	skb->data += sizeof(struct tcp_header);
+	TCP_HTONS(hdr);
+	struct tcp_header* out = (struct tcp_header*) skb_push(skb, sizeof(struct tcp_header));
+	memcpy(out, hdr, sizeof(struct tcp_header));
+	hdr = out;
 
-	if(len > 0){
-		memcpy(skb->data, data, len);
-		skb->len += len;
-		skb->data += len;
+	if(net_ipv4_add_header(skb, sock->recv_addr.sin_addr.s_addr, TCP) < 0){
+		skb_free(skb);
+		return -1;
 	}
 
 	/**
 	 * @brief TCP header checksum is calculated over the pseudo header and the TCP header.
 	 * This pseudo header contains the Source Address, the Destination Address, the Protocol, and TCP length.
 	 */
-	hdr->check = tcp_calculate_checksum(skb->hdr.ip->daddr, skb->hdr.ip->saddr, (unsigned short*)hdr, sizeof(struct tcp_header)+len);
+	hdr->check = 0;
+	sum = csum_partial(hdr, sizeof(struct tcp_header), sum);
+	sum = csum_pseudo(skb->hdr.ip->saddr, skb->hdr.ip->daddr, TCP, sizeof(struct tcp_header)+len, sum);
+	hdr->check = csum_fold(sum);
 
 	ret = net_send_skb(skb);
 	if(ret < 0){
@@ -316,69 +320,333 @@ static int __tcp_send(struct sock* sock, struct tcp_header* hdr, struct sk_buff*
 }
 
 /**
- * @brief Sends a TCP segment.
- * Function sends given data as a TCP segment. Creates a SKB and fills in the header
- * before sending it to the network daemon.
+ * @brief Attaches a TCB to an established connection.
+ * The send sequence variables start at the current sequence number,
+ * the send window is taken from the segment that established the connection.
+ */
+static int tcp_attach_tcb(struct sock* sock, struct tcp_header* hdr)
+{
+	struct tcb* tcb = tcb_new();
+	ERR_ON_NULL(tcb);
+
+	tcb->sock = sock;
+	tcb->iss = sock->tcp->sequence;
+	tcb->snd_una = tcb->iss;
+	tcb->snd_nxt = tcb->iss;
+	tcb->snd_end = tcb->iss;
+	tcb->snd_wnd = htons(hdr->window);
+	tcb->snd_wl1 = htonl(hdr->seq);
+	tcb->snd_wl2 = htonl(hdr->ack_seq);
+	tcb->state = TCP_ESTABLISHED;
+
+	sock->tcp->tcb = tcb;
+
+	return ERROR_OK;
+}
+
+/**
+ * @brief Sends sequence numbers seq to seq+len from the send buffer.
+ * Segments never cross the end of the send buffer, so the payload is contiguous.
+ */
+static int __tcp_send_data(struct sock* sock, struct tcb* tcb, uint32_t seq, uint32_t len)
+{
+	struct sk_buff* skb = skb_new();
+	ERR_ON_NULL(skb);
+
+	struct tcp_header hdr = {
+		.source = sock->bound_port,
+		.dest = sock->recv_addr.sin_port,
+		.window = 1500,
+		.seq = seq,
+		.ack_seq = sock->tcp->acknowledgement,
+		.doff = 0x05,
+		.ack = 1,
+		.psh = seq + len == tcb->snd_end
+	};
+
+	return __tcp_send(sock, &hdr, skb, &tcb->sbuf[seq % TCP_SEND_BUFFER], len);
+}
+
+/**
+ * @brief Sends as much queued data as the send window allows.
+ * Data is cut into MSS sized segments, each segment is put on the
+ * retransmit queue and the RTO timer is started if it is not running.
+ * @warning tcb->lock must be held.
+ */
+static void __tcp_output(struct sock* sock, struct tcb* tcb)
+{
+	while(tcb->snd_nxt != tcb->snd_end){
+		uint32_t in_flight = tcb->snd_nxt - tcb->snd_una;
+		uint32_t window = tcb->snd_wnd;
+
+		/* Probe a closed window with a single byte once everything is acked. */
+		if(window == 0 && in_flight == 0) window = 1;
+		if(in_flight >= window) break;
+
+		uint32_t len = tcb->snd_end - tcb->snd_nxt;
+		uint32_t offset = tcb->snd_nxt % TCP_SEND_BUFFER;
+		if(len > TCP_MSS) len = TCP_MSS;
+		if(len > window - in_flight) len = window - in_flight;
+		if(len > TCP_SEND_BUFFER - offset) len = TCP_SEND_BUFFER - offset;
+
+		struct tcp_segment* seg = kmem_cache_alloc(__segment_cache);
+		if(seg == NULL){
+			dbgprintf("[TCP] Out of segments\n");
+			break;
+		}
+		seg->seq = tcb->snd_nxt;
+		seg->len = len;
+		seg->sent = timer_get_tick();
+		seg->retransmitted = 0;
+		seg->next = NULL;
+
+		if(tcb->retransmit_tail != NULL) tcb->retransmit_tail->next = seg;
+		else tcb->retransmit = seg;
+		tcb->retransmit_tail = seg;
+
+		/* A failed send is treated as a lost segment and retransmitted on timeout. */
+		__tcp_send_data(sock, tcb, seg->seq, len);
+
+		tcb->snd_nxt += len;
+		sock->tcp->sequence = tcb->snd_nxt;
+		sock->tx += len;
+
+		if(!ktimer_pending(&tcb->rto_timer)){
+			ktimer_add(&tcb->rto_timer, tcb->rto);
+		}
+	}
+}
+
+/**
+ * @brief Updates the RTO from a round trip time sample, see RFC 6298.
+ */
+static void __tcp_rtt_sample(struct tcb* tcb, uint32_t rtt)
+{
+	if(!tcb->rtt_valid){
+		tcb->srtt = rtt;
+		tcb->rttvar = rtt / 2;
+		tcb->rtt_valid = 1;
+	} else {
+		uint32_t delta = tcb->srtt > rtt ? tcb->srtt - rtt : rtt - tcb->srtt;
+		tcb->rttvar = (3 * tcb->rttvar + delta) / 4;
+		tcb->srtt = (7 * tcb->srtt + rtt) / 8;
+	}
+
+	uint32_t rto = tcb->srtt + (tcb->rttvar * 4 > 1 ? tcb->rttvar * 4 : 1);
+	if(rto < TCP_RTO_MIN) rto = TCP_RTO_MIN;
+	if(rto > TCP_RTO_MAX) rto = TCP_RTO_MAX;
+	tcb->rto = rto;
+}
+
+/**
+ * @brief Processes the acknowledgement and window of an incoming segment.
+ * ACKs are cumulative, every segment up to the acknowledged sequence number
+ * is removed from the retransmit queue and its space in the send buffer freed.
+ * @return int 1 if new data was acknowledged, 0 otherwise.
+ */
+static int tcp_ack(struct sock* sock, struct tcp_header* hdr)
+{
+	struct tcb* tcb = sock->tcp->tcb;
+	int acked = 0;
+
+	if(tcb == NULL){
+		return 0;
+	}
+
+	uint32_t ack = htonl(hdr->ack_seq);
+	uint32_t seq = htonl(hdr->seq);
+
+	acquire(&tcb->lock);
+
+	/* Acknowledges data we have not sent, ignore it. */
+	if(TCP_SEQ_GT(ack, tcb->snd_nxt)){
+		release(&tcb->lock);
+		return 0;
+	}
+
+	/* Only update the window from segments newer than the last update. */
+	if(TCP_SEQ_LT(tcb->snd_wl1, seq) || (tcb->snd_wl1 == seq && TCP_SEQ_LEQ(tcb->snd_wl2, ack))){
+		tcb->snd_wnd = htons(hdr->window);
+		tcb->snd_wl1 = seq;
+		tcb->snd_wl2 = ack;
+	}
+
+	if(TCP_SEQ_GT(ack, tcb->snd_una)){
+		while(tcb->retransmit != NULL && TCP_SEQ_LEQ(tcb->retransmit->seq + tcb->retransmit->len, ack)){
+			struct tcp_segment* seg = tcb->retransmit;
+
+			/* Karn's algorithm, the ACK of a retransmitted segment is ambiguous. */
+			if(!seg->retransmitted){
+				__tcp_rtt_sample(tcb, timer_get_tick() - seg->sent);
+			}
+
+			tcb->retransmit = seg->next;
+			kmem_cache_free(__segment_cache, seg);
+		}
+		if(tcb->retransmit == NULL){
+			tcb->retransmit_tail = NULL;
+		} else if(TCP_SEQ_LT(tcb->retransmit->seq, ack)){
+			/* Partially acknowledged segment */
+			tcb->retransmit->len -= ack - tcb->retransmit->seq;
+			tcb->retransmit->seq = ack;
+		}
+
+		tcb->snd_una = ack;
+		tcb->backoff = 0;
+
+		ktimer_del(&tcb->rto_timer);
+		if(tcb->snd_una != tcb->snd_nxt){
+			ktimer_add(&tcb->rto_timer, tcb->rto);
+		}
+		acked = 1;
+	}
+
+	/* The window might have opened up */
+	__tcp_output(sock, tcb);
+
+	release(&tcb->lock);
+
+	if(acked){
+		TCP_UNBLOCK(sock);
+	}
+
+	return acked;
+}
+
+/**
+ * @brief Called from the timer wheel when the RTO of a TCB expires.
+ * Runs in interrupt context, so it only marks the TCB and wakes netd,
+ * which retransmits with tcp_retransmit_expired().
+ */
+static void __tcp_rto_expired(void* arg)
+{
+	struct tcb* tcb = (struct tcb*) arg;
+	tcb->rto_expired = 1;
+	__tcp_rto_pending = 1;
+
+	net_wake();
+}
+
+/**
+ * @brief Retransmits the oldest unacknowledged segment of a TCB.
+ * The RTO is doubled for each retransmission of the same segment,
+ * after TCP_RETRIES retransmissions the connection is dropped.
+ */
+static void __tcp_retransmit(struct tcb* tcb)
+{
+	struct sock* sock = tcb->sock;
+
+	acquire(&tcb->lock);
+
+	struct tcp_segment* seg = tcb->retransmit;
+	if(seg == NULL || ktimer_pending(&tcb->rto_timer)){
+		release(&tcb->lock);
+		return;
+	}
+
+	if(tcb->backoff >= TCP_RETRIES){
+		dbgprintf("[TCP] Segment %d not acked after %d retries, dropping connection\n", seg->seq, tcb->backoff);
+		release(&tcb->lock);
+
+		sock->tcp->state = TCP_CLOSED;
+		sock->data_ready = -1;
+		TCP_UNBLOCK(sock);
+		return;
+	}
+
+	dbgprintf("[TCP] Timeout for %d, retransmitting %d bytes\n", seg->seq, seg->len);
+
+	tcb->backoff++;
+	seg->retransmitted = 1;
+	seg->sent = timer_get_tick();
+	sock->tcp->retransmits++;
+
+	__tcp_send_data(sock, tcb, seg->seq, seg->len);
+
+	uint32_t timeout = tcb->rto << tcb->backoff;
+	ktimer_add(&tcb->rto_timer, timeout > TCP_RTO_MAX ? TCP_RTO_MAX : timeout);
+
+	release(&tcb->lock);
+}
+
+/* True if a RTO expired since the last tcp_retransmit_expired(). */
+int tcp_retransmit_pending()
+{
+	return __tcp_rto_pending;
+}
+
+/**
+ * @brief Retransmits for every TCB whose RTO expired, called by netd.
+ * Walking the manager under its lock keeps TCBs from being freed meanwhile.
+ */
+int tcp_retransmit_expired()
+{
+	/* Timers expiring from here on set it again */
+	__tcp_rto_pending = 0;
+
+	acquire(&tcp_manager.lock);
+	for (int i = 0; i < tcp_manager.tcb_count; i++){
+		struct tcb* tcb = tcp_manager.tcbs[i];
+		if(tcb->rto_expired){
+			tcb->rto_expired = 0;
+			__tcp_retransmit(tcb);
+		}
+	}
+	release(&tcp_manager.lock);
+
+	return ERROR_OK;
+}
+
+static int __tcp_send_space(struct sock* sock)
+{
+	struct tcb* tcb = sock->tcp->tcb;
+	return TCP_SEND_BUFFER - (tcb->snd_end - tcb->snd_una);
+}
+
+/**
+ * @brief Queues data for sending on an established connection.
+ * The data is copied into the send buffer and sent as the window allows,
+ * the caller only blocks while the send buffer is full.
  * @param sock generic socket to send from.
  * @param data given data to send.
  * @param len length of data
- * @param push if set to 1, the PSH flag will be set.
- * @return int 0 on success, -1 on failure.
+ * @return int number of bytes queued, or error code.
  */
-int tcp_send_segment(struct sock* sock, uint8_t* data, uint32_t len, uint8_t push)
+int tcp_send(struct sock* sock, uint8_t* data, uint32_t len)
 {
-	uint8_t retries;
-	uint32_t timeout;
-	int seq = sock->tcp->sequence;
-	int ack = sock->tcp->acknowledgement;
-	struct sk_buff* skb;
+	struct tcb* tcb = sock->tcp->tcb;
+	uint32_t queued = 0;
 
-	dbgprintf("[TCP] Sending segment with size %d, seq: %d (%d after)\n", len, sock->tcp->sequence, sock->tcp->sequence+len);
+	ERR_ON_NULL(tcb);
 
-	sock->tcp->sequence += len;
-
-	/**
-	 * @brief This is where we need to check if packet is lost.
-	 * @see https://github.com/joexbayer/RetrOS-32/issues/30
-	 * TODO: check if packet is lost.
-	 * Simples solution is to just wait for an ACK, if we dont get one, resend the packet.
-	 * Need a timer to resend the packet.
-	 * 
-	 * Problem is that we "lose" the skb after it is transmitted, keep a copy?
-	 */
-	retries = 0;
-
-	do {
-		struct tcp_header hdr = {
-			.source = sock->bound_port,
-			.dest = sock->recv_addr.sin_port,
-			.window = 1500,
-			.seq = seq,
-			.ack_seq = ack,
-			.doff = 0x05,
-			.ack = 1,
-			.psh = push
-		};
-
-		skb = skb_new();
-		ERR_ON_NULL(skb);
-
-		/* Send segment, __tcp_send consumes skb */
-		__tcp_send(sock, &hdr, skb, data, len);
-
-		/* Wait for ACK */
-		timeout = get_time() + 1;
-
-		/* check if ack was receiver for timeout seconds. */
-		while((uint32_t)get_time() < timeout){
-			kernel_yield();
-			if(!net_sock_awaiting_ack(sock)) return ERROR_OK;
+	while(queued < len){
+		wait_event(&sock->wait, __tcp_send_space(sock) > 0 || !net_sock_is_established(sock));
+		if(!net_sock_is_established(sock)){
+			break;
 		}
-		dbgprintf("[TCP] Timeout for %d\n", htonl(hdr.seq));
-	} while (retries++ < 3);
 
-	dbgprintf("[TCP] Failed to send segment\n");
-	return -1;
+		acquire(&tcb->lock);
+
+		uint32_t chunk = __tcp_send_space(sock);
+		if(chunk > len - queued) chunk = len - queued;
+
+		/* Copy into the circular send buffer, in two parts if it wraps. */
+		uint32_t offset = tcb->snd_end % TCP_SEND_BUFFER;
+		uint32_t first = chunk < TCP_SEND_BUFFER - offset ? chunk : TCP_SEND_BUFFER - offset;
+		memcpy(&tcb->sbuf[offset], data + queued, first);
+		memcpy(tcb->sbuf, data + queued + first, chunk - first);
+
+		tcb->snd_end += chunk;
+		queued += chunk;
+
+		__tcp_output(sock, tcb);
+
+		release(&tcb->lock);
+	}
+
+	dbgprintf("[TCP] Queued %d of %d bytes, %d in flight\n", queued, len, tcb->snd_nxt - tcb->snd_una);
+
+	return queued > 0 ? (int) queued : -ERROR_INVALID_SOCKET;
 }
 
 int tcp_accept_connection(struct sock* sock, struct sock* new)
@@ -388,10 +656,8 @@ int tcp_accept_connection(struct sock* sock, struct sock* new)
         return -1;
      }
 
-    while(sock->backlog.count == 0){
-		dbgprintf("[TCP] Socket %d is listening but backlog is empty\n", sock);
-		TCP_BLOCK(sock);
-	}
+	dbgprintf("[TCP] Socket %d is listening, waiting for backlog\n", sock);
+	wait_event(&sock->wait, sock->backlog.count > 0);
 
 	struct sk_buff* skb = sock->backlog.queue->ops->remove(sock->backlog.queue);
 	ERR_ON_NULL(skb);
@@ -404,9 +670,12 @@ int tcp_accept_connection(struct sock* sock, struct sock* new)
 	 */
 	net_prepare_tcp_sock(new, sock->bound_port, &sock->recv_addr);
 
-	new->tcp->state = TCP_ESTABLISHED;
 	new->tcp->acknowledgement = htonl(hdr->seq);
-	new->tcp->sequence = hdr->ack_seq;
+	new->tcp->sequence = htonl(hdr->ack_seq);
+	if(tcp_attach_tcb(new, hdr) < 0){
+		dbgprintf("[TCP] Unable to attach TCB to socket %d\n", new->socket);
+	}
+	new->tcp->state = TCP_ESTABLISHED;
 	sock->accept_sock = NULL;
 
 	memset(&sock->recv_addr, 0, sizeof(struct sockaddr_in));
@@ -421,19 +690,22 @@ int tcp_send_ack(struct sock* sock, struct tcp_header* tcp, int len)
 	struct sk_buff* skb = skb_new();
 	assert(skb != NULL);
 
+	/* The peer can not ack more than we sent, but data may still be in flight. */
+	if(TCP_SEQ_GT(htonl(tcp->ack_seq), sock->tcp->sequence)){
+		sock->tcp->sequence = htonl(tcp->ack_seq);
+	}
+	sock->tcp->acknowledgement = htonl(tcp->seq)+len;
+
 	struct tcp_header hdr = {
 		.source = tcp->dest,
 		.dest = tcp->source,
 		.window = 1500,
-		.seq = htonl(tcp->ack_seq),
-		.ack_seq = htonl(tcp->seq)+len,
+		.seq = sock->tcp->sequence,
+		.ack_seq = sock->tcp->acknowledgement,
 		.doff = 0x05,
 		.ack = 1
 	};
 
-	sock->tcp->sequence = htonl(tcp->ack_seq);
-	sock->tcp->acknowledgement = htonl(tcp->seq)+len;
-
 	//dbgprintf("[TCP] Sending ack for %d (seq: %d, ack: %d)\n", htonl(tcp->seq)+len, htonl(tcp->ack_seq), htonl(tcp->seq)+1);
 
 	__tcp_send(sock, &hdr, skb, NULL, 0);
@@ -505,18 +777,6 @@ int tcp_connect(struct sock* sock)
 	return ERROR_OK;
 }
 
-int tcp_recv_ack(struct sock* sock, struct tcp_header* tcp)
-{
-	dbgprintf("[TCP] Incoming TCP ack expected %d got %d\n", sock->tcp->sequence, htonl(tcp->ack_seq));
-	if(sock->tcp->sequence == htonl(tcp->ack_seq)){
-		dbgprintf("[TCP] Correct sequence acked\n");
-		sock->tcp->acknowledgement = htonl(tcp->seq);
-		sock->tcp->state = TCP_ESTABLISHED;
-	}
-	
-	return ERROR_OK;
-}
-
 int tcp_recv_syn(struct sock* sock, struct tcp_header* tcp)
 {
 	int ret;
@@ -584,10 +844,16 @@ int tcp_send_fin(struct sock* sock)
 
 int tcp_close_connection(struct sock* sock)
 {
+	/* Let queued data drain before sending the FIN */
+	if(sock->tcp->tcb != NULL){
+		struct tcb* tcb = sock->tcp->tcb;
+		wait_event(&sock->wait, tcb->snd_una == tcb->snd_end || !net_sock_is_established(sock));
+	}
+
 	sock->tcp->state = TCP_CLOSE_WAIT;
 	tcp_send_fin(sock);
 
-	WAIT(!(sock->tcp->state == TCP_CLOSED));
+	wait_event(&sock->wait, sock->tcp->state == TCP_CLOSED);
 
 	return ERROR_OK;
 }
@@ -599,7 +865,7 @@ int tcp_parse(struct sk_buff* skb)
 
 	struct tcp_header* hdr = (struct tcp_header* ) skb->data;
 	skb->hdr.tcp = hdr;
-	skb->data += hdr->doff*4;
+	skb_pull(skb, hdr->doff*4);
 	skb->data_len = skb->hdr.ip->len - skb->hdr.ip->ihl*4 - hdr->doff*4;
 
 	return tcp_state_machine(skb);
@@ -665,10 +931,7 @@ static int tcp_state_machine(struct sk_buff* skb){
 			sk->tcp->state = TCP_CLOSED;
 			sk->data_ready = -1;
 
-			if(sk->waiting != NULL){
-				sk->waiting->state = RUNNING;
-				sk->waiting = NULL;
-			}
+			TCP_UNBLOCK(sk);
 			skb_free(skb);
 			return ERROR_OK;
 		}
@@ -697,55 +960,36 @@ static int tcp_state_machine(struct sk_buff* skb){
 	case TCP_SYN_SENT:
 		if(hdr->syn == 1 && hdr->ack == 1){
 			tcp_send_ack(sk, hdr, 1);
+			if(tcp_attach_tcb(sk, hdr) < 0){
+				dbgprintf("[TCP] Unable to attach TCB to socket %d\n", sk->socket);
+			}
 			sk->tcp->state = TCP_ESTABLISHED;
+			TCP_UNBLOCK(sk);
 
 			dbgprintf("Socket %d set to established\n", sk);
 			skb_free(skb);
 			return ERROR_OK;
 		}
 		break;
-	case TCP_WAIT_ACK:
+	case TCP_ESTABLISHED:
 		if(hdr->rst == 1){
 			dbgprintf("[TCP] Received RST packet, closing connection\n");
 			sk->tcp->state = TCP_CLOSED;
 			sk->data_ready = -1;
-
-			if(sk->waiting != NULL){
-				sk->waiting->state = RUNNING;
-				sk->waiting = NULL;
-			}
+			TCP_UNBLOCK(sk);
 			skb_free(skb);
 			return ERROR_OK;
 		}
 
-		if(hdr->syn == 0 && hdr->ack == 1){
-			
-			/* check if i get a already acked retransmit */
-			if(sk->tcp->sequence > htonl(hdr->ack_seq)){
-				dbgprintf("[TCP] Received ack for already acked packet %d - %d\n", htonl(hdr->ack_seq), sk->tcp->acknowledgement);
+		if(hdr->syn == 0 && hdr->ack == 1 && hdr->fin == 0){
+			tcp_ack(sk, hdr);
+
+			/* Pure acknowledgement, nothing to deliver */
+			if(skb->data_len == 0){
 				skb_free(skb);
 				return ERROR_OK;
 			}
 
-			tcp_recv_ack(sk, hdr);
-			skb_free(skb);
-			return ERROR_OK;
-		}
-		break;
-	case TCP_ESTABLISHED:
-		if(hdr->rst == 1){
-			dbgprintf("[TCP] Received RST packet, closing connection\n");
-			sk->tcp->state = TCP_CLOSED;
-			sk->data_ready = -1;
-			if(sk->waiting != NULL){
-				sk->waiting->state = RUNNING;
-				sk->waiting = NULL;
-			}
-			skb_free(skb);
-			return ERROR_OK;
-		}
-
-		if(hdr->syn == 0 && hdr->ack == 1 && hdr->fin == 0){
 			/**
 			 * @brief This is where we should check if the packet is in order.
 			 * @see https://github.com/joexbayer/RetrOS-32/issues/34
@@ -775,6 +1019,7 @@ static int tcp_state_machine(struct sk_buff* skb){
 
 		if(hdr->fin == 1 && hdr->ack == 1){
 			//dbgprintf("Socket %d received fin for %d\n", sk, htonl(hdr->ack_seq));
+			tcp_ack(sk, hdr);
 			tcp_send_ack(sk, hdr, 1);
 
 			/**
@@ -793,6 +1038,7 @@ static int tcp_state_machine(struct sk_buff* skb){
 			/* Connection succesfully closed */
 			tcp_send_ack(sk, hdr, 1);
 			sk->tcp->state = TCP_CLOSED;
+			TCP_UNBLOCK(sk);
 			dbgprintf("[TCP] Socket %d closed\n", sk);
 		}
 		break;
@@ -804,13 +1050,8 @@ static int tcp_state_machine(struct sk_buff* skb){
 	case TCP_CLOSE_WAIT2:
 		if(hdr->fin == 0 && hdr->ack == 1){	
 			sk->tcp->state = TCP_CLOSED;
-
-			if(sk->waiting != NULL){
-				sk->waiting->state = RUNNING;
-				sk->waiting = NULL;
-				sk->data_ready = -1;
-			}
-
+			sk->data_ready = -1;
+			TCP_UNBLOCK(sk);
 		}
 		break;	
 	default:
@@ -21,32 +21,37 @@
 int net_udp_send(char* data, uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport, uint32_t length)
 {
 	dbgprintf("Preparing to send UDP packet\n");
+	if(length > SKB_DATA_SIZE - SKB_HEADROOM){
+		return -1;
+	}
+
 	struct sk_buff* skb = skb_new();
 	assert(skb != NULL);
+	skb_reserve(skb, SKB_HEADROOM);
+
+	/* The payload is checksummed while it is copied in */
+	uint32_t sum = csum_partial_copy(skb_put(skb, length), data, length, 0);
 
-	struct udp_header hdr = {
-		.destport = dport,
-		.srcport = sport,
-		.udp_length = length + sizeof(struct udp_header),
-		.checksum = 0
-	};
+	struct udp_header* hdr = (struct udp_header*) skb_push(skb, sizeof(struct udp_header));
+	hdr->destport = dport;
+	hdr->srcport = sport;
+	hdr->udp_length = length + sizeof(struct udp_header);
+	hdr->checksum = 0;
+	UDP_HTONS(hdr);
 
-	if(net_ipv4_add_header(skb, dip, UDP, length+sizeof(struct udp_header)) < 0){
+	if(net_ipv4_add_header(skb, dip, UDP) < 0){
 		skb_free(skb);	
 		return -1;
 	}
 
-	UDP_HTONS(&hdr);
-
-	memcpy(skb->data, &hdr, sizeof(struct udp_header));
-	memcpy(skb->data + sizeof(struct udp_header), (char*) data, length);
-
-	//((struct udp_header*) skb->data)->checksum = transport_checksum(sip, dip, UDP, (char*) skb->data, htons(length+sizeof(struct udp_header)));
-	//((struct udp_header*) skb->data)->checksum = htons(((struct udp_header*) skb->data)->checksum);
+	sum = csum_partial(hdr, sizeof(struct udp_header), sum);
+	sum = csum_pseudo(skb->hdr.ip->saddr, skb->hdr.ip->daddr, UDP, length + sizeof(struct udp_header), sum);
+	hdr->checksum = csum_fold(sum);
+	/* Zero means no checksum in UDP, it is sent as all ones instead */
+	if(hdr->checksum == 0){
+		hdr->checksum = 0xffff;
+	}
 
-	skb->len += sizeof(struct udp_header) + length;
-	skb->data += sizeof(struct udp_header) + length;
-	
 	dbgprintf("Sending UDP packet.\n");
 	net_send_skb(skb);
 	return 0;
@@ -62,7 +67,7 @@ int net_udp_parse(struct sk_buff* skb){
 		dbgprintf("checksum failed %x - %x.\n", hdr->checksum, udp_checksum);
 		/* TODO  UDP CHECKSUM IS BROKEN. */
 	}
-	skb->data = skb->data + sizeof(struct udp_header);
+	skb_pull(skb, sizeof(struct udp_header));
 
 	UDP_NTOHS(hdr);
 
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bcache.h>
+#include <diskdev.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define BLOCKS 256
+
+/* In memory disk counting the device calls made by the cache. */
+static char disk[BLOCKS][512];
+static int disk_reads = 0;
+static int disk_writes = 0;
+
+static int32_t mock_read(char* buffer, uint32_t from, uint32_t size)
+{
+    disk_reads++;
+    memcpy(buffer, disk[from], 512 * size);
+    return size;
+}
+
+static int32_t mock_write(char* buffer, uint32_t from, uint32_t size)
+{
+    disk_writes++;
+    memcpy(disk[from], buffer, 512 * size);
+    return size;
+}
+
+static struct diskdev mock_disk = {
+    .read = mock_read,
+    .write = mock_write,
+    .attached = 1
+};
+
+struct diskdev* disk_device_get()
+{
+    return &mock_disk;
+}
+
+int main(int argc, char const *argv[])
+{
+    for (int i = 0; i < BLOCKS; i++) memset(disk[i], i, 512);
+
+    testprintf(bcache_init(8) == 0, "bcache_init() - Create cache");
+
+    struct buffer* b = bread(3);
+    testprintf(b != NULL && b->data[0] == 3 && disk_reads == 1, "bread() - Miss reads from disk");
+    brelse(b);
+
+    b = bread(3);
+    testprintf(b != NULL && disk_reads == 1, "bread() - Hit does not touch disk");
+    memset(b->data, 0xAA, 512);
+    bdirty(b);
+    brelse(b);
+    testprintf(disk_writes == 0, "bdirty() - Writes are deferred");
+
+    /* Touch enough other blocks to push block 3 out of the cache */
+    for (int i = 10; i < 18; i++){
+        brelse(bread(i));
+    }
+    testprintf(disk_writes == 1 && (unsigned char)disk[3][0] == 0xAA, "bread() - Dirty LRU victim written back");
+
+    /* Referenced buffers are never evicted */
+    struct buffer* held = bread(100);
+    for (int i = 20; i < 40; i++){
+        brelse(bread(i));
+    }
+    testprintf(held->block == 100 && held->valid, "bread() - Held buffer survives eviction");
+    brelse(held);
+
+    /* bget skips the read for whole block writes */
+    int reads = disk_reads;
+    b = bget(200);
+    memset(b->data, 0x55, 512);
+    bdirty(b);
+    brelse(b);
+    testprintf(disk_reads == reads, "bget() - No read for full block write");
+    testprintf(bcache_sync() == 1 && (unsigned char)disk[200][0] == 0x55, "bcache_sync() - Writes back dirty blocks");
+    testprintf(bcache_sync() == 0, "bcache_sync() - Clean cache writes nothing");
+
+    /* Resizing keeps the contents consistent */
+    testprintf(bcache_init(32) == 0, "bcache_init() - Resize cache");
+    b = bread(200);
+    testprintf(b != NULL && (unsigned char)b->data[0] == 0x55, "bread() - Data survives resize");
+    brelse(b);
+
+    /* Runs of missing blocks are read with one disk command */
+    b = bread(52);
+    reads = disk_reads;
+    testprintf(bread_ahead(48, 12) == 11 && disk_reads == reads + 2, "bread_ahead() - One read per run of missing blocks");
+    brelse(b);
+    reads = disk_reads;
+    int correct = 0;
+    for (int i = 48; i < 60; i++){
+        b = bread(i);
+        correct += b != NULL && b->data[0] == i;
+        brelse(b);
+    }
+    testprintf(correct == 12 && disk_reads == reads, "bread_ahead() - Blocks read ahead are hits");
+
+    /* Consecutive dirty blocks are written back together */
+    for (int i = 70; i < 80; i++){
+        b = bget(i);
+        memset(b->data, 0x77, 512);
+        bdirty(b);
+        brelse(b);
+    }
+    int writes = disk_writes;
+    testprintf(bcache_sync() == 10 && disk_writes == writes + 1 && (unsigned char)disk[79][0] == 0x77, "bcache_sync() - One write per run of dirty blocks");
+
+    /* Repeatedly reading a small working set mostly hits */
+    struct bcache_info info;
+    bcache_get_info(&info);
+    int hits = info.hits;
+    for (int r = 0; r < 100; r++){
+        for (int i = 0; i < 16; i++){
+            brelse(bread(i));
+        }
+    }
+    bcache_get_info(&info);
+    printf("bcache: %d hits of 1600 lookups on a 16 block working set\n", info.hits - hits);
+    testprintf(info.hits - hits >= 1584, "bcache - Working set stays cached");
+
+    return failed > 0 ? -1 : 0;
+}
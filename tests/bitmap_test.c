@@ -0,0 +1,124 @@
+#include <bitmap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define BITS (16*1024)
+#define ROUNDS 2000
+
+/* Original bit at a time implementation, used as reference and baseline. */
+static int __ref_get(bitmap_t b, int i)
+{
+    return b[i / 8] & (1 << (i & 7)) ? 1 : 0;
+}
+
+static int __ref_get_free(bitmap_t b, int n)
+{
+    for (int i = 0; i < n; i++){
+        if(__ref_get(b, i) == 0) return i;
+    }
+    return -1;
+}
+
+static int __ref_get_continous(bitmap_t b, int n, int size)
+{
+    int run = 0;
+    for (int i = 0; i < n; i++){
+        run = __ref_get(b, i) ? 0 : run + 1;
+        if(run == size) return i - size + 1;
+    }
+    return -1;
+}
+
+/* Fills the first 3/4 of the map and leaves scattered single free bits. */
+static void __fragment(bitmap_t b, int n)
+{
+    memset(b, 0, get_bitmap_size(n));
+    for (int i = 0; i < n; i++){
+        if(i < (n/4)*3 || (rand() % 3)) set_bitmap(b, i);
+    }
+    /* Some longer holes to find runs in */
+    bitmap_unset_continous(b, (n/4)*3 + 100, 12);
+    bitmap_unset_continous(b, n - 40, 20);
+}
+
+int main(int argc, char const *argv[])
+{
+    bitmap_t map = create_bitmap(BITS);
+    testprintf(map != NULL, "create_bitmap() - Create bitmap");
+
+    /* First fit on an empty map */
+    testprintf(get_free_bitmap(map, BITS) == 0, "get_free_bitmap() - First bit on empty map");
+    testprintf(get_free_bitmap(map, BITS) == 1, "get_free_bitmap() - Second bit on empty map");
+
+    /* Runs crossing word boundaries */
+    memset(map, 0xFF, get_bitmap_size(BITS));
+    bitmap_unset_continous(map, 60, 40);
+    testprintf(bitmap_find_continous(map, BITS, 40, 0) == 60, "bitmap_find_continous() - Run across words");
+    testprintf(bitmap_find_continous(map, BITS, 41, 0) == -1, "bitmap_find_continous() - Run too long");
+    testprintf(bitmap_get_continous(map, BITS, 40) == 60 && bitmap_find_free(map, BITS, 0) == -1, "bitmap_get_continous() - Sets run");
+
+    /* A short hole before a long enough one must not stop the search */
+    memset(map, 0xFF, get_bitmap_size(BITS));
+    bitmap_unset_continous(map, 5, 2);
+    bitmap_unset_continous(map, 500, 8);
+    testprintf(bitmap_get_continous(map, BITS, 8) == 500, "bitmap_get_continous() - Skips short hole");
+
+    /* Bits past n are never returned, also for maps not a multiple of 32 */
+    bitmap_t small = create_bitmap(37);
+    memset(small, 0xFF, get_bitmap_size(37));
+    unset_bitmap(small, 36);
+    testprintf(bitmap_find_free(small, 37, 0) == 36, "bitmap_find_free() - Last bit in tail word");
+    set_bitmap(small, 36);
+    testprintf(bitmap_find_free(small, 37, 0) == -1, "bitmap_find_free() - Full tail word");
+
+    /* Next fit rotates and wraps around */
+    int hint = 0;
+    memset(small, 0, get_bitmap_size(37));
+    testprintf(bitmap_get_free_next(small, 37, &hint) == 0 && bitmap_get_free_next(small, 37, &hint) == 1, "bitmap_get_free_next() - Rotates");
+    unset_bitmap(small, 0);
+    hint = 36;
+    testprintf(bitmap_get_free_next(small, 37, &hint) == 36 && bitmap_get_free_next(small, 37, &hint) == 0, "bitmap_get_free_next() - Wraps");
+    destroy_bitmap(small);
+
+    /* Compare against the reference on random fragmented maps */
+    int mismatch = 0;
+    for (int r = 0; r < 50; r++){
+        __fragment(map, BITS);
+        int start = rand() % BITS;
+        if(bitmap_find_free(map, BITS, 0) != __ref_get_free(map, BITS)) mismatch++;
+        for (int size = 1; size < 24; size++){
+            if(bitmap_find_continous(map, BITS, size, 0) != __ref_get_continous(map, BITS, size)) mismatch++;
+        }
+        int bit = bitmap_find_free(map, BITS, start);
+        if(bit != -1 && (bit < start || __ref_get(map, bit))) mismatch++;
+    }
+    testprintf(mismatch == 0, "bitmap_find_*() - Matches reference on fragmented maps");
+
+    /* Benchmark against the bit at a time search */
+    srand(1);
+    __fragment(map, BITS);
+
+    volatile int sink = 0;
+    clock_t t = clock();
+    for (int i = 0; i < ROUNDS; i++){
+        sink += __ref_get_free(map, BITS) + __ref_get_continous(map, BITS, 10);
+    }
+    double ref = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++){
+        sink += bitmap_find_free(map, BITS, 0) + bitmap_find_continous(map, BITS, 10, 0);
+    }
+    double word = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    printf("bitmap: %d searches on %d bits, bit at a time %.3fs, word at a time %.3fs\n", ROUNDS*2, BITS, ref, word);
+    testprintf(word <= ref, "bitmap - Word search not slower than bit search");
+
+    destroy_bitmap(map);
+    return failed > 0 ? -1 : 0;
+}
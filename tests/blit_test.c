@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfx/blit.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define MAX_WIDTH 1024
+#define MAX_HEIGHT 768
+#define ROUNDS 200
+
+static uint8_t screen[MAX_WIDTH * MAX_HEIGHT];
+static uint8_t expected[MAX_WIDTH * MAX_HEIGHT];
+static uint8_t window[MAX_WIDTH * MAX_HEIGHT];
+static uint8_t image[320 * 240];
+
+/* The putpixel loop gfx_draw_window() used before, without clipping. */
+static void old_draw(uint8_t* buffer, int pitch, int x, int y, uint8_t* inner, int width, int height, int transparent)
+{
+    int c = 0;
+    for (int j = y; j < y + height; j++)
+        for (int i = x; i < x + width; i++){
+            if(transparent && inner[c] == GFX_TRANSPARENT_COLOR){
+                c++;
+                continue;
+            }
+            buffer[j * pitch + i] = inner[c++];
+        }
+}
+
+/* The quadruple loop ws_set_background_file() used before. */
+static void old_scale(uint8_t* buffer, int width, int height, uint8_t* src)
+{
+    float scale_x = (float)width / 320.0f;
+    float scale_y = (float)height / 240.0f;
+    for (int i = 0; i < 320; i++)
+        for (int j = 0; j < 240; j++){
+            int sx = (int)(i * scale_x);
+            int sy = (int)(j * scale_y);
+            for (int x = 0; x < scale_x; x++)
+                for (int y = 0; y < scale_y; y++)
+                    if(sx + x < width && sy + y < height) buffer[(sy + y) * width + sx + x] = src[j * 320 + i];
+        }
+}
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void bench(int width, int height)
+{
+    struct gfx_rect clip = GFX_RECT(0, 0, width, height);
+    int w = width - 16, h = height - 16;
+
+    clock_t t = clock();
+    for (int i = 0; i < ROUNDS; i++) old_draw(screen, width, 8, 8, window, w, h, 0);
+    double old_opaque = seconds(t);
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++) gfx_blit(screen, width, &clip, 8, 8, window, w, h, w);
+    double new_opaque = seconds(t);
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++) old_draw(screen, width, 8, 8, window, w, h, 1);
+    double old_masked = seconds(t);
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++) gfx_blit_masked(screen, width, &clip, 8, 8, window, w, h, w, GFX_TRANSPARENT_COLOR);
+    double new_masked = seconds(t);
+
+    t = clock();
+    for (int i = 0; i < ROUNDS / 10; i++) old_scale(screen, width, height, image);
+    double old_scaled = seconds(t) * 10;
+
+    t = clock();
+    for (int i = 0; i < ROUNDS / 10; i++) gfx_blit_scaled(screen, width, height, width, image, 320, 240, 320);
+    double new_scaled = seconds(t) * 10;
+
+    printf("blit: %dx%d, opaque %.2fms -> %.2fms, transparent %.2fms -> %.2fms, scaled %.2fms -> %.2fms\n", width, height,
+        old_opaque * 1e3 / ROUNDS, new_opaque * 1e3 / ROUNDS,
+        old_masked * 1e3 / ROUNDS, new_masked * 1e3 / ROUNDS,
+        old_scaled * 1e3 / ROUNDS, new_scaled * 1e3 / ROUNDS);
+}
+
+int main(int argc, char const *argv[])
+{
+    int width = 640, height = 480;
+    struct gfx_rect clip = GFX_RECT(0, 0, width, height);
+
+    srand(1);
+    for (int i = 0; i < MAX_WIDTH * MAX_HEIGHT; i++) window[i] = rand() % 254;
+    for (int i = 0; i < 320 * 240; i++) image[i] = rand();
+
+    /* Opaque window inside the screen, odd sizes and offsets */
+    int mismatches = 0;
+    for (int i = 0; i < 50; i++){
+        int w = 1 + rand() % 300, h = 1 + rand() % 200, x = rand() % 300, y = rand() % 200;
+        old_draw(expected, width, x, y, window, w, h, 0);
+        gfx_blit(screen, width, &clip, x, y, window, w, h, w);
+        mismatches += memcmp(screen, expected, width * height) != 0;
+    }
+    testprintf(mismatches == 0, "gfx_blit() - Matches putpixel loop");
+
+    /* Transparent window, runs of transparent pixels of every length */
+    for (int i = 0; i < 300 * 200; i++) window[i] = (rand() % 3 == 0 || (i / 7) % 5 == 0) ? GFX_TRANSPARENT_COLOR : window[i];
+    mismatches = 0;
+    for (int i = 0; i < 50; i++){
+        int w = 1 + rand() % 300, h = 1 + rand() % 200, x = rand() % 300, y = rand() % 200;
+        old_draw(expected, width, x, y, window, w, h, 1);
+        gfx_blit_masked(screen, width, &clip, x, y, window, w, h, w, GFX_TRANSPARENT_COLOR);
+        mismatches += memcmp(screen, expected, width * height) != 0;
+    }
+    testprintf(mismatches == 0, "gfx_blit_masked() - Matches putpixel loop");
+
+    /* Clipping at every edge, the source follows the destination */
+    memset(screen, 0, sizeof(screen));
+    struct gfx_rect small = GFX_RECT(10, 10, 20, 20);
+    gfx_blit(screen, width, &small, 5, 25, window, 10, 10, 10);
+    int outside = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            if(screen[y * width + x] != 0 && !(x >= 10 && x < 15 && y >= 25 && y < 30)) outside++;
+    testprintf(outside == 0 && screen[25 * width + 10] == window[5], "gfx_blit() - Clipped to clip rectangle");
+
+    memset(screen, 0xAB, sizeof(screen));
+    memset(expected, 0xAB, sizeof(expected));
+    gfx_blit(screen, width, &clip, -100, -100, window, 50, 50, 50);
+    gfx_blit_masked(screen, width, &clip, width, 0, window, 50, 50, 50, GFX_TRANSPARENT_COLOR);
+    testprintf(memcmp(screen, expected, sizeof(screen)) == 0, "gfx_blit() - Fully clipped blits are ignored");
+
+    /* Whole number scale gives the same image as the old loop */
+    old_scale(expected, width, height, image);
+    gfx_blit_scaled(screen, width, height, width, image, 320, 240, 320);
+    testprintf(memcmp(screen, expected, width * height) == 0, "gfx_blit_scaled() - Matches old loop at 2x");
+
+    bench(640, 480);
+    bench(1024, 768);
+
+    return failed > 0 ? -1 : 0;
+}
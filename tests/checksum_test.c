@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <net/checksum.h>
+#include <net/utils.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define BUFFER 2048
+#define ROUNDS 200000
+#define TCP_PROTO 6
+
+static uint8_t src[BUFFER + 4];
+static uint8_t dst[BUFFER + 4];
+
+/* The RFC 1071 loop checksum() used before. */
+static uint16_t old_checksum(void *addr, int count, int start_sum)
+{
+    uint32_t sum = start_sum;
+    uint16_t* ptr = addr;
+    while(count > 1){
+        sum += *ptr++;
+        count -= 2;
+    }
+    if(count > 0)
+        sum += *(uint8_t *) ptr;
+    while(sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+/* The tcp_calculate_checksum() used before, without clearing the check field. */
+static uint16_t old_tcp_checksum(uint32_t src_ip, uint32_t dest_ip, uint16_t* data, int size)
+{
+    uint32_t sum = 0;
+    uint16_t len = size;
+    sum += (src_ip >> 16) & 0xFFFF;
+    sum += src_ip & 0xFFFF;
+    sum += (dest_ip >> 16) & 0xFFFF;
+    sum += dest_ip & 0xFFFF;
+    sum += htons(TCP_PROTO);
+    sum += htons(len);
+    while(len > 1){
+        sum += *data++;
+        len -= 2;
+    }
+    if(len > 0)
+        sum += (*data) & htons(0xFF00);
+    while(sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+static void bench(int len)
+{
+    volatile uint32_t sink = 0;
+
+    clock_t t = clock();
+    for (int i = 0; i < ROUNDS; i++) sink += old_checksum(src, len, i);
+    double old = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++) sink += checksum(src, len, i);
+    double new = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++){
+        memcpy(dst, src, len);
+        sink += checksum(dst, len, i);
+    }
+    double copy_then_sum = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int i = 0; i < ROUNDS; i++) sink += csum_fold(csum_partial_copy(dst, src, len, i));
+    double copy_and_sum = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    printf("checksum: %4d bytes, old %.0fMB/s, new %.0fMB/s, copy then sum %.0fMB/s, sum during copy %.0fMB/s\n", len,
+        len * (ROUNDS / old) / 1e6, len * (ROUNDS / new) / 1e6,
+        len * (ROUNDS / copy_then_sum) / 1e6, len * (ROUNDS / copy_and_sum) / 1e6);
+}
+
+int main(int argc, char const *argv[])
+{
+    /* RFC 1071 section 3 example */
+    uint8_t rfc[] = {0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7};
+    testprintf(checksum(rfc, sizeof(rfc), 0) == (uint16_t)~htons(0xddf2), "checksum() - RFC 1071 example");
+
+    /* IPv4 header with a known checksum of 0xb861 */
+    uint8_t ip[] = {0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+                    0x00, 0x00, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7};
+    uint16_t csum = checksum(ip, sizeof(ip), 0);
+    testprintf(csum == htons(0xb861), "checksum() - IPv4 header example");
+    memcpy(&ip[10], &csum, 2);
+    testprintf(checksum(ip, sizeof(ip), 0) == 0, "checksum() - Valid header sums to zero");
+
+    /* Same answers as the old loop for every length and alignment */
+    srand(1);
+    for (int i = 0; i < BUFFER + 4; i++) src[i] = rand();
+    int mismatches = 0;
+    for (int len = 0; len <= 300; len++){
+        for (int off = 0; off < 4; off++){
+            mismatches += checksum(src + off, len, 0) != old_checksum(src + off, len, 0);
+            mismatches += checksum(src + off, len, 0x1ffff) != old_checksum(src + off, len, 0x1ffff);
+        }
+    }
+    for (int i = 0; i < BUFFER; i++) dst[i] = 0xff;
+    mismatches += checksum(dst, BUFFER, 0) != old_checksum(dst, BUFFER, 0);
+    testprintf(mismatches == 0, "checksum() - Matches RFC 1071 loop");
+
+    /* Copy and checksum in one pass */
+    mismatches = 0;
+    for (int len = 0; len <= 300; len++){
+        memset(dst, 0, sizeof(dst));
+        uint16_t c = csum_fold(csum_partial_copy(dst + 1, src + 3, len, 0));
+        mismatches += c != old_checksum(src + 3, len, 0) || memcmp(dst + 1, src + 3, len) != 0 || dst[len + 1] != 0;
+    }
+    testprintf(mismatches == 0, "csum_partial_copy() - Copies and sums");
+
+    /* Chained partial sums over a header and a payload */
+    uint32_t sum = csum_partial(src + 20, 1460, 0);
+    sum = csum_partial(src, 20, sum);
+    testprintf(csum_fold(sum) == old_checksum(src, 1480, 0), "csum_partial() - Chained sums");
+
+    /* Pseudo header matches the old TCP checksum, even lengths and odd */
+    mismatches = 0;
+    uint32_t saddr = htonl(0x0A000002), daddr = htonl(0xC0A80001);
+    for (int len = 20; len <= 1480; len += 123){
+        uint32_t s = csum_pseudo(saddr, daddr, TCP_PROTO, len, csum_partial(src, len, 0));
+        mismatches += csum_fold(s) != old_tcp_checksum(saddr, daddr, (uint16_t*)src, len);
+    }
+    testprintf(mismatches == 0, "csum_pseudo() - Matches old TCP checksum");
+
+    /* transport_checksum() of a packet with its checksum filled in is zero */
+    memcpy(dst, src, 100);
+    dst[6] = dst[7] = 0;
+    uint16_t tc = csum_fold(csum_pseudo(saddr, daddr, 17, 100, csum_partial(dst, 100, 0)));
+    memcpy(&dst[6], &tc, 2);
+    testprintf(transport_checksum(ntohl(saddr), ntohl(daddr), 17, dst, htons(100)) == 0, "transport_checksum() - Verifies packet");
+
+    /* Incremental update after changing one word, like an ICMP echo reply */
+    mismatches = 0;
+    for (int i = 0; i < 1000; i++){
+        uint16_t* words = (uint16_t*) dst;
+        memcpy(dst, src + i, 64);
+        words[1] = 0;
+        words[1] = checksum(dst, 64, 0);
+        uint16_t old = words[0];
+        words[0] = rand();
+        uint16_t updated = csum_update16(words[1], old, words[0]);
+        words[1] = 0;
+        mismatches += updated != checksum(dst, 64, 0);
+    }
+    testprintf(mismatches == 0, "csum_update16() - Matches full recompute");
+
+    bench(20);
+    bench(576);
+    bench(1460);
+
+    return failed > 0 ? -1 : 0;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <gfx/damage.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define WIDTH 640
+#define HEIGHT 480
+
+static uint8_t covered[HEIGHT][WIDTH];
+
+/* Checks that the damage covers every marked pixel and that no pixel is covered twice. */
+static int damage_covers(struct gfx_damage* damage)
+{
+    static uint8_t hits[HEIGHT][WIDTH];
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) hits[y][x] = 0;
+
+    for (int i = 0; i < damage->count; i++){
+        struct gfx_rect* r = &damage->rects[i];
+        for (int y = r->y; y < r->y + r->height; y++)
+            for (int x = r->x; x < r->x + r->width; x++) hits[y][x]++;
+    }
+
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            if(hits[y][x] > 1 || (covered[y][x] && hits[y][x] == 0)) return 0;
+    return 1;
+}
+
+static void mark(struct gfx_rect r)
+{
+    struct gfx_rect screen = GFX_RECT(0, 0, WIDTH, HEIGHT);
+    r = gfx_rect_intersect(&r, &screen);
+    for (int y = r.y; y < r.y + r.height; y++)
+        for (int x = r.x; x < r.x + r.width; x++) covered[y][x] = 1;
+}
+
+int main(int argc, char const *argv[])
+{
+    struct gfx_damage damage;
+    gfx_damage_init(&damage, WIDTH, HEIGHT);
+
+    struct gfx_rect a = GFX_RECT(10, 10, 16, 16);
+    struct gfx_rect b = GFX_RECT(20, 20, 16, 16);
+    struct gfx_rect u = gfx_rect_union(&a, &b);
+    testprintf(u.x == 10 && u.y == 10 && u.width == 26 && u.height == 26, "gfx_rect_union() - Bounding rectangle");
+    struct gfx_rect in = gfx_rect_intersect(&a, &b);
+    testprintf(in.x == 20 && in.y == 20 && in.width == 6 && in.height == 6, "gfx_rect_intersect() - Overlapping part");
+    struct gfx_rect c = GFX_RECT(26, 10, 4, 4);
+    testprintf(!gfx_rect_overlaps(&a, &c), "gfx_rect_overlaps() - Touching edges do not overlap");
+
+    gfx_damage_add(&damage, a);
+    gfx_damage_add(&damage, GFX_RECT(100, 100, 16, 16));
+    testprintf(damage.count == 2, "gfx_damage_add() - Disjoint rectangles are kept apart");
+
+    gfx_damage_add(&damage, b);
+    testprintf(damage.count == 2 && gfx_damage_contains(&damage, &u), "gfx_damage_add() - Overlapping rectangles are merged");
+
+    gfx_damage_add(&damage, GFX_RECT(0, 0, 0, 10));
+    testprintf(damage.count == 2, "gfx_damage_add() - Empty rectangle is ignored");
+
+    gfx_damage_clear(&damage);
+    gfx_damage_add(&damage, GFX_RECT(WIDTH - 8, -4, 16, 16));
+    testprintf(damage.count == 1 && damage.rects[0].width == 8 && damage.rects[0].height == 12 && damage.rects[0].y == 0, "gfx_damage_add() - Clipped to the screen");
+    struct gfx_rect offscreen = GFX_RECT(WIDTH - 8, -4, 16, 16);
+    testprintf(gfx_damage_contains(&damage, &offscreen), "gfx_damage_contains() - Only on screen part counts");
+
+    /* Many scattered rectangles, like a cursor crossing the screen */
+    gfx_damage_clear(&damage);
+    srand(1);
+    for (int i = 0; i < 200; i++){
+        struct gfx_rect r = GFX_RECT(rand() % WIDTH - 8, rand() % HEIGHT - 8, 1 + rand() % 64, 1 + rand() % 64);
+        mark(r);
+        gfx_damage_add(&damage, r);
+    }
+    testprintf(damage.count <= GFX_DAMAGE_MAX, "gfx_damage_add() - List stays bounded");
+    testprintf(damage_covers(&damage), "gfx_damage_add() - Covers all damage without overlap");
+
+    gfx_damage_all(&damage);
+    struct gfx_rect screen = GFX_RECT(0, 0, WIDTH, HEIGHT);
+    testprintf(damage.count == 1 && gfx_damage_contains(&damage, &screen), "gfx_damage_all() - Whole screen");
+
+    return failed > 0 ? -1 : 0;
+}
@@ -88,5 +88,23 @@ int main(int argc, char const *argv[])
 
     // Test FAT16 File Creation
     testprintf(fat16_create_file("NEWFILE", "TXT", data, sizeof(data)) == 0, "fat16_create_file()");
-    return 0;
+
+    // Test FAT16 dirty sector write back
+    struct fat16_stats before, after;
+    char big[4*512] = {0};
+    fat16_sync_fat_table();
+    fat16_get_stats(&before);
+    testprintf(before.dirty == 0, "fat16_sync_fat_table() - No dirty sectors after sync");
+
+    testprintf(fat16_write_data(file_entry.first_cluster, 0, big, sizeof(big)) == sizeof(big), "fat16_write_data() - Multi cluster write");
+    fat16_get_stats(&after);
+    testprintf(after.fat_sectors_written == before.fat_sectors_written && after.dirty > 0, "fat16_write_data() - FAT updates are deferred");
+
+    int written = fat16_sync_fat_table();
+    fat16_get_stats(&after);
+    printf("fat16: %d byte write flushed %d of %d FAT sectors\n", (int)sizeof(big), written, after.fat_sectors);
+    testprintf(written > 0 && written <= 2 && after.dirty == 0, "fat16_sync_fat_table() - Only dirty sectors written");
+    testprintf(fat16_sync_fat_table() == 0, "fat16_sync_fat_table() - Clean table writes nothing");
+
+    return failed > 0 ? -1 : 0;
 }
\ No newline at end of file
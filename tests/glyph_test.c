@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfx/glyph.h>
+#include <font8.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define WIDTH 640
+#define HEIGHT 480
+#define ROUNDS 200
+
+static uint8_t screen[WIDTH * HEIGHT];
+static uint8_t expected[WIDTH * HEIGHT];
+
+/* The bit loop kernel_gfx_draw_char() and vesa_put_char() used before, with clipping. */
+static void old_char(struct gfx_rect* clip, int x, int y, unsigned char c, uint8_t color)
+{
+    for (int l = 0; l < 8; l++)
+        for (int i = 8; i >= 0; i--)
+            if(font8x8_basic[c][l] & (1 << i)){
+                if(x + i < clip->x || y + l < clip->y || x + i >= clip->x + clip->width || y + l >= clip->y + clip->height) continue;
+                expected[(y + l) * WIDTH + x + i] = color;
+            }
+}
+
+static void old_text(struct gfx_rect* clip, int x, int y, const char* str, int len, uint8_t fg, int bg)
+{
+    for (int i = 0; i < len; i++){
+        if(bg >= 0){
+            for (int l = 0; l < 8; l++)
+                for (int j = 0; j < 8; j++){
+                    int px = x + i * 8 + j, py = y + l;
+                    if(px < clip->x || py < clip->y || px >= clip->x + clip->width || py >= clip->y + clip->height) continue;
+                    expected[py * WIDTH + px] = bg;
+                }
+        }
+        old_char(clip, x + i * 8, y, str[i], fg);
+    }
+}
+
+static void random_text(char* str, int len)
+{
+    for (int i = 0; i < len; i++) str[i] = 32 + rand() % 95;
+}
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char const *argv[])
+{
+    struct gfx_rect clip = GFX_RECT(0, 0, WIDTH, HEIGHT);
+    char str[80];
+
+    srand(1);
+    for (int i = 0; i < WIDTH * HEIGHT; i++) screen[i] = expected[i] = rand();
+
+    /* Opaque text at random positions, partly off screen */
+    for (int i = 0; i < 200; i++){
+        int len = 1 + rand() % 80, x = rand() % WIDTH - 40, y = rand() % HEIGHT - 4;
+        uint8_t fg = rand(), bg = rand();
+        random_text(str, len);
+        old_text(&clip, x, y, str, len, fg, bg);
+        gfx_text_blit(screen, WIDTH, &clip, x, y, &gfx_font_basic, str, len, fg, bg);
+    }
+    testprintf(memcmp(screen, expected, sizeof(screen)) == 0, "gfx_text_blit() - Matches bit loop");
+
+    /* Transparent text, including the transparent window color */
+    for (int i = 0; i < 200; i++){
+        int len = 1 + rand() % 80, x = rand() % WIDTH - 40, y = rand() % HEIGHT - 4;
+        uint8_t fg = i % 2 ? 255 : rand();
+        random_text(str, len);
+        old_text(&clip, x, y, str, len, fg, -1);
+        gfx_text_blit_masked(screen, WIDTH, &clip, x, y, &gfx_font_basic, str, len, fg);
+    }
+    testprintf(memcmp(screen, expected, sizeof(screen)) == 0, "gfx_text_blit_masked() - Matches bit loop");
+
+    /* Clip rectangle inside a character */
+    struct gfx_rect small = GFX_RECT(13, 11, 5, 3);
+    memset(screen, 0, sizeof(screen));
+    memset(expected, 0, sizeof(expected));
+    old_text(&small, 8, 8, "AW#", 3, 15, 1);
+    gfx_text_blit(screen, WIDTH, &small, 8, 8, &gfx_font_basic, "AW#", 3, 15, 1);
+    testprintf(memcmp(screen, expected, sizeof(screen)) == 0, "gfx_text_blit() - Clipped inside characters");
+
+    /* Characters outside the font are blank */
+    gfx_text_blit(screen, WIDTH, &clip, 0, 100, &gfx_font_basic, "\xC8", 1, 15, 3);
+    testprintf(screen[100 * WIDTH] == 3 && screen[107 * WIDTH + 7] == 3, "gfx_text_blit() - Characters past the font are blank");
+
+    /* Cache hits and least recently used replacement */
+    struct gfx_glyph_stats before, after;
+    gfx_glyph_stats(&before);
+    for (int i = 0; i < 100; i++) gfx_text_blit(screen, WIDTH, &clip, 0, 0, &gfx_font_basic, "cached", 6, 15, 1);
+    gfx_glyph_stats(&after);
+    testprintf(after.misses - before.misses <= 1 && after.hits - before.hits >= 99, "gfx_text_blit() - Expanded font is reused");
+
+    gfx_glyph_stats(&before);
+    for (int c = 0; c < GFX_GLYPH_CACHE_SIZE; c++){
+        gfx_text_blit(screen, WIDTH, &clip, 0, 0, &gfx_font_basic, "a", 1, 15, 1);
+        gfx_text_blit(screen, WIDTH, &clip, 0, 0, &gfx_font_basic, "b", 1, 100 + c, 1);
+    }
+    gfx_glyph_stats(&after);
+    testprintf(after.misses - before.misses == GFX_GLYPH_CACHE_SIZE, "gfx_text_blit() - Recently used colors stay cached");
+
+    /* A terminal worth of text, 80x60 characters */
+    char lines[60][80];
+    for (int i = 0; i < 60; i++) random_text(lines[i], 80);
+
+    clock_t t = clock();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < 60; i++) old_text(&clip, 0, i * 8, lines[i], 80, 15, 1);
+    double old_time = seconds(t);
+
+    t = clock();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < 60; i++) gfx_text_blit(screen, WIDTH, &clip, 0, i * 8, &gfx_font_basic, lines[i], 80, 15, 1);
+    double new_time = seconds(t);
+
+    t = clock();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < 60; i++) gfx_text_blit_masked(screen, WIDTH, &clip, 0, i * 8, &gfx_font_basic, lines[i], 80, 15);
+    double masked_time = seconds(t);
+
+    printf("glyph: 80x60 characters, bit loop %.2fms, row blit %.2fms, masked %.2fms\n",
+        old_time * 1e3 / ROUNDS, new_time * 1e3 / ROUNDS, masked_time * 1e3 / ROUNDS);
+
+    return failed > 0 ? -1 : 0;
+}
@@ -32,8 +32,8 @@ void kfree(void* ptr);
 typedef unsigned int        uintptr_t;
 typedef int                 intptr_t;
 
-int write_block(char* buf, int block);
-int read_block(char* buf, int block);
+int write_block(void* buf, int block);
+int read_block(void* buf, int block);
 
 struct pcb {
 
@@ -0,0 +1,139 @@
+#include <errors.h>
+#include <lib/ipc_ring.h>
+#include <mocks.h>
+
+#define CAPACITY 64
+
+static uint32_t memory[IPC_RING_SIZE(CAPACITY+20)/4];
+static struct ipc_ring* ring = (struct ipc_ring*) memory;
+
+/* Stands in for the peer process, called from the mocked futex_wait() */
+static enum {
+    PEER_NONE,
+    PEER_READ,
+    PEER_WRITE
+} peer = PEER_NONE;
+
+static int waits = 0;
+static int wakes = 0;
+static volatile unsigned int* woken = NULL;
+
+int futex_wait(volatile unsigned int* addr, unsigned int expected, int timeout)
+{
+    waits++;
+    if(*addr != expected) return -ERROR_AGAIN;
+
+    uint8_t buf[8] = {0};
+    switch (peer){
+    case PEER_READ:
+        if(addr != &ring->tail || !ring->writer_waiting) return -ERROR_INVALID_ARGUMENTS;
+        ipc_ring_read(ring, buf, sizeof(buf));
+        return 0;
+    case PEER_WRITE:
+        if(addr != &ring->head || !ring->reader_waiting) return -ERROR_INVALID_ARGUMENTS;
+        ipc_ring_write(ring, buf, sizeof(buf));
+        return 0;
+    default:
+        return -ERROR_TIMEOUT;
+    }
+}
+
+int futex_wake(volatile unsigned int* addr)
+{
+    wakes++;
+    woken = addr;
+    return 0;
+}
+
+static void __fill(uint8_t* buf, int len, int seed)
+{
+    for (int i = 0; i < len; i++) buf[i] = (uint8_t)(seed + i * 7);
+}
+
+int main(int argc, char const *argv[])
+{
+    uint8_t in[CAPACITY*2];
+    uint8_t out[CAPACITY*2];
+    int len;
+
+    ipc_ring_init(ring, sizeof(memory));
+    testprintf(ring->size == CAPACITY && ipc_ring_used(ring) == 0 && ipc_ring_free(ring) == CAPACITY, "ipc_ring_init() - Capacity rounded down to a power of two");
+
+    /* Move the head and tail close to the end of the data */
+    __fill(in, 48, 1);
+    testprintf(ipc_ring_write(ring, in, 48) == 48 && ipc_ring_read(ring, out, 48) == 48 && memcmp(in, out, 48) == 0, "ipc_ring_write() - Read back what was written");
+
+    __fill(in, 40, 2);
+    testprintf(ipc_ring_write(ring, in, 40) == 40 && ipc_ring_used(ring) == 40, "ipc_ring_write() - Write wrapping around the end");
+    testprintf(ipc_ring_read(ring, out, 40) == 40 && memcmp(in, out, 40) == 0 && ipc_ring_used(ring) == 0, "ipc_ring_read() - Read wrapping around the end");
+
+    /* In place access only returns the contiguous part up to the end of the data */
+    uint8_t* to = (uint8_t*) ipc_ring_write_ptr(ring, &len);
+    testprintf(to == ipc_ring_data(ring) + 24 && len == CAPACITY - 24, "ipc_ring_write_ptr() - Contiguous space up to the end");
+    __fill(to, len, 3);
+    ipc_ring_produce(ring, len);
+
+    to = (uint8_t*) ipc_ring_write_ptr(ring, &len);
+    testprintf(to == ipc_ring_data(ring) && len == 24, "ipc_ring_write_ptr() - Continues at the start");
+    __fill(to, len, 4);
+    ipc_ring_produce(ring, len);
+
+    ipc_ring_write_ptr(ring, &len);
+    testprintf(len == 0 && ipc_ring_free(ring) == 0, "ipc_ring_write_ptr() - No space in a full ring");
+    testprintf(ipc_ring_write(ring, in, 1) == 0, "ipc_ring_write() - Nothing written to a full ring");
+
+    const uint8_t* from = (const uint8_t*) ipc_ring_read_ptr(ring, &len);
+    __fill(in, CAPACITY - 24, 3);
+    testprintf(from == ipc_ring_data(ring) + 24 && len == CAPACITY - 24 && memcmp(in, from, len) == 0, "ipc_ring_read_ptr() - Contiguous data up to the end");
+    ipc_ring_consume(ring, len);
+
+    from = (const uint8_t*) ipc_ring_read_ptr(ring, &len);
+    __fill(in, 24, 4);
+    testprintf(from == ipc_ring_data(ring) && len == 24 && memcmp(in, from, len) == 0, "ipc_ring_read_ptr() - Continues at the start");
+    ipc_ring_consume(ring, len);
+
+    ipc_ring_read_ptr(ring, &len);
+    testprintf(len == 0 && ipc_ring_read(ring, out, 1) == 0, "ipc_ring_read() - Nothing read from an empty ring");
+    testprintf(waits == 0 && wakes == 0, "ipc_ring_produce() - No system calls without a waiting peer");
+
+    /* Counters keep running past the 32 bit wrap */
+    ipc_ring_init(ring, sizeof(memory));
+    ring->head = ring->tail = 0xFFFFFFF0;
+    __fill(in, CAPACITY, 5);
+    testprintf(ipc_ring_write(ring, in, CAPACITY) == CAPACITY && ipc_ring_used(ring) == CAPACITY, "ipc_ring_write() - Counters wrapping around");
+    testprintf(ipc_ring_read(ring, out, CAPACITY) == CAPACITY && memcmp(in, out, CAPACITY) == 0, "ipc_ring_read() - Counters wrapping around");
+
+    /* Empty ring, the producer fills it while the consumer sleeps */
+    peer = PEER_WRITE;
+    testprintf(ipc_ring_wait_readable(ring, -1) == 0 && ipc_ring_used(ring) == 8, "ipc_ring_wait_readable() - Woken by the producer");
+    testprintf(waits == 1 && ring->reader_waiting == 0, "ipc_ring_wait_readable() - Sleeps once and clears the flag");
+    testprintf(ipc_ring_wait_readable(ring, -1) == 0 && waits == 1, "ipc_ring_wait_readable() - Does not sleep with data");
+
+    ring->reader_waiting = 1;
+    wakes = 0;
+    ipc_ring_produce(ring, 0);
+    testprintf(wakes == 1 && woken == &ring->head, "ipc_ring_produce() - Wakes a waiting consumer");
+    ring->reader_waiting = 0;
+
+    /* Full ring, the consumer drains it while the producer sleeps */
+    ipc_ring_write(ring, in, CAPACITY);
+    peer = PEER_READ;
+    waits = 0;
+    testprintf(ipc_ring_free(ring) == 0 && ipc_ring_wait_writable(ring, -1) == 0 && ipc_ring_free(ring) == 8, "ipc_ring_wait_writable() - Woken by the consumer");
+    testprintf(waits == 1 && ring->writer_waiting == 0, "ipc_ring_wait_writable() - Sleeps once and clears the flag");
+
+    ring->writer_waiting = 1;
+    wakes = 0;
+    ipc_ring_consume(ring, 0);
+    testprintf(wakes == 1 && woken == &ring->tail, "ipc_ring_consume() - Wakes a waiting producer");
+    ring->writer_waiting = 0;
+
+    /* Nobody on the other side */
+    peer = PEER_NONE;
+    ipc_ring_write(ring, in, 8);
+    testprintf(ipc_ring_wait_writable(ring, 10) == -ERROR_TIMEOUT && ring->writer_waiting == 0, "ipc_ring_wait_writable() - Times out on a full ring");
+    ipc_ring_read(ring, out, CAPACITY);
+    testprintf(ipc_ring_wait_readable(ring, 10) == -ERROR_TIMEOUT && ring->reader_waiting == 0, "ipc_ring_wait_readable() - Times out on an empty ring");
+
+    return failed > 0 ? -1 : 0;
+}
@@ -1,9 +1,106 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vmem_heap.h>
 #include <mocks.h>
 
+FILE* filesystem = NULL;
+
+#define HEAP_START 0xE0000000
+#define HEAP_SIZE  0x400000
+#define LIVE 4096
+
+/* Walks the tree checking order, AVL balance and the cached max free size. */
+static int __check(struct vmem_extent* node, uintptr_t* last, int* height)
+{
+    if(node == NULL){
+        *height = 0;
+        return 0;
+    }
+
+    int lh, rh;
+    if(__check(node->left, last, &lh) < 0) return -1;
+    if(node->start < *last) return -1;
+    *last = node->start + node->size;
+    if(__check(node->right, last, &rh) < 0) return -1;
+
+    if(lh - rh > 1 || rh - lh > 1) return -1;
+    *height = (lh > rh ? lh : rh) + 1;
+    if(node->height != *height) return -1;
+
+    int best = node->free ? node->size : 0;
+    if(node->left && node->left->max_free > best) best = node->left->max_free;
+    if(node->right && node->right->max_free > best) best = node->right->max_free;
+    return node->max_free == best ? 0 : -1;
+}
+
+static int check_heap(struct vmem_heap* heap)
+{
+    uintptr_t last = 0;
+    int height;
+    return __check(heap->root, &last, &height) == 0 && last <= heap->start + heap->size;
+}
+
 int main()
 {
-    testprintf(0 == 0, "Template test!");
+    struct vmem_heap heap;
+    vmem_heap_init(&heap, HEAP_START, HEAP_SIZE);
+
+    uintptr_t a = vmem_heap_alloc(&heap, 100);
+    uintptr_t b = vmem_heap_alloc(&heap, 200);
+    uintptr_t c = vmem_heap_alloc(&heap, 300);
+    testprintf(a == HEAP_START && b == a + 100 && c == b + 200, "vmem_heap_alloc() - First allocations are packed");
+    testprintf(vmem_heap_alloc(&heap, 5) == c + 300 && heap.used == 608, "vmem_heap_alloc() - Sizes are pointer aligned");
+    testprintf(vmem_heap_size(&heap, b) == 200, "vmem_heap_size() - Size of allocation");
+
+    testprintf(vmem_heap_free(&heap, b) == 200, "vmem_heap_free() - Free allocation");
+    testprintf(vmem_heap_free(&heap, b) < 0, "vmem_heap_free() - Double free is rejected");
+    testprintf(vmem_heap_free(&heap, b + 4) < 0, "vmem_heap_free() - Unknown address is rejected");
+
+    testprintf(vmem_heap_alloc(&heap, 64) == b, "vmem_heap_alloc() - Reuses freed hole first fit");
+    testprintf(vmem_heap_alloc(&heap, 400) != b + 64, "vmem_heap_alloc() - Skips hole that is too small");
+
+    /* Freeing everything coalesces back into a single extent */
+    vmem_heap_destroy(&heap);
+    uintptr_t ptrs[LIVE];
+    for (int i = 0; i < 64; i++) ptrs[i] = vmem_heap_alloc(&heap, 64);
+    for (int i = 0; i < 64; i += 2) vmem_heap_free(&heap, ptrs[i]);
+    for (int i = 1; i < 64; i += 2) vmem_heap_free(&heap, ptrs[i]);
+    testprintf(heap.root != NULL && heap.root->left == NULL && heap.root->right == NULL && heap.root->size == HEAP_SIZE, "vmem_heap_free() - Coalesces into one extent");
+    testprintf(vmem_heap_alloc(&heap, HEAP_SIZE) == HEAP_START && vmem_heap_alloc(&heap, 4) == 0, "vmem_heap_alloc() - Whole heap and out of space");
+    vmem_heap_destroy(&heap);
+
+    /* Random workload, checking the tree invariants as we go */
+    srand(1);
+    int ok = 1;
+    for (int i = 0; i < LIVE; i++) ptrs[i] = 0;
+    for (int r = 0; r < 20000; r++){
+        int i = rand() % LIVE;
+        if(ptrs[i]){
+            if(vmem_heap_free(&heap, ptrs[i]) < 0) ok = 0;
+            ptrs[i] = 0;
+        } else {
+            ptrs[i] = vmem_heap_alloc(&heap, 1 + rand() % 512);
+        }
+        if(r % 1000 == 0 && !check_heap(&heap)) ok = 0;
+    }
+    testprintf(ok && check_heap(&heap), "vmem_heap - Tree stays ordered and balanced");
+
+    /* Time alloc/free with thousands of live allocations */
+    clock_t t = clock();
+    for (int r = 0; r < 200000; r++){
+        int i = rand() % LIVE;
+        if(ptrs[i]){
+            vmem_heap_free(&heap, ptrs[i]);
+            ptrs[i] = 0;
+        } else {
+            ptrs[i] = vmem_heap_alloc(&heap, 1 + rand() % 512);
+        }
+    }
+    printf("vmem_heap: 200000 operations with %d live allocations in %.3fs\n", heap.allocations, (double)(clock() - t) / CLOCKS_PER_SEC);
+    testprintf(check_heap(&heap), "vmem_heap - Tree valid after benchmark");
+
+    vmem_heap_destroy(&heap);
 
     return failed > 0 ? -1 : 0;
-}
\ No newline at end of file
+}
@@ -34,5 +34,26 @@ int main(int argc, char const *argv[])
     testprintf(peeked_pcb == NULL, "__pcb_queue_remove() - Remove PCB from Queue");    
     printf("%p\n", peeked_pcb);
 
+    // Test push keeps FIFO order through the tail pointer
+    struct pcb pcbs[3] = {0};
+    for (int i = 0; i < 3; i++){
+        new_queue->ops->push(new_queue, &pcbs[i]);
+    }
+    testprintf(new_queue->total == 3, "__pcb_queue_push() - Total count");
+    testprintf(new_queue->_tail == &pcbs[2], "__pcb_queue_push() - Tail pointer");
+
+    // Test remove from the middle and from the tail
+    new_queue->ops->remove(new_queue, &pcbs[1]);
+    testprintf(pcbs[0].next == &pcbs[2] && pcbs[2].prev == &pcbs[0], "__pcb_queue_remove() - Remove middle PCB");
+    new_queue->ops->remove(new_queue, &pcbs[2]);
+    testprintf(new_queue->_tail == &pcbs[0] && new_queue->total == 1, "__pcb_queue_remove() - Remove tail PCB");
+
+    // Removing a PCB that is not in the queue is a no-op
+    new_queue->ops->remove(new_queue, &pcbs[1]);
+    testprintf(new_queue->total == 1, "__pcb_queue_remove() - Remove PCB not in queue");
+
+    popped_pcb = new_queue->ops->pop(new_queue);
+    testprintf(popped_pcb == &pcbs[0] && new_queue->_list == NULL && new_queue->_tail == NULL, "__pcb_queue_pop() - Pop last PCB");
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <net/sockhash.h>
+#include <mocks.h>
+
+FILE* filesystem = NULL;
+
+#define MAX_SOCKETS 1024
+#define LOOKUPS 2000000
+#define ORDER 4096
+
+/* Stand in for struct sock, the table only stores the pointer. */
+static struct fake_sock {
+    uint16_t lport;
+    uint16_t rport;
+    uint32_t ip;
+    struct sock_hash_node node;
+} socks[MAX_SOCKETS];
+
+static struct sock_hash hash;
+/* Lookup order is generated up front to keep rand() out of the timing */
+static int order[ORDER];
+
+/* Same walk as the old net_sock_find_tcp(), for comparison. */
+static struct fake_sock* linear_find(int count, uint16_t lport, uint16_t rport, uint32_t ip)
+{
+    for (int i = 0; i < count; i++){
+        if(socks[i].lport == lport && socks[i].rport == rport && socks[i].ip == ip) return &socks[i];
+    }
+    return NULL;
+}
+
+static void bench(int count)
+{
+    volatile int found = 0;
+    srand(count);
+    for (int i = 0; i < ORDER; i++) order[i] = rand() % count;
+
+    clock_t t = clock();
+    for (int i = 0; i < LOOKUPS; i++){
+        struct fake_sock* s = &socks[order[i % ORDER]];
+        found += sock_hash_find_conn(&hash, s->lport, s->rport, s->ip) == (struct sock*)s;
+    }
+    double hashed = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int i = 0; i < LOOKUPS; i++){
+        struct fake_sock* s = &socks[order[i % ORDER]];
+        found += linear_find(count, s->lport, s->rport, s->ip) == s;
+    }
+    double linear = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+    printf("sockhash: %4d sockets, %.1fns per hashed lookup, %.1fns per linear lookup\n",
+        count, hashed * 1e9 / LOOKUPS, linear * 1e9 / LOOKUPS);
+    testprintf(found == 2 * LOOKUPS, "sock_hash_find_conn() - Benchmark lookups all hit");
+}
+
+int main(int argc, char const *argv[])
+{
+    struct sock* a = (struct sock*) &socks[0];
+    struct sock* b = (struct sock*) &socks[1];
+
+    sock_hash_add_conn(&hash, &socks[0].node, a, 80, 50000, 0x0A000001);
+    sock_hash_add_conn(&hash, &socks[1].node, b, 80, 50001, 0x0A000001);
+    testprintf(sock_hash_find_conn(&hash, 80, 50000, 0x0A000001) == a, "sock_hash_find_conn() - Finds connection");
+    testprintf(sock_hash_find_conn(&hash, 80, 50001, 0x0A000001) == b, "sock_hash_find_conn() - Tuples are distinct");
+    testprintf(sock_hash_find_conn(&hash, 80, 50000, 0x0A000002) == NULL, "sock_hash_find_conn() - Other address misses");
+
+    sock_hash_remove(&socks[0].node);
+    testprintf(sock_hash_find_conn(&hash, 80, 50000, 0x0A000001) == NULL, "sock_hash_remove() - Connection removed");
+    testprintf(sock_hash_find_conn(&hash, 80, 50001, 0x0A000001) == b, "sock_hash_remove() - Others stay hashed");
+    sock_hash_remove(&socks[0].node);
+    testprintf(socks[0].node.pprev == NULL, "sock_hash_remove() - Removing twice is harmless");
+
+    /* Moving a socket between tables, like listen after bind. */
+    sock_hash_add_listen(&hash, &socks[1].node, b, 80);
+    testprintf(sock_hash_find_listen(&hash, 80) == b && sock_hash_find_conn(&hash, 80, 50001, 0x0A000001) == NULL, "sock_hash_add_listen() - Rehashing moves the socket");
+    sock_hash_remove(&socks[1].node);
+
+    sock_hash_add_udp(&hash, &socks[2].node, (struct sock*) &socks[2], 53, 1);
+    testprintf(sock_hash_find_udp(&hash, 53, 0x0A000001) == (struct sock*) &socks[2], "sock_hash_find_udp() - Wildcard address matches");
+    testprintf(sock_hash_find_udp(&hash, 54, 0x0A000001) == NULL, "sock_hash_find_udp() - Other port misses");
+    sock_hash_remove(&socks[2].node);
+
+    /* Lookup cost as the number of connections grows */
+    int hashed = 0;
+    for (int count = 16; count <= MAX_SOCKETS; count *= 4){
+        for (; hashed < count; hashed++){
+            struct fake_sock* s = &socks[hashed];
+            s->lport = 80;
+            s->rport = 49152 + hashed;
+            s->ip = 0x0A000000 + (hashed % 7);
+            sock_hash_add_conn(&hash, &s->node, (struct sock*) s, s->lport, s->rport, s->ip);
+        }
+        bench(count);
+    }
+
+    return failed > 0 ? -1 : 0;
+}
@@ -109,6 +109,38 @@ void release(mutex_t* l)
 
 }
 
+/* Slab caches are backed by malloc in the tests. */
+struct kmem_cache {
+    int size;
+};
+
+struct kmem_cache* kmem_cache_create(char* name, int size)
+{
+    struct kmem_cache* cache = malloc(sizeof(struct kmem_cache));
+    cache->size = size;
+    return cache;
+}
+
+void* kmem_cache_alloc(struct kmem_cache* cache)
+{
+    return malloc(cache->size);
+}
+
+void* kmem_cache_alloc_atomic(struct kmem_cache* cache)
+{
+    return malloc(cache->size);
+}
+
+int kmem_cache_reserve(struct kmem_cache* cache, int count)
+{
+    return 0;
+}
+
+void kmem_cache_free(struct kmem_cache* cache, void* obj)
+{
+    free(obj);
+}
+
 int disk_size()
 {
     return DISKSIZE;
@@ -172,7 +204,7 @@ int kcalloc(int size){
 #ifdef __FS_TEST
 extern FILE* filesystem;
 /* Functions simulating the disk device read / write functions. */
-int read_block(char* buf, int block)
+int read_block(void* buf, int block)
 {
     fseek(filesystem, block*512, SEEK_SET);
     int ret = fread(buf, 1, 512, filesystem);
@@ -181,14 +213,14 @@ int read_block(char* buf, int block)
     return 1;
 }
 
-int write_block(char* buf, int block)
+int write_block(void* buf, int block)
 {
     fseek(filesystem, block*512, SEEK_SET);
     fwrite(buf, 1, 512, filesystem);
     return 1;
 }
 
-int write_block_offset(char* usr_buf, int size, int offset, int block)
+int write_block_offset(void* usr_buf, int size, int offset, int block)
 {
     char buf[512];
     read_block(buf, block);
@@ -197,7 +229,12 @@ int write_block_offset(char* usr_buf, int size, int offset, int block)
     return write_block(buf, block);
 }
 
-int read_block_offset(char* usr_buf, int size, int offset, int block)
+int read_block_ahead(int block, int count)
+{
+    return 0;
+}
+
+int read_block_offset(void* usr_buf, int size, int offset, int block)
 {
     char buf[512];
     read_block((char*)buf, block);